@@ -0,0 +1,286 @@
+#include "BmpDecoder.h"
+
+#include "ImagePixelExpansion.h"
+
+
+namespace
+{
+	constexpr int64 BmpFileHeaderSize = 14;
+	constexpr uint32 BmpCoreHeaderSize = 12;
+	constexpr uint32 BmpInfoHeaderSize = 40;
+
+	/** Offset of the red, green, blue and alpha masks, in the V2+ headers or right after the 40 byte one */
+	constexpr int64 BmpMasksOffset = BmpFileHeaderSize + BmpInfoHeaderSize;
+
+	enum EBmpCompression : uint32
+	{
+		BmpRGB = 0,
+		BmpBitfields = 3,
+		BmpAlphaBitfields = 6,
+	};
+
+	uint16 ReadUint16(const uint8* Data)
+	{
+		return uint16(Data[0]) | (uint16(Data[1]) << 8);
+	}
+
+	uint32 ReadUint32(const uint8* Data)
+	{
+		return uint32(Data[0]) | (uint32(Data[1]) << 8) | (uint32(Data[2]) << 16) | (uint32(Data[3]) << 24);
+	}
+}
+
+FBmpDecoder::FBmpDecoder(const uint8* InBuffer, int64 InLength)
+	: Buffer(InBuffer)
+	, Length(InLength)
+{
+}
+
+bool FBmpDecoder::ReadHeader()
+{
+	if (bHeaderRead || Length < BmpFileHeaderSize + 4 || Buffer[0] != 'B' || Buffer[1] != 'M')
+	{
+		return bHeaderRead;
+	}
+
+	PixelOffset = ReadUint32(Buffer + 10);
+	const uint32 HeaderSize = ReadUint32(Buffer + BmpFileHeaderSize);
+	if (Length < BmpFileHeaderSize + HeaderSize)
+	{
+		return false;
+	}
+
+	const uint8* Header = Buffer + BmpFileHeaderSize;
+	uint32 Compression = BmpRGB;
+	uint32 NumColors = 0;
+	int32 PaletteEntrySize = 4;
+	int64 PaletteOffset = BmpFileHeaderSize + HeaderSize;
+	int64 SignedHeight = 0;
+
+	if (HeaderSize == BmpCoreHeaderSize)
+	{
+		Width = ReadUint16(Header + 4);
+		SignedHeight = ReadUint16(Header + 6);
+		BitCount = ReadUint16(Header + 10);
+		PaletteEntrySize = 3;
+	}
+	else if (HeaderSize >= BmpInfoHeaderSize)
+	{
+		Width = int32(ReadUint32(Header + 4));
+		SignedHeight = int32(ReadUint32(Header + 8));
+		BitCount = ReadUint16(Header + 14);
+		Compression = ReadUint32(Header + 16);
+		NumColors = ReadUint32(Header + 32);
+
+		// The 40 byte header has the masks appended, later versions have them inside
+		const bool bHasRGBMasks = Compression == BmpBitfields || Compression == BmpAlphaBitfields;
+		const bool bHasAlphaMask = Compression == BmpAlphaBitfields || (bHasRGBMasks && HeaderSize >= 56);
+		if (HeaderSize == BmpInfoHeaderSize && bHasRGBMasks)
+		{
+			PaletteOffset += Compression == BmpAlphaBitfields ? 16 : 12;
+		}
+
+		if (bHasRGBMasks)
+		{
+			if (Length < BmpMasksOffset + (bHasAlphaMask ? 16 : 12))
+			{
+				return false;
+			}
+			for (int32 Channel = 0; Channel < (bHasAlphaMask ? 4 : 3); ++Channel)
+			{
+				Masks[Channel] = ReadUint32(Buffer + BmpMasksOffset + Channel * 4);
+			}
+		}
+	}
+	else
+	{
+		return false;
+	}
+
+	// RLE images are left to the image wrapper
+	if (Width <= 0 || SignedHeight == 0 || SignedHeight == MIN_int32
+		|| (Compression != BmpRGB && Compression != BmpBitfields && Compression != BmpAlphaBitfields))
+	{
+		return false;
+	}
+
+	bTopDown = SignedHeight < 0;
+	Height = int32(FMath::Abs(SignedHeight));
+
+	if (BitCount == 1 || BitCount == 4 || BitCount == 8)
+	{
+		if (Compression != BmpRGB)
+		{
+			return false;
+		}
+
+		NumColors = NumColors == 0 ? (1u << BitCount) : FMath::Min<uint32>(NumColors, 256);
+		if (PaletteOffset + (int64)NumColors * PaletteEntrySize > Length)
+		{
+			return false;
+		}
+
+		// Indices beyond the palette are opaque black
+		for (uint32& Entry : Palette)
+		{
+			Entry = 0xff000000u;
+		}
+
+		const uint8* PaletteData = Buffer + PaletteOffset;
+		if (PaletteEntrySize == 3)
+		{
+			ExpandBGR8ToBGRA8(PaletteData, Palette, NumColors);
+		}
+		else
+		{
+			// The fourth byte is reserved, palettes are always opaque
+			for (uint32 Index = 0; Index < NumColors; ++Index)
+			{
+				Palette[Index] = ReadUint32(PaletteData + Index * 4) | 0xff000000u;
+			}
+		}
+		Layout = ERowLayout::Indexed;
+	}
+	else if (BitCount == 16)
+	{
+		const bool bDefault555 = Compression == BmpRGB || (Masks[0] == 0x7c00 && Masks[1] == 0x03e0 && Masks[2] == 0x001f && Masks[3] == 0);
+		Layout = bDefault555 ? ERowLayout::BGR555 : ERowLayout::Bitfields;
+	}
+	else if (BitCount == 24 && Compression == BmpRGB)
+	{
+		Layout = ERowLayout::BGR24;
+	}
+	else if (BitCount == 32)
+	{
+		const bool bStandardColorMasks = Masks[0] == 0x00ff0000 && Masks[1] == 0x0000ff00 && Masks[2] == 0x000000ff;
+		if (Compression == BmpRGB || (bStandardColorMasks && Masks[3] == 0))
+		{
+			// The fourth byte of BI_RGB pixels is unused, it isn't alpha
+			Masks[3] = 0;
+			Layout = ERowLayout::BGRX32;
+		}
+		else
+		{
+			Layout = bStandardColorMasks && Masks[3] == 0xff000000u ? ERowLayout::BGRA32 : ERowLayout::Bitfields;
+		}
+	}
+	else
+	{
+		return false;
+	}
+
+	// The last row may come without its padding. Rows or row counts beyond the file size are rejected first
+	// so the size of all rows can't overflow.
+	Stride = ((int64)Width * BitCount + 31) / 32 * 4;
+	if (Stride > Length || Height > Length || PixelOffset >= Length
+		|| PixelOffset + Stride * (Height - 1) + ((int64)Width * BitCount + 7) / 8 > Length)
+	{
+		return false;
+	}
+
+	bHeaderRead = true;
+	return true;
+}
+
+bool FBmpDecoder::Decode(uint8* Dest, int64 DestSize)
+{
+	if (!bHeaderRead || DestSize < (int64)Width * Height * 4)
+	{
+		return false;
+	}
+
+	ParallelForRowBands(Width, Height, [this, Dest](int32 StartY, int32 EndY)
+	{
+		TArray<uint8> IndexScratch;
+		if (BitCount < 8)
+		{
+			IndexScratch.SetNumUninitialized(Width);
+		}
+
+		for (int32 Y = StartY; Y < EndY; ++Y)
+		{
+			const uint8* Src = Buffer + PixelOffset + (bTopDown ? Y : Height - 1 - Y) * Stride;
+			ConvertRow(Src, reinterpret_cast<uint32*>(Dest) + (int64)Y * Width, IndexScratch.GetData());
+		}
+	});
+	return true;
+}
+
+void FBmpDecoder::ConvertRow(const uint8* Src, uint32* Dest, uint8* IndexScratch) const
+{
+	switch (Layout)
+	{
+	case ERowLayout::Indexed:
+		if (BitCount == 8)
+		{
+			ExpandPaletteIndices(Src, Palette, Dest, Width);
+		}
+		else
+		{
+			// Leftmost pixel in the high bits
+			const int32 PixelsPerByte = 8 / BitCount;
+			const uint8 IndexMask = uint8((1 << BitCount) - 1);
+			for (int32 X = 0; X < Width; ++X)
+			{
+				const int32 Shift = 8 - BitCount * (X % PixelsPerByte + 1);
+				IndexScratch[X] = (Src[X / PixelsPerByte] >> Shift) & IndexMask;
+			}
+			ExpandPaletteIndices(IndexScratch, Palette, Dest, Width);
+		}
+		break;
+
+	case ERowLayout::BGR555:
+		ExpandBGR555ToBGRA8(Src, Dest, Width);
+		break;
+
+	case ERowLayout::BGR24:
+		ExpandBGR8ToBGRA8(Src, Dest, Width);
+		break;
+
+	case ERowLayout::BGRX32:
+		// Rows are only 4 byte aligned relative to the pixel offset, copy first and set alpha in place
+		FMemory::Memcpy(Dest, Src, (int64)Width * 4);
+		for (int32 X = 0; X < Width; ++X)
+		{
+			Dest[X] |= 0xff000000u;
+		}
+		break;
+
+	case ERowLayout::BGRA32:
+		FMemory::Memcpy(Dest, Src, (int64)Width * 4);
+		break;
+
+	case ERowLayout::Bitfields:
+		ConvertBitfieldsRow(Src, Dest);
+		break;
+	}
+}
+
+void FBmpDecoder::ConvertBitfieldsRow(const uint8* Src, uint32* Dest) const
+{
+	int32 Shifts[4];
+	uint32 MaxValues[4];
+	for (int32 Channel = 0; Channel < 4; ++Channel)
+	{
+		Shifts[Channel] = Masks[Channel] ? FMath::CountTrailingZeros(Masks[Channel]) : 0;
+		MaxValues[Channel] = Masks[Channel] >> Shifts[Channel];
+	}
+
+	const int32 BytesPerPixel = BitCount / 8;
+	for (int32 X = 0; X < Width; ++X)
+	{
+		const uint32 Value = BytesPerPixel == 2 ? ReadUint16(Src + X * 2) : ReadUint32(Src + X * 4);
+
+		// Channels without a mask are black, or opaque for alpha
+		uint8 Channels[4] = { 0, 0, 0, 255 };
+		for (int32 Channel = 0; Channel < 4; ++Channel)
+		{
+			if (MaxValues[Channel])
+			{
+				const uint64 ChannelValue = (Value & Masks[Channel]) >> Shifts[Channel];
+				Channels[Channel] = uint8((ChannelValue * 255 + MaxValues[Channel] / 2) / MaxValues[Channel]);
+			}
+		}
+		Dest[X] = FColor(Channels[0], Channels[1], Channels[2], Channels[3]).DWColor();
+	}
+}
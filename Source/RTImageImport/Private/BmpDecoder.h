@@ -0,0 +1,60 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/Texture.h"
+
+/**
+ * Decodes uncompressed and bitfield BMPs (1, 4, 8 bit palettized, 16, 24 and 32 bit) to BGRA8 straight into
+ * a destination owned by the caller. Rows are independent and converted in parallel bands, the header is
+ * checked so that no row can reach past the file data. RLE compressed BMPs aren't handled.
+ */
+class FBmpDecoder
+{
+public:
+	FBmpDecoder(const uint8* InBuffer, int64 InLength);
+
+	/** Parses the file and info headers, fails for compressions and bit depths this decoder doesn't handle */
+	bool ReadHeader();
+
+	int32 GetWidth() const { return Width; }
+	int32 GetHeight() const { return Height; }
+
+	/** Always TSF_BGRA8, palettes and bitfields are expanded */
+	ETextureSourceFormat GetTextureFormat() const { return TSF_BGRA8; }
+
+	/** Decodes into Dest as tightly packed top down BGRA8 rows, Dest has to hold Width x Height pixels */
+	bool Decode(uint8* Dest, int64 DestSize);
+
+private:
+	enum class ERowLayout : uint8
+	{
+		Indexed,
+		BGR555,
+		BGR24,
+		BGRX32,
+		BGRA32,
+		/** Arbitrary channel masks on 16 or 32 bit pixels */
+		Bitfields,
+	};
+
+	/** IndexScratch holds Width bytes, 1 and 4 bit indices are unpacked into it */
+	void ConvertRow(const uint8* Src, uint32* Dest, uint8* IndexScratch) const;
+
+	void ConvertBitfieldsRow(const uint8* Src, uint32* Dest) const;
+
+	const uint8* Buffer;
+	int64 Length;
+	int64 PixelOffset = 0;
+	int64 Stride = 0;
+
+	int32 Width = 0;
+	int32 Height = 0;
+	int32 BitCount = 0;
+	bool bTopDown = false;
+	bool bHeaderRead = false;
+	ERowLayout Layout = ERowLayout::Indexed;
+
+	/** Red, green, blue and alpha masks of bitfield images */
+	uint32 Masks[4] = {};
+	uint32 Palette[256];
+};
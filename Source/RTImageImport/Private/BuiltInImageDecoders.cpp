@@ -0,0 +1,855 @@
+#include "BuiltInImageDecoders.h"
+
+#include "BmpDecoder.h"
+#include "DdsDecoder.h"
+#include "ImageDecoderRegistry.h"
+#include "ImageFillZeroAlpha.h"
+#include "ImageFormatConversion.h"
+#include "ImageImporter.h"
+#include "ImageRowDownsampler.h"
+#include "ImageScratchBufferPool.h"
+#include "JpegRowDecoder.h"
+#include "PcxDecoder.h"
+#include "PngRowDecoder.h"
+#include "TgaDecoder.h"
+#include "TiffDecoder.h"
+#include "IImageWrapper.h"
+#include "IImageWrapperModule.h"
+
+
+static TAutoConsoleVariable<bool> CVarStreamingPNGDecode(
+	TEXT("RTImageImport.StreamingPNGDecode"),
+	true,
+	TEXT("Decode PNGs row by row straight from the file data instead of through IImageWrapper::GetRaw."));
+
+namespace
+{
+	/** Loaded on the game thread when the decoders are registered, decoders only create wrappers with it */
+	IImageWrapperModule* ImageWrapperModule = nullptr;
+
+	constexpr bool bAllowNonPowerOfTwo = true;
+
+	/** Wrappers hold a copy of the last file and its pixels, only those of small files stay pooled */
+	constexpr int64 MaxPooledImageWrapperFileSize = 1024 * 1024;
+
+	/**
+	 * Checks for images decoded at full size, ImportImage scales them down afterwards when they are over the limits.
+	 * bCanDownsample is false for images that keep their stored layout, like DDS mip chains.
+	 */
+	bool IsFullSizeImportValid(UImageImporter& Importer, int32 Width, int32 Height, ETextureSourceFormat Format, bool bCanDownsample = true)
+	{
+		return Importer.CheckFullSizeImportLimits(Width, Height, Format, bCanDownsample) && Importer.IsImportResolutionValid(Width, Height, bAllowNonPowerOfTwo);
+	}
+
+	/**
+	 * Decodes mip 0 of an image at full size with a native decoder that has read its header, into the target or
+	 * RawData. The rest of the chain is left for GenerateMips. Decoder.Decode takes the destination, its size and
+	 * ExtraArgs. Settings like CompressionSettings can be set on OutImage before, they are kept.
+	 */
+	template <typename DecoderType, typename... ExtraArgTypes>
+	bool DecodeFullSizeImage(UImageImporter& Importer, DecoderType& Decoder, bool bSRGB, FImportedImageStruct& OutImage, FImageDecodeTarget* Target, ExtraArgTypes... ExtraArgs)
+	{
+		if (!IsFullSizeImportValid(Importer, Decoder.GetWidth(), Decoder.GetHeight(), Decoder.GetTextureFormat()))
+		{
+			return false;
+		}
+
+		OutImage.Init2DWithParams(Decoder.GetWidth(), Decoder.GetHeight(), Decoder.GetTextureFormat(), bSRGB);
+		Importer.AllocateDecodedMips(OutImage, Target);
+		return Decoder.Decode(static_cast<uint8*>(OutImage.GetMipData(0)), OutImage.GetMipSize(0), ExtraArgs...);
+	}
+
+	/** Header info from a native decoder's header reader */
+	template<typename HeaderReaderType>
+	bool ReadNativeHeaderInfo(const uint8* Buffer, int64 Length, bool bScalesWhileDecoding, FImageHeaderInfo& OutInfo)
+	{
+		HeaderReaderType Reader(Buffer, Length);
+		if (!Reader.ReadHeader())
+		{
+			return false;
+		}
+
+		OutInfo.Width = Reader.GetWidth();
+		OutInfo.Height = Reader.GetHeight();
+		OutInfo.Format = Reader.GetTextureFormat();
+		OutInfo.bScalesWhileDecoding = bScalesWhileDecoding;
+		return true;
+	}
+
+	bool HasMagic(const uint8* Buffer, int64 Length, std::initializer_list<uint8> Magic)
+	{
+		return Length >= (int64)Magic.size() && FMemory::Memcmp(Buffer, Magic.begin(), Magic.size()) == 0;
+	}
+
+	/** Decoder that falls back to, or only uses, an IImageWrapper kept for the next file */
+	class FImageWrapperDecoder : public IImageDecoder
+	{
+	public:
+		explicit FImageWrapperDecoder(EImageFormat InWrapperFormat)
+			: WrapperFormat(InWrapperFormat)
+		{
+		}
+
+		virtual bool Decode(UImageImporter& Importer, const uint8* Buffer, int64 Length, FImportedImageStruct& OutImage, FImageDecodeTarget* Target) override final
+		{
+			const bool bDecoded = DecodeFile(Importer, Buffer, Length, OutImage, Target);
+			ReleaseLargeWrapper(Length);
+			return bDecoded;
+		}
+
+	protected:
+		virtual bool DecodeFile(UImageImporter& Importer, const uint8* Buffer, int64 Length, FImportedImageStruct& OutImage, FImageDecodeTarget* Target) = 0;
+
+		/** The pooled wrapper holding the file, null when there is no wrapper for the format or it can't read the file */
+		IImageWrapper* SetCompressed(const uint8* Buffer, int64 Length)
+		{
+			if (!ImageWrapper.IsValid())
+			{
+				ImageWrapper = ImageWrapperModule->CreateImageWrapper(WrapperFormat);
+			}
+			return ImageWrapper.IsValid() && ImageWrapper->SetCompressed(Buffer, Length) ? ImageWrapper.Get() : nullptr;
+		}
+
+		/** Drops the wrapper once it has held a large file */
+		void ReleaseLargeWrapper(int64 Length)
+		{
+			if (Length > MaxPooledImageWrapperFileSize)
+			{
+				ImageWrapper.Reset();
+			}
+		}
+
+	private:
+		EImageFormat WrapperFormat;
+		TSharedPtr<IImageWrapper> ImageWrapper;
+	};
+
+	class FPngImageDecoder : public FImageWrapperDecoder
+	{
+	public:
+		FPngImageDecoder() : FImageWrapperDecoder(EImageFormat::PNG) {}
+
+		virtual const TCHAR* GetName() const override { return TEXT("PNG"); }
+
+		virtual bool CanDecode(const uint8* Buffer, int64 Length) const override
+		{
+			return HasMagic(Buffer, Length, { 0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A });
+		}
+
+		virtual bool ReadHeaderInfo(const uint8* Buffer, int64 Length, FImageHeaderInfo& OutInfo) override
+		{
+			FPngRowDecoder PngDecoder(Buffer, Length);
+			if (!PngDecoder.ReadHeader())
+			{
+				return false;
+			}
+
+			OutInfo.Width = PngDecoder.GetWidth();
+			OutInfo.Height = PngDecoder.GetHeight();
+			OutInfo.Format = PngDecoder.GetTextureFormat();
+			OutInfo.bScalesWhileDecoding = CVarStreamingPNGDecode.GetValueOnAnyThread() && !PngDecoder.IsInterlaced();
+			return true;
+		}
+
+	protected:
+		virtual bool DecodeFile(UImageImporter& Importer, const uint8* Buffer, int64 Length, FImportedImageStruct& OutImage, FImageDecodeTarget* Target) override
+		{
+			bool bFillPNGZeroAlpha = true;
+			GConfig->GetBool(TEXT("TextureImporter"), TEXT("FillPNGZeroAlpha"), bFillPNGZeroAlpha, GEditorIni);
+
+			if (CVarStreamingPNGDecode.GetValueOnAnyThread())
+			{
+				return DecodeStreaming(Importer, Buffer, Length, OutImage, Target, bFillPNGZeroAlpha);
+			}
+
+			IImageWrapper* PngImageWrapper = SetCompressed(Buffer, Length);
+			if (!PngImageWrapper)
+			{
+				return false;
+			}
+
+			// Select the texture's source format
+			ETextureSourceFormat TextureFormat = TSF_Invalid;
+			int32 BitDepth = PngImageWrapper->GetBitDepth();
+			ERGBFormat Format = PngImageWrapper->GetFormat();
+
+			if (Format == ERGBFormat::Gray)
+			{
+				if (BitDepth <= 8)
+				{
+					TextureFormat = TSF_G8;
+					Format = ERGBFormat::Gray;
+					BitDepth = 8;
+				}
+				else if (BitDepth == 16)
+				{
+					TextureFormat = TSF_G16;
+					Format = ERGBFormat::Gray;
+					BitDepth = 16;
+				}
+			}
+			else if (Format == ERGBFormat::RGBA || Format == ERGBFormat::BGRA)
+			{
+				if (BitDepth <= 8)
+				{
+					TextureFormat = TSF_BGRA8;
+					Format = ERGBFormat::BGRA;
+					BitDepth = 8;
+				}
+				else if (BitDepth == 16)
+				{
+					TextureFormat = TSF_RGBA16;
+					Format = ERGBFormat::RGBA;
+					BitDepth = 16;
+				}
+			}
+
+			if (TextureFormat == TSF_Invalid)
+			{
+				UE_LOG(ImageImporter, Error, TEXT("PNG file contains data in an unsupported format."));
+				return false;
+			}
+
+			if (!IsFullSizeImportValid(Importer, PngImageWrapper->GetWidth(), PngImageWrapper->GetHeight(), TextureFormat))
+			{
+				return false;
+			}
+
+			OutImage.Init2DWithParams(
+				PngImageWrapper->GetWidth(),
+				PngImageWrapper->GetHeight(),
+				TextureFormat,
+				BitDepth < 16
+			);
+
+			if (!PngImageWrapper->GetRaw(Format, BitDepth, OutImage.RawData))
+			{
+				UE_LOG(ImageImporter, Error, TEXT("Failed to decode PNG."));
+				return false;
+			}
+
+			if (bFillPNGZeroAlpha)
+			{
+				// Replace the pixels with 0.0 alpha with a color value from the nearest neighboring color which has a non-zero alpha
+				FillZeroAlphaPNGData(OutImage.SizeX, OutImage.SizeY, OutImage.Format, OutImage.RawData.GetData());
+			}
+			return true;
+		}
+
+	private:
+		bool DecodeStreaming(UImageImporter& Importer, const uint8* Buffer, int64 Length, FImportedImageStruct& OutImage, FImageDecodeTarget* Target, bool bFillPNGZeroAlpha)
+		{
+			FPngRowDecoder PngDecoder(Buffer, Length);
+			if (!PngDecoder.ReadHeader())
+			{
+				return false;
+			}
+
+			int32 ImportMaxDimension = 0;
+			if (!Importer.CheckImportLimits(PngDecoder.GetWidth(), PngDecoder.GetHeight(), PngDecoder.GetTextureFormat(), ImportMaxDimension))
+			{
+				return false;
+			}
+
+			// Previews and oversized images are box filtered as rows come out of libpng, interlaced images only
+			// exist complete after the last pass and are scaled after decoding instead
+			const int32 DownsampleFactor = PngDecoder.IsInterlaced() ? 1 : FImageRowDownsampler::GetFactor(PngDecoder.GetWidth(), PngDecoder.GetHeight(), ImportMaxDimension);
+			const ETextureSourceFormat TextureFormat = PngDecoder.GetTextureFormat();
+			const bool bSRGB = TextureFormat == TSF_BGRA8 || TextureFormat == TSF_G8;
+
+			if (DownsampleFactor == 1)
+			{
+				// The zero alpha fill runs on each row as soon as it is decoded
+				return DecodeFullSizeImage(Importer, PngDecoder, bSRGB, OutImage, Target, bFillPNGZeroAlpha);
+			}
+
+			const int32 ScaledWidth = FImageRowDownsampler::GetScaledSize(PngDecoder.GetWidth(), DownsampleFactor);
+			const int32 ScaledHeight = FImageRowDownsampler::GetScaledSize(PngDecoder.GetHeight(), DownsampleFactor);
+
+			if (!Importer.IsImportResolutionValid(ScaledWidth, ScaledHeight, bAllowNonPowerOfTwo))
+			{
+				return false;
+			}
+
+			OutImage.Init2DWithParams(ScaledWidth, ScaledHeight, TextureFormat, bSRGB);
+
+			// Mip 0 is decoded, the rest of the chain is left for GenerateMips
+			Importer.AllocateDecodedMips(OutImage, Target);
+
+			uint8* MipData = static_cast<uint8*>(OutImage.GetMipData(0));
+			if (!PngDecoder.DecodeDownsampled(DownsampleFactor, MipData, OutImage.GetMipSize(0)))
+			{
+				return false;
+			}
+
+			// The box filter weights color by alpha, so only blocks that are transparent throughout are left
+			// for the fill, which needs whole rows of the final image and runs on the small one
+			if (bFillPNGZeroAlpha)
+			{
+				FillZeroAlphaPNGData(OutImage.SizeX, OutImage.SizeY, OutImage.Format, MipData);
+			}
+			return true;
+		}
+	};
+
+	class FJpegImageDecoder : public FImageWrapperDecoder
+	{
+	public:
+		FJpegImageDecoder() : FImageWrapperDecoder(EImageFormat::JPEG) {}
+
+		virtual const TCHAR* GetName() const override { return TEXT("JPEG"); }
+
+		virtual bool CanDecode(const uint8* Buffer, int64 Length) const override
+		{
+			return HasMagic(Buffer, Length, { 0xFF, 0xD8, 0xFF });
+		}
+
+#if RTIMAGEIMPORT_WITH_LIBJPEGTURBO
+		virtual bool ReadHeaderInfo(const uint8* Buffer, int64 Length, FImageHeaderInfo& OutInfo) override
+		{
+			return ReadNativeHeaderInfo<FJpegRowDecoder>(Buffer, Length, true, OutInfo);
+		}
+#endif
+
+	protected:
+		virtual bool DecodeFile(UImageImporter& Importer, const uint8* Buffer, int64 Length, FImportedImageStruct& OutImage, FImageDecodeTarget* Target) override
+		{
+#if RTIMAGEIMPORT_WITH_LIBJPEGTURBO
+			FJpegRowDecoder JpegDecoder(Buffer, Length);
+
+			// CMYK and other color spaces libjpeg-turbo can't convert to BGRA go through the image wrapper
+			if (JpegDecoder.ReadHeader())
+			{
+				int32 ImportMaxDimension = 0;
+				if (!Importer.CheckImportLimits(JpegDecoder.GetWidth(), JpegDecoder.GetHeight(), JpegDecoder.GetTextureFormat(), ImportMaxDimension))
+				{
+					return false;
+				}
+
+				if (ImportMaxDimension > 0)
+				{
+					// Previews and oversized images are scaled in the DCT domain and box filtered the rest of the way
+					JpegDecoder.SetScaleForMaxDimension(ImportMaxDimension);
+					const int32 DownsampleFactor = FImageRowDownsampler::GetFactor(JpegDecoder.GetScaledWidth(), JpegDecoder.GetScaledHeight(), ImportMaxDimension);
+
+					// Images that already fit decode at full size below, into the target or as retained JPEG data
+					const bool bDCTScaled = JpegDecoder.GetScaledWidth() != JpegDecoder.GetWidth() || JpegDecoder.GetScaledHeight() != JpegDecoder.GetHeight();
+					if (bDCTScaled || DownsampleFactor > 1)
+					{
+						const int32 ScaledWidth = FImageRowDownsampler::GetScaledSize(JpegDecoder.GetScaledWidth(), DownsampleFactor);
+						const int32 ScaledHeight = FImageRowDownsampler::GetScaledSize(JpegDecoder.GetScaledHeight(), DownsampleFactor);
+
+						if (!Importer.IsImportResolutionValid(ScaledWidth, ScaledHeight, bAllowNonPowerOfTwo))
+						{
+							return false;
+						}
+
+						OutImage.Init2DWithParams(ScaledWidth, ScaledHeight, JpegDecoder.GetTextureFormat(), true);
+
+						// Mip 0 is decoded, the rest of the chain is left for GenerateMips
+						Importer.AllocateDecodedMips(OutImage, Target);
+						return JpegDecoder.Decode(static_cast<uint8*>(OutImage.GetMipData(0)), OutImage.GetMipSize(0), DownsampleFactor);
+					}
+				}
+
+				if (Importer.bRetainJpegData && !Importer.bCompressTextures)
+				{
+					OutImage.Init2DWithParams(JpegDecoder.GetWidth(), JpegDecoder.GetHeight(), JpegDecoder.GetTextureFormat(), true);
+					if (Importer.GetNumMipsToImport(OutImage) == 1)
+					{
+						if (!Importer.IsImportResolutionValid(JpegDecoder.GetWidth(), JpegDecoder.GetHeight(), bAllowNonPowerOfTwo))
+						{
+							return false;
+						}
+
+						// Decoded straight into the texture's mip once it is created
+						FImageScratchBufferPool::Get().Acquire(OutImage.RawData, Length);
+						FMemory::Memcpy(OutImage.RawData.GetData(), Buffer, Length);
+						OutImage.RawDataCompressionFormat = TSCF_JPEG;
+						return true;
+					}
+				}
+
+				return DecodeFullSizeImage(Importer, JpegDecoder, true, OutImage, Target, 1);
+			}
+#endif
+
+			IImageWrapper* JpegImageWrapper = SetCompressed(Buffer, Length);
+			if (!JpegImageWrapper)
+			{
+				return false;
+			}
+
+			// Select the texture's source format
+			ETextureSourceFormat TextureFormat = TSF_Invalid;
+			int32 BitDepth = JpegImageWrapper->GetBitDepth();
+			ERGBFormat Format = JpegImageWrapper->GetFormat();
+
+			if (Format == ERGBFormat::Gray)
+			{
+				if (BitDepth <= 8)
+				{
+					TextureFormat = TSF_G8;
+					Format = ERGBFormat::Gray;
+					BitDepth = 8;
+				}
+			}
+			else if (Format == ERGBFormat::RGBA)
+			{
+				if (BitDepth <= 8)
+				{
+					TextureFormat = TSF_BGRA8;
+					Format = ERGBFormat::BGRA;
+					BitDepth = 8;
+				}
+			}
+
+			if (TextureFormat == TSF_Invalid)
+			{
+				UE_LOG(ImageImporter, Error, TEXT("JPEG file contains data in an unsupported format."));
+				return false;
+			}
+
+			if (!IsFullSizeImportValid(Importer, JpegImageWrapper->GetWidth(), JpegImageWrapper->GetHeight(), TextureFormat))
+			{
+				return false;
+			}
+
+			OutImage.Init2DWithParams(
+				JpegImageWrapper->GetWidth(),
+				JpegImageWrapper->GetHeight(),
+				TextureFormat,
+				BitDepth < 16
+			);
+
+			if (!JpegImageWrapper->GetRaw(Format, BitDepth, OutImage.RawData))
+			{
+				UE_LOG(ImageImporter, Error, TEXT("Failed to decode JPEG."));
+				return false;
+			}
+
+			return true;
+		}
+	};
+
+	class FExrImageDecoder : public FImageWrapperDecoder
+	{
+	public:
+		FExrImageDecoder() : FImageWrapperDecoder(EImageFormat::EXR) {}
+
+		virtual const TCHAR* GetName() const override { return TEXT("EXR"); }
+
+		virtual bool CanDecode(const uint8* Buffer, int64 Length) const override
+		{
+			return HasMagic(Buffer, Length, { 0x76, 0x2F, 0x31, 0x01 });
+		}
+
+		virtual bool ReadHeaderInfo(const uint8* Buffer, int64 Length, FImageHeaderInfo& OutInfo) override
+		{
+			if (!ReadDataWindowSize(Buffer, Length, OutInfo.Width, OutInfo.Height))
+			{
+				return false;
+			}
+			OutInfo.Format = TSF_RGBA16F;
+			return true;
+		}
+
+	protected:
+		virtual bool DecodeFile(UImageImporter& Importer, const uint8* Buffer, int64 Length, FImportedImageStruct& OutImage, FImageDecodeTarget* Target) override
+		{
+			// Images over the limits are rejected before the wrapper copies the whole file
+			int32 HeaderWidth = 0, HeaderHeight = 0;
+			if (ReadDataWindowSize(Buffer, Length, HeaderWidth, HeaderHeight) && !IsFullSizeImportValid(Importer, HeaderWidth, HeaderHeight, TSF_RGBA16F))
+			{
+				return false;
+			}
+
+			IImageWrapper* ExrImageWrapper = SetCompressed(Buffer, Length);
+			if (!ExrImageWrapper)
+			{
+				return false;
+			}
+
+			const int32 Width = ExrImageWrapper->GetWidth();
+			const int32 Height = ExrImageWrapper->GetHeight();
+
+			if (!IsFullSizeImportValid(Importer, Width, Height, TSF_RGBA16F))
+			{
+				return false;
+			}
+
+			// Linear HDR, the decoder expands gray and RGB channel layouts to RGBA
+			OutImage.Init2DWithParams(Width, Height, TSF_RGBA16F, false);
+			OutImage.CompressionSettings = TC_HDR;
+
+			const int64 NumPixels = (int64)Width * Height;
+
+			// Files stored as half come out of the wrapper as they are. For FLOAT files the wrapper's own halving
+			// is serial, decoding to 32 bit floats and halving them here goes wide.
+			const bool bStoredAsHalf = ExrImageWrapper->GetBitDepth() == 16;
+			const int32 BitDepth = bStoredAsHalf ? 16 : 32;
+			TArray64<uint8> DecodedData;
+			if (!ExrImageWrapper->GetRaw(ERGBFormat::RGBAF, BitDepth, DecodedData) || DecodedData.Num() != NumPixels * 4 * BitDepth / 8)
+			{
+				UE_LOG(ImageImporter, Error, TEXT("Failed to decode EXR."));
+				return false;
+			}
+
+			// Mip 0 is copied or converted into the target or RawData, the rest of the chain is left for GenerateMips
+			Importer.AllocateDecodedMips(OutImage, Target);
+			if (bStoredAsHalf)
+			{
+				FMemory::Memcpy(OutImage.GetMipData(0), DecodedData.GetData(), DecodedData.Num());
+			}
+			else
+			{
+				ConvertFloatRGBAToHalf(reinterpret_cast<const float*>(DecodedData.GetData()), static_cast<uint16*>(OutImage.GetMipData(0)), NumPixels);
+			}
+			return true;
+		}
+
+	private:
+		/** EXR headers are little endian */
+		static int32 ReadInt32(const uint8* Data)
+		{
+			return int32(uint32(Data[0]) | (uint32(Data[1]) << 8) | (uint32(Data[2]) << 16) | (uint32(Data[3]) << 24));
+		}
+
+		/**
+		 * Size of the data window of the first part, read from the header attributes in the file without the
+		 * wrapper, which would copy the whole file first.
+		 */
+		static bool ReadDataWindowSize(const uint8* Buffer, int64 Length, int32& OutWidth, int32& OutHeight)
+		{
+			// Magic and the version field, whose flags only change the name length limit of the attributes
+			int64 Offset = 8;
+			if (Length < Offset)
+			{
+				return false;
+			}
+
+			auto ReadString = [Buffer, Length, &Offset](const char*& OutString) -> bool
+			{
+				const int64 Start = Offset;
+				while (Offset < Length && Buffer[Offset] != 0)
+				{
+					++Offset;
+				}
+				if (Offset >= Length)
+				{
+					return false;
+				}
+				OutString = reinterpret_cast<const char*>(Buffer + Start);
+				++Offset;
+				return true;
+			};
+
+			// Attributes are name, type name, int32 size and value, the header ends with an empty name
+			for (;;)
+			{
+				const char* Name = nullptr;
+				const char* TypeName = nullptr;
+				if (!ReadString(Name) || Name[0] == 0 || !ReadString(TypeName) || Offset + 4 > Length)
+				{
+					return false;
+				}
+
+				const int32 Size = ReadInt32(Buffer + Offset);
+				Offset += 4;
+				if (Size < 0 || Offset + Size > Length)
+				{
+					return false;
+				}
+
+				if (FCStringAnsi::Strcmp(Name, "dataWindow") == 0)
+				{
+					if (FCStringAnsi::Strcmp(TypeName, "box2i") != 0 || Size != 16)
+					{
+						return false;
+					}
+
+					// Little endian xMin, yMin, xMax, yMax, both ends inclusive
+					const int64 MinX = ReadInt32(Buffer + Offset);
+					const int64 MinY = ReadInt32(Buffer + Offset + 4);
+					const int64 MaxX = ReadInt32(Buffer + Offset + 8);
+					const int64 MaxY = ReadInt32(Buffer + Offset + 12);
+					const int64 Width = MaxX - MinX + 1;
+					const int64 Height = MaxY - MinY + 1;
+					if (Width <= 0 || Height <= 0 || Width > MAX_int32 || Height > MAX_int32)
+					{
+						return false;
+					}
+
+					OutWidth = (int32)Width;
+					OutHeight = (int32)Height;
+					return true;
+				}
+
+				Offset += Size;
+			}
+		}
+	};
+
+	class FBmpImageDecoder : public FImageWrapperDecoder
+	{
+	public:
+		FBmpImageDecoder() : FImageWrapperDecoder(EImageFormat::BMP) {}
+
+		virtual const TCHAR* GetName() const override { return TEXT("BMP"); }
+
+		virtual bool CanDecode(const uint8* Buffer, int64 Length) const override
+		{
+			return HasMagic(Buffer, Length, { 'B', 'M' });
+		}
+
+		virtual bool ReadHeaderInfo(const uint8* Buffer, int64 Length, FImageHeaderInfo& OutInfo) override
+		{
+			return ReadNativeHeaderInfo<FBmpDecoder>(Buffer, Length, false, OutInfo);
+		}
+
+	protected:
+		virtual bool DecodeFile(UImageImporter& Importer, const uint8* Buffer, int64 Length, FImportedImageStruct& OutImage, FImageDecodeTarget* Target) override
+		{
+			FBmpDecoder BmpDecoder(Buffer, Length);
+
+			// RLE compressed BMPs go through the image wrapper
+			if (BmpDecoder.ReadHeader())
+			{
+				return DecodeFullSizeImage(Importer, BmpDecoder, true, OutImage, Target);
+			}
+
+			IImageWrapper* BmpImageWrapper = SetCompressed(Buffer, Length);
+			if (!BmpImageWrapper)
+			{
+				return false;
+			}
+
+			if (!IsFullSizeImportValid(Importer, BmpImageWrapper->GetWidth(), BmpImageWrapper->GetHeight(), TSF_BGRA8))
+			{
+				return false;
+			}
+
+			OutImage.Init2DWithParams(
+				BmpImageWrapper->GetWidth(),
+				BmpImageWrapper->GetHeight(),
+				TSF_BGRA8,
+				true
+			);
+
+			return BmpImageWrapper->GetRaw(ERGBFormat::BGRA, 8, OutImage.RawData);
+		}
+	};
+
+	class FTiffImageDecoder : public FImageWrapperDecoder
+	{
+	public:
+		FTiffImageDecoder() : FImageWrapperDecoder(EImageFormat::TIFF) {}
+
+		virtual const TCHAR* GetName() const override { return TEXT("TIFF"); }
+
+		/** Classic and BigTIFF in either byte order */
+		virtual bool CanDecode(const uint8* Buffer, int64 Length) const override
+		{
+			return HasMagic(Buffer, Length, { 'I', 'I', 42, 0 }) || HasMagic(Buffer, Length, { 'M', 'M', 0, 42 })
+				|| HasMagic(Buffer, Length, { 'I', 'I', 43, 0 }) || HasMagic(Buffer, Length, { 'M', 'M', 0, 43 });
+		}
+
+#if RTIMAGEIMPORT_WITH_LIBTIFF
+		virtual bool ReadHeaderInfo(const uint8* Buffer, int64 Length, FImageHeaderInfo& OutInfo) override
+		{
+			return ReadNativeHeaderInfo<FTiffDecoder>(Buffer, Length, false, OutInfo);
+		}
+#endif
+
+	protected:
+		virtual bool DecodeFile(UImageImporter& Importer, const uint8* Buffer, int64 Length, FImportedImageStruct& OutImage, FImageDecodeTarget* Target) override
+		{
+#if RTIMAGEIMPORT_WITH_LIBTIFF
+			FTiffDecoder TiffDecoder(Buffer, Length);
+			if (TiffDecoder.ReadHeader())
+			{
+				OutImage.CompressionSettings = TiffDecoder.GetCompressionSettings();
+				return DecodeFullSizeImage(Importer, TiffDecoder, TiffDecoder.IsSRGB(), OutImage, Target);
+			}
+#endif
+
+			// Palettized, CMYK, YCbCr and planar TIFFs are converted by the image wrapper in one piece
+			IImageWrapper* TiffImageWrapper = SetCompressed(Buffer, Length);
+			if (!TiffImageWrapper)
+			{
+				return false;
+			}
+
+			ETextureSourceFormat SourceFormat = TSF_Invalid;
+			const ERGBFormat TiffFormat = TiffImageWrapper->GetFormat();
+			const int32 BitDepth = TiffImageWrapper->GetBitDepth();
+			bool bIsSRGB = false;
+
+			if (TiffFormat == ERGBFormat::BGRA)
+			{
+				SourceFormat = TSF_BGRA8;
+				bIsSRGB = true;
+			}
+			else if (TiffFormat == ERGBFormat::RGBA)
+			{
+				SourceFormat = TSF_RGBA16;
+			}
+			else if (TiffFormat == ERGBFormat::RGBAF)
+			{
+				SourceFormat = TSF_RGBA16F;
+			}
+			else if (TiffFormat == ERGBFormat::Gray)
+			{
+				SourceFormat = BitDepth == 16 ? TSF_G16 : TSF_G8;
+			}
+
+			if (SourceFormat == TSF_Invalid)
+			{
+				UE_LOG(ImageImporter, Error, TEXT("TIFF uses an unsupported format."));
+				return false;
+			}
+
+			if (!IsFullSizeImportValid(Importer, TiffImageWrapper->GetWidth(), TiffImageWrapper->GetHeight(), SourceFormat))
+			{
+				return false;
+			}
+
+			OutImage.Init2DWithParams(
+				TiffImageWrapper->GetWidth(),
+				TiffImageWrapper->GetHeight(),
+				SourceFormat,
+				bIsSRGB
+			);
+
+			return TiffImageWrapper->GetRaw(TiffFormat, BitDepth, OutImage.RawData);
+		}
+	};
+
+	class FDdsImageDecoder : public IImageDecoder
+	{
+	public:
+		virtual const TCHAR* GetName() const override { return TEXT("DDS"); }
+
+		virtual bool CanDecode(const uint8* Buffer, int64 Length) const override
+		{
+			return FDdsDecoder::IsDds(Buffer, Length);
+		}
+
+		virtual bool ReadHeaderInfo(const uint8* Buffer, int64 Length, FImageHeaderInfo& OutInfo) override
+		{
+			return ReadNativeHeaderInfo<FDdsDecoder>(Buffer, Length, false, OutInfo);
+		}
+
+		virtual bool Decode(UImageImporter& Importer, const uint8* Buffer, int64 Length, FImportedImageStruct& OutImage, FImageDecodeTarget* Target) override
+		{
+			FDdsDecoder DdsDecoder(Buffer, Length);
+			if (!DdsDecoder.ReadHeader())
+			{
+				return false;
+			}
+
+			if (!IsFullSizeImportValid(Importer, DdsDecoder.GetWidth(), DdsDecoder.GetHeight(), DdsDecoder.GetTextureFormat(), false))
+			{
+				return false;
+			}
+
+			// The stored mip chain goes to the texture as is, GetMipSize works in blocks of the pixel format
+			OutImage.Init2DWithParams(DdsDecoder.GetWidth(), DdsDecoder.GetHeight(), DdsDecoder.GetTextureFormat(), DdsDecoder.IsSRGB());
+			OutImage.PixelFormat = DdsDecoder.GetPixelFormat();
+			OutImage.CompressionSettings = DdsDecoder.GetCompressionSettings();
+			OutImage.NumMips = DdsDecoder.GetNumMips();
+
+			if (Target && Target->AllocateMips(OutImage, OutImage.TargetMipData))
+			{
+				const uint8* MipData = DdsDecoder.GetMipChainData();
+				for (int32 MipIndex = 0; MipIndex < OutImage.NumMips; ++MipIndex)
+				{
+					FMemory::Memcpy(OutImage.GetMipData(MipIndex), MipData, OutImage.GetMipSize(MipIndex));
+					MipData += OutImage.GetMipSize(MipIndex);
+				}
+				return true;
+			}
+
+			OutImage.TargetMipData.Empty();
+			OutImage.Init2DWithMips(OutImage.SizeX, OutImage.SizeY, OutImage.NumMips, OutImage.Format, DdsDecoder.GetMipChainData());
+			return true;
+		}
+	};
+
+	class FPcxImageDecoder : public IImageDecoder
+	{
+	public:
+		virtual const TCHAR* GetName() const override { return TEXT("PCX"); }
+
+		/** Manufacturer 10, RLE or raw encoding and a PCX bit depth, TGAs with a 10 byte ID rarely get past it */
+		virtual bool CanDecode(const uint8* Buffer, int64 Length) const override
+		{
+			return Length >= 128 && Buffer[0] == 10 && Buffer[2] <= 1 && (Buffer[3] == 1 || Buffer[3] == 2 || Buffer[3] == 4 || Buffer[3] == 8);
+		}
+
+		virtual bool ReadHeaderInfo(const uint8* Buffer, int64 Length, FImageHeaderInfo& OutInfo) override
+		{
+			return ReadNativeHeaderInfo<FPcxDecoder>(Buffer, Length, false, OutInfo);
+		}
+
+		virtual bool Decode(UImageImporter& Importer, const uint8* Buffer, int64 Length, FImportedImageStruct& OutImage, FImageDecodeTarget* Target) override
+		{
+			FPcxDecoder PcxDecoder(Buffer, Length);
+			if (!PcxDecoder.ReadHeader())
+			{
+				return false;
+			}
+
+			return DecodeFullSizeImage(Importer, PcxDecoder, true, OutImage, Target);
+		}
+	};
+
+	/** TGA has no magic bytes, it takes whatever no other decoder claimed */
+	class FTgaImageDecoder : public IImageDecoder
+	{
+	public:
+		virtual const TCHAR* GetName() const override { return TEXT("TGA"); }
+
+		virtual bool CanDecode(const uint8* Buffer, int64 Length) const override
+		{
+			return Length >= 18;
+		}
+
+		virtual bool ReadHeaderInfo(const uint8* Buffer, int64 Length, FImageHeaderInfo& OutInfo) override
+		{
+			return ReadNativeHeaderInfo<FTgaDecoder>(Buffer, Length, false, OutInfo);
+		}
+
+		virtual bool Decode(UImageImporter& Importer, const uint8* Buffer, int64 Length, FImportedImageStruct& OutImage, FImageDecodeTarget* Target) override
+		{
+			FTgaDecoder TgaDecoder(Buffer, Length);
+			if (!TgaDecoder.ReadHeader())
+			{
+				return false;
+			}
+
+			OutImage.CompressionSettings = TgaDecoder.GetCompressionSettings();
+			return DecodeFullSizeImage(Importer, TgaDecoder, TgaDecoder.IsSRGB(), OutImage, Target);
+		}
+	};
+
+	template <typename DecoderType>
+	void RegisterBuiltInDecoder(FImageDecoderRegistry& Registry, std::initializer_list<uint8> LeadingBytes)
+	{
+		Registry.RegisterDecoder(MakeArrayView(LeadingBytes.begin(), (int32)LeadingBytes.size()), []() -> TUniquePtr<IImageDecoder> { return MakeUnique<DecoderType>(); });
+	}
+}
+
+void RegisterBuiltInImageDecoders(FImageDecoderRegistry& Registry)
+{
+	ImageWrapperModule = &FModuleManager::LoadModuleChecked<IImageWrapperModule>(FName("ImageWrapper"));
+
+	RegisterBuiltInDecoder<FTgaImageDecoder>(Registry, {});
+	RegisterBuiltInDecoder<FPcxImageDecoder>(Registry, { 10 });
+	RegisterBuiltInDecoder<FDdsImageDecoder>(Registry, { 'D' });
+	RegisterBuiltInDecoder<FTiffImageDecoder>(Registry, { 'I', 'M' });
+	RegisterBuiltInDecoder<FBmpImageDecoder>(Registry, { 'B' });
+	RegisterBuiltInDecoder<FExrImageDecoder>(Registry, { 0x76 });
+	RegisterBuiltInDecoder<FJpegImageDecoder>(Registry, { 0xFF });
+	RegisterBuiltInDecoder<FPngImageDecoder>(Registry, { 0x89 });
+}
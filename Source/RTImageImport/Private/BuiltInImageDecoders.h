@@ -0,0 +1,8 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+class FImageDecoderRegistry;
+
+/** Registers the decoders for PNG, JPEG, EXR, BMP, TIFF, DDS, PCX and TGA. Game thread only. */
+void RegisterBuiltInImageDecoders(FImageDecoderRegistry& Registry);
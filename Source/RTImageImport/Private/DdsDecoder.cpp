@@ -0,0 +1,319 @@
+#include "DdsDecoder.h"
+
+#include "ImageImporter.h"
+#include "ImageMipGenerator.h"
+
+
+#pragma pack(push,1)
+struct FDdsPixelFormat
+{
+	uint32 Size;
+	uint32 Flags;
+	uint32 FourCC;
+	uint32 RGBBitCount;
+	uint32 Masks[4];			// Red, green, blue and alpha.
+};
+
+struct FDdsFileHeader
+{
+	uint32 Magic;				// "DDS ".
+	uint32 Size;				// Always 124.
+	uint32 Flags;
+	uint32 Height;
+	uint32 Width;
+	uint32 PitchOrLinearSize;
+	uint32 Depth;
+	uint32 MipMapCount;
+	uint32 Reserved1[11];
+	FDdsPixelFormat PixelFormat;
+	uint32 Caps;
+	uint32 Caps2;
+	uint32 Caps3;
+	uint32 Caps4;
+	uint32 Reserved2;
+};
+
+struct FDdsDX10Header
+{
+	uint32 DxgiFormat;
+	uint32 ResourceDimension;	// 3 for 2D textures.
+	uint32 MiscFlag;
+	uint32 ArraySize;
+	uint32 MiscFlags2;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(FDdsFileHeader) == 128, "DDS header is the magic and 124 bytes");
+static_assert(sizeof(FDdsDX10Header) == 20, "DX10 header follows the DDS header with 20 bytes");
+
+namespace
+{
+	constexpr uint32 MakeDdsFourCC(char A, char B, char C, char D)
+	{
+		return uint32(uint8(A)) | (uint32(uint8(B)) << 8) | (uint32(uint8(C)) << 16) | (uint32(uint8(D)) << 24);
+	}
+
+	constexpr uint32 DdsMagic = MakeDdsFourCC('D', 'D', 'S', ' ');
+
+	constexpr uint32 DDSD_MIPMAPCOUNT = 0x20000;
+	constexpr uint32 DDSD_DEPTH = 0x800000;
+
+	constexpr uint32 DDPF_ALPHAPIXELS = 0x1;
+	constexpr uint32 DDPF_FOURCC = 0x4;
+	constexpr uint32 DDPF_RGB = 0x40;
+	constexpr uint32 DDPF_LUMINANCE = 0x20000;
+
+	constexpr uint32 DDSCAPS2_CUBEMAP = 0x200;
+	constexpr uint32 DDSCAPS2_VOLUME = 0x200000;
+
+	constexpr uint32 D3D10_RESOURCE_DIMENSION_TEXTURE2D = 3;
+	constexpr uint32 D3D11_RESOURCE_MISC_TEXTURECUBE = 0x4;
+
+	/** Numeric D3DFORMAT values legacy writers store in place of a FourCC */
+	constexpr uint32 D3DFMT_A16B16G16R16 = 36;
+	constexpr uint32 D3DFMT_A16B16G16R16F = 113;
+
+	enum EDxgiFormat : uint32
+	{
+		DXGI_FORMAT_R16G16B16A16_FLOAT = 10,
+		DXGI_FORMAT_R16G16B16A16_UNORM = 11,
+		DXGI_FORMAT_R8G8B8A8_UNORM = 28,
+		DXGI_FORMAT_R8G8B8A8_UNORM_SRGB = 29,
+		DXGI_FORMAT_R16_UNORM = 56,
+		DXGI_FORMAT_R8_UNORM = 61,
+		DXGI_FORMAT_BC1_UNORM = 71,
+		DXGI_FORMAT_BC1_UNORM_SRGB = 72,
+		DXGI_FORMAT_BC2_UNORM = 74,
+		DXGI_FORMAT_BC2_UNORM_SRGB = 75,
+		DXGI_FORMAT_BC3_UNORM = 77,
+		DXGI_FORMAT_BC3_UNORM_SRGB = 78,
+		DXGI_FORMAT_BC4_UNORM = 80,
+		DXGI_FORMAT_BC5_UNORM = 83,
+		DXGI_FORMAT_B8G8R8A8_UNORM = 87,
+		DXGI_FORMAT_B8G8R8A8_UNORM_SRGB = 91,
+		DXGI_FORMAT_BC6H_UF16 = 95,
+		DXGI_FORMAT_BC7_UNORM = 98,
+		DXGI_FORMAT_BC7_UNORM_SRGB = 99,
+	};
+}
+
+FDdsDecoder::FDdsDecoder(const uint8* InBuffer, int64 InLength)
+	: Buffer(InBuffer)
+	, Length(InLength)
+{
+}
+
+bool FDdsDecoder::IsDds(const uint8* Buffer, int64 Length)
+{
+	uint32 Magic = 0;
+	if (Length >= (int64)sizeof(Magic))
+	{
+		FMemory::Memcpy(&Magic, Buffer, sizeof(Magic));
+	}
+	return Magic == DdsMagic;
+}
+
+bool FDdsDecoder::ReadHeader()
+{
+	if (bHeaderRead || Length < (int64)sizeof(FDdsFileHeader))
+	{
+		return bHeaderRead;
+	}
+
+	FDdsFileHeader Header;
+	FMemory::Memcpy(&Header, Buffer, sizeof(Header));
+
+	if (Header.Magic != DdsMagic || Header.Size != 124 || Header.PixelFormat.Size != 32 || Header.Width == 0 || Header.Height == 0)
+	{
+		return false;
+	}
+
+	if ((Header.Caps2 & (DDSCAPS2_CUBEMAP | DDSCAPS2_VOLUME)) != 0 || ((Header.Flags & DDSD_DEPTH) != 0 && Header.Depth > 1))
+	{
+		UE_LOG(ImageImporter, Error, TEXT("DDS cube maps and volume textures are not supported"));
+		return false;
+	}
+
+	DataOffset = sizeof(FDdsFileHeader);
+	if ((Header.PixelFormat.Flags & DDPF_FOURCC) != 0 && Header.PixelFormat.FourCC == MakeDdsFourCC('D', 'X', '1', '0'))
+	{
+		if (Length < DataOffset + (int64)sizeof(FDdsDX10Header))
+		{
+			return false;
+		}
+
+		FDdsDX10Header DX10Header;
+		FMemory::Memcpy(&DX10Header, Buffer + DataOffset, sizeof(DX10Header));
+		DataOffset += sizeof(FDdsDX10Header);
+
+		if (DX10Header.ResourceDimension != D3D10_RESOURCE_DIMENSION_TEXTURE2D || (DX10Header.MiscFlag & D3D11_RESOURCE_MISC_TEXTURECUBE) != 0 || DX10Header.ArraySize > 1)
+		{
+			UE_LOG(ImageImporter, Error, TEXT("DDS texture arrays, cube maps and volume textures are not supported"));
+			return false;
+		}
+
+		if (!SetDxgiFormat(DX10Header.DxgiFormat))
+		{
+			UE_LOG(ImageImporter, Error, TEXT("DDS uses an unsupported DXGI format (%u)"), DX10Header.DxgiFormat);
+			return false;
+		}
+	}
+	else if (!SetLegacyFormat(Header.PixelFormat.Flags, Header.PixelFormat.FourCC, Header.PixelFormat.RGBBitCount, Header.PixelFormat.Masks))
+	{
+		UE_LOG(ImageImporter, Error, TEXT("DDS uses an unsupported format (flags 0x%x, FourCC 0x%08x, %u bits)"), Header.PixelFormat.Flags, Header.PixelFormat.FourCC, Header.PixelFormat.RGBBitCount);
+		return false;
+	}
+
+	if (Header.Width > (uint32)MAX_int32 || Header.Height > (uint32)MAX_int32)
+	{
+		return false;
+	}
+
+	Width = int32(Header.Width);
+	Height = int32(Header.Height);
+
+	// The texture's mip 0 has to consist of whole blocks
+	const FPixelFormatInfo& FormatInfo = GPixelFormats[PixelFormat];
+	if (Width % FormatInfo.BlockSizeX != 0 || Height % FormatInfo.BlockSizeY != 0)
+	{
+		UE_LOG(ImageImporter, Error, TEXT("DDS size %d x %d is not a multiple of the %s block size"), Width, Height, FormatInfo.Name);
+		return false;
+	}
+
+	// Some writers store a mip count of 0 or leave out the flag for a single mip
+	const int32 FullMipChainCount = GetFullMipChainCount(Width, Height);
+	NumMips = (Header.Flags & DDSD_MIPMAPCOUNT) != 0 ? (int32)FMath::Min<uint32>(FMath::Max<uint32>(Header.MipMapCount, 1), MAX_int32) : 1;
+	if (NumMips > FullMipChainCount)
+	{
+		return false;
+	}
+
+	int64 MipChainSize = 0;
+	for (int32 MipIndex = 0; MipIndex < NumMips; ++MipIndex)
+	{
+		const int32 MipSizeX = FMath::Max(Width >> MipIndex, 1);
+		const int32 MipSizeY = FMath::Max(Height >> MipIndex, 1);
+		MipChainSize += FMath::DivideAndRoundUp<int64>(MipSizeX, FormatInfo.BlockSizeX) * FMath::DivideAndRoundUp<int64>(MipSizeY, FormatInfo.BlockSizeY) * FormatInfo.BlockBytes;
+	}
+
+	if (MipChainSize > Length - DataOffset)
+	{
+		UE_LOG(ImageImporter, Error, TEXT("DDS data is %lld bytes, %lld are needed for %d x %d with %d mips"), Length - DataOffset, MipChainSize, Width, Height, NumMips);
+		return false;
+	}
+
+	bHeaderRead = true;
+	return true;
+}
+
+bool FDdsDecoder::SetDxgiFormat(uint32 DxgiFormat)
+{
+	switch (DxgiFormat)
+	{
+	case DXGI_FORMAT_BC1_UNORM_SRGB:
+	case DXGI_FORMAT_BC2_UNORM_SRGB:
+	case DXGI_FORMAT_BC3_UNORM_SRGB:
+	case DXGI_FORMAT_BC7_UNORM_SRGB:
+	case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+	case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+		bSRGB = true;
+		break;
+	default:
+		// DX10 headers tell linear data apart, everything without _SRGB is read as is
+		bSRGB = false;
+		break;
+	}
+
+	switch (DxgiFormat)
+	{
+	case DXGI_FORMAT_BC1_UNORM:
+	case DXGI_FORMAT_BC1_UNORM_SRGB:			SetFormat(PF_DXT1, TSF_BGRA8, TC_Default); return true;
+	case DXGI_FORMAT_BC2_UNORM:
+	case DXGI_FORMAT_BC2_UNORM_SRGB:			SetFormat(PF_DXT3, TSF_BGRA8, TC_Default); return true;
+	case DXGI_FORMAT_BC3_UNORM:
+	case DXGI_FORMAT_BC3_UNORM_SRGB:			SetFormat(PF_DXT5, TSF_BGRA8, TC_Default); return true;
+	case DXGI_FORMAT_BC4_UNORM:					SetFormat(PF_BC4, TSF_G8, TC_Grayscale); return true;
+	case DXGI_FORMAT_BC5_UNORM:					SetFormat(PF_BC5, TSF_BGRA8, TC_Normalmap); return true;
+	case DXGI_FORMAT_BC6H_UF16:					SetFormat(PF_BC6H, TSF_RGBA16F, TC_HDR_Compressed); return true;
+	case DXGI_FORMAT_BC7_UNORM:
+	case DXGI_FORMAT_BC7_UNORM_SRGB:			SetFormat(PF_BC7, TSF_BGRA8, TC_BC7); return true;
+	case DXGI_FORMAT_B8G8R8A8_UNORM:
+	case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:		SetFormat(PF_B8G8R8A8, TSF_BGRA8, TC_Default); return true;
+	case DXGI_FORMAT_R8G8B8A8_UNORM:
+	case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:		SetFormat(PF_R8G8B8A8, TSF_BGRA8, TC_Default); return true;
+	case DXGI_FORMAT_R8_UNORM:					SetFormat(PF_G8, TSF_G8, TC_Grayscale); return true;
+	case DXGI_FORMAT_R16_UNORM:					SetFormat(PF_G16, TSF_G16, TC_Grayscale); return true;
+	case DXGI_FORMAT_R16G16B16A16_UNORM:		SetFormat(PF_R16G16B16A16_UNORM, TSF_RGBA16, TC_Default); return true;
+	case DXGI_FORMAT_R16G16B16A16_FLOAT:		SetFormat(PF_FloatRGBA, TSF_RGBA16F, TC_HDR); return true;
+	default:									return false;
+	}
+}
+
+bool FDdsDecoder::SetLegacyFormat(uint32 PixelFormatFlags, uint32 FourCC, uint32 RGBBitCount, const uint32 (&Masks)[4])
+{
+	// Legacy headers don't say whether color is sRGB, color formats are assumed to be
+	bSRGB = true;
+
+	if ((PixelFormatFlags & DDPF_FOURCC) != 0)
+	{
+		switch (FourCC)
+		{
+		case MakeDdsFourCC('D', 'X', 'T', '1'):	SetFormat(PF_DXT1, TSF_BGRA8, TC_Default); return true;
+		case MakeDdsFourCC('D', 'X', 'T', '2'):
+		case MakeDdsFourCC('D', 'X', 'T', '3'):	SetFormat(PF_DXT3, TSF_BGRA8, TC_Default); return true;
+		case MakeDdsFourCC('D', 'X', 'T', '4'):
+		case MakeDdsFourCC('D', 'X', 'T', '5'):	SetFormat(PF_DXT5, TSF_BGRA8, TC_Default); return true;
+		case MakeDdsFourCC('A', 'T', 'I', '1'):
+		case MakeDdsFourCC('B', 'C', '4', 'U'):	SetFormat(PF_BC4, TSF_G8, TC_Grayscale); return true;
+		case MakeDdsFourCC('A', 'T', 'I', '2'):
+		case MakeDdsFourCC('B', 'C', '5', 'U'):	SetFormat(PF_BC5, TSF_BGRA8, TC_Normalmap); return true;
+		case D3DFMT_A16B16G16R16:				SetFormat(PF_R16G16B16A16_UNORM, TSF_RGBA16, TC_Default); return true;
+		case D3DFMT_A16B16G16R16F:				SetFormat(PF_FloatRGBA, TSF_RGBA16F, TC_HDR); return true;
+		default:								return false;
+		}
+	}
+
+	// Without alpha pixels the fourth byte is padding the texture would read as alpha, those aren't handed through
+	if ((PixelFormatFlags & DDPF_RGB) != 0 && (PixelFormatFlags & DDPF_ALPHAPIXELS) != 0 && RGBBitCount == 32 && Masks[3] == 0xff000000)
+	{
+		if (Masks[0] == 0x00ff0000 && Masks[1] == 0x0000ff00 && Masks[2] == 0x000000ff)
+		{
+			SetFormat(PF_B8G8R8A8, TSF_BGRA8, TC_Default);
+			return true;
+		}
+		if (Masks[0] == 0x000000ff && Masks[1] == 0x0000ff00 && Masks[2] == 0x00ff0000)
+		{
+			SetFormat(PF_R8G8B8A8, TSF_BGRA8, TC_Default);
+			return true;
+		}
+	}
+
+	if ((PixelFormatFlags & DDPF_LUMINANCE) != 0 && (PixelFormatFlags & DDPF_ALPHAPIXELS) == 0)
+	{
+		if (RGBBitCount == 8 && Masks[0] == 0xff)
+		{
+			SetFormat(PF_G8, TSF_G8, TC_Grayscale);
+			return true;
+		}
+		if (RGBBitCount == 16 && Masks[0] == 0xffff)
+		{
+			SetFormat(PF_G16, TSF_G16, TC_Grayscale);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void FDdsDecoder::SetFormat(EPixelFormat InPixelFormat, ETextureSourceFormat InTextureFormat, TextureCompressionSettings InCompressionSettings)
+{
+	PixelFormat = InPixelFormat;
+	TextureFormat = InTextureFormat;
+	CompressionSettings = InCompressionSettings;
+
+	// Data, HDR and grayscale masks are linear whatever the header says
+	if (InCompressionSettings == TC_Normalmap || InCompressionSettings == TC_HDR || InCompressionSettings == TC_HDR_Compressed || InCompressionSettings == TC_Grayscale)
+	{
+		bSRGB = false;
+	}
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/Texture.h"
+
+/**
+ * Reads 2D DDS files, legacy FourCC and DX10 headers, whose pixel format the RHI can hold as is. Nothing is
+ * decoded, the mip chain stored in the file is handed to the texture byte for byte. The header is validated
+ * so that every mip the format and size call for lies within the file data.
+ */
+class FDdsDecoder
+{
+public:
+	FDdsDecoder(const uint8* InBuffer, int64 InLength);
+
+	/** Cheap check for the "DDS " magic, true doesn't mean the file can be imported */
+	static bool IsDds(const uint8* Buffer, int64 Length);
+
+	/** Parses the header, fails for cube maps, volumes, arrays and formats without a matching pixel format */
+	bool ReadHeader();
+
+	int32 GetWidth() const { return Width; }
+	int32 GetHeight() const { return Height; }
+	int32 GetNumMips() const { return NumMips; }
+
+	/** Pixel format of the stored data, PF_Unknown before ReadHeader succeeded */
+	EPixelFormat GetPixelFormat() const { return PixelFormat; }
+
+	/** Source format the stored data decodes to, for code that only looks at the texture source format */
+	ETextureSourceFormat GetTextureFormat() const { return TextureFormat; }
+
+	bool IsSRGB() const { return bSRGB; }
+	TextureCompressionSettings GetCompressionSettings() const { return CompressionSettings; }
+
+	/** First byte of mip 0, the smaller mips follow it tightly packed */
+	const uint8* GetMipChainData() const { return Buffer + DataOffset; }
+
+private:
+	/** Maps a DX10 header's DXGI_FORMAT, sets the sRGB flag from the format */
+	bool SetDxgiFormat(uint32 DxgiFormat);
+
+	/** Maps a legacy header's FourCC, or its channel masks for uncompressed data */
+	bool SetLegacyFormat(uint32 PixelFormatFlags, uint32 FourCC, uint32 RGBBitCount, const uint32 (&Masks)[4]);
+
+	void SetFormat(EPixelFormat InPixelFormat, ETextureSourceFormat InTextureFormat, TextureCompressionSettings InCompressionSettings);
+
+	const uint8* Buffer;
+	int64 Length;
+	int64 DataOffset = 0;
+
+	int32 Width = 0;
+	int32 Height = 0;
+	int32 NumMips = 0;
+	EPixelFormat PixelFormat = PF_Unknown;
+	ETextureSourceFormat TextureFormat = TSF_Invalid;
+	TextureCompressionSettings CompressionSettings = TC_Default;
+	bool bSRGB = true;
+	bool bHeaderRead = false;
+};
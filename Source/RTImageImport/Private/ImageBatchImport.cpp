@@ -0,0 +1,373 @@
+#include "ImageImporter.h"
+
+#include "ImageDecoderRegistry.h"
+#include "ImageFileView.h"
+#include "ImageScratchBufferPool.h"
+#include "ImageTextureCache.h"
+#include "TextureDecodeTarget.h"
+#include "Async/Async.h"
+#include "Engine/Texture2D.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+
+
+static TAutoConsoleVariable<int32> CVarBatchMaxWorkers(
+	TEXT("RTImageImport.Batch.MaxWorkers"),
+	0,
+	TEXT("Maximum number of files decoded concurrently by a batch import, 0 uses the number of cores minus one."));
+
+static TAutoConsoleVariable<int32> CVarBatchMaxInFlightMB(
+	TEXT("RTImageImport.Batch.MaxInFlightMB"),
+	1024,
+	TEXT("Maximum amount of file and decoded data a batch import holds, files wait for uploads to catch up before they are decoded."));
+
+/**
+ * Shared state of one ImportFilesAsync call. Every file is its own thread pool task and at most
+ * MaxWorkers of them run at once, no task ever waits. A task reserves the file and the decoded size
+ * estimated from the header in the in-flight budget before decoding, or hands the file back to wait
+ * for budget when it doesn't fit. Uploads happen on the game thread as soon as a file is decoded,
+ * which releases its budget and starts the next files.
+ */
+class FImageBatchImport : public TSharedFromThis<FImageBatchImport, ESPMode::ThreadSafe>
+{
+public:
+	FImageBatchImport(UImageImporter* InImporter, const TArray<FString>& InFilenames, FOnImageBatchImportedNative InOnImported)
+		: Importer(InImporter)
+		, CacheLookupTemplate(InImporter->CreateCacheLookup())
+		, Filenames(InFilenames)
+		, OnImported(MoveTemp(InOnImported))
+		, MaxInFlightBytes(FMath::Max<int64>(CVarBatchMaxInFlightMB.GetValueOnGameThread(), 1) * 1024 * 1024)
+	{
+		Results.SetNum(Filenames.Num());
+		for (int32 Index = 0; Index < Filenames.Num(); ++Index)
+		{
+			Results[Index].Filename = Filenames[Index];
+		}
+		NumRemaining = Filenames.Num();
+	}
+
+	void Start()
+	{
+		check(IsInGameThread());
+
+		StartTime = FPlatformTime::Seconds();
+
+		if (Filenames.Num() == 0)
+		{
+			Finish();
+			return;
+		}
+
+		MaxWorkers = CVarBatchMaxWorkers.GetValueOnGameThread();
+		if (MaxWorkers <= 0)
+		{
+			MaxWorkers = FPlatformMisc::NumberOfCores() - 1;
+		}
+		MaxWorkers = FMath::Clamp(MaxWorkers, 1, Filenames.Num());
+		Stats.NumWorkers = MaxWorkers;
+
+		FScopeLock Lock(&Critical);
+		StartFiles();
+	}
+
+private:
+	/** A file that didn't fit into the budget, it is started again once Bytes can be reserved */
+	struct FWaitingFile
+	{
+		int32 Index = 0;
+		int64 Bytes = 0;
+	};
+
+	/** Starts tasks for waiting files, then for new ones, while there are free workers. Critical has to be held. */
+	void StartFiles()
+	{
+		while (NumActiveTasks < MaxWorkers)
+		{
+			if (WaitingFiles.Num() > 0)
+			{
+				// In order, so smaller files can't keep a large one waiting forever
+				const FWaitingFile File = WaitingFiles[0];
+				if (!TryReserve(File.Bytes))
+				{
+					break;
+				}
+				WaitingFiles.RemoveAt(0, 1, false);
+				StartTask(File.Index, File.Bytes);
+			}
+			else if (NextIndex < Filenames.Num() && InFlightBytes < MaxInFlightBytes)
+			{
+				StartTask(NextIndex++, 0);
+			}
+			else
+			{
+				break;
+			}
+		}
+	}
+
+	void StartTask(int32 Index, int64 ReservedBytes)
+	{
+		++NumActiveTasks;
+		Async(EAsyncExecution::ThreadPool, [This = AsShared(), Index, ReservedBytes]()
+		{
+			This->ProcessFile(Index, ReservedBytes);
+
+			FScopeLock Lock(&This->Critical);
+			--This->NumActiveTasks;
+			This->StartFiles();
+		});
+	}
+
+	/** ReservedBytes is what a waiting file already holds of the budget, 0 for a file that starts for the first time */
+	void ProcessFile(int32 Index, int64 ReservedBytes)
+	{
+		const double FileStartTime = FPlatformTime::Seconds();
+		const FString& Filename = Filenames[Index];
+
+		// Cached files never take budget, their texture already exists
+		TSharedRef<FImageCacheLookup, ESPMode::ThreadSafe> CacheLookup = MakeShared<FImageCacheLookup, ESPMode::ThreadSafe>(CacheLookupTemplate);
+		if (CacheLookup->PinByPath(Filename))
+		{
+			AdjustBudget(-ReservedBytes);
+			AsyncTask(ENamedThreads::GameThread, [This = AsShared(), Index, CacheLookup]()
+			{
+				This->CompleteCachedFile(Index, CacheLookup->TakeTexture(), 0);
+			});
+			return;
+		}
+
+		TSharedRef<FImportedImageStruct> Image = MakeShared<FImportedImageStruct>();
+		TSharedRef<FTextureDecodeTarget, ESPMode::ThreadSafe> Target = MakeShared<FTextureDecodeTarget, ESPMode::ThreadSafe>(Importer);
+		bool bDecoded = false;
+		int64 FileSize = 0;
+
+		FImageFileView Data;
+		if (Data.Open(*Filename) && Data.Num() > 0 && Data.Num() <= MAX_uint32)
+		{
+			FileSize = Data.Num();
+			if (CacheLookup->PinByContent(Data.GetData(), Data.Num()))
+			{
+				Data.Close();
+				AdjustBudget(-ReservedBytes);
+
+				AsyncTask(ENamedThreads::GameThread, [This = AsShared(), Index, CacheLookup, FileSize]()
+				{
+					This->CompleteCachedFile(Index, CacheLookup->TakeTexture(), FileSize);
+				});
+				return;
+			}
+
+			// The decoded image is budgeted up front where the decoder can tell its size from the header,
+			// the rest is reconciled with the actual size once it is decoded
+			if (ReservedBytes == 0)
+			{
+				FImageHeaderInfo HeaderInfo;
+				const bool bHasHeaderInfo = FImageDecoderRegistry::Get().ReadHeaderInfo(Data.GetData(), Data.Num(), HeaderInfo);
+				const int64 EstimatedBytes = FileSize + (bHasHeaderInfo ? Importer->EstimateImportBytes(HeaderInfo) : 0);
+				if (!ReserveOrWait(Index, EstimatedBytes))
+				{
+					return;
+				}
+				ReservedBytes = EstimatedBytes;
+			}
+
+			bDecoded = Importer->ImportImage(Data.GetData(), Data.Num(), *Image, &Target.Get());
+		}
+		else
+		{
+			UE_LOG(ImageImporter, Error, TEXT("Failed to load file '%s'"), *Filename);
+		}
+		Data.Close();
+
+		// The file is unmapped, what is left in flight is the decoded image until it is uploaded, in RawData
+		// or in the locked mips of the texture it was decoded into
+		const int64 DecodedSize = bDecoded ? GetDecodedBytes(*Image) : 0;
+		AdjustBudget(DecodedSize - ReservedBytes);
+
+		const float DecodeSeconds = float(FPlatformTime::Seconds() - FileStartTime);
+
+		AsyncTask(ENamedThreads::GameThread, [This = AsShared(), Index, Image, Target, CacheLookup, bDecoded, FileSize, DecodedSize, DecodeSeconds]()
+		{
+			This->CompleteFile(Index, *Image, *Target, *CacheLookup, bDecoded, FileSize, DecodeSeconds);
+			FImageScratchBufferPool::Get().Release(Image->RawData);
+			This->AdjustBudget(-DecodedSize);
+		});
+	}
+
+	void CompleteFile(int32 Index, const FImportedImageStruct& Image, FTextureDecodeTarget& Target, FImageCacheLookup& CacheLookup, bool bDecoded, int64 FileSize, float DecodeSeconds)
+	{
+		check(IsInGameThread());
+
+		FImageImportResult& Result = Results[Index];
+		Result.BytesRead = FileSize;
+		Result.DecodeSeconds = DecodeSeconds;
+		Result.Texture = Target.FinishTexture(Image, bDecoded);
+		CacheLookup.AddTexture(Result.Texture);
+
+		CompleteResult(Result);
+	}
+
+	void CompleteCachedFile(int32 Index, UTexture2D* Texture, int64 FileSize)
+	{
+		check(IsInGameThread());
+
+		FImageImportResult& Result = Results[Index];
+		Result.BytesRead = FileSize;
+		Result.Texture = Texture;
+
+		CompleteResult(Result);
+	}
+
+	void CompleteResult(FImageImportResult& Result)
+	{
+		Result.bSuccess = Result.Texture != nullptr;
+
+		Stats.TotalBytesRead += Result.BytesRead;
+		if (Result.bSuccess)
+		{
+			Importer->PendingTextures.Add(Result.Texture);
+			Stats.TotalPixels += (int64)Result.Texture->GetSizeX() * Result.Texture->GetSizeY();
+			++Stats.NumSucceeded;
+		}
+		else
+		{
+			UE_LOG(ImageImporter, Warning, TEXT("Failed to import '%s'"), *Result.Filename);
+			++Stats.NumFailed;
+		}
+
+		if (--NumRemaining == 0)
+		{
+			Finish();
+		}
+	}
+
+	void Finish()
+	{
+		check(IsInGameThread());
+
+		Stats.WallSeconds = float(FPlatformTime::Seconds() - StartTime);
+		Stats.PeakInFlightBytes = PeakInFlightBytes;
+		if (Stats.WallSeconds > 0.f)
+		{
+			Stats.MegabytesPerSecond = float(Stats.TotalBytesRead / (1024.0 * 1024.0) / Stats.WallSeconds);
+			Stats.MegapixelsPerSecond = float(Stats.TotalPixels / 1.0e6 / Stats.WallSeconds);
+		}
+
+		UE_LOG(ImageImporter, Log, TEXT("Batch imported %d/%d files in %.2fs with %d workers (%.1f MB/s, %.1f MP/s)"),
+			Stats.NumSucceeded, Results.Num(), Stats.WallSeconds, Stats.NumWorkers, Stats.MegabytesPerSecond, Stats.MegapixelsPerSecond);
+
+		for (const FImageImportResult& Result : Results)
+		{
+			if (Result.Texture)
+			{
+				Importer->PendingTextures.RemoveSingleSwap(Result.Texture);
+			}
+		}
+
+		OnImported.ExecuteIfBound(Results, Stats);
+		Importer->EndAsyncImport();
+	}
+
+	static int64 GetDecodedBytes(const FImportedImageStruct& Image)
+	{
+		if (!Image.IsRawDataInTarget())
+		{
+			return Image.RawData.Num();
+		}
+
+		int64 Size = 0;
+		for (int32 MipIndex = 0; MipIndex < Image.NumMips; ++MipIndex)
+		{
+			Size += Image.GetMipSize(MipIndex);
+		}
+		return Size;
+	}
+
+	/**
+	 * Reserves Size when it fits into the budget. A single file larger than the budget is let through once
+	 * nothing else is in flight. Critical has to be held.
+	 */
+	bool TryReserve(int64 Size)
+	{
+		if (InFlightBytes > 0 && InFlightBytes + Size > MaxInFlightBytes)
+		{
+			return false;
+		}
+
+		InFlightBytes += Size;
+		PeakInFlightBytes = FMath::Max(PeakInFlightBytes, InFlightBytes);
+		return true;
+	}
+
+	/** Reserves Size, or queues the file to be started again once it fits */
+	bool ReserveOrWait(int32 Index, int64 Size)
+	{
+		FScopeLock Lock(&Critical);
+		if (TryReserve(Size))
+		{
+			return true;
+		}
+
+		WaitingFiles.Add({ Index, Size });
+		return false;
+	}
+
+	void AdjustBudget(int64 Delta)
+	{
+		if (Delta == 0)
+		{
+			return;
+		}
+
+		FScopeLock Lock(&Critical);
+		InFlightBytes += Delta;
+		PeakInFlightBytes = FMath::Max(PeakInFlightBytes, InFlightBytes);
+
+		if (Delta < 0)
+		{
+			StartFiles();
+		}
+	}
+
+	UImageImporter* Importer;
+	/** Captures the cache settings at the start of the batch, copied for every file */
+	const FImageCacheLookup CacheLookupTemplate;
+	TArray<FString> Filenames;
+	TArray<FImageImportResult> Results;
+	FImageBatchImportStats Stats;
+	FOnImageBatchImportedNative OnImported;
+
+	int32 NumRemaining = 0;
+	double StartTime = 0.0;
+	int32 MaxWorkers = 1;
+
+	/** Guards the scheduling and the budget below, tasks and the game thread both start files */
+	FCriticalSection Critical;
+	int32 NextIndex = 0;
+	int32 NumActiveTasks = 0;
+	TArray<FWaitingFile> WaitingFiles;
+	const int64 MaxInFlightBytes;
+	int64 InFlightBytes = 0;
+	int64 PeakInFlightBytes = 0;
+};
+
+void UImageImporter::ImportFilesAsync(const TArray<FString>& Filenames, FOnImageBatchImported OnImported)
+{
+	ImportFilesAsync(Filenames, FOnImageBatchImportedNative::CreateLambda([OnImported](const TArray<FImageImportResult>& Results, const FImageBatchImportStats& Stats)
+	{
+		OnImported.ExecuteIfBound(Results, Stats);
+	}));
+}
+
+void UImageImporter::ImportFilesAsync(const TArray<FString>& Filenames, FOnImageBatchImportedNative OnImported)
+{
+	check(IsInGameThread());
+
+	// The registry loads the image wrapper module, which only works on the game thread, make sure it exists before going wide
+	FImageDecoderRegistry::Get();
+
+	BeginAsyncImport();
+
+	TSharedRef<FImageBatchImport, ESPMode::ThreadSafe> Batch = MakeShared<FImageBatchImport, ESPMode::ThreadSafe>(this, Filenames, MoveTemp(OnImported));
+	Batch->Start();
+}
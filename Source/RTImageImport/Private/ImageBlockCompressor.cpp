@@ -0,0 +1,689 @@
+#include "ImageBlockCompressor.h"
+
+#include "Async/ParallelFor.h"
+
+
+namespace
+{
+	constexpr int32 PixelsPerBlock = 16;
+
+	/** Below this many blocks a mip isn't worth going wide for */
+	constexpr int32 MinBlocksForParallelMip = 64;
+
+	/** One 4x4 block split into R, G, B and A lanes of 16 floats, the per pixel loops below walk one lane at a time */
+	struct FBlockPixels
+	{
+		float Channels[4][PixelsPerBlock];
+	};
+
+	void GatherBlock(ETextureSourceFormat SourceFormat, const uint8* Src, int32 SizeX, int32 SizeY, int32 BlockX, int32 BlockY, FBlockPixels& OutBlock)
+	{
+		for (int32 Y = 0; Y < 4; ++Y)
+		{
+			const int64 SrcY = FMath::Min(BlockY * 4 + Y, SizeY - 1);
+			for (int32 X = 0; X < 4; ++X)
+			{
+				const int64 SrcX = FMath::Min(BlockX * 4 + X, SizeX - 1);
+				const int32 Index = Y * 4 + X;
+
+				if (SourceFormat == TSF_G8)
+				{
+					const float Gray = Src[SrcY * SizeX + SrcX];
+					OutBlock.Channels[0][Index] = Gray;
+					OutBlock.Channels[1][Index] = Gray;
+					OutBlock.Channels[2][Index] = Gray;
+					OutBlock.Channels[3][Index] = 255.f;
+				}
+				else
+				{
+					const uint8* Pixel = Src + (SrcY * SizeX + SrcX) * 4;
+					OutBlock.Channels[0][Index] = Pixel[2];
+					OutBlock.Channels[1][Index] = Pixel[1];
+					OutBlock.Channels[2][Index] = Pixel[0];
+					OutBlock.Channels[3][Index] = Pixel[3];
+				}
+			}
+		}
+	}
+
+	/**
+	 * Line through the block colors the endpoints are picked on. Fast uses the bounding box diagonal with
+	 * the channels flipped that run against the widest one, Quality the principal axis of the covariance.
+	 */
+	template<int32 NumChannels>
+	void FindEndpoints(const float* const* Lanes, EImageCompressionQuality Quality, float* OutStart, float* OutEnd)
+	{
+		float Min[NumChannels], Max[NumChannels], Mean[NumChannels];
+		for (int32 Channel = 0; Channel < NumChannels; ++Channel)
+		{
+			const float* Lane = Lanes[Channel];
+			float LaneMin = Lane[0], LaneMax = Lane[0], LaneSum = 0.f;
+			for (int32 Index = 0; Index < PixelsPerBlock; ++Index)
+			{
+				LaneMin = FMath::Min(LaneMin, Lane[Index]);
+				LaneMax = FMath::Max(LaneMax, Lane[Index]);
+				LaneSum += Lane[Index];
+			}
+			Min[Channel] = LaneMin;
+			Max[Channel] = LaneMax;
+			Mean[Channel] = LaneSum / PixelsPerBlock;
+		}
+
+		float Covariance[NumChannels][NumChannels];
+		for (int32 ChannelA = 0; ChannelA < NumChannels; ++ChannelA)
+		{
+			for (int32 ChannelB = ChannelA; ChannelB < NumChannels; ++ChannelB)
+			{
+				float Sum = 0.f;
+				for (int32 Index = 0; Index < PixelsPerBlock; ++Index)
+				{
+					Sum += (Lanes[ChannelA][Index] - Mean[ChannelA]) * (Lanes[ChannelB][Index] - Mean[ChannelB]);
+				}
+				Covariance[ChannelA][ChannelB] = Sum;
+				Covariance[ChannelB][ChannelA] = Sum;
+			}
+		}
+
+		if (Quality == EImageCompressionQuality::Fast)
+		{
+			int32 WidestChannel = 0;
+			for (int32 Channel = 1; Channel < NumChannels; ++Channel)
+			{
+				if (Max[Channel] - Min[Channel] > Max[WidestChannel] - Min[WidestChannel])
+				{
+					WidestChannel = Channel;
+				}
+			}
+
+			for (int32 Channel = 0; Channel < NumChannels; ++Channel)
+			{
+				// Inset by 1/16 of the range, the extremes are rarely worth a full palette entry
+				const float Inset = (Max[Channel] - Min[Channel]) / 16.f;
+				const bool bFlip = Covariance[WidestChannel][Channel] < 0.f;
+				OutStart[Channel] = bFlip ? Max[Channel] - Inset : Min[Channel] + Inset;
+				OutEnd[Channel] = bFlip ? Min[Channel] + Inset : Max[Channel] - Inset;
+			}
+			return;
+		}
+
+		float Axis[NumChannels];
+		for (int32 Channel = 0; Channel < NumChannels; ++Channel)
+		{
+			Axis[Channel] = Max[Channel] - Min[Channel];
+		}
+
+		// Power iteration converges on the principal axis within a few steps for 16 samples
+		for (int32 Iteration = 0; Iteration < 8; ++Iteration)
+		{
+			float NextAxis[NumChannels];
+			float Largest = 0.f;
+			for (int32 Row = 0; Row < NumChannels; ++Row)
+			{
+				NextAxis[Row] = 0.f;
+				for (int32 Column = 0; Column < NumChannels; ++Column)
+				{
+					NextAxis[Row] += Covariance[Row][Column] * Axis[Column];
+				}
+				Largest = FMath::Max(Largest, FMath::Abs(NextAxis[Row]));
+			}
+
+			if (Largest < KINDA_SMALL_NUMBER)
+			{
+				break;
+			}
+
+			for (int32 Channel = 0; Channel < NumChannels; ++Channel)
+			{
+				Axis[Channel] = NextAxis[Channel] / Largest;
+			}
+		}
+
+		float AxisLengthSquared = 0.f;
+		for (int32 Channel = 0; Channel < NumChannels; ++Channel)
+		{
+			AxisLengthSquared += Axis[Channel] * Axis[Channel];
+		}
+
+		if (AxisLengthSquared < KINDA_SMALL_NUMBER)
+		{
+			for (int32 Channel = 0; Channel < NumChannels; ++Channel)
+			{
+				OutStart[Channel] = Min[Channel];
+				OutEnd[Channel] = Max[Channel];
+			}
+			return;
+		}
+
+		float MinProjection = MAX_flt, MaxProjection = -MAX_flt;
+		for (int32 Index = 0; Index < PixelsPerBlock; ++Index)
+		{
+			float Projection = 0.f;
+			for (int32 Channel = 0; Channel < NumChannels; ++Channel)
+			{
+				Projection += (Lanes[Channel][Index] - Mean[Channel]) * Axis[Channel];
+			}
+			MinProjection = FMath::Min(MinProjection, Projection);
+			MaxProjection = FMath::Max(MaxProjection, Projection);
+		}
+
+		for (int32 Channel = 0; Channel < NumChannels; ++Channel)
+		{
+			OutStart[Channel] = FMath::Clamp(Mean[Channel] + Axis[Channel] * MinProjection / AxisLengthSquared, 0.f, 255.f);
+			OutEnd[Channel] = FMath::Clamp(Mean[Channel] + Axis[Channel] * MaxProjection / AxisLengthSquared, 0.f, 255.f);
+		}
+	}
+
+	/**
+	 * Least squares endpoints for fixed indices, Weights holds how much of endpoint 0 each pixel gets.
+	 * Returns false when the indices don't constrain both endpoints.
+	 */
+	bool RefineEndpoints(const float* const* Lanes, int32 NumChannels, const float* Weights, float* OutEndpoint0, float* OutEndpoint1)
+	{
+		float A = 0.f, B = 0.f, C = 0.f;
+		for (int32 Index = 0; Index < PixelsPerBlock; ++Index)
+		{
+			const float Alpha = Weights[Index];
+			const float Beta = 1.f - Alpha;
+			A += Alpha * Alpha;
+			B += Alpha * Beta;
+			C += Beta * Beta;
+		}
+
+		const float Determinant = A * C - B * B;
+		if (FMath::Abs(Determinant) < KINDA_SMALL_NUMBER)
+		{
+			return false;
+		}
+
+		for (int32 Channel = 0; Channel < NumChannels; ++Channel)
+		{
+			float X = 0.f, Y = 0.f;
+			for (int32 Index = 0; Index < PixelsPerBlock; ++Index)
+			{
+				X += Weights[Index] * Lanes[Channel][Index];
+				Y += (1.f - Weights[Index]) * Lanes[Channel][Index];
+			}
+			OutEndpoint0[Channel] = FMath::Clamp((C * X - B * Y) / Determinant, 0.f, 255.f);
+			OutEndpoint1[Channel] = FMath::Clamp((A * Y - B * X) / Determinant, 0.f, 255.f);
+		}
+		return true;
+	}
+
+	/** Index of the closest palette entry for every pixel, returns the summed squared error */
+	template<int32 NumChannels, int32 NumEntries>
+	float SelectIndices(const float* const* Lanes, const float (&Palette)[NumEntries][NumChannels], uint8* OutIndices)
+	{
+		float TotalError = 0.f;
+		for (int32 Index = 0; Index < PixelsPerBlock; ++Index)
+		{
+			float BestError = MAX_flt;
+			uint8 BestEntry = 0;
+			for (int32 Entry = 0; Entry < NumEntries; ++Entry)
+			{
+				float Error = 0.f;
+				for (int32 Channel = 0; Channel < NumChannels; ++Channel)
+				{
+					const float Delta = Lanes[Channel][Index] - Palette[Entry][Channel];
+					Error += Delta * Delta;
+				}
+
+				if (Error < BestError)
+				{
+					BestError = Error;
+					BestEntry = (uint8)Entry;
+				}
+			}
+			OutIndices[Index] = BestEntry;
+			TotalError += BestError;
+		}
+		return TotalError;
+	}
+
+	//
+	// BC1 color block, also the color half of BC3
+	//
+
+	uint16 QuantizeRGB565(const float* Color)
+	{
+		const uint32 R = FMath::Clamp(FMath::RoundToInt(Color[0] * 31.f / 255.f), 0, 31);
+		const uint32 G = FMath::Clamp(FMath::RoundToInt(Color[1] * 63.f / 255.f), 0, 63);
+		const uint32 B = FMath::Clamp(FMath::RoundToInt(Color[2] * 31.f / 255.f), 0, 31);
+		return (uint16)((R << 11) | (G << 5) | B);
+	}
+
+	void DecodeRGB565(uint16 Color, float* OutColor)
+	{
+		const uint32 R = Color >> 11;
+		const uint32 G = (Color >> 5) & 0x3f;
+		const uint32 B = Color & 0x1f;
+		OutColor[0] = float((R << 3) | (R >> 2));
+		OutColor[1] = float((G << 2) | (G >> 4));
+		OutColor[2] = float((B << 3) | (B >> 2));
+	}
+
+	/** Four color mode, Color0 > Color1 */
+	float SelectColorIndices(const float* const* Lanes, uint16 Color0, uint16 Color1, uint8* OutIndices)
+	{
+		float Palette[4][3];
+		DecodeRGB565(Color0, Palette[0]);
+		DecodeRGB565(Color1, Palette[1]);
+		for (int32 Channel = 0; Channel < 3; ++Channel)
+		{
+			Palette[2][Channel] = (2.f * Palette[0][Channel] + Palette[1][Channel]) / 3.f;
+			Palette[3][Channel] = (Palette[0][Channel] + 2.f * Palette[1][Channel]) / 3.f;
+		}
+		return SelectIndices<3, 4>(Lanes, Palette, OutIndices);
+	}
+
+	void EncodeColorBlock(const FBlockPixels& Block, EImageCompressionQuality Quality, uint8* Out)
+	{
+		static const float EndpointWeights[4] = { 1.f, 0.f, 2.f / 3.f, 1.f / 3.f };
+		const float* const Lanes[3] = { Block.Channels[0], Block.Channels[1], Block.Channels[2] };
+
+		float Start[3], End[3];
+		FindEndpoints<3>(Lanes, Quality, Start, End);
+
+		uint16 Color0 = QuantizeRGB565(End);
+		uint16 Color1 = QuantizeRGB565(Start);
+		if (Color0 < Color1)
+		{
+			Swap(Color0, Color1);
+		}
+
+		uint8 Indices[PixelsPerBlock] = {};
+		if (Color0 != Color1)
+		{
+			float Error = SelectColorIndices(Lanes, Color0, Color1, Indices);
+
+			if (Quality == EImageCompressionQuality::Quality)
+			{
+				for (int32 Iteration = 0; Iteration < 2; ++Iteration)
+				{
+					float Weights[PixelsPerBlock];
+					for (int32 Index = 0; Index < PixelsPerBlock; ++Index)
+					{
+						Weights[Index] = EndpointWeights[Indices[Index]];
+					}
+
+					float Refined0[3], Refined1[3];
+					if (!RefineEndpoints(Lanes, 3, Weights, Refined0, Refined1))
+					{
+						break;
+					}
+
+					uint16 NewColor0 = QuantizeRGB565(Refined0);
+					uint16 NewColor1 = QuantizeRGB565(Refined1);
+					if (NewColor0 < NewColor1)
+					{
+						Swap(NewColor0, NewColor1);
+					}
+
+					uint8 NewIndices[PixelsPerBlock];
+					const float NewError = NewColor0 != NewColor1 ? SelectColorIndices(Lanes, NewColor0, NewColor1, NewIndices) : MAX_flt;
+					if (NewError >= Error)
+					{
+						break;
+					}
+
+					Color0 = NewColor0;
+					Color1 = NewColor1;
+					FMemory::Memcpy(Indices, NewIndices, sizeof(Indices));
+					Error = NewError;
+				}
+			}
+		}
+
+		uint32 IndexBits = 0;
+		for (int32 Index = 0; Index < PixelsPerBlock; ++Index)
+		{
+			IndexBits |= uint32(Indices[Index]) << (Index * 2);
+		}
+
+		Out[0] = Color0 & 0xff;
+		Out[1] = Color0 >> 8;
+		Out[2] = Color1 & 0xff;
+		Out[3] = Color1 >> 8;
+		Out[4] = IndexBits & 0xff;
+		Out[5] = (IndexBits >> 8) & 0xff;
+		Out[6] = (IndexBits >> 16) & 0xff;
+		Out[7] = IndexBits >> 24;
+	}
+
+	//
+	// BC4 single channel block, also the alpha half of BC3 and both halves of BC5
+	//
+
+	float SelectSingleChannelIndices(const float* Lane, uint8 Value0, uint8 Value1, uint8* OutIndices)
+	{
+		float Palette[8][1];
+		Palette[0][0] = Value0;
+		Palette[1][0] = Value1;
+		if (Value0 > Value1)
+		{
+			for (int32 Step = 1; Step < 7; ++Step)
+			{
+				Palette[Step + 1][0] = ((7 - Step) * float(Value0) + Step * float(Value1)) / 7.f;
+			}
+		}
+		else
+		{
+			for (int32 Step = 1; Step < 5; ++Step)
+			{
+				Palette[Step + 1][0] = ((5 - Step) * float(Value0) + Step * float(Value1)) / 5.f;
+			}
+			Palette[6][0] = 0.f;
+			Palette[7][0] = 255.f;
+		}
+
+		const float* const Lanes[1] = { Lane };
+		return SelectIndices<1, 8>(Lanes, Palette, OutIndices);
+	}
+
+	void EncodeSingleChannelBlock(const float* Lane, EImageCompressionQuality Quality, uint8* Out)
+	{
+		static const float EndpointWeights[8] = { 1.f, 0.f, 6.f / 7.f, 5.f / 7.f, 4.f / 7.f, 3.f / 7.f, 2.f / 7.f, 1.f / 7.f };
+
+		float Min = Lane[0], Max = Lane[0];
+		float InnerMin = 255.f, InnerMax = 0.f;
+		bool bHasExtremes = false;
+		for (int32 Index = 0; Index < PixelsPerBlock; ++Index)
+		{
+			Min = FMath::Min(Min, Lane[Index]);
+			Max = FMath::Max(Max, Lane[Index]);
+			if (Lane[Index] == 0.f || Lane[Index] == 255.f)
+			{
+				bHasExtremes = true;
+			}
+			else
+			{
+				InnerMin = FMath::Min(InnerMin, Lane[Index]);
+				InnerMax = FMath::Max(InnerMax, Lane[Index]);
+			}
+		}
+
+		uint8 Value0 = (uint8)FMath::RoundToInt(Max);
+		uint8 Value1 = (uint8)FMath::RoundToInt(Min);
+		uint8 Indices[PixelsPerBlock] = {};
+
+		if (Value0 != Value1)
+		{
+			float Error = SelectSingleChannelIndices(Lane, Value0, Value1, Indices);
+
+			if (Quality == EImageCompressionQuality::Quality)
+			{
+				const float* const Lanes[1] = { Lane };
+				float Weights[PixelsPerBlock];
+				for (int32 Index = 0; Index < PixelsPerBlock; ++Index)
+				{
+					Weights[Index] = EndpointWeights[Indices[Index]];
+				}
+
+				float Refined0, Refined1;
+				if (RefineEndpoints(Lanes, 1, Weights, &Refined0, &Refined1))
+				{
+					const uint8 NewValue0 = (uint8)FMath::RoundToInt(Refined0);
+					const uint8 NewValue1 = (uint8)FMath::RoundToInt(Refined1);
+					if (NewValue0 > NewValue1)
+					{
+						uint8 NewIndices[PixelsPerBlock];
+						const float NewError = SelectSingleChannelIndices(Lane, NewValue0, NewValue1, NewIndices);
+						if (NewError < Error)
+						{
+							Value0 = NewValue0;
+							Value1 = NewValue1;
+							FMemory::Memcpy(Indices, NewIndices, sizeof(Indices));
+							Error = NewError;
+						}
+					}
+				}
+
+				// Blocks with fully black or white pixels can spend the six entry mode on the rest
+				if (bHasExtremes && InnerMin <= InnerMax)
+				{
+					const uint8 NewValue0 = (uint8)FMath::RoundToInt(InnerMin);
+					const uint8 NewValue1 = (uint8)FMath::RoundToInt(InnerMax);
+					uint8 NewIndices[PixelsPerBlock];
+					const float NewError = SelectSingleChannelIndices(Lane, NewValue0, NewValue1, NewIndices);
+					if (NewError < Error)
+					{
+						Value0 = NewValue0;
+						Value1 = NewValue1;
+						FMemory::Memcpy(Indices, NewIndices, sizeof(Indices));
+						Error = NewError;
+					}
+				}
+			}
+		}
+
+		uint64 IndexBits = 0;
+		for (int32 Index = 0; Index < PixelsPerBlock; ++Index)
+		{
+			IndexBits |= uint64(Indices[Index]) << (Index * 3);
+		}
+
+		Out[0] = Value0;
+		Out[1] = Value1;
+		for (int32 Byte = 0; Byte < 6; ++Byte)
+		{
+			Out[2 + Byte] = (IndexBits >> (Byte * 8)) & 0xff;
+		}
+	}
+
+	//
+	// BC7, mode 6 only: one subset, 7 bit RGBA endpoints with a p-bit each and 4 bit indices
+	//
+
+	struct FBlockBitWriter
+	{
+		uint8* Out;
+		int32 BitPosition = 0;
+
+		void Write(uint32 Value, int32 NumBits)
+		{
+			for (int32 Bit = 0; Bit < NumBits; ++Bit, ++BitPosition)
+			{
+				if ((Value >> Bit) & 1)
+				{
+					Out[BitPosition >> 3] |= uint8(1 << (BitPosition & 7));
+				}
+			}
+		}
+	};
+
+	static const int32 BC7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	/** 7 bit channels plus the p-bit that gives the lowest error for this endpoint */
+	void QuantizeBC7Endpoint(const float* Endpoint, uint8* OutQuantized, uint8& OutPBit)
+	{
+		float BestError = MAX_flt;
+		for (uint8 PBit = 0; PBit < 2; ++PBit)
+		{
+			uint8 Quantized[4];
+			float Error = 0.f;
+			for (int32 Channel = 0; Channel < 4; ++Channel)
+			{
+				Quantized[Channel] = (uint8)FMath::Clamp(FMath::RoundToInt((Endpoint[Channel] - PBit) * 0.5f), 0, 127);
+				const float Delta = float((Quantized[Channel] << 1) | PBit) - Endpoint[Channel];
+				Error += Delta * Delta;
+			}
+
+			if (Error < BestError)
+			{
+				BestError = Error;
+				OutPBit = PBit;
+				FMemory::Memcpy(OutQuantized, Quantized, sizeof(Quantized));
+			}
+		}
+	}
+
+	float SelectBC7Indices(const float* const* Lanes, const uint8* Quantized0, uint8 PBit0, const uint8* Quantized1, uint8 PBit1, uint8* OutIndices)
+	{
+		float Palette[16][4];
+		for (int32 Channel = 0; Channel < 4; ++Channel)
+		{
+			const int32 Value0 = (Quantized0[Channel] << 1) | PBit0;
+			const int32 Value1 = (Quantized1[Channel] << 1) | PBit1;
+			for (int32 Entry = 0; Entry < 16; ++Entry)
+			{
+				Palette[Entry][Channel] = float(((64 - BC7Weights4[Entry]) * Value0 + BC7Weights4[Entry] * Value1 + 32) >> 6);
+			}
+		}
+		return SelectIndices<4, 16>(Lanes, Palette, OutIndices);
+	}
+
+	void EncodeBC7Block(const FBlockPixels& Block, EImageCompressionQuality Quality, uint8* Out)
+	{
+		const float* const Lanes[4] = { Block.Channels[0], Block.Channels[1], Block.Channels[2], Block.Channels[3] };
+
+		float Start[4], End[4];
+		FindEndpoints<4>(Lanes, Quality, Start, End);
+
+		uint8 Quantized0[4], Quantized1[4], PBit0 = 0, PBit1 = 0;
+		QuantizeBC7Endpoint(Start, Quantized0, PBit0);
+		QuantizeBC7Endpoint(End, Quantized1, PBit1);
+
+		uint8 Indices[PixelsPerBlock];
+		float Error = SelectBC7Indices(Lanes, Quantized0, PBit0, Quantized1, PBit1, Indices);
+
+		if (Quality == EImageCompressionQuality::Quality)
+		{
+			for (int32 Iteration = 0; Iteration < 2; ++Iteration)
+			{
+				float Weights[PixelsPerBlock];
+				for (int32 Index = 0; Index < PixelsPerBlock; ++Index)
+				{
+					Weights[Index] = 1.f - BC7Weights4[Indices[Index]] / 64.f;
+				}
+
+				float Refined0[4], Refined1[4];
+				if (!RefineEndpoints(Lanes, 4, Weights, Refined0, Refined1))
+				{
+					break;
+				}
+
+				uint8 NewQuantized0[4], NewQuantized1[4], NewPBit0 = 0, NewPBit1 = 0;
+				QuantizeBC7Endpoint(Refined0, NewQuantized0, NewPBit0);
+				QuantizeBC7Endpoint(Refined1, NewQuantized1, NewPBit1);
+
+				uint8 NewIndices[PixelsPerBlock];
+				const float NewError = SelectBC7Indices(Lanes, NewQuantized0, NewPBit0, NewQuantized1, NewPBit1, NewIndices);
+				if (NewError >= Error)
+				{
+					break;
+				}
+
+				FMemory::Memcpy(Quantized0, NewQuantized0, sizeof(Quantized0));
+				FMemory::Memcpy(Quantized1, NewQuantized1, sizeof(Quantized1));
+				PBit0 = NewPBit0;
+				PBit1 = NewPBit1;
+				FMemory::Memcpy(Indices, NewIndices, sizeof(Indices));
+				Error = NewError;
+			}
+		}
+
+		// The anchor index is stored without its top bit, swap the endpoints when it is set
+		if (Indices[0] & 0x8)
+		{
+			for (int32 Channel = 0; Channel < 4; ++Channel)
+			{
+				Swap(Quantized0[Channel], Quantized1[Channel]);
+			}
+			Swap(PBit0, PBit1);
+			for (int32 Index = 0; Index < PixelsPerBlock; ++Index)
+			{
+				Indices[Index] = 15 - Indices[Index];
+			}
+		}
+
+		FMemory::Memzero(Out, 16);
+		FBlockBitWriter Writer{ Out };
+		Writer.Write(1 << 6, 7);
+		for (int32 Channel = 0; Channel < 4; ++Channel)
+		{
+			Writer.Write(Quantized0[Channel], 7);
+			Writer.Write(Quantized1[Channel], 7);
+		}
+		Writer.Write(PBit0, 1);
+		Writer.Write(PBit1, 1);
+		Writer.Write(Indices[0], 3);
+		for (int32 Index = 1; Index < PixelsPerBlock; ++Index)
+		{
+			Writer.Write(Indices[Index], 4);
+		}
+	}
+}
+
+EPixelFormat GetBlockCompressedFormat(TextureCompressionSettings Settings, ETextureSourceFormat SourceFormat, bool bSRGB, bool bHasAlpha)
+{
+	if (SourceFormat != TSF_BGRA8 && SourceFormat != TSF_G8)
+	{
+		return PF_Unknown;
+	}
+
+	switch (Settings)
+	{
+	case TC_Default:
+	case TC_Masks:
+		return bHasAlpha ? PF_DXT5 : PF_DXT1;
+
+	case TC_Normalmap:
+		return PF_BC5;
+
+	case TC_Grayscale:
+		return bSRGB ? PF_DXT1 : PF_BC4;
+
+	case TC_BC7:
+		return PF_BC7;
+
+	default:
+		return PF_Unknown;
+	}
+}
+
+void CompressMipBlocks(EPixelFormat PixelFormat, ETextureSourceFormat SourceFormat, const uint8* Src, int32 SizeX, int32 SizeY, uint8* Dest, EImageCompressionQuality Quality)
+{
+	check(SourceFormat == TSF_BGRA8 || SourceFormat == TSF_G8);
+
+	const int32 NumBlocksX = FMath::DivideAndRoundUp(SizeX, 4);
+	const int32 NumBlocksY = FMath::DivideAndRoundUp(SizeY, 4);
+	const int32 BlockBytes = GPixelFormats[PixelFormat].BlockBytes;
+
+	ParallelFor(NumBlocksY, [&](int32 BlockY)
+	{
+		FBlockPixels Block;
+		for (int32 BlockX = 0; BlockX < NumBlocksX; ++BlockX)
+		{
+			GatherBlock(SourceFormat, Src, SizeX, SizeY, BlockX, BlockY, Block);
+			uint8* Out = Dest + ((int64)BlockY * NumBlocksX + BlockX) * BlockBytes;
+
+			switch (PixelFormat)
+			{
+			case PF_DXT1:
+				EncodeColorBlock(Block, Quality, Out);
+				break;
+
+			case PF_DXT5:
+				EncodeSingleChannelBlock(Block.Channels[3], Quality, Out);
+				EncodeColorBlock(Block, Quality, Out + 8);
+				break;
+
+			case PF_BC4:
+				EncodeSingleChannelBlock(Block.Channels[0], Quality, Out);
+				break;
+
+			case PF_BC5:
+				EncodeSingleChannelBlock(Block.Channels[0], Quality, Out);
+				EncodeSingleChannelBlock(Block.Channels[1], Quality, Out + 8);
+				break;
+
+			case PF_BC7:
+				EncodeBC7Block(Block, Quality, Out);
+				break;
+
+			default:
+				checkNoEntry();
+				break;
+			}
+		}
+	}, NumBlocksX * NumBlocksY < MinBlocksForParallelMip);
+}
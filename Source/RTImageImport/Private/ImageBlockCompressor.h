@@ -0,0 +1,20 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/Texture.h"
+#include "ImageImporter.h"
+
+/**
+ * Block compressed format the compression settings map to for a source format, PF_Unknown keeps the
+ * image uncompressed. Only 8 bit sources (BGRA8, G8) are handled, HDR would need BC6H. BC4 has no sRGB
+ * variant, sRGB grayscale goes to BC1 instead.
+ */
+EPixelFormat GetBlockCompressedFormat(TextureCompressionSettings Settings, ETextureSourceFormat SourceFormat, bool bSRGB, bool bHasAlpha);
+
+/**
+ * Encodes one mip of BGRA8 or G8 pixels into BC1, BC3, BC4, BC5 or BC7 blocks, block rows are encoded in
+ * parallel. Partial blocks at the edges repeat the last row and column. Dest has to hold
+ * ceil(SizeX / 4) * ceil(SizeY / 4) blocks. The block encoders are scalar C++, there are no SSE or NEON
+ * kernels yet, so throughput comes from the block rows running wide only.
+ */
+void CompressMipBlocks(EPixelFormat PixelFormat, ETextureSourceFormat SourceFormat, const uint8* Src, int32 SizeX, int32 SizeY, uint8* Dest, EImageCompressionQuality Quality);
@@ -0,0 +1,155 @@
+#include "ImageDecoderRegistry.h"
+
+#include "BuiltInImageDecoders.h"
+#include "ImageImporter.h"
+#include "Misc/ScopeRWLock.h"
+
+
+static TUniquePtr<FImageDecoderRegistry> GImageDecoderRegistry;
+
+/** Pooled instances never outnumber the threads decoding at once, this only bounds odd bursts */
+static constexpr int32 MaxPooledInstancesPerDecoder = 64;
+
+struct FImageDecoderRegistry::FRegisteredDecoder
+{
+	int32 Handle = 0;
+	FDecoderFactory Factory;
+
+	/** Only asked CanDecode, never decodes */
+	TUniquePtr<IImageDecoder> Probe;
+
+	FCriticalSection PoolCritical;
+	TArray<TUniquePtr<IImageDecoder>> FreeInstances;
+};
+
+FImageDecoderRegistry& FImageDecoderRegistry::Get()
+{
+	if (!GImageDecoderRegistry.IsValid())
+	{
+		check(IsInGameThread());
+		GImageDecoderRegistry = MakeUnique<FImageDecoderRegistry>();
+	}
+	return *GImageDecoderRegistry;
+}
+
+void FImageDecoderRegistry::Shutdown()
+{
+	GImageDecoderRegistry.Reset();
+}
+
+FImageDecoderRegistry::FImageDecoderRegistry()
+{
+	RegisterBuiltInImageDecoders(*this);
+}
+
+FImageDecoderRegistry::~FImageDecoderRegistry() = default;
+
+int32 FImageDecoderRegistry::RegisterDecoder(TConstArrayView<uint8> LeadingBytes, FDecoderFactory Factory)
+{
+	check(IsInGameThread());
+
+	TSharedPtr<FRegisteredDecoder, ESPMode::ThreadSafe> Decoder = MakeShared<FRegisteredDecoder, ESPMode::ThreadSafe>();
+	Decoder->Handle = NextHandle++;
+	Decoder->Probe = Factory();
+	Decoder->Factory = MoveTemp(Factory);
+	check(Decoder->Probe.IsValid());
+
+	FRWScopeLock ScopeLock(Lock, SLT_Write);
+	if (LeadingBytes.Num() == 0)
+	{
+		DecodersWithoutMagic.Insert(Decoder, 0);
+	}
+	for (uint8 LeadingByte : LeadingBytes)
+	{
+		DecodersByLeadingByte[LeadingByte].Insert(Decoder, 0);
+	}
+	return Decoder->Handle;
+}
+
+void FImageDecoderRegistry::UnregisterDecoder(int32 Handle)
+{
+	check(IsInGameThread());
+
+	auto HasHandle = [Handle](const TSharedPtr<FRegisteredDecoder, ESPMode::ThreadSafe>& Decoder) { return Decoder->Handle == Handle; };
+
+	FRWScopeLock ScopeLock(Lock, SLT_Write);
+	for (TArray<TSharedPtr<FRegisteredDecoder, ESPMode::ThreadSafe>>& Decoders : DecodersByLeadingByte)
+	{
+		Decoders.RemoveAll(HasHandle);
+	}
+	DecodersWithoutMagic.RemoveAll(HasHandle);
+}
+
+bool FImageDecoderRegistry::Decode(UImageImporter& Importer, const uint8* Buffer, int64 Length, FImportedImageStruct& OutImage, FImageDecodeTarget* Target, const TCHAR*& OutFormatName)
+{
+	OutFormatName = nullptr;
+
+	TSharedPtr<FRegisteredDecoder, ESPMode::ThreadSafe> Picked = PickDecoder(Buffer, Length);
+	if (!Picked.IsValid())
+	{
+		return false;
+	}
+
+	TUniquePtr<IImageDecoder> Instance = AcquireInstance(*Picked);
+	OutFormatName = Picked->Probe->GetName();
+	const bool bDecoded = Instance->Decode(Importer, Buffer, Length, OutImage, Target);
+	ReleaseInstance(*Picked, MoveTemp(Instance));
+	return bDecoded;
+}
+
+bool FImageDecoderRegistry::ReadHeaderInfo(const uint8* Buffer, int64 Length, FImageHeaderInfo& OutInfo)
+{
+	TSharedPtr<FRegisteredDecoder, ESPMode::ThreadSafe> Picked = PickDecoder(Buffer, Length);
+	if (!Picked.IsValid())
+	{
+		return false;
+	}
+
+	TUniquePtr<IImageDecoder> Instance = AcquireInstance(*Picked);
+	const bool bRead = Instance->ReadHeaderInfo(Buffer, Length, OutInfo);
+	ReleaseInstance(*Picked, MoveTemp(Instance));
+	return bRead && OutInfo.Width > 0 && OutInfo.Height > 0 && OutInfo.Format != TSF_Invalid;
+}
+
+TSharedPtr<FImageDecoderRegistry::FRegisteredDecoder, ESPMode::ThreadSafe> FImageDecoderRegistry::PickDecoder(const uint8* Buffer, int64 Length) const
+{
+	if (Length <= 0)
+	{
+		return nullptr;
+	}
+
+	// Decoding can take long, only the pick happens under the lock
+	FRWScopeLock ScopeLock(Lock, SLT_ReadOnly);
+	for (const TArray<TSharedPtr<FRegisteredDecoder, ESPMode::ThreadSafe>>* Decoders : { &DecodersByLeadingByte[Buffer[0]], &DecodersWithoutMagic })
+	{
+		for (const TSharedPtr<FRegisteredDecoder, ESPMode::ThreadSafe>& Decoder : *Decoders)
+		{
+			if (Decoder->Probe->CanDecode(Buffer, Length))
+			{
+				return Decoder;
+			}
+		}
+	}
+	return nullptr;
+}
+
+TUniquePtr<IImageDecoder> FImageDecoderRegistry::AcquireInstance(FRegisteredDecoder& Decoder)
+{
+	{
+		FScopeLock ScopeLock(&Decoder.PoolCritical);
+		if (Decoder.FreeInstances.Num() > 0)
+		{
+			return Decoder.FreeInstances.Pop(false);
+		}
+	}
+	return Decoder.Factory();
+}
+
+void FImageDecoderRegistry::ReleaseInstance(FRegisteredDecoder& Decoder, TUniquePtr<IImageDecoder> Instance)
+{
+	FScopeLock ScopeLock(&Decoder.PoolCritical);
+	if (Decoder.FreeInstances.Num() < MaxPooledInstancesPerDecoder)
+	{
+		Decoder.FreeInstances.Push(MoveTemp(Instance));
+	}
+}
@@ -0,0 +1,282 @@
+#include "ImageDiskCache.h"
+
+#include "ImageFileView.h"
+#include "ImageScratchBufferPool.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/Crc.h"
+#include "Misc/Guid.h"
+#include "Misc/Paths.h"
+
+
+static TAutoConsoleVariable<int32> CVarDiskCacheMaxSizeMB(
+	TEXT("RTImageImport.DiskCache.MaxSizeMB"),
+	2048,
+	TEXT("Size the on-disk decode cache is trimmed to, least recently used entries are deleted first."));
+
+static TAutoConsoleVariable<bool> CVarDiskCacheVerifyPayload(
+	TEXT("RTImageImport.DiskCache.VerifyPayload"),
+	true,
+	TEXT("Check the CRC of the pixel data of on-disk cache entries before using them, the header is always checked."));
+
+namespace
+{
+	/** Bump whenever the layout or anything that changes the stored pixels (decoders, filters, encoders) changes */
+	constexpr uint32 DiskCacheVersion = 1;
+
+	constexpr uint32 DiskCacheMagic = 0x43495452; // 'RTIC'
+
+	const TCHAR* DiskCacheExtension = TEXT("rtic");
+
+#pragma pack(push, 1)
+	struct FDiskCacheHeader
+	{
+		uint32 Magic;
+		uint32 Version;
+		uint64 Key;
+		int32 SizeX;
+		int32 SizeY;
+		int32 NumMips;
+		uint8 Format;
+		uint8 PixelFormat;
+		uint8 CompressionSettings;
+		uint8 bSRGB;
+		uint64 PayloadSize;
+		uint32 PayloadCrc;
+		/** CRC of everything above */
+		uint32 HeaderCrc;
+		/** Keeps the payload 64 byte aligned in the mapped file */
+		uint8 Padding[16];
+	};
+#pragma pack(pop)
+
+	static_assert(sizeof(FDiskCacheHeader) == 64, "The payload has to start 64 byte aligned");
+
+	uint32 CalcHeaderCrc(const FDiskCacheHeader& Header)
+	{
+		return FCrc::MemCrc32(&Header, STRUCT_OFFSET(FDiskCacheHeader, HeaderCrc));
+	}
+}
+
+FImageDiskCache& FImageDiskCache::Get()
+{
+	static FImageDiskCache Instance;
+	return Instance;
+}
+
+FImageDiskCache::FImageDiskCache()
+	: Directory(FPaths::ProjectSavedDir() / TEXT("RTImageImport") / TEXT("DecodeCache"))
+{
+}
+
+FString FImageDiskCache::GetEntryPath(uint64 Key) const
+{
+	return Directory / FString::Printf(TEXT("%016llx.%s"), Key, DiskCacheExtension);
+}
+
+bool FImageDiskCache::Load(uint64 Key, FImportedImageStruct& OutImage, FImageDecodeTarget* Target)
+{
+	const FString Path = GetEntryPath(Key);
+
+	FImageFileView View;
+	if (!View.Open(*Path))
+	{
+		return false;
+	}
+
+	FDiskCacheHeader Header;
+	if (View.Num() < (int64)sizeof(Header))
+	{
+		View.Close();
+		Discard(Path, TEXT("truncated header"));
+		return false;
+	}
+	FMemory::Memcpy(&Header, View.GetData(), sizeof(Header));
+
+	if (Header.Magic != DiskCacheMagic || Header.HeaderCrc != CalcHeaderCrc(Header) || Header.Key != Key)
+	{
+		View.Close();
+		Discard(Path, TEXT("corrupt header"));
+		return false;
+	}
+
+	if (Header.Version != DiskCacheVersion)
+	{
+		View.Close();
+		Discard(Path, TEXT("stale version"));
+		return false;
+	}
+
+	if (Header.SizeX <= 0 || Header.SizeY <= 0 || Header.NumMips <= 0 || Header.NumMips > MAX_TEXTURE_MIP_COUNT
+		|| Header.Format >= TSF_MAX || Header.PixelFormat >= PF_MAX || Header.CompressionSettings >= TC_MAX
+		|| Header.PayloadSize != uint64(View.Num() - sizeof(Header)))
+	{
+		View.Close();
+		Discard(Path, TEXT("inconsistent header"));
+		return false;
+	}
+
+	OutImage.Init2DWithParams(Header.SizeX, Header.SizeY, ETextureSourceFormat(Header.Format), Header.bSRGB != 0);
+	OutImage.NumMips = Header.NumMips;
+	OutImage.PixelFormat = EPixelFormat(Header.PixelFormat);
+	OutImage.CompressionSettings = TextureCompressionSettings(Header.CompressionSettings);
+
+	int64 ExpectedSize = 0;
+	for (int32 MipIndex = 0; MipIndex < OutImage.NumMips; ++MipIndex)
+	{
+		ExpectedSize += OutImage.GetMipSize(MipIndex);
+	}
+
+	const uint8* Payload = View.GetData() + sizeof(Header);
+	if (ExpectedSize != (int64)Header.PayloadSize
+		|| (CVarDiskCacheVerifyPayload.GetValueOnAnyThread() && FCrc::MemCrc32(Payload, Header.PayloadSize) != Header.PayloadCrc))
+	{
+		OutImage = FImportedImageStruct();
+		View.Close();
+		Discard(Path, TEXT("corrupt payload"));
+		return false;
+	}
+
+	// Block compressed payloads don't fit the source format textures the targets create
+	if (Target && OutImage.PixelFormat == PF_Unknown && Target->AllocateMips(OutImage, OutImage.TargetMipData))
+	{
+		for (int32 MipIndex = 0; MipIndex < OutImage.NumMips; ++MipIndex)
+		{
+			const int64 MipSize = OutImage.GetMipSize(MipIndex);
+			FMemory::Memcpy(OutImage.GetMipData(MipIndex), Payload, MipSize);
+			Payload += MipSize;
+		}
+	}
+	else
+	{
+		OutImage.TargetMipData.Empty();
+		FImageScratchBufferPool::Get().Acquire(OutImage.RawData, Header.PayloadSize);
+		FMemory::Memcpy(OutImage.RawData.GetData(), Payload, Header.PayloadSize);
+	}
+
+	View.Close();
+
+	// The file time is what eviction goes by
+	IFileManager::Get().SetTimeStamp(*Path, FDateTime::UtcNow());
+	return true;
+}
+
+void FImageDiskCache::Store(uint64 Key, FImportedImageStruct& Image)
+{
+	if (Image.RawDataCompressionFormat != TSCF_None)
+	{
+		return;
+	}
+
+	FDiskCacheHeader Header;
+	FMemory::Memzero(Header);
+	Header.Magic = DiskCacheMagic;
+	Header.Version = DiskCacheVersion;
+	Header.Key = Key;
+	Header.SizeX = Image.SizeX;
+	Header.SizeY = Image.SizeY;
+	Header.NumMips = Image.NumMips;
+	Header.Format = uint8(Image.Format);
+	Header.PixelFormat = uint8(Image.PixelFormat);
+	Header.CompressionSettings = uint8(Image.CompressionSettings);
+	Header.bSRGB = Image.SRGB ? 1 : 0;
+
+	uint32 PayloadCrc = 0;
+	for (int32 MipIndex = 0; MipIndex < Image.NumMips; ++MipIndex)
+	{
+		const int64 MipSize = Image.GetMipSize(MipIndex);
+		PayloadCrc = FCrc::MemCrc32(Image.GetMipData(MipIndex), MipSize, PayloadCrc);
+		Header.PayloadSize += MipSize;
+	}
+	Header.PayloadCrc = PayloadCrc;
+	Header.HeaderCrc = CalcHeaderCrc(Header);
+
+	// Written under a unique name and moved into place, readers never see a partial entry
+	const FString Path = GetEntryPath(Key);
+	const FString TempPath = Directory / FString::Printf(TEXT("%s.tmp"), *FGuid::NewGuid().ToString());
+
+	TUniquePtr<FArchive> Writer(IFileManager::Get().CreateFileWriter(*TempPath));
+	if (!Writer)
+	{
+		UE_LOG(ImageImporter, Warning, TEXT("Failed to write disk cache entry '%s'"), *TempPath);
+		return;
+	}
+
+	Writer->Serialize(&Header, sizeof(Header));
+	for (int32 MipIndex = 0; MipIndex < Image.NumMips; ++MipIndex)
+	{
+		Writer->Serialize(Image.GetMipData(MipIndex), Image.GetMipSize(MipIndex));
+	}
+
+	const bool bWritten = Writer->Close() && !Writer->IsError();
+	Writer.Reset();
+
+	if (!bWritten || !IFileManager::Get().Move(*Path, *TempPath, /*bReplace=*/ true))
+	{
+		UE_LOG(ImageImporter, Warning, TEXT("Failed to write disk cache entry '%s'"), *Path);
+		IFileManager::Get().Delete(*TempPath);
+		return;
+	}
+
+	const int64 MaxSizeBytes = FMath::Max<int64>(CVarDiskCacheMaxSizeMB.GetValueOnAnyThread(), 0) * 1024 * 1024;
+
+	FScopeLock Lock(&Critical);
+	if (TotalBytes >= 0)
+	{
+		TotalBytes += sizeof(Header) + Header.PayloadSize;
+	}
+
+	if (TotalBytes < 0 || TotalBytes > MaxSizeBytes)
+	{
+		EvictToLimit(MaxSizeBytes);
+	}
+}
+
+void FImageDiskCache::Discard(const FString& Path, const TCHAR* Reason)
+{
+	UE_LOG(ImageImporter, Warning, TEXT("Discarding disk cache entry '%s': %s"), *Path, Reason);
+	IFileManager::Get().Delete(*Path);
+}
+
+void FImageDiskCache::EvictToLimit(int64 MaxSizeBytes)
+{
+	struct FEntryFile
+	{
+		FString Path;
+		int64 Size;
+		FDateTime LastUse;
+	};
+
+	TArray<FEntryFile> Files;
+	int64 ScannedBytes = 0;
+	IFileManager::Get().IterateDirectoryStat(*Directory, [&Files, &ScannedBytes](const TCHAR* Filename, const FFileStatData& StatData)
+	{
+		if (!StatData.bIsDirectory && FPaths::GetExtension(Filename) == DiskCacheExtension)
+		{
+			Files.Add({ Filename, StatData.FileSize, StatData.ModificationTime });
+			ScannedBytes += StatData.FileSize;
+		}
+		return true;
+	});
+
+	if (ScannedBytes > MaxSizeBytes)
+	{
+		Files.Sort([](const FEntryFile& A, const FEntryFile& B) { return A.LastUse < B.LastUse; });
+
+		for (const FEntryFile& File : Files)
+		{
+			if (ScannedBytes <= MaxSizeBytes)
+			{
+				break;
+			}
+
+			// Entries being read right now can't be deleted on every platform, they are retried on the next trim
+			if (IFileManager::Get().Delete(*File.Path, false, false, true))
+			{
+				ScannedBytes -= File.Size;
+			}
+		}
+	}
+
+	TotalBytes = ScannedBytes;
+}
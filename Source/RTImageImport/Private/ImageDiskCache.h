@@ -0,0 +1,42 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ImageImporter.h"
+
+/**
+ * Final images (after mip generation and block compression) stored under Saved/RTImageImport/DecodeCache,
+ * one file per source hash and import settings. A file is a fixed 64 byte header with the fields of
+ * FImportedImageStruct and CRCs, followed by the mips back to back, so a hit maps the file and copies
+ * the mips straight into the texture without decoding.
+ *
+ * Files that fail the checks are deleted and count as a miss. Hits touch the file's timestamp and the
+ * least recently used files are deleted once the cache grows past RTImageImport.DiskCache.MaxSizeMB.
+ */
+class FImageDiskCache
+{
+public:
+	static FImageDiskCache& Get();
+
+	/** Loads the image stored under Key, into the target's mips when it provides them. Any thread. */
+	bool Load(uint64 Key, FImportedImageStruct& OutImage, FImageDecodeTarget* Target);
+
+	/** Writes the image under Key, replacing what was there. Any thread. */
+	void Store(uint64 Key, FImportedImageStruct& Image);
+
+private:
+	FImageDiskCache();
+
+	FString GetEntryPath(uint64 Key) const;
+
+	/** Deletes an entry that failed the checks */
+	void Discard(const FString& Path, const TCHAR* Reason);
+
+	/** Rescans the directory and deletes the oldest entries until the cache fits MaxSizeBytes. Called with Critical held. */
+	void EvictToLimit(int64 MaxSizeBytes);
+
+	FString Directory;
+
+	FCriticalSection Critical;
+	/** Size of all entries, -1 until the directory has been scanned */
+	int64 TotalBytes = -1;
+};
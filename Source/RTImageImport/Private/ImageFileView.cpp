@@ -0,0 +1,57 @@
+#include "ImageFileView.h"
+
+#include "ImageImporter.h"
+#include "ImageImportStats.h"
+#include "Async/MappedFileHandle.h"
+#include "HAL/PlatformFileManager.h"
+
+
+FImageFileView::FImageFileView() = default;
+
+FImageFileView::~FImageFileView()
+{
+	Close();
+}
+
+bool FImageFileView::Open(const TCHAR* Filename)
+{
+	RTIMAGEIMPORT_STAGE_SCOPE(ReadFile);
+	Close();
+
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	MappedHandle.Reset(PlatformFile.OpenMapped(Filename));
+	if (MappedHandle.IsValid() && MappedHandle->GetFileSize() > 0)
+	{
+		MappedRegion.Reset(MappedHandle->MapRegion(0, MappedHandle->GetFileSize()));
+		if (MappedRegion.IsValid())
+		{
+			Data = MappedRegion->GetMappedPtr();
+			Size = MappedRegion->GetMappedSize();
+			FImageImportStats::Get().AddBytesRead(Size);
+			return true;
+		}
+	}
+	MappedHandle.Reset();
+
+	// Mapping is not available for every platform file (pak files, some consoles), load a copy instead
+	if (!FFileHelper::LoadFileToArray(FallbackData, Filename))
+	{
+		return false;
+	}
+
+	UE_LOG(ImageImporter, Verbose, TEXT("Could not map '%s', loaded a copy instead"), Filename);
+	Data = FallbackData.GetData();
+	Size = FallbackData.Num();
+	FImageImportStats::Get().AddBytesRead(Size);
+	return true;
+}
+
+void FImageFileView::Close()
+{
+	// The region has to go before the handle it was mapped from
+	MappedRegion.Reset();
+	MappedHandle.Reset();
+	FallbackData.Empty();
+	Data = nullptr;
+	Size = 0;
+}
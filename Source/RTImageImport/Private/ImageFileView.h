@@ -0,0 +1,35 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+/**
+ * Read-only view of a whole file. The file is memory mapped when the platform supports it so
+ * decoders read straight from the page cache, otherwise it is loaded into a heap buffer.
+ */
+class FImageFileView
+{
+public:
+	FImageFileView();
+	~FImageFileView();
+
+	FImageFileView(const FImageFileView&) = delete;
+	FImageFileView& operator=(const FImageFileView&) = delete;
+
+	bool Open(const TCHAR* Filename);
+	void Close();
+
+	const uint8* GetData() const { return Data; }
+	int64 Num() const { return Size; }
+	bool IsMapped() const { return MappedRegion.IsValid(); }
+
+private:
+	TUniquePtr<IMappedFileHandle> MappedHandle;
+	TUniquePtr<IMappedFileRegion> MappedRegion;
+	TArray64<uint8> FallbackData;
+
+	const uint8* Data = nullptr;
+	int64 Size = 0;
+};
@@ -0,0 +1,314 @@
+#include "ImageFillZeroAlpha.h"
+
+#include "ImageImportStats.h"
+#include "Async/ParallelFor.h"
+
+#if PLATFORM_ENABLE_VECTORINTRINSICS && !PLATFORM_ENABLE_VECTORINTRINSICS_NEON
+#include <emmintrin.h>
+#define RTIMAGEIMPORT_FILL_SSE2 1
+#else
+#define RTIMAGEIMPORT_FILL_SSE2 0
+#endif
+
+
+namespace
+{
+	/** Rows per parallel work item of the whole image fill */
+	constexpr int32 FillRowsPerBand = 64;
+
+	/** Below this many pixels the fill isn't worth going wide for */
+	constexpr int64 MinPixelsForParallelFill = 256 * 256;
+
+	/** First pixel at or after X that is (bMatch) or isn't (!bMatch) Value, Width if there is none */
+	int32 FindPixel(const uint32* Row, int32 X, int32 Width, uint32 Value, bool bMatch)
+	{
+#if RTIMAGEIMPORT_FILL_SSE2
+		const __m128i Pattern = _mm_set1_epi32(int32(Value));
+		for (; X + 4 <= Width; X += 4)
+		{
+			const __m128i Pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Row + X));
+			const uint32 EqualMask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(Pixels, Pattern)));
+			const uint32 HitMask = bMatch ? EqualMask : (~EqualMask & 0xf);
+			if (HitMask)
+			{
+				return X + FMath::CountTrailingZeros(HitMask);
+			}
+		}
+#endif
+		for (; X < Width; ++X)
+		{
+			if ((Row[X] == Value) == bMatch)
+			{
+				return X;
+			}
+		}
+		return Width;
+	}
+
+	int32 FindPixel(const uint64* Row, int32 X, int32 Width, uint64 Value, bool bMatch)
+	{
+#if RTIMAGEIMPORT_FILL_SSE2
+		const __m128i Pattern = _mm_set1_epi64x(int64(Value));
+		for (; X + 2 <= Width; X += 2)
+		{
+			const __m128i Pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Row + X));
+			// SSE2 has no 64 bit compare, a pixel matches when both of its 32 bit halves do
+			const __m128i EqualHalves = _mm_cmpeq_epi32(Pixels, Pattern);
+			const __m128i Equal = _mm_and_si128(EqualHalves, _mm_shuffle_epi32(EqualHalves, _MM_SHUFFLE(2, 3, 0, 1)));
+			const uint32 EqualMask = _mm_movemask_pd(_mm_castsi128_pd(Equal));
+			const uint32 HitMask = bMatch ? EqualMask : (~EqualMask & 0x3);
+			if (HitMask)
+			{
+				return X + FMath::CountTrailingZeros(HitMask);
+			}
+		}
+#endif
+		for (; X < Width; ++X)
+		{
+			if ((Row[X] == Value) == bMatch)
+			{
+				return X;
+			}
+		}
+		return Width;
+	}
+
+	void FillPixels(uint32* Row, int32 Start, int32 End, uint32 Value)
+	{
+		int32 X = Start;
+#if RTIMAGEIMPORT_FILL_SSE2
+		const __m128i Splat = _mm_set1_epi32(int32(Value));
+		for (; X + 4 <= End; X += 4)
+		{
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(Row + X), Splat);
+		}
+#endif
+		for (; X < End; ++X)
+		{
+			Row[X] = Value;
+		}
+	}
+
+	void FillPixels(uint64* Row, int32 Start, int32 End, uint64 Value)
+	{
+		int32 X = Start;
+#if RTIMAGEIMPORT_FILL_SSE2
+		const __m128i Splat = _mm_set1_epi64x(int64(Value));
+		for (; X + 2 <= End; X += 2)
+		{
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(Row + X), Splat);
+		}
+#endif
+		for (; X < End; ++X)
+		{
+			Row[X] = Value;
+		}
+	}
+}
+
+template<typename PixelDataType, typename ColorDataType, int32 RIdx, int32 GIdx, int32 BIdx, int32 AIdx>
+void PNGDataFill<PixelDataType, ColorDataType, RIdx, GIdx, BIdx, AIdx>::ProcessData()
+{
+	const int32 NumBands = FMath::DivideAndRoundUp(TextureHeight, FillRowsPerBand);
+	const bool bSingleThreaded = (int64)TextureWidth * TextureHeight < MinPixelsForParallelFill;
+
+	TArray<bool> RowHasColor;
+	RowHasColor.SetNumUninitialized(TextureHeight);
+
+	ParallelFor(NumBands, [&](int32 BandIndex)
+	{
+		const int32 EndY = FMath::Min((BandIndex + 1) * FillRowsPerBand, TextureHeight);
+		for (int32 Y = BandIndex * FillRowsPerBand; Y < EndY; ++Y)
+		{
+			RowHasColor[Y] = ProcessHorizontalRow(Y);
+		}
+	}, bSingleThreaded);
+
+	// Same choice of source row as ProcessRow makes: the closest row with color above, or the first
+	// row with color for the zeroed rows at the top
+	TArray<int32> SourceRows;
+	SourceRows.SetNumUninitialized(TextureHeight);
+
+	int32 LastColorRow = -1;
+	bool bNeedsVerticalFill = false;
+	for (int32 Y = 0; Y < TextureHeight; ++Y)
+	{
+		if (RowHasColor[Y])
+		{
+			// ProcessRow leaves a single zeroed top row alone, keep doing so to stay byte identical
+			if (LastColorRow == -1 && Y > 1)
+			{
+				for (int32 TopY = 0; TopY < Y; ++TopY)
+				{
+					SourceRows[TopY] = Y;
+				}
+			}
+
+			LastColorRow = Y;
+			SourceRows[Y] = -1;
+		}
+		else
+		{
+			SourceRows[Y] = LastColorRow;
+			bNeedsVerticalFill |= LastColorRow != -1;
+		}
+	}
+
+	bNeedsVerticalFill |= TextureHeight > 0 && SourceRows[0] != -1;
+	if (!bNeedsVerticalFill)
+	{
+		return;
+	}
+
+	// Source rows all have color and aren't written by this pass, so the bands don't depend on each other
+	ParallelFor(NumBands, [&](int32 BandIndex)
+	{
+		const int32 EndY = FMath::Min((BandIndex + 1) * FillRowsPerBand, TextureHeight);
+		for (int32 Y = BandIndex * FillRowsPerBand; Y < EndY; ++Y)
+		{
+			if (SourceRows[Y] != -1)
+			{
+				FillRowColorPixels(SourceRows[Y], Y);
+			}
+		}
+	}, bSingleThreaded);
+}
+
+template<typename PixelDataType, typename ColorDataType, int32 RIdx, int32 GIdx, int32 BIdx, int32 AIdx>
+void PNGDataFill<PixelDataType, ColorDataType, RIdx, GIdx, BIdx, AIdx>::ProcessRow(int32 Y)
+{
+	if (!ProcessHorizontalRow(Y))
+	{
+		if (FillColorRow != -1)
+		{
+			FillRowColorPixels(FillColorRow, Y);
+		}
+		else
+		{
+			NumZeroedTopRowsToProcess = Y;
+		}
+	}
+	else
+	{
+		// Can only fill upwards once a row with color exists, the zeroed top rows are all directly above this one
+		if (FillColorRow == -1 && NumZeroedTopRowsToProcess > 0)
+		{
+			for (int32 TopY = 0; TopY <= NumZeroedTopRowsToProcess; ++TopY)
+			{
+				FillRowColorPixels(NumZeroedTopRowsToProcess + 1, TopY);
+			}
+		}
+
+		FillColorRow = Y;
+	}
+}
+
+template<typename PixelDataType, typename ColorDataType, int32 RIdx, int32 GIdx, int32 BIdx, int32 AIdx>
+bool PNGDataFill<PixelDataType, ColorDataType, RIdx, GIdx, BIdx, AIdx>::ProcessHorizontalRow(int32 Y)
+{
+	// only wipe out colors that are affected by png turning valid colors white if alpha = 0
+	const ColorDataType WhiteWithZeroAlpha = FColor(255, 255, 255, 0).DWColor();
+
+	// Matching pixels have zero alpha, so filling one is writing the color of its fill pixel without alpha
+	const ColorDataType ColorMask = ~(ColorDataType(TNumericLimits<PixelDataType>::Max()) << (AIdx * sizeof(PixelDataType) * 8));
+
+	ColorDataType* Row = reinterpret_cast<ColorDataType*>(SourceData + (int64)Y * TextureWidth * 4);
+
+	// Left -> Right, each run of matching pixels takes the color of the pixel just before it
+	const int32 FirstColorX = FindPixel(Row, 0, TextureWidth, WhiteWithZeroAlpha, false);
+	for (int32 X = FirstColorX; X < TextureWidth;)
+	{
+		const int32 RunStart = FindPixel(Row, X, TextureWidth, WhiteWithZeroAlpha, true);
+		if (RunStart == TextureWidth)
+		{
+			break;
+		}
+
+		const int32 RunEnd = FindPixel(Row, RunStart, TextureWidth, WhiteWithZeroAlpha, false);
+		FillPixels(Row, RunStart, RunEnd, Row[RunStart - 1] & ColorMask);
+		X = RunEnd;
+	}
+
+	if (FirstColorX <= 1)
+	{
+		// No pixels left that are zero. A single leading zero pixel is only marked, never filled.
+		if (FirstColorX == 1)
+		{
+			Row[0] = 0;
+		}
+		return true;
+	}
+
+	if (FirstColorX == TextureWidth)
+	{
+		// All pixels in this row are zero and must be filled using rows above or below
+		FillPixels(Row, 0, TextureWidth, 0);
+		return false;
+	}
+
+	// Fill zero pixels found at beginning of row using the first pixel with color
+	FillPixels(Row, 0, FirstColorX, Row[FirstColorX] & ColorMask);
+
+	return true;
+}
+
+template<typename PixelDataType, typename ColorDataType, int32 RIdx, int32 GIdx, int32 BIdx, int32 AIdx>
+void PNGDataFill<PixelDataType, ColorDataType, RIdx, GIdx, BIdx, AIdx>::FillRowColorPixels(int32 FillColorRow, int32 Y)
+{
+	const ColorDataType AlphaMask = ColorDataType(TNumericLimits<PixelDataType>::Max()) << (AIdx * sizeof(PixelDataType) * 8);
+
+	const ColorDataType* FillRow = reinterpret_cast<const ColorDataType*>(SourceData + (int64)FillColorRow * TextureWidth * 4);
+	ColorDataType* Row = reinterpret_cast<ColorDataType*>(SourceData + (int64)Y * TextureWidth * 4);
+
+	// Whole pixel selects vectorize, copying the color channels one by one doesn't
+	for (int32 X = 0; X < TextureWidth; ++X)
+	{
+		Row[X] = (Row[X] & AlphaMask) | (FillRow[X] & ~AlphaMask);
+	}
+}
+
+template class PNGDataFill<uint8, uint32, 2, 1, 0, 3>;
+template class PNGDataFill<uint16, uint64, 0, 1, 2, 3>;
+
+void FillZeroAlphaPNGData(int32 SizeX, int32 SizeY, ETextureSourceFormat SourceFormat, uint8* SourceData)
+{
+	RTIMAGEIMPORT_STAGE_SCOPE(FillZeroAlpha);
+
+	switch (SourceFormat)
+	{
+	case TSF_BGRA8:
+	{
+		PNGDataFill<uint8, uint32, 2, 1, 0, 3> PNGFill(SizeX, SizeY, SourceData);
+		PNGFill.ProcessData();
+		break;
+	}
+
+	case TSF_RGBA16:
+	{
+		PNGDataFill<uint16, uint64, 0, 1, 2, 3> PNGFill(SizeX, SizeY, SourceData);
+		PNGFill.ProcessData();
+		break;
+	}
+	}
+}
+
+FZeroAlphaRowFiller::FZeroAlphaRowFiller(int32 SizeX, int32 SizeY, ETextureSourceFormat SourceFormat, uint8* SourceData)
+	: Format(SourceFormat)
+	, FillBGRA8(SizeX, SizeY, SourceData)
+	, FillRGBA16(SizeX, SizeY, SourceData)
+{
+}
+
+void FZeroAlphaRowFiller::ProcessRow(int32 Y)
+{
+	switch (Format)
+	{
+	case TSF_BGRA8:
+		FillBGRA8.ProcessRow(Y);
+		break;
+
+	case TSF_RGBA16:
+		FillRGBA16.ProcessRow(Y);
+		break;
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/Texture.h"
+
+/** Members are defined in ImageFillZeroAlpha.cpp, instantiated for the BGRA8 and RGBA16 layouts only */
+template<typename PixelDataType, typename ColorDataType, int32 RIdx, int32 GIdx, int32 BIdx, int32 AIdx> class PNGDataFill
+{
+public:
+
+	PNGDataFill(int32 SizeX, int32 SizeY, uint8* SourceTextureData)
+		: SourceData(reinterpret_cast<PixelDataType*>(SourceTextureData))
+		, TextureWidth(SizeX)
+		, TextureHeight(SizeY)
+	{
+	}
+
+	/**
+	 * Processes the whole image. The horizontal pass is row local and runs on bands of rows in parallel,
+	 * the rows it leaves fully zeroed are then matched to their source row in one serial pass over the
+	 * row flags, so a zeroed row takes its color from the right row even when that lies in another band.
+	 */
+	void ProcessData();
+
+	/**
+	 * Processes a single row, rows have to be fed top to bottom. Besides row Y this only reads the last
+	 * row that had color and, once the first such row shows up, the fully zeroed rows above it, so it can
+	 * run on rows as they come out of a streaming decoder.
+	 */
+	void ProcessRow(int32 Y);
+
+	/* returns False if requires further processing because entire row is filled with zeroed alpha values */
+	bool ProcessHorizontalRow(int32 Y);
+
+	void FillRowColorPixels(int32 FillColorRow, int32 Y);
+
+	PixelDataType* SourceData;
+	int32 TextureWidth;
+	int32 TextureHeight;
+	int32 NumZeroedTopRowsToProcess = 0;
+	int32 FillColorRow = -1;
+};
+
+/** Replaces the pixels with 0.0 alpha with a color value from the nearest neighboring color which has a non-zero alpha */
+void FillZeroAlphaPNGData(int32 SizeX, int32 SizeY, ETextureSourceFormat SourceFormat, uint8* SourceData);
+
+/** Same as FillZeroAlphaPNGData, but fed one row at a time while the image is being decoded */
+class FZeroAlphaRowFiller
+{
+public:
+	FZeroAlphaRowFiller(int32 SizeX, int32 SizeY, ETextureSourceFormat SourceFormat, uint8* SourceData);
+
+	/** Rows have to be complete and pushed top to bottom */
+	void ProcessRow(int32 Y);
+
+	static bool SupportsFormat(ETextureSourceFormat SourceFormat) { return SourceFormat == TSF_BGRA8 || SourceFormat == TSF_RGBA16; }
+
+private:
+	ETextureSourceFormat Format;
+	PNGDataFill<uint8, uint32, 2, 1, 0, 3> FillBGRA8;
+	PNGDataFill<uint16, uint64, 0, 1, 2, 3> FillRGBA16;
+};
@@ -0,0 +1,78 @@
+#include "ImageFormatConversion.h"
+
+#include "ImageScratchBufferPool.h"
+#include "Async/ParallelFor.h"
+
+namespace
+{
+	/** Pixels per parallel work item of the float to half conversion */
+	constexpr int64 HalfConversionPixelsPerTask = 64 * 1024;
+}
+
+bool ConvertToBGRA8(const FImportedImageStruct& Image, TArray64<uint8>& OutData)
+{
+	const int64 NumPixels = Image.RawData.Num() / FTextureSource::GetBytesPerPixel(Image.Format);
+	FImageScratchBufferPool::Get().Acquire(OutData, NumPixels * 4);
+	FColor* Dest = reinterpret_cast<FColor*>(OutData.GetData());
+
+	switch (Image.Format)
+	{
+	case TSF_G8:
+	{
+		const uint8* Src = Image.RawData.GetData();
+		for (int64 Index = 0; Index < NumPixels; ++Index)
+		{
+			Dest[Index] = FColor(Src[Index], Src[Index], Src[Index], 255);
+		}
+		return true;
+	}
+
+	case TSF_G16:
+	{
+		const uint16* Src = reinterpret_cast<const uint16*>(Image.RawData.GetData());
+		for (int64 Index = 0; Index < NumPixels; ++Index)
+		{
+			const uint8 Gray = Src[Index] >> 8;
+			Dest[Index] = FColor(Gray, Gray, Gray, 255);
+		}
+		return true;
+	}
+
+	case TSF_RGBA16:
+	{
+		const uint16* Src = reinterpret_cast<const uint16*>(Image.RawData.GetData());
+		for (int64 Index = 0; Index < NumPixels; ++Index, Src += 4)
+		{
+			Dest[Index] = FColor(Src[0] >> 8, Src[1] >> 8, Src[2] >> 8, Src[3] >> 8);
+		}
+		return true;
+	}
+
+	case TSF_RGBA16F:
+	{
+		const FFloat16Color* Src = reinterpret_cast<const FFloat16Color*>(Image.RawData.GetData());
+		for (int64 Index = 0; Index < NumPixels; ++Index)
+		{
+			Dest[Index] = FLinearColor(Src[Index]).ToFColor(true);
+		}
+		return true;
+	}
+
+	default:
+		return false;
+	}
+}
+
+void ConvertFloatRGBAToHalf(const float* Src, uint16* Dest, int64 NumPixels)
+{
+	const int32 NumTasks = int32(FMath::DivideAndRoundUp(NumPixels, HalfConversionPixelsPerTask));
+	ParallelFor(NumTasks, [Src, Dest, NumPixels](int32 TaskIndex)
+	{
+		const int64 EndPixel = FMath::Min((TaskIndex + 1) * HalfConversionPixelsPerTask, NumPixels);
+		for (int64 Pixel = TaskIndex * HalfConversionPixelsPerTask; Pixel < EndPixel; ++Pixel)
+		{
+			// F16C where the platform guarantees it, a branchless SSE/NEON emulation otherwise
+			FPlatformMath::VectorStoreHalf(Dest + Pixel * 4, Src + Pixel * 4);
+		}
+	}, NumTasks == 1);
+}
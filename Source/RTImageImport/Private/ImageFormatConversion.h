@@ -0,0 +1,16 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ImageImporter.h"
+
+/**
+ * Converts source formats to BGRA8 for RHIs that lack the native format, all mips at once. Half float
+ * images are clamped and sRGB encoded, the texture has to be created sRGB for them.
+ */
+bool ConvertToBGRA8(const FImportedImageStruct& Image, TArray64<uint8>& OutData);
+
+/** Whether ConvertToBGRA8 output of this format is sRGB encoded regardless of the image's SRGB flag */
+inline bool IsBGRA8ConversionSRGB(ETextureSourceFormat Format) { return Format == TSF_RGBA16F; }
+
+/** Halves 32 bit float RGBA pixels into RGBA16F, four channels per vector store, in parallel chunks */
+void ConvertFloatRGBAToHalf(const float* Src, uint16* Dest, int64 NumPixels);
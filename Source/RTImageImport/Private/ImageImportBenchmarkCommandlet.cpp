@@ -0,0 +1,863 @@
+#include "ImageImportBenchmarkCommandlet.h"
+
+// The benchmark, its corpus generator and the JSON reports only exist in editor builds
+#if WITH_EDITOR
+
+#include "BmpDecoder.h"
+#include "ImageFillZeroAlpha.h"
+#include "ImageFormatConversion.h"
+#include "ImageImporter.h"
+#include "JpegRowDecoder.h"
+#include "PcxDecoder.h"
+#include "PngRowDecoder.h"
+#include "TgaDecoder.h"
+#include "TiffDecoder.h"
+#include "IImageWrapper.h"
+#include "IImageWrapperModule.h"
+#include "Dom/JsonObject.h"
+#include "HAL/PlatformMemory.h"
+#include "Math/RandomStream.h"
+#include "Misc/Compression.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+#include "UObject/UObjectGlobals.h"
+
+#endif
+
+
+DEFINE_LOG_CATEGORY_STATIC(LogImageImportBenchmark, Log, All);
+
+#if WITH_EDITOR
+
+namespace
+{
+	/** Bumped when stages or the report layout change, reports of different versions aren't compared */
+	constexpr int32 BenchmarkReportVersion = 1;
+
+	enum class ECorpusFormat : uint8
+	{
+		Png,
+		Jpeg,
+		Tga,
+		TgaRLE,
+		Bmp,
+		Pcx,
+		/** Deflate compressed 256 x 256 tiles */
+		TiffTiled,
+	};
+
+	enum class ECorpusAlpha : uint8
+	{
+		Opaque,
+		/** 32 pixel checker of opaque cells and white zero alpha cells, the worst case of the zero alpha fill */
+		Cutout,
+		Gradient,
+	};
+
+	struct FCorpusSpec
+	{
+		ECorpusFormat Format;
+		ERGBFormat RGBFormat;
+		int32 BitDepth;
+		ECorpusAlpha Alpha;
+		int32 Size;
+
+		FString GetName() const
+		{
+			static const TCHAR* FormatNames[] = { TEXT("png"), TEXT("jpg"), TEXT("tga"), TEXT("tgarle"), TEXT("bmp"), TEXT("pcx"), TEXT("tiftiled") };
+			static const TCHAR* AlphaNames[] = { TEXT("opaque"), TEXT("cutout"), TEXT("gradient") };
+			return FString::Printf(TEXT("%s_%s%d_%s_%d"),
+				FormatNames[(int32)Format],
+				RGBFormat == ERGBFormat::Gray ? TEXT("gray") : TEXT("color"),
+				BitDepth,
+				AlphaNames[(int32)Alpha],
+				Size);
+		}
+
+		FString GetExtension() const
+		{
+			static const TCHAR* Extensions[] = { TEXT("png"), TEXT("jpg"), TEXT("tga"), TEXT("tga"), TEXT("bmp"), TEXT("pcx"), TEXT("tif") };
+			return Extensions[(int32)Format];
+		}
+	};
+
+	struct FStageResult
+	{
+		FString Stage;
+		TArray<double> Seconds;
+		int64 NumPixels = 0;
+		bool bSuccess = true;
+
+		double GetPercentile(double Percentile) const
+		{
+			TArray<double> Sorted = Seconds;
+			Sorted.Sort();
+			const int32 Rank = FMath::Clamp(FMath::CeilToInt(Percentile / 100.0 * Sorted.Num()) - 1, 0, Sorted.Num() - 1);
+			return Sorted[Rank];
+		}
+
+		double GetMean() const
+		{
+			double Sum = 0.0;
+			for (double Value : Seconds)
+			{
+				Sum += Value;
+			}
+			return Sum / FMath::Max(Seconds.Num(), 1);
+		}
+	};
+
+	TArray<FCorpusSpec> MakeCorpusSpecs(const TArray<int32>& Sizes)
+	{
+		TArray<FCorpusSpec> Specs;
+		for (int32 Size : Sizes)
+		{
+			Specs.Add({ ECorpusFormat::Png, ERGBFormat::BGRA, 8, ECorpusAlpha::Opaque, Size });
+			Specs.Add({ ECorpusFormat::Png, ERGBFormat::BGRA, 8, ECorpusAlpha::Cutout, Size });
+			Specs.Add({ ECorpusFormat::Png, ERGBFormat::BGRA, 8, ECorpusAlpha::Gradient, Size });
+			Specs.Add({ ECorpusFormat::Png, ERGBFormat::RGBA, 16, ECorpusAlpha::Cutout, Size });
+			Specs.Add({ ECorpusFormat::Png, ERGBFormat::Gray, 8, ECorpusAlpha::Opaque, Size });
+			Specs.Add({ ECorpusFormat::Png, ERGBFormat::Gray, 16, ECorpusAlpha::Opaque, Size });
+			Specs.Add({ ECorpusFormat::Jpeg, ERGBFormat::BGRA, 8, ECorpusAlpha::Opaque, Size });
+			Specs.Add({ ECorpusFormat::Tga, ERGBFormat::BGRA, 8, ECorpusAlpha::Gradient, Size });
+			Specs.Add({ ECorpusFormat::Tga, ERGBFormat::Gray, 8, ECorpusAlpha::Opaque, Size });
+			Specs.Add({ ECorpusFormat::TgaRLE, ERGBFormat::BGRA, 8, ECorpusAlpha::Cutout, Size });
+			Specs.Add({ ECorpusFormat::Bmp, ERGBFormat::BGRA, 8, ECorpusAlpha::Opaque, Size });
+			Specs.Add({ ECorpusFormat::Bmp, ERGBFormat::Gray, 8, ECorpusAlpha::Opaque, Size });
+			Specs.Add({ ECorpusFormat::Pcx, ERGBFormat::BGRA, 8, ECorpusAlpha::Opaque, Size });
+			Specs.Add({ ECorpusFormat::Pcx, ERGBFormat::Gray, 8, ECorpusAlpha::Opaque, Size });
+#if RTIMAGEIMPORT_WITH_LIBTIFF
+			Specs.Add({ ECorpusFormat::TiffTiled, ERGBFormat::BGRA, 8, ECorpusAlpha::Gradient, Size });
+			Specs.Add({ ECorpusFormat::TiffTiled, ERGBFormat::Gray, 16, ECorpusAlpha::Opaque, Size });
+#endif
+		}
+		return Specs;
+	}
+
+	/** Smooth gradients with a little noise, compresses roughly like photographic content */
+	TArray64<uint8> GeneratePixels(const FCorpusSpec& Spec)
+	{
+		const int32 NumChannels = Spec.RGBFormat == ERGBFormat::Gray ? 1 : 4;
+		const int32 BytesPerChannel = Spec.BitDepth / 8;
+		const int32 Size = Spec.Size;
+
+		TArray64<uint8> Pixels;
+		Pixels.SetNumUninitialized((int64)Size * Size * NumChannels * BytesPerChannel);
+
+		FRandomStream Random(Size * 31 + (int32)Spec.Alpha);
+		int64 Offset = 0;
+		auto WriteChannel = [&Pixels, &Offset, BytesPerChannel](float Value)
+		{
+			if (BytesPerChannel == 1)
+			{
+				Pixels[Offset++] = (uint8)FMath::RoundToInt(Value * 255.f);
+			}
+			else
+			{
+				const uint16 Value16 = (uint16)FMath::RoundToInt(Value * 65535.f);
+				FMemory::Memcpy(&Pixels[Offset], &Value16, sizeof(Value16));
+				Offset += sizeof(Value16);
+			}
+		};
+
+		for (int32 Y = 0; Y < Size; ++Y)
+		{
+			for (int32 X = 0; X < Size; ++X)
+			{
+				float Alpha = 1.f;
+				if (Spec.Alpha == ECorpusAlpha::Cutout)
+				{
+					Alpha = ((X / 32 + Y / 32) & 1) ? 1.f : 0.f;
+				}
+				else if (Spec.Alpha == ECorpusAlpha::Gradient)
+				{
+					Alpha = X / float(FMath::Max(Size - 1, 1));
+				}
+
+				const float Base[3] = { X / float(Size), Y / float(Size), (X + Y) / float(2 * Size) };
+				const int32 NumColorChannels = FMath::Min(NumChannels, 3);
+				for (int32 Channel = 0; Channel < NumColorChannels; ++Channel)
+				{
+					// Exporters write fully transparent pixels as white, which is what the fill looks for
+					const float Value = Alpha == 0.f ? 1.f : FMath::Clamp(Base[Channel] + Random.FRandRange(-0.05f, 0.05f), 0.f, 1.f);
+					WriteChannel(Value);
+				}
+
+				if (NumChannels == 4)
+				{
+					WriteChannel(Alpha);
+				}
+			}
+		}
+		return Pixels;
+	}
+
+	void AppendBytes(TArray64<uint8>& Out, std::initializer_list<uint32> Values, int32 BytesPerValue)
+	{
+		for (uint32 Value : Values)
+		{
+			for (int32 Byte = 0; Byte < BytesPerValue; ++Byte)
+			{
+				Out.Add(uint8(Value >> (Byte * 8)));
+			}
+		}
+	}
+
+	/** Top down 8 bit grayscale or 24/32 bit true color, RLE packets never cross rows */
+	TArray64<uint8> EncodeTga(const FCorpusSpec& Spec, const TArray64<uint8>& Pixels)
+	{
+		const bool bGray = Spec.RGBFormat == ERGBFormat::Gray;
+		const bool bRLE = Spec.Format == ECorpusFormat::TgaRLE;
+		const int32 SrcBytesPerPixel = bGray ? 1 : 4;
+		const int32 BytesPerPixel = bGray ? 1 : Spec.Alpha == ECorpusAlpha::Opaque ? 3 : 4;
+
+		TArray64<uint8> Out;
+		AppendBytes(Out, { 0, 0, uint32(bGray ? 3 : 2) + (bRLE ? 8 : 0) }, 1);
+		AppendBytes(Out, { 0, 0 }, 2);
+		AppendBytes(Out, { 0 }, 1);
+		AppendBytes(Out, { 0, 0, uint32(Spec.Size), uint32(Spec.Size) }, 2);
+		AppendBytes(Out, { uint32(BytesPerPixel * 8), uint32(0x20 | (BytesPerPixel == 4 ? 8 : 0)) }, 1);
+
+		auto PixelAt = [&Pixels, &Spec, SrcBytesPerPixel](int32 X, int32 Y) { return &Pixels[((int64)Y * Spec.Size + X) * SrcBytesPerPixel]; };
+		auto SamePixel = [BytesPerPixel](const uint8* A, const uint8* B) { return FMemory::Memcmp(A, B, BytesPerPixel) == 0; };
+
+		for (int32 Y = 0; Y < Spec.Size; ++Y)
+		{
+			for (int32 X = 0; X < Spec.Size;)
+			{
+				int32 Count = 1;
+				if (bRLE)
+				{
+					while (X + Count < Spec.Size && Count < 128 && SamePixel(PixelAt(X + Count, Y), PixelAt(X, Y)))
+					{
+						++Count;
+					}
+
+					if (Count > 1)
+					{
+						Out.Add(uint8(0x80 | (Count - 1)));
+						Out.Append(PixelAt(X, Y), BytesPerPixel);
+						X += Count;
+						continue;
+					}
+
+					// Raw packet up to the next run
+					while (X + Count < Spec.Size && Count < 128 && (X + Count + 1 >= Spec.Size || !SamePixel(PixelAt(X + Count, Y), PixelAt(X + Count + 1, Y))))
+					{
+						++Count;
+					}
+					Out.Add(uint8(Count - 1));
+				}
+				else
+				{
+					Count = Spec.Size;
+				}
+
+				for (int32 Index = 0; Index < Count; ++Index)
+				{
+					Out.Append(PixelAt(X + Index, Y), BytesPerPixel);
+				}
+				X += Count;
+			}
+		}
+		return Out;
+	}
+
+	/** Bottom up 24 bit color, or 8 bit with a gray ramp palette */
+	TArray64<uint8> EncodeBmp(const FCorpusSpec& Spec, const TArray64<uint8>& Pixels)
+	{
+		const bool bGray = Spec.RGBFormat == ERGBFormat::Gray;
+		const int32 BitCount = bGray ? 8 : 24;
+		const int64 Stride = ((int64)Spec.Size * BitCount + 31) / 32 * 4;
+		const uint32 PaletteSize = bGray ? 256 * 4 : 0;
+		const uint32 PixelOffset = 14 + 40 + PaletteSize;
+
+		TArray64<uint8> Out;
+		AppendBytes(Out, { 'B', 'M' }, 1);
+		AppendBytes(Out, { uint32(PixelOffset + Stride * Spec.Size), 0, PixelOffset }, 4);
+		AppendBytes(Out, { 40, uint32(Spec.Size), uint32(Spec.Size) }, 4);
+		AppendBytes(Out, { 1, uint32(BitCount) }, 2);
+		AppendBytes(Out, { 0, uint32(Stride * Spec.Size), 2835, 2835, 0, 0 }, 4);
+
+		if (bGray)
+		{
+			for (uint32 Index = 0; Index < 256; ++Index)
+			{
+				AppendBytes(Out, { Index, Index, Index, 0 }, 1);
+			}
+		}
+
+		for (int32 Y = Spec.Size - 1; Y >= 0; --Y)
+		{
+			const int64 RowStart = Out.Num();
+			for (int32 X = 0; X < Spec.Size; ++X)
+			{
+				const int64 Pixel = (int64)Y * Spec.Size + X;
+				Out.Append(&Pixels[Pixel * (bGray ? 1 : 4)], bGray ? 1 : 3);
+			}
+			Out.AddZeroed(RowStart + Stride - Out.Num());
+		}
+		return Out;
+	}
+
+	/** RLE 24 bit planar color, or 8 bit with a gray ramp palette */
+	TArray64<uint8> EncodePcx(const FCorpusSpec& Spec, const TArray64<uint8>& Pixels)
+	{
+		const bool bGray = Spec.RGBFormat == ERGBFormat::Gray;
+		const int32 NumPlanes = bGray ? 1 : 3;
+		const int32 BytesPerLine = Align(Spec.Size, 2);
+
+		TArray64<uint8> Out;
+		AppendBytes(Out, { 10, 5, 1, 8 }, 1);
+		AppendBytes(Out, { 0, 0, uint32(Spec.Size - 1), uint32(Spec.Size - 1), 72, 72 }, 2);
+		Out.AddZeroed(48 + 1);
+		AppendBytes(Out, { uint32(NumPlanes) }, 1);
+		AppendBytes(Out, { uint32(BytesPerLine), 1, 0, 0 }, 2);
+		Out.AddZeroed(54);
+
+		TArray<uint8> Line;
+		Line.SetNumZeroed(BytesPerLine * NumPlanes);
+		for (int32 Y = 0; Y < Spec.Size; ++Y)
+		{
+			for (int32 X = 0; X < Spec.Size; ++X)
+			{
+				const int64 Pixel = (int64)Y * Spec.Size + X;
+				if (bGray)
+				{
+					Line[X] = Pixels[Pixel];
+				}
+				else
+				{
+					// Planes are R, G, B, the generated pixels are BGRA
+					for (int32 Plane = 0; Plane < 3; ++Plane)
+					{
+						Line[Plane * BytesPerLine + X] = Pixels[Pixel * 4 + 2 - Plane];
+					}
+				}
+			}
+
+			for (int32 Index = 0; Index < Line.Num();)
+			{
+				int32 Count = 1;
+				while (Index + Count < Line.Num() && Count < 63 && Line[Index + Count] == Line[Index])
+				{
+					++Count;
+				}
+
+				if (Count > 1 || (Line[Index] & 0xc0) == 0xc0)
+				{
+					Out.Add(uint8(0xc0 | Count));
+				}
+				Out.Add(Line[Index]);
+				Index += Count;
+			}
+		}
+
+		if (bGray)
+		{
+			Out.Add(0x0c);
+			for (uint32 Index = 0; Index < 256; ++Index)
+			{
+				AppendBytes(Out, { Index, Index, Index }, 1);
+			}
+		}
+		return Out;
+	}
+
+	/** Little endian TIFF of deflate compressed tiles, the layout scanners write large images in */
+	TArray64<uint8> EncodeTiledTiff(const FCorpusSpec& Spec, const TArray64<uint8>& Pixels)
+	{
+		constexpr int32 TileSize = 256;
+		constexpr uint32 TypeShort = 3;
+		constexpr uint32 TypeLong = 4;
+
+		const bool bGray = Spec.RGBFormat == ERGBFormat::Gray;
+		const int32 NumSamples = bGray ? 1 : 4;
+		const int32 BytesPerPixel = NumSamples * Spec.BitDepth / 8;
+		const int32 TilesAcross = FMath::DivideAndRoundUp(Spec.Size, TileSize);
+		const int32 NumTiles = TilesAcross * TilesAcross;
+
+		TArray64<uint8> Out;
+		AppendBytes(Out, { 'I', 'I' }, 1);
+		AppendBytes(Out, { 42 }, 2);
+		AppendBytes(Out, { 0 }, 4);
+
+		// Edge tiles are padded to the full tile size, 8 bit color is stored RGBA
+		TArray<uint32> TileOffsets;
+		TArray<uint32> TileByteCounts;
+		TArray64<uint8> Tile;
+		TArray64<uint8> CompressedTile;
+		for (int32 TileIndex = 0; TileIndex < NumTiles; ++TileIndex)
+		{
+			Tile.SetNumZeroed((int64)TileSize * TileSize * BytesPerPixel);
+			const int32 StartX = (TileIndex % TilesAcross) * TileSize;
+			const int32 StartY = (TileIndex / TilesAcross) * TileSize;
+			const int32 NumPixels = FMath::Min(TileSize, Spec.Size - StartX);
+			for (int32 Row = 0; Row < FMath::Min(TileSize, Spec.Size - StartY); ++Row)
+			{
+				uint8* TileRow = Tile.GetData() + (int64)Row * TileSize * BytesPerPixel;
+				FMemory::Memcpy(TileRow, Pixels.GetData() + ((int64)(StartY + Row) * Spec.Size + StartX) * BytesPerPixel, (int64)NumPixels * BytesPerPixel);
+				if (!bGray && Spec.BitDepth == 8)
+				{
+					for (int32 X = 0; X < NumPixels; ++X)
+					{
+						Swap(TileRow[X * 4], TileRow[X * 4 + 2]);
+					}
+				}
+			}
+
+			int32 CompressedSize = FCompression::CompressMemoryBound(NAME_Zlib, int32(Tile.Num()));
+			CompressedTile.SetNumUninitialized(CompressedSize);
+			if (!FCompression::CompressMemory(NAME_Zlib, CompressedTile.GetData(), CompressedSize, Tile.GetData(), int32(Tile.Num())))
+			{
+				return TArray64<uint8>();
+			}
+
+			TileOffsets.Add(uint32(Out.Num()));
+			TileByteCounts.Add(uint32(CompressedSize));
+			Out.Append(CompressedTile.GetData(), CompressedSize);
+		}
+
+		const uint32 TileOffsetsOffset = uint32(Out.Num());
+		for (uint32 Offset : TileOffsets)
+		{
+			AppendBytes(Out, { Offset }, 4);
+		}
+		const uint32 TileByteCountsOffset = uint32(Out.Num());
+		for (uint32 ByteCount : TileByteCounts)
+		{
+			AppendBytes(Out, { ByteCount }, 4);
+		}
+		const uint32 BitsPerSampleOffset = uint32(Out.Num());
+		for (int32 Sample = 0; Sample < NumSamples; ++Sample)
+		{
+			AppendBytes(Out, { uint32(Spec.BitDepth) }, 2);
+		}
+
+		// Word aligned IFD with its entries sorted by tag
+		if (Out.Num() & 1)
+		{
+			Out.Add(0);
+		}
+		const uint32 IfdOffset = uint32(Out.Num());
+		FMemory::Memcpy(Out.GetData() + 4, &IfdOffset, sizeof(IfdOffset));
+
+		auto AppendEntry = [&Out](uint32 Tag, uint32 Type, uint32 Count, uint32 Value)
+		{
+			AppendBytes(Out, { Tag, Type }, 2);
+			AppendBytes(Out, { Count, Value }, 4);
+		};
+
+		AppendBytes(Out, { uint32(bGray ? 11 : 12) }, 2);
+		AppendEntry(256, TypeLong, 1, uint32(Spec.Size));											// ImageWidth
+		AppendEntry(257, TypeLong, 1, uint32(Spec.Size));											// ImageLength
+		AppendEntry(258, TypeShort, NumSamples, bGray ? uint32(Spec.BitDepth) : BitsPerSampleOffset);	// BitsPerSample
+		AppendEntry(259, TypeShort, 1, 8);															// Compression, deflate
+		AppendEntry(262, TypeShort, 1, bGray ? 1 : 2);												// Photometric, min is black or RGB
+		AppendEntry(277, TypeShort, 1, uint32(NumSamples));											// SamplesPerPixel
+		AppendEntry(284, TypeShort, 1, 1);															// PlanarConfig, contiguous
+		AppendEntry(322, TypeLong, 1, TileSize);													// TileWidth
+		AppendEntry(323, TypeLong, 1, TileSize);													// TileLength
+		AppendEntry(324, TypeLong, NumTiles, NumTiles == 1 ? TileOffsets[0] : TileOffsetsOffset);		// TileOffsets
+		AppendEntry(325, TypeLong, NumTiles, NumTiles == 1 ? TileByteCounts[0] : TileByteCountsOffset);	// TileByteCounts
+		if (!bGray)
+		{
+			AppendEntry(338, TypeShort, 1, 2);														// ExtraSamples, unassociated alpha
+		}
+		AppendBytes(Out, { 0 }, 4);
+		return Out;
+	}
+
+	bool GenerateCorpusFile(IImageWrapperModule& ImageWrapperModule, const FCorpusSpec& Spec, const FString& Path)
+	{
+		const TArray64<uint8> Pixels = GeneratePixels(Spec);
+
+		TArray64<uint8> Compressed;
+		switch (Spec.Format)
+		{
+		case ECorpusFormat::Tga:
+		case ECorpusFormat::TgaRLE:
+			Compressed = EncodeTga(Spec, Pixels);
+			break;
+
+		case ECorpusFormat::Bmp:
+			Compressed = EncodeBmp(Spec, Pixels);
+			break;
+
+		case ECorpusFormat::Pcx:
+			Compressed = EncodePcx(Spec, Pixels);
+			break;
+
+		case ECorpusFormat::TiffTiled:
+			Compressed = EncodeTiledTiff(Spec, Pixels);
+			break;
+
+		default:
+		{
+			TSharedPtr<IImageWrapper> Wrapper = ImageWrapperModule.CreateImageWrapper(Spec.Format == ECorpusFormat::Png ? EImageFormat::PNG : EImageFormat::JPEG);
+			if (!Wrapper.IsValid() || !Wrapper->SetRaw(Pixels.GetData(), Pixels.Num(), Spec.Size, Spec.Size, Spec.RGBFormat, Spec.BitDepth))
+			{
+				return false;
+			}
+			Compressed = Wrapper->GetCompressed(Spec.Format == ECorpusFormat::Jpeg ? 85 : 0);
+			break;
+		}
+		}
+
+		return Compressed.Num() > 0 && FFileHelper::SaveArrayToFile(Compressed, *Path);
+	}
+
+	/** Decode stage of the native legacy format decoders, they share one interface */
+	template<typename DecoderType>
+	bool DecodeNative(const TArray64<uint8>& FileData, FImportedImageStruct& OutDecoded)
+	{
+		DecoderType Decoder(FileData.GetData(), FileData.Num());
+		if (!Decoder.ReadHeader())
+		{
+			return false;
+		}
+
+		OutDecoded = FImportedImageStruct();
+		OutDecoded.Init2DWithOneMip(Decoder.GetWidth(), Decoder.GetHeight(), Decoder.GetTextureFormat());
+		return Decoder.Decode(OutDecoded.RawData.GetData(), OutDecoded.RawData.Num());
+	}
+
+	/** Runs Prepare untimed and Run timed for every iteration, a stage that fails once is reported as failed */
+	FStageResult TimeStage(const TCHAR* Stage, int32 NumIterations, int64 NumPixels, TFunctionRef<void()> Prepare, TFunctionRef<bool()> Run)
+	{
+		FStageResult Result;
+		Result.Stage = Stage;
+		Result.NumPixels = NumPixels;
+
+		for (int32 Iteration = 0; Iteration < NumIterations; ++Iteration)
+		{
+			Prepare();
+
+			const double StartTime = FPlatformTime::Seconds();
+			const bool bSuccess = Run();
+			Result.Seconds.Add(FPlatformTime::Seconds() - StartTime);
+
+			if (!bSuccess)
+			{
+				Result.bSuccess = false;
+				break;
+			}
+		}
+		return Result;
+	}
+
+	TSharedRef<FJsonObject> StageToJson(const FStageResult& Result)
+	{
+		TSharedRef<FJsonObject> Json = MakeShared<FJsonObject>();
+		Json->SetStringField(TEXT("stage"), Result.Stage);
+		Json->SetBoolField(TEXT("ok"), Result.bSuccess);
+		Json->SetNumberField(TEXT("samples"), Result.Seconds.Num());
+
+		if (Result.bSuccess && Result.Seconds.Num() > 0)
+		{
+			const double Median = Result.GetPercentile(50.0);
+			Json->SetNumberField(TEXT("median_ms"), Median * 1000.0);
+			Json->SetNumberField(TEXT("mean_ms"), Result.GetMean() * 1000.0);
+			Json->SetNumberField(TEXT("p90_ms"), Result.GetPercentile(90.0) * 1000.0);
+			Json->SetNumberField(TEXT("p99_ms"), Result.GetPercentile(99.0) * 1000.0);
+			Json->SetNumberField(TEXT("min_ms"), Result.GetPercentile(0.0) * 1000.0);
+			Json->SetNumberField(TEXT("max_ms"), Result.GetPercentile(100.0) * 1000.0);
+			Json->SetNumberField(TEXT("mpix_per_s"), Median > 0.0 ? Result.NumPixels / 1.0e6 / Median : 0.0);
+		}
+		return Json;
+	}
+
+	/** Number of stages whose median is more than Tolerance slower than in the baseline report */
+	int32 CountRegressions(const FJsonObject& Report, const FJsonObject& Baseline, double Tolerance)
+	{
+		if (Baseline.GetIntegerField(TEXT("version")) != BenchmarkReportVersion)
+		{
+			UE_LOG(LogImageImportBenchmark, Warning, TEXT("Baseline report has a different version, not comparing"));
+			return 0;
+		}
+
+		TMap<FString, double> BaselineMedians;
+		for (const TSharedPtr<FJsonValue>& CorpusValue : Baseline.GetArrayField(TEXT("corpora")))
+		{
+			const TSharedPtr<FJsonObject>& Corpus = CorpusValue->AsObject();
+			for (const TSharedPtr<FJsonValue>& StageValue : Corpus->GetArrayField(TEXT("stages")))
+			{
+				double Median = 0.0;
+				if (StageValue->AsObject()->TryGetNumberField(TEXT("median_ms"), Median))
+				{
+					BaselineMedians.Add(Corpus->GetStringField(TEXT("name")) / StageValue->AsObject()->GetStringField(TEXT("stage")), Median);
+				}
+			}
+		}
+
+		int32 NumRegressions = 0;
+		for (const TSharedPtr<FJsonValue>& CorpusValue : Report.GetArrayField(TEXT("corpora")))
+		{
+			const TSharedPtr<FJsonObject>& Corpus = CorpusValue->AsObject();
+			for (const TSharedPtr<FJsonValue>& StageValue : Corpus->GetArrayField(TEXT("stages")))
+			{
+				const FString Key = Corpus->GetStringField(TEXT("name")) / StageValue->AsObject()->GetStringField(TEXT("stage"));
+				const double* BaselineMedian = BaselineMedians.Find(Key);
+				double Median = 0.0;
+				if (BaselineMedian && StageValue->AsObject()->TryGetNumberField(TEXT("median_ms"), Median) && Median > *BaselineMedian * (1.0 + Tolerance))
+				{
+					UE_LOG(LogImageImportBenchmark, Error, TEXT("Regression in %s: %.3f ms, baseline %.3f ms"), *Key, Median, *BaselineMedian);
+					++NumRegressions;
+				}
+			}
+		}
+		return NumRegressions;
+	}
+}
+
+#endif
+
+UImageImportBenchmarkCommandlet::UImageImportBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UImageImportBenchmarkCommandlet::Main(const FString& Params)
+{
+#if !WITH_EDITOR
+	UE_LOG(LogImageImportBenchmark, Error, TEXT("The image import benchmark only runs in editor builds"));
+	return 1;
+#else
+	TArray<int32> Sizes = { 256, 1024, 4096 };
+	FString SizesParam;
+	if (FParse::Value(*Params, TEXT("sizes="), SizesParam))
+	{
+		TArray<FString> SizeStrings;
+		SizesParam.ParseIntoArray(SizeStrings, TEXT(","));
+		Sizes.Reset();
+		for (const FString& SizeString : SizeStrings)
+		{
+			Sizes.Add(FMath::Max(FCString::Atoi(*SizeString), 1));
+		}
+	}
+
+	int32 NumIterations = 7;
+	FParse::Value(*Params, TEXT("iterations="), NumIterations);
+	NumIterations = FMath::Max(NumIterations, 1);
+
+	FString OutputPath = FPaths::ProjectSavedDir() / TEXT("RTImageImport") / TEXT("Benchmark.json");
+	FParse::Value(*Params, TEXT("output="), OutputPath);
+
+	const bool bRegenerate = FParse::Param(*Params, TEXT("regenerate"));
+	const FString CorpusDir = FPaths::ProjectSavedDir() / TEXT("RTImageImport") / TEXT("BenchmarkCorpus");
+
+	IImageWrapperModule& ImageWrapperModule = FModuleManager::LoadModuleChecked<IImageWrapperModule>(FName("ImageWrapper"));
+	UImageImporter* Importer = NewObject<UImageImporter>(GetTransientPackage());
+	Importer->AddToRoot();
+
+	TArray<TSharedPtr<FJsonValue>> CorporaJson;
+	int32 NumFailures = 0;
+
+	for (const FCorpusSpec& Spec : MakeCorpusSpecs(Sizes))
+	{
+		const FString Name = Spec.GetName();
+		const FString Path = CorpusDir / Name + TEXT(".") + Spec.GetExtension();
+
+		if ((bRegenerate || !FPaths::FileExists(Path)) && !GenerateCorpusFile(ImageWrapperModule, Spec, Path))
+		{
+			UE_LOG(LogImageImportBenchmark, Error, TEXT("Failed to generate %s"), *Path);
+			++NumFailures;
+			continue;
+		}
+
+		const int64 NumPixels = (int64)Spec.Size * Spec.Size;
+		TArray<FStageResult> Stages;
+
+		TArray64<uint8> FileData;
+		Stages.Add(TimeStage(TEXT("read"), NumIterations, NumPixels, [&FileData]() { FileData.Empty(); }, [&FileData, &Path]()
+		{
+			return FFileHelper::LoadFileToArray(FileData, *Path);
+		}));
+
+		// Reference decode the later stages start from
+		FImportedImageStruct Decoded;
+		if (Spec.Format == ECorpusFormat::Tga || Spec.Format == ECorpusFormat::TgaRLE)
+		{
+			Stages.Add(TimeStage(TEXT("decode"), NumIterations, NumPixels, []() {}, [&FileData, &Decoded]()
+			{
+				return DecodeNative<FTgaDecoder>(FileData, Decoded);
+			}));
+		}
+		else if (Spec.Format == ECorpusFormat::Bmp)
+		{
+			Stages.Add(TimeStage(TEXT("decode"), NumIterations, NumPixels, []() {}, [&FileData, &Decoded]()
+			{
+				return DecodeNative<FBmpDecoder>(FileData, Decoded);
+			}));
+		}
+		else if (Spec.Format == ECorpusFormat::Pcx)
+		{
+			Stages.Add(TimeStage(TEXT("decode"), NumIterations, NumPixels, []() {}, [&FileData, &Decoded]()
+			{
+				return DecodeNative<FPcxDecoder>(FileData, Decoded);
+			}));
+		}
+#if RTIMAGEIMPORT_WITH_LIBTIFF
+		else if (Spec.Format == ECorpusFormat::TiffTiled)
+		{
+			Stages.Add(TimeStage(TEXT("decode"), NumIterations, NumPixels, []() {}, [&FileData, &Decoded]()
+			{
+				return DecodeNative<FTiffDecoder>(FileData, Decoded);
+			}));
+		}
+#endif
+		else if (Spec.Format == ECorpusFormat::Png)
+		{
+			Stages.Add(TimeStage(TEXT("decode"), NumIterations, NumPixels, []() {}, [&FileData, &Decoded]()
+			{
+				FPngRowDecoder Decoder(FileData.GetData(), FileData.Num());
+				if (!Decoder.ReadHeader())
+				{
+					return false;
+				}
+
+				Decoded = FImportedImageStruct();
+				Decoded.Init2DWithOneMip(Decoder.GetWidth(), Decoder.GetHeight(), Decoder.GetTextureFormat());
+				return Decoder.Decode(Decoded.RawData.GetData(), Decoded.RawData.Num(), false);
+			}));
+		}
+		else
+		{
+#if RTIMAGEIMPORT_WITH_LIBJPEGTURBO
+			// Same decoder ImportImage uses for JPEGs
+			Stages.Add(TimeStage(TEXT("decode"), NumIterations, NumPixels, []() {}, [&FileData, &Decoded]()
+			{
+				FJpegRowDecoder Decoder(FileData.GetData(), FileData.Num());
+				if (!Decoder.ReadHeader())
+				{
+					return false;
+				}
+
+				Decoded = FImportedImageStruct();
+				Decoded.Init2DWithOneMip(Decoder.GetWidth(), Decoder.GetHeight(), Decoder.GetTextureFormat());
+				return Decoder.Decode(Decoded.RawData.GetData(), Decoded.RawData.Num(), 1);
+			}));
+#else
+			Stages.Add(TimeStage(TEXT("decode"), NumIterations, NumPixels, []() {}, [&ImageWrapperModule, &FileData, &Decoded]()
+			{
+				TSharedPtr<IImageWrapper> Wrapper = ImageWrapperModule.CreateImageWrapper(EImageFormat::JPEG);
+				if (!Wrapper.IsValid() || !Wrapper->SetCompressed(FileData.GetData(), FileData.Num()))
+				{
+					return false;
+				}
+
+				Decoded = FImportedImageStruct();
+				Decoded.Init2DWithParams(Wrapper->GetWidth(), Wrapper->GetHeight(), TSF_BGRA8, true);
+				return Wrapper->GetRaw(ERGBFormat::BGRA, 8, Decoded.RawData);
+			}));
+#endif
+		}
+
+		if (Stages.Last().bSuccess)
+		{
+			if (FZeroAlphaRowFiller::SupportsFormat(Decoded.Format))
+			{
+				TArray64<uint8> FillData;
+				Stages.Add(TimeStage(TEXT("fill_zero_alpha"), NumIterations, NumPixels, [&FillData, &Decoded]() { FillData = Decoded.RawData; }, [&FillData, &Decoded]()
+				{
+					FillZeroAlphaPNGData(Decoded.SizeX, Decoded.SizeY, Decoded.Format, FillData.GetData());
+					return true;
+				}));
+			}
+
+			if (Decoded.Format != TSF_BGRA8)
+			{
+				TArray64<uint8> ConvertedData;
+				Stages.Add(TimeStage(TEXT("convert_bgra8"), NumIterations, NumPixels, [&ConvertedData]() { ConvertedData.Empty(); }, [&ConvertedData, &Decoded]()
+				{
+					return ConvertToBGRA8(Decoded, ConvertedData);
+				}));
+			}
+
+			Stages.Add(TimeStage(TEXT("create_texture"), NumIterations, NumPixels, []() {}, [&Decoded]()
+			{
+				return UImageImporter::CreateTextureFromImage(Decoded) != nullptr;
+			}));
+		}
+
+		FImportedImageStruct Imported;
+		Stages.Add(TimeStage(TEXT("import_image"), NumIterations, NumPixels, [&Imported]() { Imported = FImportedImageStruct(); }, [Importer, &FileData, &Imported]()
+		{
+			return Importer->ImportImage(FileData.GetData(), uint32(FileData.Num()), Imported);
+		}));
+
+		TSharedRef<FJsonObject> CorpusJson = MakeShared<FJsonObject>();
+		CorpusJson->SetStringField(TEXT("name"), Name);
+		CorpusJson->SetNumberField(TEXT("width"), Spec.Size);
+		CorpusJson->SetNumberField(TEXT("height"), Spec.Size);
+		CorpusJson->SetNumberField(TEXT("bit_depth"), Spec.BitDepth);
+		CorpusJson->SetNumberField(TEXT("file_bytes"), (double)FileData.Num());
+
+		TArray<TSharedPtr<FJsonValue>> StagesJson;
+		for (const FStageResult& Stage : Stages)
+		{
+			if (!Stage.bSuccess)
+			{
+				UE_LOG(LogImageImportBenchmark, Error, TEXT("%s: stage %s failed"), *Name, *Stage.Stage);
+				++NumFailures;
+			}
+			else
+			{
+				UE_LOG(LogImageImportBenchmark, Display, TEXT("%-32s %-16s median %8.3f ms  p90 %8.3f ms  %8.1f MP/s"),
+					*Name, *Stage.Stage, Stage.GetPercentile(50.0) * 1000.0, Stage.GetPercentile(90.0) * 1000.0, NumPixels / 1.0e6 / FMath::Max(Stage.GetPercentile(50.0), 1.0e-9));
+			}
+			StagesJson.Add(MakeShared<FJsonValueObject>(StageToJson(Stage)));
+		}
+		CorpusJson->SetArrayField(TEXT("stages"), StagesJson);
+		CorpusJson->SetNumberField(TEXT("peak_rss_bytes"), (double)FPlatformMemory::GetStats().PeakUsedPhysical);
+		CorporaJson.Add(MakeShared<FJsonValueObject>(CorpusJson));
+
+		// Textures of the create_texture stage pile up otherwise
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+	}
+
+	Importer->RemoveFromRoot();
+
+	TSharedRef<FJsonObject> Report = MakeShared<FJsonObject>();
+	Report->SetNumberField(TEXT("version"), BenchmarkReportVersion);
+	Report->SetStringField(TEXT("platform"), FPlatformProperties::IniPlatformName());
+	Report->SetNumberField(TEXT("cores"), FPlatformMisc::NumberOfCoresIncludingHyperthreads());
+	Report->SetNumberField(TEXT("iterations"), NumIterations);
+	Report->SetNumberField(TEXT("peak_rss_bytes"), (double)FPlatformMemory::GetStats().PeakUsedPhysical);
+	Report->SetArrayField(TEXT("corpora"), CorporaJson);
+
+	FString ReportString;
+	FJsonSerializer::Serialize(Report, TJsonWriterFactory<>::Create(&ReportString));
+	if (!FFileHelper::SaveStringToFile(ReportString, *OutputPath))
+	{
+		UE_LOG(LogImageImportBenchmark, Error, TEXT("Failed to write %s"), *OutputPath);
+		return 1;
+	}
+	UE_LOG(LogImageImportBenchmark, Display, TEXT("Wrote %s"), *OutputPath);
+
+	FString BaselinePath;
+	if (FParse::Value(*Params, TEXT("baseline="), BaselinePath))
+	{
+		double Tolerance = 0.1;
+		FParse::Value(*Params, TEXT("tolerance="), Tolerance);
+
+		FString BaselineString;
+		TSharedPtr<FJsonObject> Baseline;
+		if (!FFileHelper::LoadFileToString(BaselineString, *BaselinePath) || !FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(BaselineString), Baseline) || !Baseline.IsValid())
+		{
+			UE_LOG(LogImageImportBenchmark, Error, TEXT("Failed to read baseline %s"), *BaselinePath);
+			return 1;
+		}
+
+		NumFailures += CountRegressions(*Report, *Baseline, Tolerance);
+	}
+
+	return NumFailures > 0 ? 1 : 0;
+#endif
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+
+#include "ImageImportBenchmarkCommandlet.generated.h"
+
+/**
+ * Headless benchmark of the import pipeline:
+ *
+ *   UnrealEditor-Cmd <Project> -run=ImageImportBenchmark -nullrhi [-sizes=256,1024,4096] [-iterations=7]
+ *       [-output=<file.json>] [-baseline=<file.json> -tolerance=0.1] [-regenerate]
+ *
+ * Generates a synthetic PNG/JPEG/TGA/BMP/PCX/TIFF corpus under Saved/RTImageImport/BenchmarkCorpus covering
+ * the sizes, 8 and 16 bit, gray and color, opaque, cutout and gradient alpha, palettized, RLE and tiled
+ * encodings. Every file is timed stage by stage (read, decode, zero alpha fill, format conversion, texture
+ * creation) and through ImportImage as a whole. The JSON report holds latency percentiles, megapixels per second and the
+ * peak resident set. With a baseline report the commandlet fails when a stage's median got slower than the
+ * tolerance allows.
+ *
+ * The benchmark is compiled into editor builds only, game builds keep an empty commandlet whose Main fails.
+ */
+UCLASS()
+class UImageImportBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UImageImportBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
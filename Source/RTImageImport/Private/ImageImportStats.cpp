@@ -0,0 +1,199 @@
+#include "ImageImportStats.h"
+
+#include "ImageScratchBufferPool.h"
+#include "RenderUtils.h"
+#include "Engine/Texture2D.h"
+#include "HAL/IConsoleManager.h"
+
+
+DEFINE_STAT(STAT_RTImageImport_ImportFile);
+DEFINE_STAT(STAT_RTImageImport_ReadFile);
+DEFINE_STAT(STAT_RTImageImport_CreateBinary);
+DEFINE_STAT(STAT_RTImageImport_ImportImage);
+DEFINE_STAT(STAT_RTImageImport_Decode);
+DEFINE_STAT(STAT_RTImageImport_FillZeroAlpha);
+DEFINE_STAT(STAT_RTImageImport_GenerateMips);
+DEFINE_STAT(STAT_RTImageImport_Compress);
+DEFINE_STAT(STAT_RTImageImport_CreateTexture);
+
+DEFINE_STAT(STAT_RTImageImport_ImagesDecoded);
+DEFINE_STAT(STAT_RTImageImport_PixelsDecoded);
+DEFINE_STAT(STAT_RTImageImport_BytesRead);
+DEFINE_STAT(STAT_RTImageImport_UploadBytes);
+DEFINE_STAT(STAT_RTImageImport_LiveTextureMemory);
+DEFINE_STAT(STAT_RTImageImport_ScratchPoolMemory);
+
+static FAutoConsoleCommandWithOutputDevice DumpImportStatsCommand(
+	TEXT("RTImageImport.DumpStats"),
+	TEXT("Prints the cumulative import stage timings, byte counters, per format decode histograms and scratch buffer usage."),
+	FConsoleCommandWithOutputDeviceDelegate::CreateLambda([](FOutputDevice& Ar)
+	{
+		FImageImportStats::Get().Dump(Ar);
+		FImageScratchBufferPool::Get().Dump(Ar);
+	}));
+
+static FAutoConsoleCommand ResetImportStatsCommand(
+	TEXT("RTImageImport.ResetStats"),
+	TEXT("Clears the cumulative import stats, live texture memory keeps being tracked."),
+	FConsoleCommandDelegate::CreateLambda([]()
+	{
+		FImageImportStats::Get().Reset();
+	}));
+
+namespace
+{
+	const TCHAR* StageNames[] =
+	{
+		TEXT("ImportFile"),
+		TEXT("ReadFile"),
+		TEXT("CreateBinary"),
+		TEXT("ImportImage"),
+		TEXT("Decode"),
+		TEXT("FillZeroAlpha"),
+		TEXT("GenerateMips"),
+		TEXT("Compress"),
+		TEXT("CreateTexture"),
+	};
+	static_assert(UE_ARRAY_COUNT(StageNames) == (int32)EImageImportStage::Num, "Stage names out of date");
+}
+
+FImageImportStats& FImageImportStats::Get()
+{
+	static FImageImportStats Stats;
+	return Stats;
+}
+
+void FImageImportStats::FLatencyHistogram::Add(double Seconds)
+{
+	const double Milliseconds = Seconds * 1000.0;
+	const int32 Bucket = Milliseconds < 1.0 ? 0 : FMath::Min(FMath::FloorLog2(uint32(FMath::Min(Milliseconds, double(MAX_uint32)))) + 1, NumLatencyBuckets - 1);
+
+	++Count;
+	TotalSeconds += Seconds;
+	MaxSeconds = FMath::Max(MaxSeconds, Seconds);
+	++Buckets[Bucket];
+}
+
+void FImageImportStats::FLatencyHistogram::Dump(FOutputDevice& Ar, const TCHAR* Name) const
+{
+	if (Count == 0)
+	{
+		return;
+	}
+
+	Ar.Logf(TEXT("  %-16s %8lld calls  total %10.1f ms  mean %8.3f ms  max %8.3f ms"),
+		Name, Count, TotalSeconds * 1000.0, TotalSeconds * 1000.0 / Count, MaxSeconds * 1000.0);
+
+	FString Line;
+	for (int32 Bucket = 0; Bucket < NumLatencyBuckets; ++Bucket)
+	{
+		if (Buckets[Bucket] > 0)
+		{
+			const FString Range = Bucket == 0 ? TEXT("<1") : FString::Printf(TEXT("%s%d"), Bucket == NumLatencyBuckets - 1 ? TEXT(">=") : TEXT("<"), 1 << Bucket);
+			Line += FString::Printf(TEXT(" %sms:%lld"), *Range, Buckets[Bucket]);
+		}
+	}
+	Ar.Logf(TEXT("    %s"), *Line);
+}
+
+void FImageImportStats::AddStageTime(EImageImportStage Stage, double Seconds)
+{
+	FScopeLock ScopeLock(&Lock);
+	Stages[(int32)Stage].Add(Seconds);
+}
+
+void FImageImportStats::AddBytesRead(int64 NumBytes)
+{
+	INC_MEMORY_STAT_BY(STAT_RTImageImport_BytesRead, NumBytes);
+
+	FScopeLock ScopeLock(&Lock);
+	BytesRead += NumBytes;
+}
+
+void FImageImportStats::AddDecodedImage(const TCHAR* FormatName, int64 EncodedBytes, int64 NumPixels, double Seconds)
+{
+	INC_DWORD_STAT(STAT_RTImageImport_ImagesDecoded);
+	INC_DWORD_STAT_BY(STAT_RTImageImport_PixelsDecoded, NumPixels);
+
+	FScopeLock ScopeLock(&Lock);
+	FFormatStats& FormatStats = Formats.FindOrAdd(FormatName);
+	FormatStats.EncodedBytes += EncodedBytes;
+	FormatStats.NumPixels += NumPixels;
+	FormatStats.DecodeTime.Add(Seconds);
+}
+
+void FImageImportStats::AddUploadedTexture(UTexture2D* Texture)
+{
+	check(IsInGameThread());
+
+	if (!Texture)
+	{
+		return;
+	}
+
+	const int64 TextureBytes = (int64)CalcTextureSize(Texture->GetSizeX(), Texture->GetSizeY(), Texture->GetPixelFormat(), Texture->GetNumMips());
+	INC_MEMORY_STAT_BY(STAT_RTImageImport_UploadBytes, TextureBytes);
+
+	FScopeLock ScopeLock(&Lock);
+	UploadBytes += TextureBytes;
+
+	// Textures that are uploaded again, like the cache handing out its own texture, stay counted once
+	int64& LiveBytes = LiveTextures.FindOrAdd(Texture);
+	LiveTextureBytes += TextureBytes - LiveBytes;
+	LiveBytes = TextureBytes;
+	SET_MEMORY_STAT(STAT_RTImageImport_LiveTextureMemory, LiveTextureBytes);
+}
+
+void FImageImportStats::PruneDestroyedTextures()
+{
+	FScopeLock ScopeLock(&Lock);
+	for (auto It = LiveTextures.CreateIterator(); It; ++It)
+	{
+		if (!It.Key().IsValid())
+		{
+			LiveTextureBytes -= It.Value();
+			It.RemoveCurrent();
+		}
+	}
+	SET_MEMORY_STAT(STAT_RTImageImport_LiveTextureMemory, LiveTextureBytes);
+}
+
+void FImageImportStats::Dump(FOutputDevice& Ar)
+{
+	PruneDestroyedTextures();
+
+	FScopeLock ScopeLock(&Lock);
+
+	Ar.Logf(TEXT("RTImageImport stats"));
+	Ar.Logf(TEXT("  Bytes read %.2f MB, uploaded %.2f MB, live imported textures %d using %.2f MB"),
+		BytesRead / 1048576.0, UploadBytes / 1048576.0, LiveTextures.Num(), LiveTextureBytes / 1048576.0);
+
+	Ar.Logf(TEXT("Stages"));
+	for (int32 Stage = 0; Stage < (int32)EImageImportStage::Num; ++Stage)
+	{
+		Stages[Stage].Dump(Ar, StageNames[Stage]);
+	}
+
+	Ar.Logf(TEXT("Decode by format"));
+	for (const TPair<FString, FFormatStats>& Pair : Formats)
+	{
+		const FFormatStats& FormatStats = Pair.Value;
+		FormatStats.DecodeTime.Dump(Ar, *Pair.Key);
+		Ar.Logf(TEXT("    %.2f MB encoded, %.1f MP, %.1f MP/s"),
+			FormatStats.EncodedBytes / 1048576.0,
+			FormatStats.NumPixels / 1.0e6,
+			FormatStats.DecodeTime.TotalSeconds > 0.0 ? FormatStats.NumPixels / 1.0e6 / FormatStats.DecodeTime.TotalSeconds : 0.0);
+	}
+}
+
+void FImageImportStats::Reset()
+{
+	FScopeLock ScopeLock(&Lock);
+	for (FLatencyHistogram& Stage : Stages)
+	{
+		Stage = FLatencyHistogram();
+	}
+	Formats.Empty();
+	BytesRead = 0;
+	UploadBytes = 0;
+}
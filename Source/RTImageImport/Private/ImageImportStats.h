@@ -0,0 +1,123 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "Stats/Stats.h"
+#include "UObject/WeakObjectPtrTemplates.h"
+
+class UTexture2D;
+
+DECLARE_STATS_GROUP(TEXT("RTImageImport"), STATGROUP_RTImageImport, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Import File"), STAT_RTImageImport_ImportFile, STATGROUP_RTImageImport, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Read File"), STAT_RTImageImport_ReadFile, STATGROUP_RTImageImport, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Create Binary"), STAT_RTImageImport_CreateBinary, STATGROUP_RTImageImport, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Import Image"), STAT_RTImageImport_ImportImage, STATGROUP_RTImageImport, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Decode"), STAT_RTImageImport_Decode, STATGROUP_RTImageImport, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Fill Zero Alpha"), STAT_RTImageImport_FillZeroAlpha, STATGROUP_RTImageImport, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Generate Mips"), STAT_RTImageImport_GenerateMips, STATGROUP_RTImageImport, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Compress"), STAT_RTImageImport_Compress, STATGROUP_RTImageImport, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Create Texture"), STAT_RTImageImport_CreateTexture, STATGROUP_RTImageImport, );
+
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Images Decoded"), STAT_RTImageImport_ImagesDecoded, STATGROUP_RTImageImport, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Pixels Decoded"), STAT_RTImageImport_PixelsDecoded, STATGROUP_RTImageImport, );
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Bytes Read"), STAT_RTImageImport_BytesRead, STATGROUP_RTImageImport, );
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Upload Bytes"), STAT_RTImageImport_UploadBytes, STATGROUP_RTImageImport, );
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Live Imported Textures"), STAT_RTImageImport_LiveTextureMemory, STATGROUP_RTImageImport, );
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Pooled Scratch Buffers"), STAT_RTImageImport_ScratchPoolMemory, STATGROUP_RTImageImport, );
+
+/** Stages timed into the cumulative stats, each has a cycle stat named STAT_RTImageImport_<Stage> */
+enum class EImageImportStage : uint8
+{
+	ImportFile,
+	ReadFile,
+	CreateBinary,
+	ImportImage,
+	Decode,
+	FillZeroAlpha,
+	GenerateMips,
+	Compress,
+	CreateTexture,
+
+	Num
+};
+
+/**
+ * Cumulative counters of all imports since startup or the last RTImageImport.ResetStats. The stat group
+ * shows the current frame, this keeps the totals and latency histograms per stage and per source format
+ * for RTImageImport.DumpStats. Fed from the import workers as well as the game thread.
+ */
+class FImageImportStats
+{
+public:
+	static FImageImportStats& Get();
+
+	void AddStageTime(EImageImportStage Stage, double Seconds);
+	void AddBytesRead(int64 NumBytes);
+	void AddDecodedImage(const TCHAR* FormatName, int64 EncodedBytes, int64 NumPixels, double Seconds);
+
+	/** Counts the texture's mips as uploaded and tracks them as live until the texture is destroyed */
+	void AddUploadedTexture(UTexture2D* Texture);
+
+	/** Drops the textures the GC destroyed from the live texture memory */
+	void PruneDestroyedTextures();
+
+	void Dump(FOutputDevice& Ar);
+	void Reset();
+
+private:
+	/** Power of two millisecond buckets, bucket 0 is below 1 ms and the last one is open ended */
+	static constexpr int32 NumLatencyBuckets = 14;
+
+	struct FLatencyHistogram
+	{
+		int64 Count = 0;
+		double TotalSeconds = 0.0;
+		double MaxSeconds = 0.0;
+		int64 Buckets[NumLatencyBuckets] = {};
+
+		void Add(double Seconds);
+		void Dump(FOutputDevice& Ar, const TCHAR* Name) const;
+	};
+
+	struct FFormatStats
+	{
+		int64 EncodedBytes = 0;
+		int64 NumPixels = 0;
+		FLatencyHistogram DecodeTime;
+	};
+
+	FCriticalSection Lock;
+	FLatencyHistogram Stages[(int32)EImageImportStage::Num];
+	TMap<FString, FFormatStats> Formats;
+	int64 BytesRead = 0;
+	int64 UploadBytes = 0;
+	TMap<TWeakObjectPtr<UTexture2D>, int64> LiveTextures;
+	int64 LiveTextureBytes = 0;
+};
+
+/** Times a stage into FImageImportStats, used through RTIMAGEIMPORT_STAGE_SCOPE */
+class FImageImportStageScope
+{
+public:
+	explicit FImageImportStageScope(EImageImportStage InStage)
+		: Stage(InStage)
+		, StartTime(FPlatformTime::Seconds())
+	{
+	}
+
+	~FImageImportStageScope()
+	{
+		FImageImportStats::Get().AddStageTime(Stage, FPlatformTime::Seconds() - StartTime);
+	}
+
+private:
+	EImageImportStage Stage;
+	double StartTime;
+};
+
+/** Insights CPU event, cycle stat and cumulative timing of one import stage for the rest of the scope */
+#define RTIMAGEIMPORT_STAGE_SCOPE(Stage) \
+	TRACE_CPUPROFILER_EVENT_SCOPE(RTImageImport_##Stage); \
+	SCOPE_CYCLE_COUNTER(STAT_RTImageImport_##Stage); \
+	FImageImportStageScope PREPROCESSOR_JOIN(ImageImportStageScope, __LINE__)(EImageImportStage::Stage)
@@ -1,177 +1,55 @@
 #include "ImageImporter.h"
 
-#include "IImageWrapper.h"
-#include "IImageWrapperModule.h"
+#include "DdsDecoder.h"
+#include "ImageDecoderRegistry.h"
+#include "ImageBlockCompressor.h"
+#include "ImageDiskCache.h"
+#include "ImageFileView.h"
+#include "ImageFormatConversion.h"
+#include "ImageImportStats.h"
+#include "ImageMipGenerator.h"
+#include "ImageRowDownsampler.h"
+#include "ImageScratchBufferPool.h"
+#include "ImageTextureCache.h"
+#include "ImageTexturePool.h"
+#include "JpegRowDecoder.h"
+#include "TextureDecodeTarget.h"
+#include "TiledImage.h"
+#include "TiledImageSource.h"
 #include "ImageSaver.h"
 
 #include "TgaImageSupport.h"
+#include "Async/Async.h"
+#include "Hash/CityHash.h"
 #include "Kismet/GameplayStatics.h"
-#include "Misc/MessageDialog.h"
 
 
 DEFINE_LOG_CATEGORY(ImageImporter)
 
-template<typename PixelDataType, typename ColorDataType, int32 RIdx, int32 GIdx, int32 BIdx, int32 AIdx> class PNGDataFill
+namespace
 {
-public:
-
-	PNGDataFill(int32 SizeX, int32 SizeY, uint8* SourceTextureData)
-		: SourceData(reinterpret_cast<PixelDataType*>(SourceTextureData))
-		, TextureWidth(SizeX)
-		, TextureHeight(SizeY)
-	{
-	}
-
-	void ProcessData()
-	{
-		int32 NumZeroedTopRowsToProcess = 0;
-		int32 FillColorRow = -1;
-		for (int32 Y = 0; Y < TextureHeight; ++Y)
-		{
-			if (!ProcessHorizontalRow(Y))
-			{
-				if (FillColorRow != -1)
-				{
-					FillRowColorPixels(FillColorRow, Y);
-				}
-				else
-				{
-					NumZeroedTopRowsToProcess = Y;
-				}
-			}
-			else
-			{
-				FillColorRow = Y;
-			}
-		}
-
-		// Can only fill upwards if image not fully zeroed
-		if (NumZeroedTopRowsToProcess > 0 && NumZeroedTopRowsToProcess + 1 < TextureHeight)
-		{
-			for (int32 Y = 0; Y <= NumZeroedTopRowsToProcess; ++Y)
-			{
-				FillRowColorPixels(NumZeroedTopRowsToProcess + 1, Y);
-			}
-		}
-	}
-
-	/* returns False if requires further processing because entire row is filled with zeroed alpha values */
-	bool ProcessHorizontalRow(int32 Y)
+	/** Largest side of a texture an import can create */
+	int32 GetMaxTextureResolution()
 	{
-		// only wipe out colors that are affected by png turning valid colors white if alpha = 0
-		const uint32 WhiteWithZeroAlpha = FColor(255, 255, 255, 0).DWColor();
-
-		// Left -> Right
-		int32 NumLeftmostZerosToProcess = 0;
-		const PixelDataType* FillColor = nullptr;
-		for (int32 X = 0; X < TextureWidth; ++X)
-		{
-			PixelDataType* PixelData = SourceData + (Y * TextureWidth + X) * 4;
-			ColorDataType* ColorData = reinterpret_cast<ColorDataType*>(PixelData);
-
-			if (*ColorData == WhiteWithZeroAlpha)
-			{
-				if (FillColor)
-				{
-					PixelData[RIdx] = FillColor[RIdx];
-					PixelData[GIdx] = FillColor[GIdx];
-					PixelData[BIdx] = FillColor[BIdx];
-				}
-				else
-				{
-					// Mark pixel as needing fill
-					*ColorData = 0;
-
-					// Keep track of how many pixels to fill starting at beginning of row
-					NumLeftmostZerosToProcess = X;
-				}
-			}
-			else
-			{
-				FillColor = PixelData;
-			}
-		}
-
-		if (NumLeftmostZerosToProcess == 0)
-		{
-			// No pixels left that are zero
-			return true;
-		}
-
-		if (NumLeftmostZerosToProcess + 1 >= TextureWidth)
-		{
-			// All pixels in this row are zero and must be filled using rows above or below
-			return false;
-		}
-
-		// Fill using non zero pixel immediately to the right of the beginning series of zeros
-		FillColor = SourceData + (Y * TextureWidth + NumLeftmostZerosToProcess + 1) * 4;
+		static const auto CVarVirtualTexturesEnabled = IConsoleManager::Get().FindTConsoleVariableDataInt(TEXT("r.VirtualTextures")); check(CVarVirtualTexturesEnabled);
 
-		// Fill zero pixels found at beginning of row that could not be filled during the Left to Right pass
-		for (int32 X = 0; X <= NumLeftmostZerosToProcess; ++X)
-		{
-			PixelDataType* PixelData = SourceData + (Y * TextureWidth + X) * 4;
-			PixelData[RIdx] = FillColor[RIdx];
-			PixelData[GIdx] = FillColor[GIdx];
-			PixelData[BIdx] = FillColor[BIdx];
-		}
+		// In theory this value could be much higher, but various UE image code currently uses 32bit size/offset values
+		const int32 MaximumSupportedVirtualTextureResolution = 16 * 1024;
 
-		return true;
+		// Calculate the maximum supported resolution utilizing the global max texture mip count
+		// (Note, have to subtract 1 because 1x1 is a valid mip-size; this means a GMaxTextureMipCount of 4 means a max resolution of 8x8, not 2^4 = 16x16)
+		return CVarVirtualTexturesEnabled->GetValueOnAnyThread() ? MaximumSupportedVirtualTextureResolution : (1 << (15 - 1));
 	}
 
-	void FillRowColorPixels(int32 FillColorRow, int32 Y)
+	/** Decoded bytes per pixel of mip 0, a generated mip chain adds a third */
+	double GetImportBytesPerPixel(ETextureSourceFormat Format, bool bGenerateMips)
 	{
-		for (int32 X = 0; X < TextureWidth; ++X)
-		{
-			const PixelDataType* FillColor = SourceData + (FillColorRow * TextureWidth + X) * 4;
-			PixelDataType* PixelData = SourceData + (Y * TextureWidth + X) * 4;
-			PixelData[RIdx] = FillColor[RIdx];
-			PixelData[GIdx] = FillColor[GIdx];
-			PixelData[BIdx] = FillColor[BIdx];
-		}
+		const double BytesPerPixel = FTextureSource::GetBytesPerPixel(Format);
+		return bGenerateMips && CanGenerateMips(Format) ? BytesPerPixel * 4.0 / 3.0 : BytesPerPixel;
 	}
-
-	PixelDataType* SourceData;
-	int32 TextureWidth;
-	int32 TextureHeight;
-};
+}
 
 #pragma pack(push,1)
-class FPCXFileHeader
-{
-public:
-	uint8	Manufacturer;		// Always 10.
-	uint8	Version;			// PCX file version.
-	uint8	Encoding;			// 1=run-length, 0=none.
-	uint8	BitsPerPixel;		// 1,2,4, or 8.
-	uint16	XMin;				// Dimensions of the image.
-	uint16	YMin;				// Dimensions of the image.
-	uint16	XMax;				// Dimensions of the image.
-	uint16	YMax;				// Dimensions of the image.
-	uint16	XDotsPerInch;		// Horizontal printer resolution.
-	uint16	YDotsPerInch;		// Vertical printer resolution.
-	uint8	OldColorMap[48];	// Old colormap info data.
-	uint8	Reserved1;			// Must be 0.
-	uint8	NumPlanes;			// Number of color planes (1, 3, 4, etc).
-	uint16	BytesPerLine;		// Number of bytes per scanline.
-	uint16	PaletteType;		// How to interpret palette: 1=color, 2=gray.
-	uint16	HScreenSize;		// Horizontal monitor size.
-	uint16	VScreenSize;		// Vertical monitor size.
-	uint8	Reserved2[54];		// Must be 0.
-	friend FArchive& operator<<(FArchive& Ar, FPCXFileHeader& H)
-	{
-		Ar << H.Manufacturer << H.Version << H.Encoding << H.BitsPerPixel;
-		Ar << H.XMin << H.YMin << H.XMax << H.YMax << H.XDotsPerInch << H.YDotsPerInch;
-		for (int32 i = 0; i < UE_ARRAY_COUNT(H.OldColorMap); i++)
-			Ar << H.OldColorMap[i];
-		Ar << H.Reserved1 << H.NumPlanes;
-		Ar << H.BytesPerLine << H.PaletteType << H.HScreenSize << H.VScreenSize;
-		for (int32 i = 0; i < UE_ARRAY_COUNT(H.Reserved2); i++)
-			Ar << H.Reserved2[i];
-		return Ar;
-	}
-};
-
 struct FTGAFileFooter
 {
 	uint32 ExtensionAreaOffset;
@@ -229,26 +107,6 @@ struct FPSDFileHeader
 
 #pragma pack(pop)
 
-void FillZeroAlphaPNGData(int32 SizeX, int32 SizeY, ETextureSourceFormat SourceFormat, uint8* SourceData)
-{
-	switch (SourceFormat)
-	{
-	case TSF_BGRA8:
-	{
-		PNGDataFill<uint8, uint32, 2, 1, 0, 3> PNGFill(SizeX, SizeY, SourceData);
-		PNGFill.ProcessData();
-		break;
-	}
-
-	case TSF_RGBA16:
-	{
-		PNGDataFill<uint16, uint64, 0, 1, 2, 3> PNGFill(SizeX, SizeY, SourceData);
-		PNGFill.ProcessData();
-		break;
-	}
-	}
-}
-
 void FImportedImageStruct::Init2DWithParams(int32 InSizeX, int32 InSizeY, ETextureSourceFormat InFormat, bool InSRGB)
 {
 	SizeX = InSizeX;
@@ -264,7 +122,7 @@ void FImportedImageStruct::Init2DWithOneMip(int32 InSizeX, int32 InSizeY, ETextu
 	SizeY = InSizeY;
 	NumMips = 1;
 	Format = InFormat;
-	RawData.AddUninitialized((int64)SizeX * SizeY * FTextureSource::GetBytesPerPixel(Format));
+	FImageScratchBufferPool::Get().Acquire(RawData, (int64)SizeX * SizeY * FTextureSource::GetBytesPerPixel(Format));
 	if (InData)
 	{
 		FMemory::Memcpy(RawData.GetData(), InData, RawData.Num());
@@ -283,7 +141,7 @@ void FImportedImageStruct::Init2DWithMips(int32 InSizeX, int32 InSizeY, int32 In
 	{
 		TotalSize += GetMipSize(MipIndex);
 	}
-	RawData.AddUninitialized(TotalSize);
+	FImageScratchBufferPool::Get().Acquire(RawData, TotalSize);
 
 	if (InData)
 	{
@@ -297,11 +155,21 @@ int64 FImportedImageStruct::GetMipSize(int32 InMipIndex) const
 	check(InMipIndex < NumMips);
 	const int32 MipSizeX = FMath::Max(SizeX >> InMipIndex, 1);
 	const int32 MipSizeY = FMath::Max(SizeY >> InMipIndex, 1);
+	if (PixelFormat != PF_Unknown)
+	{
+		const FPixelFormatInfo& FormatInfo = GPixelFormats[PixelFormat];
+		return FMath::DivideAndRoundUp<int64>(MipSizeX, FormatInfo.BlockSizeX) * FMath::DivideAndRoundUp<int64>(MipSizeY, FormatInfo.BlockSizeY) * FormatInfo.BlockBytes;
+	}
 	return (int64)MipSizeX * MipSizeY * FTextureSource::GetBytesPerPixel(Format);
 }
 
 void* FImportedImageStruct::GetMipData(int32 InMipIndex)
 {
+	if (IsRawDataInTarget())
+	{
+		return TargetMipData[InMipIndex];
+	}
+
 	int64 Offset = 0;
 	for (int32 MipIndex = 0; MipIndex < InMipIndex; ++MipIndex)
 	{
@@ -310,698 +178,655 @@ void* FImportedImageStruct::GetMipData(int32 InMipIndex)
 	return &RawData[Offset];
 }
 
-#pragma optimize("", off)
 void UImageImporter::ImportFile(const FString Filename)
 {
-	TArray<uint8> Data;
-	if (!FFileHelper::LoadFileToArray(Data, *Filename))
+	RTIMAGEIMPORT_STAGE_SCOPE(ImportFile);
+
+	FImageCacheLookup CacheLookup = CreateCacheLookup();
+	if (CacheLookup.PinByPath(Filename))
 	{
-		UE_LOG(ImageImporter, Error, TEXT("Failed to load file '%s' to array"), *Filename);
+		Texture2D = CacheLookup.TakeTexture();
 	}
-	UPackage* Pkg = CreatePackage(L"Game/ImagePkg");
+	else
+	{
+		FImageFileView Data;
+		if (!Data.Open(*Filename) || Data.Num() == 0 || Data.Num() > MAX_uint32)
+		{
+			UE_LOG(ImageImporter, Error, TEXT("Failed to load file '%s'"), *Filename);
+			return;
+		}
+
+		if (CacheLookup.PinByContent(Data.GetData(), Data.Num()))
+		{
+			Texture2D = CacheLookup.TakeTexture();
+		}
+		else
+		{
+			UPackage* Pkg = CreatePackage(L"Game/ImagePkg");
 
-	Data.Add(0);
-	const uint8* Ptr = &Data[0];
-	FString Name = FPaths::GetBaseFilename(Filename);
-	FString FileExtension = FPaths::GetExtension(Filename);
+			// The view is read-only and the decoders don't need a terminator, so no sentinel byte is appended
+			const uint8* Ptr = Data.GetData();
+			FString Name = FPaths::GetBaseFilename(Filename);
+			FString FileExtension = FPaths::GetExtension(Filename);
+
+			UObject* Ret = CreateBinary(UTexture::StaticClass(), Pkg, *Name, RF_Public | RF_Standalone, nullptr, *FileExtension, Ptr, Ptr + Data.Num());
+			Texture2D = Cast<UTexture2D>(Ret);
+			CacheLookup.AddTexture(Texture2D);
+		}
+	}
 
-	UObject* Ret = CreateBinary(UTexture::StaticClass(), Pkg, *Name, RF_Public | RF_Standalone, nullptr, *FileExtension, Ptr, Ptr + Data.Num() - 1);
-	Texture2D = Cast<UTexture2D>(Ret);
 	if(Texture2D)
 	{
-		USaveGame* GameSaver = UGameplayStatics::CreateSaveGameObject(UImageSaver::StaticClass());
-		UImageSaver* ImageSaver = Cast<UImageSaver>(GameSaver);
-		if(ImageSaver)
+		// Compressed and written in the background, the import doesn't wait for the slot
+		UImageSaver::AsyncSaveTextureToSlot(Texture2D, TEXT("TestSaveImage"), 0, FOnImageSaved());
+	}
+}
+
+void UImageImporter::ImportFileAsync(const FString Filename, FOnImageImported OnImported)
+{
+	ImportFileAsync(Filename, FOnImageImportedNative::CreateLambda([OnImported](UTexture2D* Texture, bool bSuccess)
+	{
+		OnImported.ExecuteIfBound(Texture, bSuccess);
+	}));
+}
+
+void UImageImporter::ImportFileAsync(const FString Filename, FOnImageImportedNative OnImported)
+{
+	check(IsInGameThread());
+
+	// The registry loads the image wrapper module, which only works on the game thread, make sure it exists before going wide
+	FImageDecoderRegistry::Get();
+
+	BeginAsyncImport();
+
+	Async(EAsyncExecution::ThreadPool, [this, Filename, CacheLookup = CreateCacheLookup(), OnImported = MoveTemp(OnImported)]() mutable
+	{
+		TSharedRef<FImportedImageStruct> Image = MakeShared<FImportedImageStruct>();
+		TSharedRef<FTextureDecodeTarget, ESPMode::ThreadSafe> Target = MakeShared<FTextureDecodeTarget, ESPMode::ThreadSafe>(this);
+		bool bDecoded = false;
+
+		if (!CacheLookup.PinByPath(Filename))
 		{
-			ImageSaver->SavedTexture2D = Texture2D;
-			if (UGameplayStatics::SaveGameToSlot(ImageSaver, "TestSaveImage", 0))
-				UE_LOG(ImageImporter, Verbose, TEXT("Image Save Successfully"))
+			FImageFileView Data;
+			if (Data.Open(*Filename) && Data.Num() > 0 && Data.Num() <= MAX_uint32)
+			{
+				if (!CacheLookup.PinByContent(Data.GetData(), Data.Num()))
+				{
+					bDecoded = ImportImage(Data.GetData(), Data.Num(), *Image, &Target.Get());
+				}
+			}
 			else
-				UE_LOG(ImageImporter, Warning, TEXT("Image Save Failed"))
+			{
+				UE_LOG(ImageImporter, Error, TEXT("Failed to load file '%s'"), *Filename);
+			}
+
+			// Unmap the file before handing the decoded image back
+			Data.Close();
 		}
+
+		AsyncTask(ENamedThreads::GameThread, [this, Image, Target, bDecoded, Filename, CacheLookup = MoveTemp(CacheLookup), OnImported = MoveTemp(OnImported)]() mutable
+		{
+			UTexture2D* Texture = CacheLookup.TakeTexture();
+			if (!Texture)
+			{
+				Texture = Target->FinishTexture(*Image, bDecoded);
+				CacheLookup.AddTexture(Texture);
+			}
+			FImageScratchBufferPool::Get().Release(Image->RawData);
+
+			if (Texture)
+			{
+				Texture2D = Texture;
+			}
+			else
+			{
+				UE_LOG(ImageImporter, Warning, TEXT("Failed to import '%s'"), *Filename);
+			}
+
+			OnImported.ExecuteIfBound(Texture, Texture != nullptr);
+			EndAsyncImport();
+		});
+	});
+}
+
+UTiledImage* UImageImporter::OpenTiledImage(const FString Filename, int32 TileSize, int32 MaxResidentMegabytes)
+{
+	check(IsInGameThread());
+
+	TSharedPtr<FTiledImageSource, ESPMode::ThreadSafe> Source = FTiledImageSource::Open(Filename);
+	if (!Source.IsValid())
+	{
+		return nullptr;
+	}
+
+	UTiledImage* TiledImage = NewObject<UTiledImage>(this);
+	TiledImage->Init(this, MoveTemp(Source), TileSize, MaxResidentMegabytes);
+
+	UE_LOG(ImageImporter, Log, TEXT("Opened %d x %d image '%s' as %d x %d tiles"), TiledImage->GetWidth(), TiledImage->GetHeight(), *Filename, TiledImage->GetNumTilesX(), TiledImage->GetNumTilesY());
+	return TiledImage;
+}
+
+void UImageImporter::BeginAsyncImport()
+{
+	check(IsInGameThread());
+	if (NumPendingAsyncImports++ == 0)
+	{
+		AddToRoot();
+	}
+}
+
+void UImageImporter::EndAsyncImport()
+{
+	check(IsInGameThread());
+	check(NumPendingAsyncImports > 0);
+	if (--NumPendingAsyncImports == 0)
+	{
+		RemoveFromRoot();
 	}
 }
 
 UObject* UImageImporter::CreateBinary(UClass* InClass, UObject* InParent, FName InName, EObjectFlags Flags,
 	UObject* Context, const TCHAR* Type, const uint8*& Buffer, const uint8* BufferEnd)
 {
-	const int32 Length = BufferEnd - Buffer;
+	RTIMAGEIMPORT_STAGE_SCOPE(CreateBinary);
+
+	const uint32 Length = uint32(BufferEnd - Buffer);
 	FImportedImageStruct Image;
-	if (ImportImage(Buffer, Length, Image))
+	TSharedRef<FTextureDecodeTarget, ESPMode::ThreadSafe> Target = MakeShared<FTextureDecodeTarget, ESPMode::ThreadSafe>(this);
+	const bool bDecoded = ImportImage(Buffer, Length, Image, &Target.Get());
+
+	UTexture2D* Texture = Target->FinishTexture(Image, bDecoded);
+	FImageScratchBufferPool::Get().Release(Image.RawData);
+	return Texture;
+}
+
+FImageTextureCacheStats UImageImporter::GetTextureCacheStats()
+{
+	return FImageTextureCache::Get().GetStats();
+}
+
+void UImageImporter::FlushTextureCache()
+{
+	FImageTextureCache::Get().Empty();
+}
+
+void UImageImporter::ReleaseTexture(UTexture2D* Texture)
+{
+	FImageTexturePool::Get().Release(Texture);
+}
+
+void UImageImporter::FlushTexturePool()
+{
+	FImageTexturePool::Get().Empty();
+}
+
+uint64 UImageImporter::GetImportSettingsHash() const
+{
+	const uint32 Settings[] =
 	{
-		UTexture2D* Texture = UTexture2D::CreateTransient(Image.SizeX, Image.SizeY, PF_B8G8R8A8);
-		if (Texture)
+		uint32(bGenerateMips),
+		uint32(bCompressTextures),
+		uint32(CompressionQuality),
+		uint32(bOverrideCompressionSettings),
+		uint32(CompressionSettings),
+		uint32(FMath::Max(MaxDimension, 0)),
+		uint32(OversizePolicy),
+		uint32(FMath::Max<int64>(MaxImportPixels, 0)),
+		uint32(FMath::Max<int64>(MaxImportPixels, 0) >> 32),
+		uint32(FMath::Max(MaxImportMegabytes, 0)),
+		// Retained JPEGs aren't stored, but an entry decoded without it must not be served once it is on
+		uint32(bRetainJpegData),
+	};
+	return CityHash64(reinterpret_cast<const char*>(Settings), sizeof(Settings));
+}
+
+FImageCacheLookup UImageImporter::CreateCacheLookup() const
+{
+	check(IsInGameThread());
+
+	if (bUseTextureCache)
+	{
+		// Workers only pin entries, make sure the cache exists before they look it up
+		FImageTextureCache::Get();
+	}
+	return FImageCacheLookup(bUseTextureCache, TextureCacheKey, GetImportSettingsHash());
+}
+
+EPixelFormat UImageImporter::GetPixelFormatForSourceFormat(ETextureSourceFormat Format)
+{
+	switch (Format)
+	{
+	case TSF_G8:		return PF_G8;
+	case TSF_G16:		return PF_G16;
+	case TSF_BGRA8:		return PF_B8G8R8A8;
+	case TSF_RGBA16:	return PF_R16G16B16A16_UNORM;
+	case TSF_RGBA16F:	return PF_FloatRGBA;
+	default:			return PF_Unknown;
+	}
+}
+
+UTexture2D* UImageImporter::CreateTransientTexture(int32 SizeX, int32 SizeY, int32 NumMips, EPixelFormat PixelFormat)
+{
+	UTexture2D* Texture = UTexture2D::CreateTransient(SizeX, SizeY, PixelFormat);
+	if (Texture)
+	{
+		const FPixelFormatInfo& FormatInfo = GPixelFormats[PixelFormat];
+		FTexturePlatformData* PlatformData = Texture->GetPlatformData();
+		for (int32 MipIndex = 1; MipIndex < NumMips; ++MipIndex)
 		{
-			// if (Image.RawDataCompressionFormat == ETextureSourceCompressionFormat::TSCF_None)
-			// {
-				// Texture->Source.Init(
-				// 	Image.SizeX,
-				// 	Image.SizeY,
-				// 	/*NumSlices=*/ 1,
-				// 	Image.NumMips,
-				// 	Image.Format,
-				// 	Image.RawData.GetData()
-				// );
-				void* DataPtr = Texture->GetPlatformData()->Mips[0].BulkData.Lock(EBulkDataLockFlags::LOCK_READ_WRITE);
-				FMemory::Memcpy(DataPtr, Image.RawData.GetData(), Image.RawData.Num());
-				Texture->GetPlatformData()->Mips[0].BulkData.Unlock();
-				Texture->UpdateResource();
-			// }
-			// else
-			// {
-			// 	Texture->Source.InitWithCompressedSourceData(
-			// 		Image.SizeX,
-			// 		Image.SizeY,
-			// 		Image.NumMips,
-			// 		Image.Format,
-			// 		Image.RawData,
-			// 		Image.RawDataCompressionFormat
-			// 	);
-			// }
-
-			Texture->CompressionSettings = Image.CompressionSettings;
-
-			
-			Texture->SRGB = Image.SRGB;
-			
-			
+			FTexture2DMipMap* Mip = new FTexture2DMipMap();
+			Mip->SizeX = FMath::Max(SizeX >> MipIndex, 1);
+			Mip->SizeY = FMath::Max(SizeY >> MipIndex, 1);
+			Mip->SizeZ = 1;
+
+			const int64 NumBlocksX = FMath::DivideAndRoundUp<int64>(Mip->SizeX, FormatInfo.BlockSizeX);
+			const int64 NumBlocksY = FMath::DivideAndRoundUp<int64>(Mip->SizeY, FormatInfo.BlockSizeY);
+			Mip->BulkData.Lock(EBulkDataLockFlags::LOCK_READ_WRITE);
+			Mip->BulkData.Realloc(NumBlocksX * NumBlocksY * FormatInfo.BlockBytes);
+			Mip->BulkData.Unlock();
+
+			PlatformData->Mips.Add(Mip);
 		}
-		return Texture;
+	}
+	return Texture;
+}
+
+UTexture2D* UImageImporter::CreateTextureFromRetainedJpeg(const FImportedImageStruct& Image)
+{
+#if RTIMAGEIMPORT_WITH_LIBJPEGTURBO
+	FJpegRowDecoder JpegDecoder(Image.RawData.GetData(), Image.RawData.Num());
+	if (!JpegDecoder.ReadHeader() || JpegDecoder.GetWidth() != Image.SizeX || JpegDecoder.GetHeight() != Image.SizeY || Image.NumMips != 1)
+	{
+		UE_LOG(ImageImporter, Error, TEXT("Retained JPEG data doesn't match its %d x %d image"), Image.SizeX, Image.SizeY);
+		return nullptr;
+	}
+
+	const EPixelFormat PixelFormat = GetPixelFormatForSourceFormat(JpegDecoder.GetTextureFormat());
+	if (!GPixelFormats[PixelFormat].Supported)
+	{
+		UE_LOG(ImageImporter, Error, TEXT("Pixel format %s is not supported by this RHI"), GPixelFormats[PixelFormat].Name);
+		return nullptr;
 	}
 
+	UTexture2D* Texture = CreateTransientTexture(Image.SizeX, Image.SizeY, 1, PixelFormat);
+	if (!Texture)
+	{
+		return nullptr;
+	}
+
+	FByteBulkData& BulkData = Texture->GetPlatformData()->Mips[0].BulkData;
+	const bool bDecoded = JpegDecoder.Decode(static_cast<uint8*>(BulkData.Lock(EBulkDataLockFlags::LOCK_READ_WRITE)), BulkData.GetBulkDataSize(), 1);
+	BulkData.Unlock();
+
+	if (!bDecoded)
+	{
+		return nullptr;
+	}
+
+	Texture->CompressionSettings = Image.CompressionSettings;
+	Texture->SRGB = Image.SRGB;
+	Texture->UpdateResource();
+	FImageImportStats::Get().AddUploadedTexture(Texture);
+	return Texture;
+#else
+	UE_LOG(ImageImporter, Error, TEXT("Retained JPEG data needs libjpeg-turbo, which this platform doesn't have"));
 	return nullptr;
+#endif
 }
 
-bool UImageImporter::ImportImage(const uint8* Buffer, uint32 Length, FImportedImageStruct& OutImage)
+UTexture2D* UImageImporter::CreateTextureFromImage(const FImportedImageStruct& Image)
 {
-	IImageWrapperModule& ImageWrapperModule = FModuleManager::LoadModuleChecked<IImageWrapperModule>(FName("ImageWrapper"));
+	check(IsInGameThread());
+	RTIMAGEIMPORT_STAGE_SCOPE(CreateTexture);
 
-	// Use the magic bytes when possible to avoid calling inefficient code to check if the image is of the right format
-	EImageFormat ImageFormat = ImageWrapperModule.DetectImageFormat(Buffer, int64(Length));
+	if (Image.RawDataCompressionFormat == TSCF_JPEG)
+	{
+		return CreateTextureFromRetainedJpeg(Image);
+	}
 
-	const bool bAllowNonPowerOfTwo = true;
+	const bool bBlockCompressed = Image.PixelFormat != PF_Unknown;
+	EPixelFormat PixelFormat = bBlockCompressed ? Image.PixelFormat : GetPixelFormatForSourceFormat(Image.Format);
+	if (PixelFormat == PF_Unknown)
+	{
+		UE_LOG(ImageImporter, Error, TEXT("No pixel format for texture source format %d"), (int32)Image.Format);
+		return nullptr;
+	}
 
-	//
-	// PNG
-	//
-	if (ImageFormat == EImageFormat::PNG)
+	int64 SourceSize = 0;
+	for (int32 MipIndex = 0; MipIndex < Image.NumMips; ++MipIndex)
 	{
-		TSharedPtr<IImageWrapper> PngImageWrapper = ImageWrapperModule.CreateImageWrapper(EImageFormat::PNG);
-		if (PngImageWrapper.IsValid() && PngImageWrapper->SetCompressed(Buffer, Length))
+		SourceSize += Image.GetMipSize(MipIndex);
+	}
+
+	if (Image.RawData.Num() < SourceSize)
+	{
+		UE_LOG(ImageImporter, Error, TEXT("Image data is %lld bytes, %lld are needed for %d x %d with %d mips"), Image.RawData.Num(), SourceSize, Image.SizeX, Image.SizeY, Image.NumMips);
+		return nullptr;
+	}
+
+	const uint8* SourceData = Image.RawData.GetData();
+	bool bSRGB = Image.SRGB;
+	TextureCompressionSettings Settings = Image.CompressionSettings;
+
+	TArray64<uint8> ConvertedData;
+	if (!GPixelFormats[PixelFormat].Supported)
+	{
+		if (bBlockCompressed || !ConvertToBGRA8(Image, ConvertedData))
 		{
-			if (!IsImportResolutionValid(PngImageWrapper->GetWidth(), PngImageWrapper->GetHeight(), bAllowNonPowerOfTwo))
-			{
-				return false;
-			}
+			UE_LOG(ImageImporter, Error, TEXT("Pixel format %s is not supported by this RHI"), GPixelFormats[PixelFormat].Name);
+			return nullptr;
+		}
 
-			// Select the texture's source format
-			ETextureSourceFormat TextureFormat = TSF_Invalid;
-			int32 BitDepth = PngImageWrapper->GetBitDepth();
-			ERGBFormat Format = PngImageWrapper->GetFormat();
+		UE_LOG(ImageImporter, Verbose, TEXT("Pixel format %s is not supported by this RHI, converting to PF_B8G8R8A8"), GPixelFormats[PixelFormat].Name);
+		PixelFormat = PF_B8G8R8A8;
+		SourceData = ConvertedData.GetData();
 
-			if (Format == ERGBFormat::Gray)
-			{
-				if (BitDepth <= 8)
-				{
-					TextureFormat = TSF_G8;
-					Format = ERGBFormat::Gray;
-					BitDepth = 8;
-				}
-				else if (BitDepth == 16)
-				{
-					TextureFormat = TSF_G16;
-					Format = ERGBFormat::Gray;
-					BitDepth = 16;
-				}
-			}
-			else if (Format == ERGBFormat::RGBA || Format == ERGBFormat::BGRA)
+		// HDR images lose their range, 8 bits of linear color would band badly
+		if (IsBGRA8ConversionSRGB(Image.Format))
+		{
+			bSRGB = true;
+			Settings = TC_Default;
+		}
+	}
+
+	FImageTexturePoolKey PoolKey;
+	PoolKey.SizeX = Image.SizeX;
+	PoolKey.SizeY = Image.SizeY;
+	PoolKey.NumMips = Image.NumMips;
+	PoolKey.PixelFormat = PixelFormat;
+	PoolKey.bSRGB = bSRGB;
+	if (UTexture2D* PooledTexture = FImageTexturePool::Get().Acquire(PoolKey))
+	{
+		RefillPooledTexture(PooledTexture, SourceData);
+		FImageScratchBufferPool::Get().Release(ConvertedData);
+		PooledTexture->CompressionSettings = Settings;
+		FImageImportStats::Get().AddUploadedTexture(PooledTexture);
+		return PooledTexture;
+	}
+
+	UTexture2D* Texture = CreateTransientTexture(Image.SizeX, Image.SizeY, Image.NumMips, PixelFormat);
+	if (Texture)
+	{
+		// if (Image.RawDataCompressionFormat == ETextureSourceCompressionFormat::TSCF_None)
+		// {
+			// Texture->Source.Init(
+			// 	Image.SizeX,
+			// 	Image.SizeY,
+			// 	/*NumSlices=*/ 1,
+			// 	Image.NumMips,
+			// 	Image.Format,
+			// 	Image.RawData.GetData()
+			// );
+			for (int32 MipIndex = 0; MipIndex < Image.NumMips; ++MipIndex)
 			{
-				if (BitDepth <= 8)
-				{
-					TextureFormat = TSF_BGRA8;
-					Format = ERGBFormat::BGRA;
-					BitDepth = 8;
-				}
-				else if (BitDepth == 16)
+				const int64 MipSize = ConvertedData.Num() > 0
+					? Image.GetMipSize(MipIndex) / FTextureSource::GetBytesPerPixel(Image.Format) * 4
+					: Image.GetMipSize(MipIndex);
+				FByteBulkData& BulkData = Texture->GetPlatformData()->Mips[MipIndex].BulkData;
+				if (BulkData.GetBulkDataSize() != MipSize)
 				{
-					TextureFormat = TSF_RGBA16;
-					Format = ERGBFormat::RGBA;
-					BitDepth = 16;
+					UE_LOG(ImageImporter, Error, TEXT("Mip %d size mismatch, texture has %lld bytes and the image %lld"), MipIndex, (int64)BulkData.GetBulkDataSize(), MipSize);
+					return nullptr;
 				}
-			}
 
-			if (TextureFormat == TSF_Invalid)
-			{
-				// Warn->Logf(ELogVerbosity::Error, TEXT("PNG file contains data in an unsupported format."));
-				return false;
+				void* DataPtr = BulkData.Lock(EBulkDataLockFlags::LOCK_READ_WRITE);
+				FMemory::Memcpy(DataPtr, SourceData, MipSize);
+				BulkData.Unlock();
+
+				SourceData += MipSize;
 			}
+			FImageScratchBufferPool::Get().Release(ConvertedData);
+		// }
+		// else
+		// {
+		// 	Texture->Source.InitWithCompressedSourceData(
+		// 		Image.SizeX,
+		// 		Image.SizeY,
+		// 		Image.NumMips,
+		// 		Image.Format,
+		// 		Image.RawData,
+		// 		Image.RawDataCompressionFormat
+		// 	);
+		// }
+
+		Texture->CompressionSettings = Settings;
+
+		// Has to be set before the resource is created, the RHI texture is created sRGB or not
+		Texture->SRGB = bSRGB;
+
+		Texture->UpdateResource();
+		FImageImportStats::Get().AddUploadedTexture(Texture);
+	}
+	return Texture;
+}
 
-			OutImage.Init2DWithParams(
-				PngImageWrapper->GetWidth(),
-				PngImageWrapper->GetHeight(),
-				TextureFormat,
-				BitDepth < 16
-			);
+bool UImageImporter::ImportImage(const uint8* Buffer, uint32 Length, FImportedImageStruct& OutImage, FImageDecodeTarget* Target)
+{
+	RTIMAGEIMPORT_STAGE_SCOPE(ImportImage);
 
-			if (PngImageWrapper->GetRaw(Format, BitDepth, OutImage.RawData))
-			{
-				bool bFillPNGZeroAlpha = true;
-				GConfig->GetBool(TEXT("TextureImporter"), TEXT("FillPNGZeroAlpha"), bFillPNGZeroAlpha, GEditorIni);
-
-				if (bFillPNGZeroAlpha)
-				{
-					// Replace the pixels with 0.0 alpha with a color value from the nearest neighboring color which has a non-zero alpha
-					FillZeroAlphaPNGData(OutImage.SizeX, OutImage.SizeY, OutImage.Format, OutImage.RawData.GetData());
-				}
-			}
-			else
-			{
-				// Warn->Logf(ELogVerbosity::Error, TEXT("Failed to decode PNG."));
-				return false;
-			}
+	// DDS data is stored as the texture wants it, caching it would only add a second copy on disk
+	const bool bUseDiskCacheForImage = bUseDiskCache && !FDdsDecoder::IsDds(Buffer, Length);
 
+	uint64 DiskCacheKey = 0;
+	if (bUseDiskCacheForImage)
+	{
+		DiskCacheKey = FImageCacheKey::FromContent(Buffer, Length, GetImportSettingsHash()).Hash;
+		if (FImageDiskCache::Get().Load(DiskCacheKey, OutImage, Target))
+		{
 			return true;
 		}
 	}
 
-	//
-	// JPEG
-	//
-	if (ImageFormat == EImageFormat::JPEG)
 	{
-		TSharedPtr<IImageWrapper> JpegImageWrapper = ImageWrapperModule.CreateImageWrapper(EImageFormat::JPEG);
-		if (JpegImageWrapper.IsValid() && JpegImageWrapper->SetCompressed(Buffer, Length))
+		RTIMAGEIMPORT_STAGE_SCOPE(Decode);
+
+		const double DecodeStartTime = FPlatformTime::Seconds();
+		const TCHAR* FormatName = nullptr;
+		if (!FImageDecoderRegistry::Get().Decode(*this, Buffer, Length, OutImage, Target, FormatName))
 		{
-			if (!IsImportResolutionValid(JpegImageWrapper->GetWidth(), JpegImageWrapper->GetHeight(), bAllowNonPowerOfTwo))
-			{
-				return false;
-			}
+			return false;
+		}
 
-			// Select the texture's source format
-			ETextureSourceFormat TextureFormat = TSF_Invalid;
-			int32 BitDepth = JpegImageWrapper->GetBitDepth();
-			ERGBFormat Format = JpegImageWrapper->GetFormat();
+		FImageImportStats::Get().AddDecodedImage(
+			FormatName,
+			Length,
+			(int64)OutImage.SizeX * OutImage.SizeY,
+			FPlatformTime::Seconds() - DecodeStartTime);
+	}
 
-			if (Format == ERGBFormat::Gray)
-			{
-				if (BitDepth <= 8)
-				{
-					TextureFormat = TSF_G8;
-					Format = ERGBFormat::Gray;
-					BitDepth = 8;
-				}
-			}
-			else if (Format == ERGBFormat::RGBA)
-			{
-				if (BitDepth <= 8)
-				{
-					TextureFormat = TSF_BGRA8;
-					Format = ERGBFormat::BGRA;
-					BitDepth = 8;
-				}
-			}
+	if (bOverrideCompressionSettings)
+	{
+		OutImage.CompressionSettings = CompressionSettings;
+	}
 
-			if (TextureFormat == TSF_Invalid)
-			{
-				// Warn->Logf(ELogVerbosity::Error, TEXT("JPEG file contains data in an unsupported format."));
-				return false;
-			}
+	DownsampleToMaxDimension(OutImage);
+
+	// Built-in decoders reject what they can't bring within the limits before decoding, this catches other decoders
+	if (!IsWithinImportLimits(OutImage.SizeX, OutImage.SizeY, OutImage.Format))
+	{
+		UE_LOG(ImageImporter, Warning, TEXT("Rejecting %d x %d image, it exceeds the import limits and can't be scaled down"), OutImage.SizeX, OutImage.SizeY);
+		return false;
+	}
 
-			OutImage.Init2DWithParams(
-				JpegImageWrapper->GetWidth(),
-				JpegImageWrapper->GetHeight(),
-				TextureFormat,
-				BitDepth < 16
-			);
-
-			// bool bRetainJpegFormat = false;
-			// // if (EnumHasAllFlags(Flags, EImageImportFlags::AllowReturnOfCompressedData))
-			// // {
-			// // 	// For now this option is opt in via the config files once there is no technical risk this will become the default path.
-			// // 	GConfig->GetBool(TEXT("TextureImporter"), TEXT("RetainJpegFormat"), bRetainJpegFormat, GEditorIni);
-			// // }
-			//
-			// if (bRetainJpegFormat)
-			// {
-			// 	OutImage.RawData.Append(Buffer, Length);
-			// 	OutImage.RawDataCompressionFormat = ETextureSourceCompressionFormat::TSCF_JPEG;
-			// }
-			// else if (!JpegImageWrapper->GetRaw(Format, BitDepth, OutImage.RawData))
-			// {
-			// 	Warn->Logf(ELogVerbosity::Error, TEXT("Failed to decode JPEG."));
-			// 	return false;
-			// }
+	// Images that arrive in a GPU format (DDS) keep the mips they came with and aren't compressed again
+	const bool bHasPixelFormat = OutImage.PixelFormat != PF_Unknown;
 
-			return true;
+	if (bGenerateMips && !bHasPixelFormat && CanGenerateMips(OutImage.Format))
+	{
+		GenerateMips(OutImage);
+	}
+
+	if (bCompressTextures && !bHasPixelFormat)
+	{
+		CompressImage(OutImage);
+	}
+
+	if (bUseDiskCacheForImage)
+	{
+		FImageDiskCache::Get().Store(DiskCacheKey, OutImage);
+	}
+
+	return true;
+}
+
+int32 UImageImporter::GetNumMipsToImport(const FImportedImageStruct& Image) const
+{
+	return bGenerateMips && CanGenerateMips(Image.Format) ? GetFullMipChainCount(Image.SizeX, Image.SizeY) : 1;
+}
+
+void UImageImporter::DownsampleToMaxDimension(FImportedImageStruct& Image) const
+{
+	// Decoders that scale while decoding already fit, the rest are scaled from the full size image here
+	const int32 Factor = FImageRowDownsampler::GetFactor(Image.SizeX, Image.SizeY, GetImportMaxDimension(Image.SizeX, Image.SizeY, Image.Format));
+	if (Factor == 1 || Image.NumMips != 1 || Image.IsRawDataInTarget() || Image.PixelFormat != PF_Unknown || Image.RawDataCompressionFormat != TSCF_None || !FImageRowDownsampler::SupportsFormat(Image.Format))
+	{
+		return;
+	}
+
+	FImportedImageStruct ScaledImage;
+	ScaledImage.Init2DWithOneMip(FImageRowDownsampler::GetScaledSize(Image.SizeX, Factor), FImageRowDownsampler::GetScaledSize(Image.SizeY, Factor), Image.Format);
+	ScaledImage.SRGB = Image.SRGB;
+	ScaledImage.CompressionSettings = Image.CompressionSettings;
+
+	FImageRowDownsampler Downsampler(Image.SizeX, Image.SizeY, Factor, Image.Format, Image.SRGB, ScaledImage.RawData.GetData());
+	const int64 RowBytes = (int64)Image.SizeX * FTextureSource::GetBytesPerPixel(Image.Format);
+	for (int32 Y = 0; Y < Image.SizeY; ++Y)
+	{
+		Downsampler.AddRow(Image.RawData.GetData() + Y * RowBytes);
+	}
+
+	FImageScratchBufferPool::Get().Release(Image.RawData);
+	Image = MoveTemp(ScaledImage);
+}
+
+int64 UImageImporter::EstimateImportBytes(const FImageHeaderInfo& Info) const
+{
+	const int32 Factor = FImageRowDownsampler::SupportsFormat(Info.Format) ? FImageRowDownsampler::GetFactor(Info.Width, Info.Height, GetImportMaxDimension(Info.Width, Info.Height, Info.Format)) : 1;
+	const int64 ScaledPixels = (int64)FImageRowDownsampler::GetScaledSize(Info.Width, Factor) * FImageRowDownsampler::GetScaledSize(Info.Height, Factor);
+	const int64 ImportedBytes = int64(ScaledPixels * GetImportBytesPerPixel(Info.Format, bGenerateMips));
+
+	// Images scaled after decoding hold the full size image next to the scaled one
+	const int64 FullSizeBytes = Factor > 1 && !Info.bScalesWhileDecoding ? (int64)Info.Width * Info.Height * FTextureSource::GetBytesPerPixel(Info.Format) : 0;
+	return ImportedBytes + FullSizeBytes;
+}
+
+void UImageImporter::GenerateMips(FImportedImageStruct& Image) const
+{
+	RTIMAGEIMPORT_STAGE_SCOPE(GenerateMips);
+
+	// Decoders that only produce mip 0 get the rest of the chain appended to RawData
+	const int32 NumMips = GetFullMipChainCount(Image.SizeX, Image.SizeY);
+	if (Image.NumMips != NumMips && !Image.IsRawDataInTarget())
+	{
+		Image.NumMips = NumMips;
+
+		int64 TotalSize = 0;
+		for (int32 MipIndex = 0; MipIndex < NumMips; ++MipIndex)
+		{
+			TotalSize += Image.GetMipSize(MipIndex);
 		}
+		Image.RawData.SetNumUninitialized(TotalSize);
+	}
+
+	TArray<uint8*, TInlineAllocator<16>> MipData;
+	for (int32 MipIndex = 0; MipIndex < Image.NumMips; ++MipIndex)
+	{
+		MipData.Add(static_cast<uint8*>(Image.GetMipData(MipIndex)));
+	}
+
+	GenerateMipChain(Image.Format, Image.SRGB, Image.SizeX, Image.SizeY, MipData);
+}
+
+void UImageImporter::CompressImage(FImportedImageStruct& Image) const
+{
+	RTIMAGEIMPORT_STAGE_SCOPE(Compress);
+
+	check(!Image.IsRawDataInTarget() && Image.PixelFormat == PF_Unknown);
+
+	// Transient textures in block formats have to be whole blocks, the edge blocks of other sizes have nowhere to go
+	if (Image.SizeX % 4 != 0 || Image.SizeY % 4 != 0)
+	{
+		UE_LOG(ImageImporter, Verbose, TEXT("Keeping %d x %d image uncompressed, block compressed textures need sizes that are a multiple of 4"), Image.SizeX, Image.SizeY);
+		return;
+	}
+
+	bool bHasAlpha = false;
+	if (Image.Format == TSF_BGRA8)
+	{
+		const FColor* Pixels = reinterpret_cast<const FColor*>(Image.RawData.GetData());
+		const int64 NumPixels = (int64)Image.SizeX * Image.SizeY;
+		for (int64 Index = 0; Index < NumPixels && !bHasAlpha; ++Index)
+		{
+			bHasAlpha = Pixels[Index].A != 255;
+		}
+	}
+
+	const EPixelFormat PixelFormat = GetBlockCompressedFormat(Image.CompressionSettings, Image.Format, Image.SRGB, bHasAlpha);
+	if (PixelFormat == PF_Unknown || !GPixelFormats[PixelFormat].Supported)
+	{
+		UE_LOG(ImageImporter, Verbose, TEXT("Keeping %d x %d image uncompressed, no supported block format for compression settings %d"), Image.SizeX, Image.SizeY, (int32)Image.CompressionSettings);
+		return;
+	}
+
+	TArray<int64, TInlineAllocator<16>> SourceOffsets;
+	int64 SourceOffset = 0;
+	for (int32 MipIndex = 0; MipIndex < Image.NumMips; ++MipIndex)
+	{
+		SourceOffsets.Add(SourceOffset);
+		SourceOffset += Image.GetMipSize(MipIndex);
+	}
+
+	// From here on GetMipSize returns block compressed sizes
+	Image.PixelFormat = PixelFormat;
+
+	int64 TotalSize = 0;
+	for (int32 MipIndex = 0; MipIndex < Image.NumMips; ++MipIndex)
+	{
+		TotalSize += Image.GetMipSize(MipIndex);
 	}
 
-	// //
-	// // EXR
-	// //
-	// if (ImageFormat == EImageFormat::EXR)
-	// {
-	// 	TSharedPtr<IImageWrapper> ExrImageWrapper = ImageWrapperModule.CreateImageWrapper(EImageFormat::EXR);
-	// 	if (ExrImageWrapper.IsValid() && ExrImageWrapper->SetCompressed(Buffer, Length))
-	// 	{
-	// 		int32 Width = ExrImageWrapper->GetWidth();
-	// 		int32 Height = ExrImageWrapper->GetHeight();
-	//
-	// 		if (!IsImportResolutionValid(Width, Height, bAllowNonPowerOfTwo, Warn))
-	// 		{
-	// 			return false;
-	// 		}
-	//
-	// 		// Currently the only texture source format compatible with EXR image formats is TSF_RGBA16F.
-	// 		// EXR decoder automatically converts imported image channels into the requested float format.
-	// 		// In case if the imported image is a gray scale image, its content will be stored in the green channel of the created texture.
-	// 		ETextureSourceFormat TextureFormat = TSF_RGBA16F;
-	// 		ERGBFormat Format = ERGBFormat::RGBAF;
-	// 		int32 BitDepth = 16;
-	//
-	// 		OutImage.Init2DWithParams(
-	// 			Width,
-	// 			Height,
-	// 			TextureFormat,
-	// 			false
-	// 		);
-	// 		OutImage.CompressionSettings = TC_HDR;
-	//
-	// 		if (!ExrImageWrapper->GetRaw(Format, BitDepth, OutImage.RawData))
-	// 		{
-	// 			Warn->Logf(ELogVerbosity::Error, TEXT("Failed to decode EXR."));
-	// 			return false;
-	// 		}
-	//
-	// 		return true;
-	// 	}
-	// }
-	//
-	// //
-	// // BMP
-	// //
-	// if (ImageFormat == EImageFormat::BMP)
-	// {
-	// 	TSharedPtr<IImageWrapper> BmpImageWrapper = ImageWrapperModule.CreateImageWrapper(EImageFormat::BMP);
-	// 	if (BmpImageWrapper.IsValid() && BmpImageWrapper->SetCompressed(Buffer, Length))
-	// 	{
-	// 		// Check the resolution of the imported texture to ensure validity
-	// 		if (!IsImportResolutionValid(BmpImageWrapper->GetWidth(), BmpImageWrapper->GetHeight(), bAllowNonPowerOfTwo, Warn))
-	// 		{
-	// 			return false;
-	// 		}
-	//
-	// 		OutImage.Init2DWithParams(
-	// 			BmpImageWrapper->GetWidth(),
-	// 			BmpImageWrapper->GetHeight(),
-	// 			TSF_BGRA8,
-	// 			false
-	// 		);
-	//
-	// 		return BmpImageWrapper->GetRaw(BmpImageWrapper->GetFormat(), BmpImageWrapper->GetBitDepth(), OutImage.RawData);
-	// 	}
-	// }
-	//
-	// //
-	// // TIFF
-	// //
-	// if (ImageFormat == EImageFormat::TIFF)
-	// {
-	// 	TSharedPtr<IImageWrapper> TiffImageWrapper = ImageWrapperModule.CreateImageWrapper(EImageFormat::TIFF);
-	// 	if (TiffImageWrapper.IsValid())
-	// 	{
-	// 		if (TiffImageWrapper->SetCompressed(Buffer, Length))
-	// 		{
-	// 			// Check the resolution of the imported texture to ensure validity
-	// 			if (!IsImportResolutionValid(TiffImageWrapper->GetWidth(), TiffImageWrapper->GetHeight(), bAllowNonPowerOfTwo, Warn))
-	// 			{
-	// 				return false;
-	// 			}
-	//
-	// 			ETextureSourceFormat SourceFormat = TSF_Invalid;
-	// 			ERGBFormat TiffFormat = TiffImageWrapper->GetFormat();
-	// 			const int32 BitDepth = TiffImageWrapper->GetBitDepth();
-	// 			bool bIsSRGB = false;
-	//
-	// 			if (TiffFormat == ERGBFormat::BGRA)
-	// 			{
-	// 				SourceFormat = TSF_BGRA8;
-	// 				bIsSRGB = true;
-	// 			}
-	// 			else if (TiffFormat == ERGBFormat::RGBA)
-	// 			{
-	// 				SourceFormat = TSF_RGBA16;
-	// 			}
-	// 			else if (TiffFormat == ERGBFormat::RGBAF)
-	// 			{
-	// 				SourceFormat = TSF_RGBA16F;
-	// 			}
-	// 			else if (TiffFormat == ERGBFormat::Gray)
-	// 			{
-	// 				SourceFormat = TSF_G8;
-	// 				if (BitDepth == 16)
-	// 				{
-	// 					SourceFormat = TSF_G16;
-	// 				}
-	// 			}
-	//
-	// 			OutImage.Init2DWithParams(
-	// 				TiffImageWrapper->GetWidth(),
-	// 				TiffImageWrapper->GetHeight(),
-	// 				SourceFormat,
-	// 				bIsSRGB
-	// 			);
-	//
-	// 			return TiffImageWrapper->GetRaw(TiffFormat, BitDepth, OutImage.RawData);
-	// 		}
-	//
-	// 		return false;
-	// 	}
-	// }
-	//
-	// //
-	// // PCX
-	// //
-	// const FPCXFileHeader* PCX = (FPCXFileHeader*)Buffer;
-	// if (Length >= sizeof(FPCXFileHeader) && PCX->Manufacturer == 10)
-	// {
-	// 	int32 NewU = PCX->XMax + 1 - PCX->XMin;
-	// 	int32 NewV = PCX->YMax + 1 - PCX->YMin;
-	//
-	// 	// Check the resolution of the imported texture to ensure validity
-	// 	if (!IsImportResolutionValid(NewU, NewV, bAllowNonPowerOfTwo, Warn))
-	// 	{
-	// 		return false;
-	// 	}
-	// 	else if (PCX->NumPlanes == 1 && PCX->BitsPerPixel == 8)
-	// 	{
-	//
-	// 		// Set texture properties.
-	// 		OutImage.Init2DWithOneMip(
-	// 			NewU,
-	// 			NewV,
-	// 			TSF_BGRA8
-	// 		);
-	// 		FColor* DestPtr = (FColor*)OutImage.RawData.GetData();
-	//
-	// 		// Import the palette.
-	// 		uint8* PCXPalette = (uint8*)(Buffer + Length - 256 * 3);
-	// 		TArray<FColor>	Palette;
-	// 		for (uint32 i = 0; i < 256; i++)
-	// 		{
-	// 			Palette.Add(FColor(PCXPalette[i * 3 + 0], PCXPalette[i * 3 + 1], PCXPalette[i * 3 + 2], i == 0 ? 0 : 255));
-	// 		}
-	//
-	// 		// Import it.
-	// 		FColor* DestEnd = DestPtr + NewU * NewV;
-	// 		Buffer += 128;
-	// 		while (DestPtr < DestEnd)
-	// 		{
-	// 			uint8 Color = *Buffer++;
-	// 			if ((Color & 0xc0) == 0xc0)
-	// 			{
-	// 				uint32 RunLength = Color & 0x3f;
-	// 				Color = *Buffer++;
-	//
-	// 				for (uint32 Index = 0; Index < RunLength; Index++)
-	// 				{
-	// 					*DestPtr++ = Palette[Color];
-	// 				}
-	// 			}
-	// 			else *DestPtr++ = Palette[Color];
-	// 		}
-	// 	}
-	// 	else if (PCX->NumPlanes == 3 && PCX->BitsPerPixel == 8)
-	// 	{
-	// 		// Set texture properties.
-	// 		OutImage.Init2DWithOneMip(
-	// 			NewU,
-	// 			NewV,
-	// 			TSF_BGRA8
-	// 		);
-	//
-	// 		uint8* Dest = OutImage.RawData.GetData();
-	//
-	// 		// Doing a memset to make sure the alpha channel is set to 0xff since we only have 3 color planes.
-	// 		FMemory::Memset(Dest, 0xff, NewU * NewV * FTextureSource::GetBytesPerPixel(OutImage.Format));
-	//
-	// 		// Copy upside-down scanlines.
-	// 		Buffer += 128;
-	// 		int32 CountU = FMath::Min<int32>(PCX->BytesPerLine, NewU);
-	// 		for (int32 i = 0; i < NewV; i++)
-	// 		{
-	// 			// We need to decode image one line per time building RGB image color plane by color plane.
-	// 			int32 RunLength, Overflow = 0;
-	// 			uint8 Color = 0;
-	// 			for (int32 ColorPlane = 2; ColorPlane >= 0; ColorPlane--)
-	// 			{
-	// 				for (int32 j = 0; j < CountU; j++)
-	// 				{
-	// 					if (!Overflow)
-	// 					{
-	// 						Color = *Buffer++;
-	// 						if ((Color & 0xc0) == 0xc0)
-	// 						{
-	// 							RunLength = FMath::Min((Color & 0x3f), CountU - j);
-	// 							Overflow = (Color & 0x3f) - RunLength;
-	// 							Color = *Buffer++;
-	// 						}
-	// 						else
-	// 							RunLength = 1;
-	// 					}
-	// 					else
-	// 					{
-	// 						RunLength = FMath::Min(Overflow, CountU - j);
-	// 						Overflow = Overflow - RunLength;
-	// 					}
-	//
-	// 					//checkf(((i*NewU + RunLength) * 4 + ColorPlane) < (Texture->Source.CalcMipSize(0)),
-	// 					//	TEXT("RLE going off the end of buffer"));
-	// 					for (int32 k = j; k < j + RunLength; k++)
-	// 					{
-	// 						Dest[(i * NewU + k) * 4 + ColorPlane] = Color;
-	// 					}
-	// 					j += RunLength - 1;
-	// 				}
-	// 			}
-	// 		}
-	// 	}
-	// 	else
-	// 	{
-	// 		Warn->Logf(ELogVerbosity::Error, TEXT("PCX uses an unsupported format (%i/%i)"), PCX->NumPlanes, PCX->BitsPerPixel);
-	// 		return false;
-	// 	}
-	//
-	// 	return true;
-	// }
-	//
-	// //
-	// // TGA
-	// //
-	// TSharedPtr<IImageWrapper> TgaImageWrapper = ImageWrapperModule.CreateImageWrapper(EImageFormat::TGA);
-	// if (TgaImageWrapper.IsValid() && TgaImageWrapper->SetCompressed(Buffer, Length))
-	// {
-	// 	// Check the resolution of the imported texture to ensure validity
-	// 	if (!IsImportResolutionValid(TgaImageWrapper->GetWidth(), TgaImageWrapper->GetHeight(), bAllowNonPowerOfTwo, Warn))
-	// 	{
-	// 		return false;
-	// 	}
-	//
-	// 	const FTGAFileHeader* TGA = (FTGAFileHeader*)Buffer;
-	//
-	// 	if (TGA->ColorMapType == 1 && TGA->ImageTypeCode == 1 && TGA->BitsPerPixel == 8)
-	// 	{
-	// 		// Notes: The Scaleform GFx exporter (dll) strips all font glyphs into a single 8-bit texture.
-	// 		// The targa format uses this for a palette index; GFx uses a palette of (i,i,i,i) so the index
-	// 		// is also the alpha value.
-	// 		//
-	// 		// We store the image as PF_G8, where it will be used as alpha in the Glyph shader.
-	// 		OutImage.Init2DWithOneMip(
-	// 			TGA->Width,
-	// 			TGA->Height,
-	// 			TSF_G8);
-	// 		OutImage.CompressionSettings = TC_Grayscale;
-	// 	}
-	// 	else if (TGA->ColorMapType == 0 && TGA->ImageTypeCode == 3 && TGA->BitsPerPixel == 8)
-	// 	{
-	// 		// standard grayscale images
-	// 		OutImage.Init2DWithOneMip(
-	// 			TGA->Width,
-	// 			TGA->Height,
-	// 			TSF_G8);
-	// 		OutImage.CompressionSettings = TC_Grayscale;
-	// 	}
-	// 	else
-	// 	{
-	// 		if (TGA->ImageTypeCode == 10) // 10 = RLE compressed 
-	// 		{
-	// 			if (TGA->BitsPerPixel != 32 &&
-	// 				TGA->BitsPerPixel != 24 &&
-	// 				TGA->BitsPerPixel != 16)
-	// 			{
-	// 				Warn->Logf(ELogVerbosity::Error, TEXT("TGA uses an unsupported rle-compressed bit-depth: %u"), TGA->BitsPerPixel);
-	// 				return false;
-	// 			}
-	// 		}
-	// 		else
-	// 		{
-	// 			if (TGA->BitsPerPixel != 32 &&
-	// 				TGA->BitsPerPixel != 16 &&
-	// 				TGA->BitsPerPixel != 24)
-	// 			{
-	// 				Warn->Logf(ELogVerbosity::Error, TEXT("TGA uses an unsupported bit-depth: %u"), TGA->BitsPerPixel);
-	// 				return false;
-	// 			}
-	// 		}
-	//
-	// 		OutImage.Init2DWithOneMip(
-	// 			TGA->Width,
-	// 			TGA->Height,
-	// 			TSF_BGRA8);
-	// 	}
-	//
-	// 	const bool bResult = TgaImageWrapper->GetRaw(TgaImageWrapper->GetFormat(), TgaImageWrapper->GetBitDepth(), OutImage.RawData);
-	//
-	// 	if (bResult && OutImage.CompressionSettings == TC_Grayscale && TGA->ImageTypeCode == 3)
-	// 	{
-	// 		// default grayscales to linear as they wont get compression otherwise and are commonly used as masks
-	// 		OutImage.SRGB = false;
-	// 	}
-	//
-	// 	return bResult;
-	// }
-	//
-	// //
-	// // PSD File
-	// //
-	// FPSDFileHeader			 psdhdr;
-	// if (Length > sizeof(FPSDFileHeader))
-	// {
-	// 	psd_GetPSDHeader(Buffer, psdhdr);
-	// }
-	// if (psdhdr.IsValid())
-	// {
-	// 	// Check the resolution of the imported texture to ensure validity
-	// 	if (!IsImportResolutionValid(psdhdr.Width, psdhdr.Height, bAllowNonPowerOfTwo, Warn))
-	// 	{
-	// 		return false;
-	// 	}
-	// 	if (!psdhdr.IsSupported())
-	// 	{
-	// 		Warn->Logf(TEXT("Format of this PSD is not supported. Only Grayscale and RGBColor PSD images are currently supported, in 8-bit or 16-bit."));
-	// 		return false;
-	// 	}
-	//
-	// 	// Select the texture's source format
-	// 	ETextureSourceFormat TextureFormat = TSF_Invalid;
-	// 	if (psdhdr.Depth == 8)
-	// 	{
-	// 		TextureFormat = TSF_BGRA8;
-	// 	}
-	// 	else if (psdhdr.Depth == 16)
-	// 	{
-	// 		TextureFormat = TSF_RGBA16;
-	// 	}
-	//
-	// 	if (TextureFormat == TSF_Invalid)
-	// 	{
-	// 		Warn->Logf(ELogVerbosity::Error, TEXT("PSD file contains data in an unsupported format."));
-	// 		return false;
-	// 	}
-	//
-	// 	// The psd is supported. Load it up.        
-	// 	OutImage.Init2DWithOneMip(
-	// 		psdhdr.Width,
-	// 		psdhdr.Height,
-	// 		TextureFormat
-	// 	);
-	// 	uint8* Dst = (uint8*)OutImage.RawData.GetData();
-	//
-	// 	if (!psd_ReadData(Dst, Buffer, psdhdr))
-	// 	{
-	// 		Warn->Logf(TEXT("Failed to read this PSD"));
-	// 		return false;
-	// 	}
-	//
-	// 	return true;
-	// }
-	//
-	// //
-	// // DDS Texture
-	// //
-	// FDDSLoadHelper  DDSLoadHelper(Buffer, Length);
-	// if (DDSLoadHelper.IsValid2DTexture())
-	// {
-	// 	// DDS 2d texture
-	// 	if (!IsImportResolutionValid(DDSLoadHelper.DDSHeader->dwWidth, DDSLoadHelper.DDSHeader->dwHeight, bAllowNonPowerOfTwo, Warn))
-	// 	{
-	// 		Warn->Logf(ELogVerbosity::Error, TEXT("DDS has invalid dimensions."));
-	// 		return false;
-	// 	}
-	//
-	// 	ETextureSourceFormat SourceFormat = DDSLoadHelper.ComputeSourceFormat();
-	//
-	// 	// Invalid DDS format
-	// 	if (SourceFormat == TSF_Invalid)
-	// 	{
-	// 		Warn->Logf(ELogVerbosity::Error, TEXT("DDS uses an unsupported format."));
-	// 		return false;
-	// 	}
-	//
-	// 	uint32 MipMapCount = DDSLoadHelper.ComputeMipMapCount();
-	// 	if (SourceFormat != TSF_Invalid && MipMapCount > 0)
-	// 	{
-	// 		OutImage.Init2DWithMips(
-	// 			DDSLoadHelper.DDSHeader->dwWidth,
-	// 			DDSLoadHelper.DDSHeader->dwHeight,
-	// 			MipMapCount,
-	// 			SourceFormat,
-	// 			DDSLoadHelper.GetDDSDataPointer()
-	// 		);
-	//
-	// 		if (MipMapCount > 1)
-	// 		{
-	// 			// if the source has mips we keep the mips by default, unless the user changes that
-	// 			MipGenSettings = TMGS_LeaveExistingMips;
-	// 		}
-	//
-	// 		if (FTextureSource::IsHDR(SourceFormat))
-	// 		{
-	// 			// the loader can suggest a compression setting
-	// 			OutImage.CompressionSettings = TC_HDR;
-	// 			OutImage.SRGB = false;
-	// 		}
-	//
-	// 		return true;
-	// 	}
-	// }
-	//
-	//
-	// //
-	// // Legacy TIFF import (for the platforms that doesn't have libtiff)
-	// //
-	// FTiffLoadHelper TiffLoaderHelper;
-	// if (TiffLoaderHelper.IsValid())
-	// {
-	// 	if (TiffLoaderHelper.Load(Buffer, Length))
-	// 	{
-	// 		OutImage.Init2DWithOneMip(
-	// 			TiffLoaderHelper.Width,
-	// 			TiffLoaderHelper.Height,
-	// 			TiffLoaderHelper.TextureSourceFormat,
-	// 			TiffLoaderHelper.RawData.GetData()
-	// 		);
-	//
-	// 		OutImage.SRGB = TiffLoaderHelper.bSRGB;
-	// 		OutImage.CompressionSettings = TiffLoaderHelper.CompressionSettings;
-	// 		return true;
-	// 	}
-	// }
-
-	return false;
+	TArray64<uint8> CompressedData;
+	FImageScratchBufferPool::Get().Acquire(CompressedData, TotalSize);
+
+	int64 DestOffset = 0;
+	for (int32 MipIndex = 0; MipIndex < Image.NumMips; ++MipIndex)
+	{
+		const int32 MipSizeX = FMath::Max(Image.SizeX >> MipIndex, 1);
+		const int32 MipSizeY = FMath::Max(Image.SizeY >> MipIndex, 1);
+		CompressMipBlocks(PixelFormat, Image.Format, Image.RawData.GetData() + SourceOffsets[MipIndex], MipSizeX, MipSizeY, CompressedData.GetData() + DestOffset, CompressionQuality);
+		DestOffset += Image.GetMipSize(MipIndex);
+	}
+
+	FImageScratchBufferPool::Get().Release(Image.RawData);
+	Image.RawData = MoveTemp(CompressedData);
+
+	// Normal maps are data, BC5 has no sRGB variant
+	if (PixelFormat == PF_BC5)
+	{
+		Image.SRGB = false;
+	}
 }
 
-#pragma optimize("", on)
+void UImageImporter::AllocateDecodedMips(FImportedImageStruct& Image, FImageDecodeTarget* Target) const
+{
+	// Images scaled down after decoding get their mips from the scaled image and can't use a texture of the full size
+	const bool bDownsampleAfterDecode = FImageRowDownsampler::GetFactor(Image.SizeX, Image.SizeY, GetImportMaxDimension(Image.SizeX, Image.SizeY, Image.Format)) > 1;
+
+	// The block format of an image compressed after decoding depends on its alpha, so there is no texture to decode
+	// into yet. Images already in a GPU format (DDS) allocate the target themselves and still decode straight into it.
+	Image.NumMips = bDownsampleAfterDecode ? 1 : GetNumMipsToImport(Image);
+	if (!Target || bDownsampleAfterDecode || bCompressTextures || !Target->AllocateMips(Image, Image.TargetMipData))
+	{
+		Image.TargetMipData.Empty();
+
+		int64 TotalSize = 0;
+		for (int32 MipIndex = 0; MipIndex < Image.NumMips; ++MipIndex)
+		{
+			TotalSize += Image.GetMipSize(MipIndex);
+		}
+		FImageScratchBufferPool::Get().Acquire(Image.RawData, TotalSize);
+	}
+}
 
 UTexture2D* UImageImporter::CreateTexture2D(UObject* InParent, FName Name, EObjectFlags Flags)
 {
@@ -1015,57 +840,112 @@ UTexture2D* UImageImporter::CreateTexture2D(UObject* InParent, FName Name, EObje
 	return NewTexture;
 }
 
-bool UImageImporter::IsImportResolutionValid(int32 Width, int32 Height, bool bAllowNonPowerOfTwo)
+bool UImageImporter::IsImportResolutionValid(int32 Width, int32 Height, bool bAllowNonPowerOfTwo) const
 {
-	static const auto CVarVirtualTexturesEnabled = IConsoleManager::Get().FindTConsoleVariableDataInt(TEXT("r.VirtualTextures")); check(CVarVirtualTexturesEnabled);
+	if (Width <= 0 || Height <= 0)
+	{
+		UE_LOG(ImageImporter, Error, TEXT("Image has an invalid resolution of %d x %d"), Width, Height);
+		return false;
+	}
 
-	// In theory this value could be much higher, but various UE image code currently uses 32bit size/offset values
-	const int32 MaximumSupportedVirtualTextureResolution = 16 * 1024;
+	// Larger images can't be decoded in one piece, various UE image code uses 32 bit sizes and offsets
+	const int64 MaxSupportedResolution = GetMaxTextureResolution();
+	if ((int64)Width * Height > MaxSupportedResolution * MaxSupportedResolution)
+	{
+		UE_LOG(ImageImporter, Error, TEXT("%d x %d image is too large to import, the maximum is %lld pixels"), Width, Height, MaxSupportedResolution * MaxSupportedResolution);
+		return false;
+	}
 
-	// Calculate the maximum supported resolution utilizing the global max texture mip count
-	// (Note, have to subtract 1 because 1x1 is a valid mip-size; this means a GMaxTextureMipCount of 4 means a max resolution of 8x8, not 2^4 = 16x16)
-	const int32 MaximumSupportedResolution = CVarVirtualTexturesEnabled->GetValueOnAnyThread() ? MaximumSupportedVirtualTextureResolution : (1 << (15 - 1));
+	if (!bAllowNonPowerOfTwo && !(FMath::IsPowerOfTwo(Width) && FMath::IsPowerOfTwo(Height)))
+	{
+		UE_LOG(ImageImporter, Error, TEXT("Cannot import texture with non-power of two dimensions"));
+		return false;
+	}
 
-	bool bValid = true;
+	return true;
+}
 
-	// Check if the texture is above the supported resolution and prompt the user if they wish to continue if it is
-	if (Width > MaximumSupportedResolution || Height > MaximumSupportedResolution)
+bool UImageImporter::CheckImportLimits(int32 Width, int32 Height, ETextureSourceFormat Format, int32& OutMaxDimension) const
+{
+	OutMaxDimension = 0;
+	if (Width <= 0 || Height <= 0)
 	{
-		if (Width * Height < 0)
-		{
-			// Warn->Log(ELogVerbosity::Error, *FText::Format(
-				// NSLOCTEXT("UnrealEd", "Warning_TextureSizeTooLargeOrInvalid", "Texture is too large to import or it has an invalid resolution. The current maximun is {0} pixels"),
-				// FText::AsNumber(FMath::Square(MaximumSupportedVirtualTextureResolution))
-			// ).ToString());
+		return false;
+	}
 
-			bValid = false;
-		}
+	if (OversizePolicy == EImageOversizePolicy::Reject && !IsWithinImportLimits(Width, Height, Format))
+	{
+		UE_LOG(ImageImporter, Warning, TEXT("Rejecting %d x %d image, it exceeds the import limits"), Width, Height);
+		return false;
+	}
 
-		if (bValid && (Width * Height) > FMath::Square(MaximumSupportedVirtualTextureResolution))
-		{
-			// Warn->Log(ELogVerbosity::Error, *FText::Format(
-				// NSLOCTEXT("UnrealEd", "Warning_TextureSizeTooLarge", "Texture is too large to import. The current maximun is {0} pixels"),
-				// FText::AsNumber(FMath::Square(MaximumSupportedVirtualTextureResolution))
-			// ).ToString());
+	OutMaxDimension = GetImportMaxDimension(Width, Height, Format);
+	return true;
+}
 
-			bValid = false;
-		}
+bool UImageImporter::CheckFullSizeImportLimits(int32 Width, int32 Height, ETextureSourceFormat Format, bool bCanDownsample) const
+{
+	int32 ImportMaxDimension = 0;
+	if (!CheckImportLimits(Width, Height, Format, ImportMaxDimension))
+	{
+		return false;
+	}
 
-		if (bValid && EAppReturnType::Yes != FMessageDialog::Open(EAppMsgType::YesNo, FText::Format(
-			NSLOCTEXT("UnrealEd", "Warning_LargeTextureImport", "Attempting to import {0} x {1} texture, proceed?\nLargest supported texture size: {2} x {3}"),
-			FText::AsNumber(Width), FText::AsNumber(Height), FText::AsNumber(MaximumSupportedResolution), FText::AsNumber(MaximumSupportedResolution))))
-		{
-			bValid = false;
-		}
+	// Past CheckImportLimits an image over the limits is downscaled, which needs the full size image first
+	if (IsWithinImportLimits(Width, Height, Format))
+	{
+		return true;
+	}
+
+	if (!bCanDownsample || !FImageRowDownsampler::SupportsFormat(Format))
+	{
+		UE_LOG(ImageImporter, Warning, TEXT("Rejecting %d x %d image, it exceeds the import limits and its format can't be scaled down"), Width, Height);
+		return false;
+	}
+
+	if (MaxImportMegabytes > 0 && (double)Width * Height * FTextureSource::GetBytesPerPixel(Format) > (double)MaxImportMegabytes * 1024 * 1024)
+	{
+		UE_LOG(ImageImporter, Warning, TEXT("Rejecting %d x %d image, it is only scaled down after decoding and decoding it at full size exceeds MaxImportMegabytes"), Width, Height);
+		return false;
+	}
+
+	return true;
+}
+
+bool UImageImporter::IsWithinImportLimits(int64 Width, int64 Height, ETextureSourceFormat Format) const
+{
+	const int32 MaxSupportedResolution = GetMaxTextureResolution();
+	if (Width > MaxSupportedResolution || Height > MaxSupportedResolution)
+	{
+		return false;
 	}
+	if (MaxImportPixels > 0 && Width * Height > MaxImportPixels)
+	{
+		return false;
+	}
+	return MaxImportMegabytes <= 0 || Width * Height * GetImportBytesPerPixel(Format, bGenerateMips) <= (double)MaxImportMegabytes * 1024 * 1024;
+}
 
-	const bool bIsPowerOfTwo = FMath::IsPowerOfTwo(Width) && FMath::IsPowerOfTwo(Height);
-	// Check if the texture dimensions are powers of two
-	if (!bAllowNonPowerOfTwo && !bIsPowerOfTwo)
+int32 UImageImporter::GetImportMaxDimension(int32 Width, int32 Height, ETextureSourceFormat Format) const
+{
+	const int32 PreviewMaxDimension = FMath::Max(MaxDimension, 0);
+	if (OversizePolicy != EImageOversizePolicy::Downscale || IsWithinImportLimits(Width, Height, Format))
 	{
-		// Warn->Log(ELogVerbosity::Error, *NSLOCTEXT("UnrealEd", "Warning_TextureNotAPowerOfTwo", "Cannot import texture with non-power of two dimensions").ToString());
-		bValid = false;
+		return PreviewMaxDimension;
 	}
 
-	return bValid;
+	double MaxPixels = MaxImportPixels > 0 ? (double)MaxImportPixels : (double)TNumericLimits<int64>::Max();
+	if (MaxImportMegabytes > 0)
+	{
+		MaxPixels = FMath::Min(MaxPixels, (double)MaxImportMegabytes * 1024 * 1024 / GetImportBytesPerPixel(Format, bGenerateMips));
+	}
+
+	// Downscaling rounds the shorter side up, so the image can have up to one row more than its aspect ratio
+	// suggests. The longer side L with L * (L * Aspect + 1) <= MaxPixels keeps it within the limit anyway.
+	const int32 LongerSide = FMath::Max(Width, Height);
+	const double Aspect = (double)FMath::Min(Width, Height) / LongerSide;
+	const double LimitSide = (FMath::Sqrt(1.0 + 4.0 * Aspect * MaxPixels) - 1.0) / (2.0 * Aspect);
+
+	const int32 LimitDimension = FMath::Max((int32)FMath::Min<double>(LimitSide, FMath::Min(LongerSide, GetMaxTextureResolution())), 1);
+	return PreviewMaxDimension > 0 ? FMath::Min(PreviewMaxDimension, LimitDimension) : LimitDimension;
 }
\ No newline at end of file
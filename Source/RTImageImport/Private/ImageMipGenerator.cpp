@@ -0,0 +1,288 @@
+#include "ImageMipGenerator.h"
+
+#include "Async/ParallelFor.h"
+#include "Math/VectorRegister.h"
+
+#if PLATFORM_ENABLE_VECTORINTRINSICS && !PLATFORM_ENABLE_VECTORINTRINSICS_NEON
+#include <emmintrin.h>
+#define RTIMAGEIMPORT_MIPS_SSE2 1
+#else
+#define RTIMAGEIMPORT_MIPS_SSE2 0
+#endif
+
+
+namespace
+{
+	/** Rows of the destination mip filtered by one parallel task */
+	constexpr int32 MipRowsPerBand = 32;
+
+	/** Below this many destination pixels a level isn't worth going wide for */
+	constexpr int64 MinPixelsForParallelMip = 128 * 128;
+
+	struct FMipLevel
+	{
+		uint8* Data;
+		int32 SizeX;
+		int32 SizeY;
+	};
+
+	/** Linear -> sRGB with 12 bits of precision, plenty for 8 bit output */
+	struct FLinearToSRGBTable
+	{
+		static constexpr int32 NumEntries = 4096;
+		uint8 Table[NumEntries];
+
+		FLinearToSRGBTable()
+		{
+			for (int32 Index = 0; Index < NumEntries; ++Index)
+			{
+				const float Linear = float(Index) / float(NumEntries - 1);
+				const float SRGB = Linear <= 0.0031308f ? Linear * 12.92f : 1.055f * FMath::Pow(Linear, 1.0f / 2.4f) - 0.055f;
+				Table[Index] = (uint8)FMath::Clamp(FMath::RoundToInt(SRGB * 255.f), 0, 255);
+			}
+		}
+
+		static const FLinearToSRGBTable& Get()
+		{
+			static const FLinearToSRGBTable Instance;
+			return Instance;
+		}
+
+		FORCEINLINE uint8 Convert(float Linear) const
+		{
+			return Table[FMath::Clamp(FMath::RoundToInt(Linear * float(NumEntries - 1)), 0, NumEntries - 1)];
+		}
+	};
+
+	FORCEINLINE void GetSourceRows(const FMipLevel& Src, int32 DestY, int32& OutY0, int32& OutY1)
+	{
+		OutY0 = FMath::Min(DestY * 2, Src.SizeY - 1);
+		OutY1 = FMath::Min(DestY * 2 + 1, Src.SizeY - 1);
+	}
+
+	FORCEINLINE void GetSourceColumns(const FMipLevel& Src, int32 DestX, int32& OutX0, int32& OutX1)
+	{
+		OutX0 = FMath::Min(DestX * 2, Src.SizeX - 1);
+		OutX1 = FMath::Min(DestX * 2 + 1, Src.SizeX - 1);
+	}
+
+	/** Integer channels, rounded average of the four source samples */
+	template<typename ChannelType, int32 NumChannels>
+	void DownsampleRowsLinear(const FMipLevel& Src, const FMipLevel& Dest, int32 RowStart, int32 RowEnd)
+	{
+		const ChannelType* SrcData = reinterpret_cast<const ChannelType*>(Src.Data);
+		ChannelType* DestData = reinterpret_cast<ChannelType*>(Dest.Data);
+
+		for (int32 Y = RowStart; Y < RowEnd; ++Y)
+		{
+			int32 SrcY0, SrcY1;
+			GetSourceRows(Src, Y, SrcY0, SrcY1);
+			const ChannelType* Row0 = SrcData + (int64)SrcY0 * Src.SizeX * NumChannels;
+			const ChannelType* Row1 = SrcData + (int64)SrcY1 * Src.SizeX * NumChannels;
+			ChannelType* DestRow = DestData + (int64)Y * Dest.SizeX * NumChannels;
+
+			int32 X = 0;
+#if RTIMAGEIMPORT_MIPS_SSE2
+			if constexpr (sizeof(ChannelType) == 1 && NumChannels == 4)
+			{
+				// Two destination pixels from four source pixels of each row per iteration
+				const __m128i Zero = _mm_setzero_si128();
+				const __m128i Round = _mm_set1_epi16(2);
+				for (; X + 1 < Dest.SizeX && X * 2 + 3 < Src.SizeX; X += 2)
+				{
+					const __m128i Src0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Row0 + X * 2 * 4));
+					const __m128i Src1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Row1 + X * 2 * 4));
+					const __m128i SumLo = _mm_add_epi16(_mm_unpacklo_epi8(Src0, Zero), _mm_unpacklo_epi8(Src1, Zero));
+					const __m128i SumHi = _mm_add_epi16(_mm_unpackhi_epi8(Src0, Zero), _mm_unpackhi_epi8(Src1, Zero));
+					const __m128i PairLo = _mm_add_epi16(SumLo, _mm_srli_si128(SumLo, 8));
+					const __m128i PairHi = _mm_add_epi16(SumHi, _mm_srli_si128(SumHi, 8));
+					const __m128i Average = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(PairLo, PairHi), Round), 2);
+					_mm_storel_epi64(reinterpret_cast<__m128i*>(DestRow + X * 4), _mm_packus_epi16(Average, Average));
+				}
+			}
+			else if constexpr (sizeof(ChannelType) == 1 && NumChannels == 1)
+			{
+				// Eight destination pixels from sixteen source pixels of each row per iteration
+				const __m128i Zero = _mm_setzero_si128();
+				const __m128i Ones = _mm_set1_epi16(1);
+				const __m128i Round = _mm_set1_epi16(2);
+				for (; X + 7 < Dest.SizeX && X * 2 + 15 < Src.SizeX; X += 8)
+				{
+					const __m128i Src0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Row0 + X * 2));
+					const __m128i Src1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Row1 + X * 2));
+					const __m128i SumLo = _mm_add_epi16(_mm_unpacklo_epi8(Src0, Zero), _mm_unpacklo_epi8(Src1, Zero));
+					const __m128i SumHi = _mm_add_epi16(_mm_unpackhi_epi8(Src0, Zero), _mm_unpackhi_epi8(Src1, Zero));
+					const __m128i Pairs = _mm_packs_epi32(_mm_madd_epi16(SumLo, Ones), _mm_madd_epi16(SumHi, Ones));
+					const __m128i Average = _mm_srli_epi16(_mm_add_epi16(Pairs, Round), 2);
+					_mm_storel_epi64(reinterpret_cast<__m128i*>(DestRow + X), _mm_packus_epi16(Average, Average));
+				}
+			}
+#endif
+
+			for (; X < Dest.SizeX; ++X)
+			{
+				int32 SrcX0, SrcX1;
+				GetSourceColumns(Src, X, SrcX0, SrcX1);
+				for (int32 Channel = 0; Channel < NumChannels; ++Channel)
+				{
+					const uint32 Sum = (uint32)Row0[SrcX0 * NumChannels + Channel] + Row0[SrcX1 * NumChannels + Channel]
+						+ Row1[SrcX0 * NumChannels + Channel] + Row1[SrcX1 * NumChannels + Channel];
+					DestRow[X * NumChannels + Channel] = (ChannelType)((Sum + 2) >> 2);
+				}
+			}
+		}
+	}
+
+	/** 8 bit sRGB color, averaged in linear space. NumChannels is 1 (G8) or 4 (BGRA8, alpha stays linear) */
+	template<int32 NumChannels>
+	void DownsampleRowsSRGB8(const FMipLevel& Src, const FMipLevel& Dest, int32 RowStart, int32 RowEnd)
+	{
+		const FLinearToSRGBTable& ToSRGB = FLinearToSRGBTable::Get();
+		const float* ToLinear = FLinearColor::sRGBToLinearTable;
+		const VectorRegister4Float Quarter = VectorSetFloat1(0.25f);
+		const float AlphaScale = 1.f / 255.f;
+
+		auto LoadLinear = [ToLinear, AlphaScale](const uint8* Pixel) -> VectorRegister4Float
+		{
+			if constexpr (NumChannels == 4)
+			{
+				return MakeVectorRegisterFloat(ToLinear[Pixel[0]], ToLinear[Pixel[1]], ToLinear[Pixel[2]], Pixel[3] * AlphaScale);
+			}
+			return VectorSetFloat1(ToLinear[Pixel[0]]);
+		};
+
+		for (int32 Y = RowStart; Y < RowEnd; ++Y)
+		{
+			int32 SrcY0, SrcY1;
+			GetSourceRows(Src, Y, SrcY0, SrcY1);
+			const uint8* Row0 = Src.Data + (int64)SrcY0 * Src.SizeX * NumChannels;
+			const uint8* Row1 = Src.Data + (int64)SrcY1 * Src.SizeX * NumChannels;
+			uint8* DestRow = Dest.Data + (int64)Y * Dest.SizeX * NumChannels;
+
+			for (int32 X = 0; X < Dest.SizeX; ++X)
+			{
+				int32 SrcX0, SrcX1;
+				GetSourceColumns(Src, X, SrcX0, SrcX1);
+
+				VectorRegister4Float Sum = VectorAdd(LoadLinear(Row0 + SrcX0 * NumChannels), LoadLinear(Row0 + SrcX1 * NumChannels));
+				Sum = VectorAdd(Sum, LoadLinear(Row1 + SrcX0 * NumChannels));
+				Sum = VectorAdd(Sum, LoadLinear(Row1 + SrcX1 * NumChannels));
+
+				alignas(16) float Average[4];
+				VectorStoreAligned(VectorMultiply(Sum, Quarter), Average);
+
+				uint8* DestPixel = DestRow + X * NumChannels;
+				DestPixel[0] = ToSRGB.Convert(Average[0]);
+				if constexpr (NumChannels == 4)
+				{
+					DestPixel[1] = ToSRGB.Convert(Average[1]);
+					DestPixel[2] = ToSRGB.Convert(Average[2]);
+					DestPixel[3] = (uint8)FMath::Clamp(FMath::RoundToInt(Average[3] * 255.f), 0, 255);
+				}
+			}
+		}
+	}
+
+	/** RGBA16F, averaged in float four channels at a time */
+	void DownsampleRowsHalf4(const FMipLevel& Src, const FMipLevel& Dest, int32 RowStart, int32 RowEnd)
+	{
+		const uint16* SrcData = reinterpret_cast<const uint16*>(Src.Data);
+		uint16* DestData = reinterpret_cast<uint16*>(Dest.Data);
+		const VectorRegister4Float Quarter = VectorSetFloat1(0.25f);
+
+		auto LoadHalf4 = [](const uint16* Pixel) -> VectorRegister4Float
+		{
+			alignas(16) float Values[4];
+			FPlatformMath::VectorLoadHalf(Values, Pixel);
+			return VectorLoadAligned(Values);
+		};
+
+		for (int32 Y = RowStart; Y < RowEnd; ++Y)
+		{
+			int32 SrcY0, SrcY1;
+			GetSourceRows(Src, Y, SrcY0, SrcY1);
+			const uint16* Row0 = SrcData + (int64)SrcY0 * Src.SizeX * 4;
+			const uint16* Row1 = SrcData + (int64)SrcY1 * Src.SizeX * 4;
+			uint16* DestRow = DestData + (int64)Y * Dest.SizeX * 4;
+
+			for (int32 X = 0; X < Dest.SizeX; ++X)
+			{
+				int32 SrcX0, SrcX1;
+				GetSourceColumns(Src, X, SrcX0, SrcX1);
+
+				VectorRegister4Float Sum = VectorAdd(LoadHalf4(Row0 + SrcX0 * 4), LoadHalf4(Row0 + SrcX1 * 4));
+				Sum = VectorAdd(Sum, LoadHalf4(Row1 + SrcX0 * 4));
+				Sum = VectorAdd(Sum, LoadHalf4(Row1 + SrcX1 * 4));
+
+				alignas(16) float Average[4];
+				VectorStoreAligned(VectorMultiply(Sum, Quarter), Average);
+				FPlatformMath::VectorStoreHalf(DestRow + X * 4, Average);
+			}
+		}
+	}
+
+	void DownsampleRows(ETextureSourceFormat Format, bool bSRGB, const FMipLevel& Src, const FMipLevel& Dest, int32 RowStart, int32 RowEnd)
+	{
+		switch (Format)
+		{
+		case TSF_G8:
+			bSRGB ? DownsampleRowsSRGB8<1>(Src, Dest, RowStart, RowEnd) : DownsampleRowsLinear<uint8, 1>(Src, Dest, RowStart, RowEnd);
+			break;
+
+		case TSF_BGRA8:
+			bSRGB ? DownsampleRowsSRGB8<4>(Src, Dest, RowStart, RowEnd) : DownsampleRowsLinear<uint8, 4>(Src, Dest, RowStart, RowEnd);
+			break;
+
+		case TSF_G16:
+			DownsampleRowsLinear<uint16, 1>(Src, Dest, RowStart, RowEnd);
+			break;
+
+		case TSF_RGBA16:
+			DownsampleRowsLinear<uint16, 4>(Src, Dest, RowStart, RowEnd);
+			break;
+
+		case TSF_RGBA16F:
+			DownsampleRowsHalf4(Src, Dest, RowStart, RowEnd);
+			break;
+
+		default:
+			checkNoEntry();
+			break;
+		}
+	}
+}
+
+int32 GetFullMipChainCount(int32 SizeX, int32 SizeY)
+{
+	return FMath::FloorLog2(FMath::Max(FMath::Max(SizeX, SizeY), 1)) + 1;
+}
+
+uint8 ConvertLinearToSRGB8(float Linear)
+{
+	return FLinearToSRGBTable::Get().Convert(Linear);
+}
+
+bool CanGenerateMips(ETextureSourceFormat Format)
+{
+	return Format == TSF_G8 || Format == TSF_BGRA8 || Format == TSF_G16 || Format == TSF_RGBA16 || Format == TSF_RGBA16F;
+}
+
+void GenerateMipChain(ETextureSourceFormat Format, bool bSRGB, int32 SizeX, int32 SizeY, TArrayView<uint8* const> MipData)
+{
+	check(CanGenerateMips(Format));
+
+	for (int32 MipIndex = 1; MipIndex < MipData.Num(); ++MipIndex)
+	{
+		const FMipLevel Src = { MipData[MipIndex - 1], FMath::Max(SizeX >> (MipIndex - 1), 1), FMath::Max(SizeY >> (MipIndex - 1), 1) };
+		const FMipLevel Dest = { MipData[MipIndex], FMath::Max(SizeX >> MipIndex, 1), FMath::Max(SizeY >> MipIndex, 1) };
+
+		const int32 NumBands = FMath::DivideAndRoundUp(Dest.SizeY, MipRowsPerBand);
+		const bool bSingleThreaded = (int64)Dest.SizeX * Dest.SizeY < MinPixelsForParallelMip;
+		ParallelFor(NumBands, [&](int32 BandIndex)
+		{
+			const int32 RowStart = BandIndex * MipRowsPerBand;
+			const int32 RowEnd = FMath::Min(RowStart + MipRowsPerBand, Dest.SizeY);
+			DownsampleRows(Format, bSRGB, Src, Dest, RowStart, RowEnd);
+		}, bSingleThreaded);
+	}
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/Texture.h"
+
+/** Number of mips of a full chain down to 1x1 */
+int32 GetFullMipChainCount(int32 SizeX, int32 SizeY);
+
+/** True when GenerateMipChain has a filter for the format */
+bool CanGenerateMips(ETextureSourceFormat Format);
+
+/** Linear [0, 1] to 8 bit sRGB through the table the mip filter uses */
+uint8 ConvertLinearToSRGB8(float Linear);
+
+/**
+ * Fills mips 1 to MipData.Num() - 1 from mip 0 with a 2x2 box filter. Each level is split into row bands
+ * that are filtered in parallel, levels run one after the other as each one is built from the previous.
+ * 8 bit color marked sRGB is averaged in linear space, alpha always is. Mip sizes follow
+ * FImportedImageStruct::GetMipSize, odd sizes clamp the last row or column.
+ */
+void GenerateMipChain(ETextureSourceFormat Format, bool bSRGB, int32 SizeX, int32 SizeY, TArrayView<uint8* const> MipData);
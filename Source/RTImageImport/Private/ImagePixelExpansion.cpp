@@ -0,0 +1,141 @@
+#include "ImagePixelExpansion.h"
+
+#include "Async/ParallelFor.h"
+
+#if PLATFORM_ENABLE_VECTORINTRINSICS && !PLATFORM_ENABLE_VECTORINTRINSICS_NEON
+#include <emmintrin.h>
+#define RTIMAGEIMPORT_EXPAND_SSE2 1
+#else
+#define RTIMAGEIMPORT_EXPAND_SSE2 0
+#endif
+
+// The byte shuffle is SSSE3, only used when the target is built for SSE4.1 anyway
+#if RTIMAGEIMPORT_EXPAND_SSE2 && PLATFORM_ALWAYS_HAS_SSE4_1
+#include <smmintrin.h>
+#define RTIMAGEIMPORT_EXPAND_SSSE3 1
+#else
+#define RTIMAGEIMPORT_EXPAND_SSSE3 0
+#endif
+
+
+namespace
+{
+	constexpr uint32 OpaqueAlpha = 0xff000000u;
+
+	/** Rows per parallel work item of the uncompressed row conversions */
+	constexpr int32 ConvertRowsPerBand = 64;
+
+	/** Below this many pixels a conversion isn't worth going wide for */
+	constexpr int64 MinPixelsForParallelConvert = 256 * 256;
+
+	FORCEINLINE uint32 Expand5To8(uint32 Value)
+	{
+		return (Value << 3) | (Value >> 2);
+	}
+}
+
+void ExpandPaletteIndices(const uint8* Indices, const uint32* Palette, uint32* Dest, int32 Count)
+{
+	int32 X = 0;
+#if RTIMAGEIMPORT_EXPAND_SSE2
+	// SSE2 has no gather, the lookups stay scalar and the pixels go out four per store
+	for (; X + 4 <= Count; X += 4)
+	{
+		const __m128i Pixels = _mm_setr_epi32(int32(Palette[Indices[X]]), int32(Palette[Indices[X + 1]]), int32(Palette[Indices[X + 2]]), int32(Palette[Indices[X + 3]]));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(Dest + X), Pixels);
+	}
+#endif
+	for (; X < Count; ++X)
+	{
+		Dest[X] = Palette[Indices[X]];
+	}
+}
+
+void FillPixelsBGRA8(uint32* Dest, uint32 Value, int32 Count)
+{
+	int32 X = 0;
+#if RTIMAGEIMPORT_EXPAND_SSE2
+	const __m128i Splat = _mm_set1_epi32(int32(Value));
+	for (; X + 4 <= Count; X += 4)
+	{
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(Dest + X), Splat);
+	}
+#endif
+	for (; X < Count; ++X)
+	{
+		Dest[X] = Value;
+	}
+}
+
+void InterleavePlanesToBGRA8(const uint8* B, const uint8* G, const uint8* R, const uint8* A, uint32* Dest, int32 Count)
+{
+	int32 X = 0;
+#if RTIMAGEIMPORT_EXPAND_SSE2
+	const __m128i Opaque = _mm_set1_epi8(-1);
+	for (; X + 16 <= Count; X += 16)
+	{
+		const __m128i Blue = _mm_loadu_si128(reinterpret_cast<const __m128i*>(B + X));
+		const __m128i Green = _mm_loadu_si128(reinterpret_cast<const __m128i*>(G + X));
+		const __m128i Red = _mm_loadu_si128(reinterpret_cast<const __m128i*>(R + X));
+		const __m128i Alpha = A ? _mm_loadu_si128(reinterpret_cast<const __m128i*>(A + X)) : Opaque;
+
+		// Byte pairs first, then the pairs into whole pixels
+		const __m128i BlueGreenLo = _mm_unpacklo_epi8(Blue, Green);
+		const __m128i BlueGreenHi = _mm_unpackhi_epi8(Blue, Green);
+		const __m128i RedAlphaLo = _mm_unpacklo_epi8(Red, Alpha);
+		const __m128i RedAlphaHi = _mm_unpackhi_epi8(Red, Alpha);
+
+		__m128i* Out = reinterpret_cast<__m128i*>(Dest + X);
+		_mm_storeu_si128(Out + 0, _mm_unpacklo_epi16(BlueGreenLo, RedAlphaLo));
+		_mm_storeu_si128(Out + 1, _mm_unpackhi_epi16(BlueGreenLo, RedAlphaLo));
+		_mm_storeu_si128(Out + 2, _mm_unpacklo_epi16(BlueGreenHi, RedAlphaHi));
+		_mm_storeu_si128(Out + 3, _mm_unpackhi_epi16(BlueGreenHi, RedAlphaHi));
+	}
+#endif
+	for (; X < Count; ++X)
+	{
+		Dest[X] = uint32(B[X]) | (uint32(G[X]) << 8) | (uint32(R[X]) << 16) | (A ? uint32(A[X]) << 24 : OpaqueAlpha);
+	}
+}
+
+void ExpandBGR8ToBGRA8(const uint8* Src, uint32* Dest, int32 Count)
+{
+	int32 X = 0;
+#if RTIMAGEIMPORT_EXPAND_SSSE3
+	const __m128i Shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+	const __m128i Alpha = _mm_set1_epi32(int32(OpaqueAlpha));
+
+	// Four pixels per iteration from a 16 byte load, the last pixels are left to the scalar loop so the load stays in bounds
+	for (; X + 6 <= Count; X += 4)
+	{
+		const __m128i Packed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Src + X * 3));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(Dest + X), _mm_or_si128(_mm_shuffle_epi8(Packed, Shuffle), Alpha));
+	}
+#endif
+	for (; X < Count; ++X)
+	{
+		const uint8* Pixel = Src + X * 3;
+		Dest[X] = uint32(Pixel[0]) | (uint32(Pixel[1]) << 8) | (uint32(Pixel[2]) << 16) | OpaqueAlpha;
+	}
+}
+
+void ExpandBGR555ToBGRA8(const uint8* Src, uint32* Dest, int32 Count)
+{
+	for (int32 X = 0; X < Count; ++X)
+	{
+		const uint32 Value = uint32(Src[X * 2]) | (uint32(Src[X * 2 + 1]) << 8);
+		Dest[X] = Expand5To8(Value & 0x1f) | (Expand5To8((Value >> 5) & 0x1f) << 8) | (Expand5To8((Value >> 10) & 0x1f) << 16) | OpaqueAlpha;
+	}
+}
+
+void ParallelForRowBands(int32 Width, int32 Height, TFunctionRef<void(int32 StartY, int32 EndY)> ConvertRows)
+{
+	const int32 NumBands = FMath::DivideAndRoundUp(Height, ConvertRowsPerBand);
+	const bool bSingleThreaded = (int64)Width * Height < MinPixelsForParallelConvert;
+
+	ParallelFor(NumBands, [&ConvertRows, Height](int32 BandIndex)
+	{
+		const int32 StartY = BandIndex * ConvertRowsPerBand;
+		ConvertRows(StartY, FMath::Min(StartY + ConvertRowsPerBand, Height));
+	}, bSingleThreaded);
+}
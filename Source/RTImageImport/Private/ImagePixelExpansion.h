@@ -0,0 +1,27 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/Function.h"
+
+/**
+ * Row converters shared by the native legacy format decoders. Pixels are written as BGRA8 packed into
+ * uint32, little endian, which is the layout of TSF_BGRA8 and FColor.
+ */
+
+/** Looks 8 bit indices up in a 256 entry BGRA8 palette */
+void ExpandPaletteIndices(const uint8* Indices, const uint32* Palette, uint32* Dest, int32 Count);
+
+/** Fills Count pixels with one value, used for RLE runs */
+void FillPixelsBGRA8(uint32* Dest, uint32 Value, int32 Count);
+
+/** Interleaves separate B, G, R and A planes into pixels, A may be null for opaque pixels */
+void InterleavePlanesToBGRA8(const uint8* B, const uint8* G, const uint8* R, const uint8* A, uint32* Dest, int32 Count);
+
+/** Expands packed 24 bit BGR to opaque BGRA8 */
+void ExpandBGR8ToBGRA8(const uint8* Src, uint32* Dest, int32 Count);
+
+/** Expands little endian 16 bit X1R5G5B5 to opaque BGRA8 */
+void ExpandBGR555ToBGRA8(const uint8* Src, uint32* Dest, int32 Count);
+
+/** Calls ConvertRows for bands of rows [StartY, EndY), in parallel for images large enough to be worth it */
+void ParallelForRowBands(int32 Width, int32 Height, TFunctionRef<void(int32 StartY, int32 EndY)> ConvertRows);
@@ -0,0 +1,164 @@
+#include "ImageRowDownsampler.h"
+
+#include "ImageMipGenerator.h"
+
+
+namespace
+{
+	struct FByteToLinearTable
+	{
+		float Table[256];
+
+		FByteToLinearTable()
+		{
+			for (int32 Index = 0; Index < 256; ++Index)
+			{
+				Table[Index] = Index * (1.f / 255.f);
+			}
+		}
+	};
+}
+
+int32 FImageRowDownsampler::GetFactor(int32 SizeX, int32 SizeY, int32 MaxDimension)
+{
+	if (MaxDimension <= 0)
+	{
+		return 1;
+	}
+	return FMath::Max3(FMath::DivideAndRoundUp(SizeX, MaxDimension), FMath::DivideAndRoundUp(SizeY, MaxDimension), 1);
+}
+
+bool FImageRowDownsampler::SupportsFormat(ETextureSourceFormat Format)
+{
+	return Format == TSF_G8 || Format == TSF_G16 || Format == TSF_BGRA8 || Format == TSF_RGBA16;
+}
+
+FImageRowDownsampler::FImageRowDownsampler(int32 InSrcSizeX, int32 InSrcSizeY, int32 InFactor, ETextureSourceFormat InFormat, bool bInSRGB, uint8* InDest)
+	: SrcSizeX(InSrcSizeX)
+	, SrcSizeY(InSrcSizeY)
+	, Factor(FMath::Max(InFactor, 1))
+	, DestSizeX(GetScaledSize(InSrcSizeX, FMath::Max(InFactor, 1)))
+	, NumChannels(InFormat == TSF_G8 || InFormat == TSF_G16 ? 1 : 4)
+	, BytesPerChannel(InFormat == TSF_G16 || InFormat == TSF_RGBA16 ? 2 : 1)
+	, bSRGB(bInSRGB && (InFormat == TSF_G8 || InFormat == TSF_BGRA8))
+	, Dest(InDest)
+{
+	check(SupportsFormat(InFormat));
+
+	static const FByteToLinearTable LinearTable;
+	ByteToLinear = bSRGB ? FLinearColor::sRGBToLinearTable : LinearTable.Table;
+
+	Sums.SetNumZeroed(DestSizeX * NumChannels);
+	if (NumChannels == 4)
+	{
+		UnweightedSums.SetNumZeroed(DestSizeX * 3);
+	}
+}
+
+void FImageRowDownsampler::AddRow(const uint8* Row)
+{
+	if (SrcY >= SrcSizeY)
+	{
+		return;
+	}
+
+	if (BytesPerChannel == 1)
+	{
+		AccumulateRow(Row);
+	}
+	else
+	{
+		AccumulateRow(reinterpret_cast<const uint16*>(Row));
+	}
+
+	++SrcY;
+	if (++NumBandRows == Factor || SrcY == SrcSizeY)
+	{
+		if (BytesPerChannel == 1)
+		{
+			WriteDestRow<uint8>();
+		}
+		else
+		{
+			WriteDestRow<uint16>();
+		}
+	}
+}
+
+template<typename SampleType>
+void FImageRowDownsampler::AccumulateRow(const SampleType* Row)
+{
+	for (int32 DestX = 0; DestX < DestSizeX; ++DestX)
+	{
+		double* Sum = Sums.GetData() + DestX * NumChannels;
+		const int32 EndX = FMath::Min((DestX + 1) * Factor, SrcSizeX);
+
+		if (NumChannels == 1)
+		{
+			for (int32 X = DestX * Factor; X < EndX; ++X)
+			{
+				Sum[0] += ColorToLinear(Row[X]);
+			}
+			continue;
+		}
+
+		double* Unweighted = UnweightedSums.GetData() + DestX * 3;
+		for (int32 X = DestX * Factor; X < EndX; ++X)
+		{
+			const SampleType* Pixel = Row + X * 4;
+			const float Alpha = AlphaToLinear(Pixel[3]);
+			for (int32 Channel = 0; Channel < 3; ++Channel)
+			{
+				const float Color = ColorToLinear(Pixel[Channel]);
+				Sum[Channel] += Color * Alpha;
+				Unweighted[Channel] += Color;
+			}
+			Sum[3] += Alpha;
+		}
+	}
+}
+
+template<typename SampleType>
+void FImageRowDownsampler::WriteDestRow()
+{
+	SampleType* DestRow = reinterpret_cast<SampleType*>(Dest) + (int64)DestY * DestSizeX * NumChannels;
+	for (int32 DestX = 0; DestX < DestSizeX; ++DestX)
+	{
+		const int32 NumColumns = FMath::Min((DestX + 1) * Factor, SrcSizeX) - DestX * Factor;
+		const double NumSamples = double(NumColumns) * NumBandRows;
+		double* Sum = Sums.GetData() + DestX * NumChannels;
+		SampleType* DestPixel = DestRow + DestX * NumChannels;
+
+		if (NumChannels == 1)
+		{
+			LinearToSample(float(Sum[0] / NumSamples), true, DestPixel[0]);
+			Sum[0] = 0.0;
+			continue;
+		}
+
+		double* Unweighted = UnweightedSums.GetData() + DestX * 3;
+		const double AlphaSum = Sum[3];
+		for (int32 Channel = 0; Channel < 3; ++Channel)
+		{
+			const double Color = AlphaSum > 0.0 ? Sum[Channel] / AlphaSum : Unweighted[Channel] / NumSamples;
+			LinearToSample(float(Color), true, DestPixel[Channel]);
+			Sum[Channel] = 0.0;
+			Unweighted[Channel] = 0.0;
+		}
+		LinearToSample(float(AlphaSum / NumSamples), false, DestPixel[3]);
+		Sum[3] = 0.0;
+	}
+
+	NumBandRows = 0;
+	++DestY;
+}
+
+void FImageRowDownsampler::LinearToSample(float Linear, bool bColor, uint8& OutSample) const
+{
+	OutSample = bColor && bSRGB ? ConvertLinearToSRGB8(Linear) : (uint8)FMath::Clamp(FMath::RoundToInt(Linear * 255.f), 0, 255);
+}
+
+void FImageRowDownsampler::LinearToSample(float Linear, bool bColor, uint16& OutSample) const
+{
+	OutSample = (uint16)FMath::Clamp(FMath::RoundToInt(Linear * 65535.f), 0, 65535);
+}
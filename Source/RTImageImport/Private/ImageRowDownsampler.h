@@ -0,0 +1,67 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/Texture.h"
+
+/**
+ * Box filters an image down by an integer factor while its rows come in top to bottom. Only one row of
+ * sums is kept, so a decoder can feed it scanline by scanline without the full size image ever existing.
+ * Blocks at the right and bottom edges that are cut off average the pixels they have. 8 bit color marked
+ * sRGB is averaged in linear space like the mip filter does. Color with alpha is weighted by it, so the
+ * color under transparent pixels doesn't bleed into the edges of cutouts, blocks that are transparent
+ * throughout keep the plain average and end up with zero alpha.
+ */
+class FImageRowDownsampler
+{
+public:
+	/** Smallest integer factor that brings neither side above MaxDimension, 1 when the image already fits */
+	static int32 GetFactor(int32 SizeX, int32 SizeY, int32 MaxDimension);
+
+	static int32 GetScaledSize(int32 Size, int32 Factor) { return FMath::DivideAndRoundUp(Size, Factor); }
+
+	/** G8, G16, BGRA8 and RGBA16 */
+	static bool SupportsFormat(ETextureSourceFormat Format);
+
+	/** Dest has to hold GetScaledSize(SrcSizeX) x GetScaledSize(SrcSizeY) pixels */
+	FImageRowDownsampler(int32 InSrcSizeX, int32 InSrcSizeY, int32 InFactor, ETextureSourceFormat InFormat, bool bInSRGB, uint8* InDest);
+
+	/** Adds the next source row, rows beyond the source height are ignored */
+	void AddRow(const uint8* Row);
+
+private:
+	template<typename SampleType>
+	void AccumulateRow(const SampleType* Row);
+
+	template<typename SampleType>
+	void WriteDestRow();
+
+	FORCEINLINE float ColorToLinear(uint8 Value) const { return ByteToLinear[Value]; }
+	FORCEINLINE float ColorToLinear(uint16 Value) const { return Value * (1.f / 65535.f); }
+	FORCEINLINE static float AlphaToLinear(uint8 Value) { return Value * (1.f / 255.f); }
+	FORCEINLINE static float AlphaToLinear(uint16 Value) { return Value * (1.f / 65535.f); }
+
+	void LinearToSample(float Linear, bool bColor, uint8& OutSample) const;
+	void LinearToSample(float Linear, bool bColor, uint16& OutSample) const;
+
+	int32 SrcSizeX;
+	int32 SrcSizeY;
+	int32 Factor;
+	int32 DestSizeX;
+	int32 NumChannels;
+	int32 BytesPerChannel;
+	bool bSRGB;
+	uint8* Dest;
+
+	/** 8 bit color to linear, the sRGB curve or a plain scale */
+	const float* ByteToLinear;
+
+	/** Per destination pixel: alpha weighted color and the alpha sum with alpha, otherwise the plain sums */
+	TArray<double> Sums;
+
+	/** Per destination pixel with alpha: the unweighted color for blocks without any coverage */
+	TArray<double> UnweightedSums;
+
+	int32 SrcY = 0;
+	int32 NumBandRows = 0;
+	int32 DestY = 0;
+};
@@ -0,0 +1,311 @@
+#include "ImageSaver.h"
+
+#include "ImageImporter.h"
+#include "ImageScratchBufferPool.h"
+#include "Async/Async.h"
+#include "Async/ParallelFor.h"
+#include "Engine/Texture2D.h"
+#include "Kismet/GameplayStatics.h"
+#include "Misc/Compression.h"
+
+
+namespace
+{
+	/** Chunks compress in parallel and keep every call within the 32 bit sizes FCompression takes */
+	constexpr int32 SavedImageChunkSize = 16 * 1024 * 1024;
+
+	/** Pixels and their compressed form while they move between the game thread and a worker */
+	struct FSavedImageData
+	{
+		FImportedImageStruct Image;
+		FSavedImageInfo Info;
+		TArray<uint8> CompressedPixels;
+	};
+
+	ETextureSourceFormat GetSourceFormatForPixelFormat(EPixelFormat PixelFormat)
+	{
+		switch (PixelFormat)
+		{
+		case PF_G8:						return TSF_G8;
+		case PF_G16:					return TSF_G16;
+		case PF_B8G8R8A8:				return TSF_BGRA8;
+		case PF_R16G16B16A16_UNORM:		return TSF_RGBA16;
+		case PF_FloatRGBA:				return TSF_RGBA16F;
+		default:						return TSF_Invalid;
+		}
+	}
+
+	/** Copies the mips the texture was created with, fails when its bulk data was released after upload. Game thread only. */
+	bool CaptureTexture(UTexture2D* Texture, FImportedImageStruct& OutImage)
+	{
+		check(IsInGameThread());
+
+		const FTexturePlatformData* PlatformData = Texture->GetPlatformData();
+		if (!PlatformData || PlatformData->Mips.Num() == 0)
+		{
+			return false;
+		}
+
+		const EPixelFormat PixelFormat = PlatformData->PixelFormat;
+		const ETextureSourceFormat Format = GetSourceFormatForPixelFormat(PixelFormat);
+		const bool bBlockCompressed = GPixelFormats[PixelFormat].BlockSizeX > 1;
+
+		// RGBA8 from DDS imports has no source format, it is saved as is and recreated with its pixel format like DDS imports are
+		const bool bKeepPixelFormat = bBlockCompressed || PixelFormat == PF_R8G8B8A8;
+		if (Format == TSF_Invalid && !bKeepPixelFormat)
+		{
+			UE_LOG(ImageImporter, Warning, TEXT("Can't save texture '%s' with pixel format %s"), *Texture->GetName(), GPixelFormats[PixelFormat].Name);
+			return false;
+		}
+
+		// Mips kept in their pixel format are sized by it, the source format only has to be valid
+		OutImage.Init2DWithParams(PlatformData->SizeX, PlatformData->SizeY, bKeepPixelFormat ? TSF_BGRA8 : Format, Texture->SRGB);
+		OutImage.NumMips = PlatformData->Mips.Num();
+		OutImage.PixelFormat = bKeepPixelFormat ? PixelFormat : PF_Unknown;
+		OutImage.CompressionSettings = Texture->CompressionSettings;
+
+		int64 TotalSize = 0;
+		for (int32 MipIndex = 0; MipIndex < OutImage.NumMips; ++MipIndex)
+		{
+			TotalSize += OutImage.GetMipSize(MipIndex);
+		}
+		FImageScratchBufferPool::Get().Acquire(OutImage.RawData, TotalSize);
+
+		for (int32 MipIndex = 0; MipIndex < OutImage.NumMips; ++MipIndex)
+		{
+			const FByteBulkData& BulkData = PlatformData->Mips[MipIndex].BulkData;
+			const int64 MipSize = OutImage.GetMipSize(MipIndex);
+			if (BulkData.GetBulkDataSize() != MipSize)
+			{
+				UE_LOG(ImageImporter, Warning, TEXT("Can't save texture '%s', the pixels of mip %d are no longer available"), *Texture->GetName(), MipIndex);
+				FImageScratchBufferPool::Get().Release(OutImage.RawData);
+				return false;
+			}
+
+			FMemory::Memcpy(OutImage.GetMipData(MipIndex), BulkData.LockReadOnly(), MipSize);
+			BulkData.Unlock();
+		}
+		return true;
+	}
+
+	bool CompressImage(FSavedImageData& Data)
+	{
+		const FImportedImageStruct& Image = Data.Image;
+		FSavedImageInfo& Info = Data.Info;
+
+		Info.SizeX = Image.SizeX;
+		Info.SizeY = Image.SizeY;
+		Info.NumMips = Image.NumMips;
+		Info.Format = Image.Format;
+		Info.PixelFormat = Image.PixelFormat;
+		Info.CompressionSettings = Image.CompressionSettings;
+		Info.bSRGB = Image.SRGB;
+		Info.CompressionFormat = NAME_Oodle;
+		Info.UncompressedSize = Image.RawData.Num();
+		Info.ChunkSize = SavedImageChunkSize;
+
+		const int32 NumChunks = int32(FMath::DivideAndRoundUp<int64>(Info.UncompressedSize, Info.ChunkSize));
+		TArray<TArray<uint8>> Chunks;
+		Chunks.SetNum(NumChunks);
+
+		std::atomic<bool> bFailed{false};
+		ParallelFor(NumChunks, [&](int32 ChunkIndex)
+		{
+			const int64 Offset = (int64)ChunkIndex * Info.ChunkSize;
+			const int32 Size = int32(FMath::Min<int64>(Info.ChunkSize, Info.UncompressedSize - Offset));
+
+			int32 CompressedSize = FCompression::CompressMemoryBound(Info.CompressionFormat, Size);
+			Chunks[ChunkIndex].SetNumUninitialized(CompressedSize);
+			if (!FCompression::CompressMemory(Info.CompressionFormat, Chunks[ChunkIndex].GetData(), CompressedSize, Image.RawData.GetData() + Offset, Size))
+			{
+				bFailed = true;
+				return;
+			}
+			Chunks[ChunkIndex].SetNum(CompressedSize, false);
+		});
+
+		if (bFailed)
+		{
+			return false;
+		}
+
+		int64 TotalCompressedSize = 0;
+		for (const TArray<uint8>& Chunk : Chunks)
+		{
+			TotalCompressedSize += Chunk.Num();
+		}
+
+		if (TotalCompressedSize > MAX_int32)
+		{
+			UE_LOG(ImageImporter, Warning, TEXT("Compressed image is %lld bytes, too large for a save game"), TotalCompressedSize);
+			return false;
+		}
+
+		Data.CompressedPixels.Reserve(int32(TotalCompressedSize));
+		for (const TArray<uint8>& Chunk : Chunks)
+		{
+			Info.ChunkCompressedSizes.Add(Chunk.Num());
+			Data.CompressedPixels.Append(Chunk);
+		}
+		return true;
+	}
+
+	bool DecompressImage(FSavedImageData& Data)
+	{
+		const FSavedImageInfo& Info = Data.Info;
+		FImportedImageStruct& Image = Data.Image;
+
+		if (Info.SizeX <= 0 || Info.SizeY <= 0 || Info.NumMips <= 0 || Info.NumMips > MAX_TEXTURE_MIP_COUNT || Info.ChunkSize <= 0
+			|| Info.Format == TSF_Invalid || Info.Format >= TSF_MAX || Info.PixelFormat >= PF_MAX)
+		{
+			return false;
+		}
+
+		Image.Init2DWithParams(Info.SizeX, Info.SizeY, Info.Format, Info.bSRGB);
+		Image.NumMips = Info.NumMips;
+		Image.PixelFormat = Info.PixelFormat;
+		Image.CompressionSettings = Info.CompressionSettings;
+
+		int64 ExpectedSize = 0;
+		for (int32 MipIndex = 0; MipIndex < Image.NumMips; ++MipIndex)
+		{
+			ExpectedSize += Image.GetMipSize(MipIndex);
+		}
+
+		const int32 NumChunks = Info.ChunkCompressedSizes.Num();
+		if (ExpectedSize != Info.UncompressedSize || NumChunks != FMath::DivideAndRoundUp<int64>(Info.UncompressedSize, Info.ChunkSize))
+		{
+			return false;
+		}
+
+		TArray<int64> ChunkOffsets;
+		int64 CompressedOffset = 0;
+		for (int32 CompressedSize : Info.ChunkCompressedSizes)
+		{
+			ChunkOffsets.Add(CompressedOffset);
+			CompressedOffset += CompressedSize;
+		}
+
+		if (CompressedOffset != Data.CompressedPixels.Num())
+		{
+			return false;
+		}
+
+		FImageScratchBufferPool::Get().Acquire(Image.RawData, Info.UncompressedSize);
+
+		std::atomic<bool> bFailed{false};
+		ParallelFor(NumChunks, [&](int32 ChunkIndex)
+		{
+			const int64 Offset = (int64)ChunkIndex * Info.ChunkSize;
+			const int32 Size = int32(FMath::Min<int64>(Info.ChunkSize, Info.UncompressedSize - Offset));
+			if (!FCompression::UncompressMemory(Info.CompressionFormat, Image.RawData.GetData() + Offset, Size,
+				Data.CompressedPixels.GetData() + ChunkOffsets[ChunkIndex], Info.ChunkCompressedSizes[ChunkIndex]))
+			{
+				bFailed = true;
+			}
+		});
+
+		return !bFailed;
+	}
+}
+
+void UImageSaver::AsyncSaveTextureToSlot(UTexture2D* Texture, const FString& SlotName, int32 UserIndex, FOnImageSaved OnSaved)
+{
+	check(IsInGameThread());
+
+	TSharedRef<FSavedImageData, ESPMode::ThreadSafe> Data = MakeShared<FSavedImageData, ESPMode::ThreadSafe>();
+	if (!Texture || !CaptureTexture(Texture, Data->Image))
+	{
+		OnSaved.ExecuteIfBound(false);
+		return;
+	}
+
+	Async(EAsyncExecution::ThreadPool, [Data, WeakTexture = TWeakObjectPtr<UTexture2D>(Texture), SlotName, UserIndex, OnSaved]()
+	{
+		const bool bCompressed = CompressImage(*Data);
+		FImageScratchBufferPool::Get().Release(Data->Image.RawData);
+		Data->Image = FImportedImageStruct();
+
+		AsyncTask(ENamedThreads::GameThread, [Data, WeakTexture, SlotName, UserIndex, OnSaved, bCompressed]()
+		{
+			if (!bCompressed)
+			{
+				UE_LOG(ImageImporter, Warning, TEXT("Failed to compress image for slot '%s'"), *SlotName);
+				OnSaved.ExecuteIfBound(false);
+				return;
+			}
+
+			UImageSaver* ImageSaver = Cast<UImageSaver>(UGameplayStatics::CreateSaveGameObject(UImageSaver::StaticClass()));
+			ImageSaver->SavedTexture2D = WeakTexture.Get();
+			ImageSaver->ImageInfo = MoveTemp(Data->Info);
+			ImageSaver->CompressedPixels = MoveTemp(Data->CompressedPixels);
+
+			// Only the serialization into memory runs here, the compressed pixels are a single copy
+			UGameplayStatics::AsyncSaveGameToSlot(ImageSaver, SlotName, UserIndex, FAsyncSaveGameToSlotDelegate::CreateLambda([OnSaved](const FString& SavedSlotName, const int32, bool bSuccess)
+			{
+				UE_LOG(ImageImporter, Verbose, TEXT("Saving image to slot '%s' %s"), *SavedSlotName, bSuccess ? TEXT("succeeded") : TEXT("failed"));
+				OnSaved.ExecuteIfBound(bSuccess);
+			}));
+		});
+	});
+}
+
+void UImageSaver::AsyncLoadTextureFromSlot(const FString& SlotName, int32 UserIndex, FOnImageLoaded OnLoaded)
+{
+	check(IsInGameThread());
+
+	UGameplayStatics::AsyncLoadGameFromSlot(SlotName, UserIndex, FAsyncLoadGameFromSlotDelegate::CreateLambda([OnLoaded](const FString& LoadedSlotName, const int32, USaveGame* SaveGame)
+	{
+		UImageSaver* ImageSaver = Cast<UImageSaver>(SaveGame);
+		if (!ImageSaver || ImageSaver->CompressedPixels.Num() == 0)
+		{
+			UE_LOG(ImageImporter, Warning, TEXT("Slot '%s' holds no saved image"), *LoadedSlotName);
+			OnLoaded.ExecuteIfBound(nullptr);
+			return;
+		}
+
+		TSharedRef<FSavedImageData, ESPMode::ThreadSafe> Data = MakeShared<FSavedImageData, ESPMode::ThreadSafe>();
+		Data->Info = ImageSaver->ImageInfo;
+		Data->CompressedPixels = MoveTemp(ImageSaver->CompressedPixels);
+
+		Async(EAsyncExecution::ThreadPool, [Data, WeakSaver = TWeakObjectPtr<UImageSaver>(ImageSaver), LoadedSlotName, OnLoaded]()
+		{
+			const bool bDecompressed = DecompressImage(*Data);
+			Data->CompressedPixels.Empty();
+
+			AsyncTask(ENamedThreads::GameThread, [Data, WeakSaver, LoadedSlotName, OnLoaded, bDecompressed]()
+			{
+				UTexture2D* Texture = nullptr;
+				if (bDecompressed)
+				{
+					Texture = UImageImporter::CreateTextureFromImage(Data->Image);
+					FImageScratchBufferPool::Get().Release(Data->Image.RawData);
+				}
+				else
+				{
+					UE_LOG(ImageImporter, Warning, TEXT("Image in slot '%s' is corrupt"), *LoadedSlotName);
+				}
+
+				if (UImageSaver* LoadedSaver = WeakSaver.Get())
+				{
+					LoadedSaver->SavedTexture2D = Texture;
+				}
+				OnLoaded.ExecuteIfBound(Texture);
+			});
+		});
+	}));
+}
+
+void UImageSaver::Serialize(FArchive& Ar)
+{
+	Super::Serialize(Ar);
+
+	// Slots saved before the pixels were stored end here
+	if (Ar.IsLoading() && Ar.AtEnd())
+	{
+		return;
+	}
+
+	// Bulk serialized, a reflected byte array would go through the property system byte by byte
+	Ar << CompressedPixels;
+}
@@ -0,0 +1,208 @@
+#include "ImageScratchBufferPool.h"
+
+#include "ImageImportStats.h"
+#include "HAL/IConsoleManager.h"
+
+
+static TAutoConsoleVariable<int32> CVarScratchPoolMaxMB(
+	TEXT("RTImageImport.ScratchPool.MaxMB"),
+	512,
+	TEXT("Memory of released pixel buffers kept for reuse, 0 disables the pool."));
+
+static TAutoConsoleVariable<float> CVarScratchPoolIdleSeconds(
+	TEXT("RTImageImport.ScratchPool.IdleSeconds"),
+	10.f,
+	TEXT("Pooled pixel buffers unused for longer than this are freed."));
+
+FImageScratchBufferPool& FImageScratchBufferPool::Get()
+{
+	static FImageScratchBufferPool Pool;
+	return Pool;
+}
+
+int32 FImageScratchBufferPool::GetSizeClassFor(int64 Size)
+{
+	const int64 ClampedSize = FMath::Max<int64>(Size, int64(1) << MinSizeExponent);
+	const int32 Exponent = int32(FMath::FloorLog2_64(uint64(ClampedSize)));
+	const int64 OctaveBase = int64(1) << Exponent;
+	const int64 Step = OctaveBase / ClassesPerOctave;
+
+	// Rounding up past the last class of the octave lands on the first class of the next one
+	const int32 SizeClass = (Exponent - MinSizeExponent) * ClassesPerOctave + int32(FMath::DivideAndRoundUp<int64>(ClampedSize - OctaveBase, Step));
+	return SizeClass < NumSizeClasses ? SizeClass : INDEX_NONE;
+}
+
+int32 FImageScratchBufferPool::GetSizeClassOf(int64 Capacity)
+{
+	if (Capacity < (int64(1) << MinSizeExponent))
+	{
+		return INDEX_NONE;
+	}
+
+	const int32 SizeClass = GetSizeClassFor(Capacity);
+	if (SizeClass == INDEX_NONE)
+	{
+		return NumSizeClasses - 1;
+	}
+	return GetClassSize(SizeClass) > Capacity ? SizeClass - 1 : SizeClass;
+}
+
+int64 FImageScratchBufferPool::GetClassSize(int32 SizeClass)
+{
+	const int64 OctaveBase = int64(1) << (MinSizeExponent + SizeClass / ClassesPerOctave);
+	return OctaveBase + (SizeClass % ClassesPerOctave) * (OctaveBase / ClassesPerOctave);
+}
+
+void FImageScratchBufferPool::Acquire(TArray64<uint8>& Buffer, int64 Size)
+{
+	if (Buffer.Max() >= Size)
+	{
+		Buffer.SetNumUninitialized(Size, false);
+		return;
+	}
+
+	Release(Buffer);
+
+	const int32 SizeClass = GetSizeClassFor(Size);
+	if (Size < (int64(1) << MinSizeExponent) || SizeClass == INDEX_NONE)
+	{
+		// Small buffers are cheap to allocate and huge ones too rare to keep around
+		Buffer.SetNumUninitialized(Size);
+		return;
+	}
+
+	{
+		FScopeLock Lock(&Critical);
+		++NumAcquires;
+		OutstandingBytes += GetClassSize(SizeClass);
+		PeakOutstandingBytes = FMath::Max(PeakOutstandingBytes, OutstandingBytes);
+
+		TArray<FPooledBuffer>& Buffers = FreeBuffers[SizeClass];
+		if (Buffers.Num() > 0)
+		{
+			// Most recently released first, it is the most likely to still be in cache and mapped
+			Buffer = MoveTemp(Buffers.Last().Buffer);
+			Buffers.Pop(false);
+			PooledBytes -= Buffer.Max();
+			++NumReuses;
+			UpdateMemoryStat();
+		}
+	}
+
+	if (Buffer.Max() == 0)
+	{
+		// Allocated at the full class size so the buffer can serve any request of its class once released
+		Buffer.Empty(GetClassSize(SizeClass));
+	}
+	Buffer.SetNumUninitialized(Size, false);
+}
+
+void FImageScratchBufferPool::Release(TArray64<uint8>& Buffer)
+{
+	const int32 SizeClass = GetSizeClassOf(Buffer.Max());
+	const int64 MaxPooledBytes = FMath::Max<int64>(CVarScratchPoolMaxMB.GetValueOnAnyThread(), 0) * 1024 * 1024;
+	if (SizeClass == INDEX_NONE || MaxPooledBytes == 0)
+	{
+		Buffer.Empty();
+		return;
+	}
+
+	Buffer.Reset();
+
+	FScopeLock Lock(&Critical);
+	OutstandingBytes = FMath::Max<int64>(OutstandingBytes - GetClassSize(SizeClass), 0);
+
+	FPooledBuffer& PooledBuffer = FreeBuffers[SizeClass].AddDefaulted_GetRef();
+	PooledBuffer.Buffer = MoveTemp(Buffer);
+	PooledBuffer.ReleaseTime = FPlatformTime::Seconds();
+	PooledBytes += PooledBuffer.Buffer.Max();
+	PeakPooledBytes = FMath::Max(PeakPooledBytes, PooledBytes);
+
+	while (PooledBytes > MaxPooledBytes && FreeOldestBuffer())
+	{
+	}
+	UpdateMemoryStat();
+}
+
+bool FImageScratchBufferPool::FreeOldestBuffer()
+{
+	// Each class is in release order, so the oldest buffer is at the front of one of them
+	int32 OldestClass = INDEX_NONE;
+	for (int32 SizeClass = 0; SizeClass < NumSizeClasses; ++SizeClass)
+	{
+		if (FreeBuffers[SizeClass].Num() > 0 && (OldestClass == INDEX_NONE || FreeBuffers[SizeClass][0].ReleaseTime < FreeBuffers[OldestClass][0].ReleaseTime))
+		{
+			OldestClass = SizeClass;
+		}
+	}
+
+	if (OldestClass == INDEX_NONE)
+	{
+		return false;
+	}
+
+	PooledBytes -= FreeBuffers[OldestClass][0].Buffer.Max();
+	FreeBuffers[OldestClass].RemoveAt(0, 1, false);
+	++NumTrimmed;
+	return true;
+}
+
+void FImageScratchBufferPool::Trim()
+{
+	const double IdleSeconds = FMath::Max(CVarScratchPoolIdleSeconds.GetValueOnAnyThread(), 0.f);
+	const double Now = FPlatformTime::Seconds();
+
+	FScopeLock Lock(&Critical);
+	for (TArray<FPooledBuffer>& Buffers : FreeBuffers)
+	{
+		int32 NumIdle = 0;
+		while (NumIdle < Buffers.Num() && Now - Buffers[NumIdle].ReleaseTime > IdleSeconds)
+		{
+			PooledBytes -= Buffers[NumIdle].Buffer.Max();
+			++NumIdle;
+		}
+
+		if (NumIdle > 0)
+		{
+			Buffers.RemoveAt(0, NumIdle, false);
+			NumTrimmed += NumIdle;
+		}
+	}
+	UpdateMemoryStat();
+}
+
+void FImageScratchBufferPool::Empty()
+{
+	FScopeLock Lock(&Critical);
+	for (TArray<FPooledBuffer>& Buffers : FreeBuffers)
+	{
+		NumTrimmed += Buffers.Num();
+		Buffers.Empty();
+	}
+	PooledBytes = 0;
+	UpdateMemoryStat();
+}
+
+void FImageScratchBufferPool::Dump(FOutputDevice& Ar)
+{
+	FScopeLock Lock(&Critical);
+
+	Ar.Logf(TEXT("Scratch buffers"));
+	Ar.Logf(TEXT("  %lld acquires, %lld reused (%.1f%%), %lld freed idle or over budget"),
+		NumAcquires, NumReuses, NumAcquires > 0 ? 100.0 * NumReuses / NumAcquires : 0.0, NumTrimmed);
+	Ar.Logf(TEXT("  Pooled %.2f MB, peak %.2f MB. In use %.2f MB, peak %.2f MB"),
+		PooledBytes / 1048576.0, PeakPooledBytes / 1048576.0, OutstandingBytes / 1048576.0, PeakOutstandingBytes / 1048576.0);
+
+	for (int32 SizeClass = 0; SizeClass < NumSizeClasses; ++SizeClass)
+	{
+		if (FreeBuffers[SizeClass].Num() > 0)
+		{
+			Ar.Logf(TEXT("    %8.2f MB x %d"), GetClassSize(SizeClass) / 1048576.0, FreeBuffers[SizeClass].Num());
+		}
+	}
+}
+
+void FImageScratchBufferPool::UpdateMemoryStat()
+{
+	SET_MEMORY_STAT(STAT_RTImageImport_ScratchPoolMemory, PooledBytes);
+}
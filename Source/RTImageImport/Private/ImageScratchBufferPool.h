@@ -0,0 +1,67 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Large pixel buffers recycled across imports instead of going back to the allocator. Buffers are kept
+ * in size classes four to an octave from 256 KB to 1 GB, a request is served by the smallest class that
+ * holds it so a reused buffer is at most a quarter larger than needed. Buffers idle for longer than
+ * RTImageImport.ScratchPool.IdleSeconds are freed by Trim, the pool never keeps more than
+ * RTImageImport.ScratchPool.MaxMB. Any thread.
+ */
+class FImageScratchBufferPool
+{
+public:
+	static FImageScratchBufferPool& Get();
+
+	/**
+	 * Resizes Buffer to Size uninitialized bytes. When its allocation is too small it is swapped for a
+	 * pooled one, the previous contents are not kept in that case.
+	 */
+	void Acquire(TArray64<uint8>& Buffer, int64 Size);
+
+	/** Takes the allocation of Buffer for reuse, Buffer is left empty */
+	void Release(TArray64<uint8>& Buffer);
+
+	/** Frees the buffers that have been idle for longer than the timeout, driven by the module's ticker */
+	void Trim();
+
+	void Empty();
+
+	void Dump(FOutputDevice& Ar);
+
+private:
+	static constexpr int32 MinSizeExponent = 18;
+	static constexpr int32 MaxSizeExponent = 30;
+	static constexpr int32 ClassesPerOctave = 4;
+	static constexpr int32 NumSizeClasses = (MaxSizeExponent - MinSizeExponent) * ClassesPerOctave + 1;
+
+	/** Smallest class whose buffers hold Size bytes, INDEX_NONE above the largest class */
+	static int32 GetSizeClassFor(int64 Size);
+
+	/** Largest class a buffer of Capacity bytes can serve, INDEX_NONE below the smallest class */
+	static int32 GetSizeClassOf(int64 Capacity);
+
+	static int64 GetClassSize(int32 SizeClass);
+
+	struct FPooledBuffer
+	{
+		TArray64<uint8> Buffer;
+		double ReleaseTime = 0.0;
+	};
+
+	/** Frees the buffer released the longest ago */
+	bool FreeOldestBuffer();
+
+	void UpdateMemoryStat();
+
+	FCriticalSection Critical;
+	TArray<FPooledBuffer> FreeBuffers[NumSizeClasses];
+	int64 PooledBytes = 0;
+	int64 OutstandingBytes = 0;
+	int64 PeakPooledBytes = 0;
+	int64 PeakOutstandingBytes = 0;
+	int64 NumAcquires = 0;
+	int64 NumReuses = 0;
+	int64 NumTrimmed = 0;
+};
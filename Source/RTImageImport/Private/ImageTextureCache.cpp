@@ -0,0 +1,285 @@
+#include "ImageTextureCache.h"
+
+#include "Engine/Texture2D.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Hash/CityHash.h"
+#include "Misc/Paths.h"
+
+
+static TAutoConsoleVariable<int32> CVarCacheBudgetMB(
+	TEXT("RTImageImport.Cache.BudgetMB"),
+	512,
+	TEXT("Texture memory the import cache keeps alive, least recently used textures are dropped beyond it."));
+
+static TUniquePtr<FImageTextureCache> GImageTextureCache;
+
+bool FImageCacheKey::FromPath(const FString& Filename, uint64 SettingsHash, FImageCacheKey& OutKey)
+{
+	const FFileStatData StatData = IFileManager::Get().GetStatData(*Filename);
+	if (!StatData.bIsValid || StatData.bIsDirectory)
+	{
+		return false;
+	}
+
+	FString FullPath = FPaths::ConvertRelativePathToFull(Filename);
+	FPaths::NormalizeFilename(FullPath);
+
+	const uint64 FileInfo[] = { uint64(StatData.FileSize), uint64(StatData.ModificationTime.GetTicks()), SettingsHash };
+	const uint64 PathHash = CityHash64(reinterpret_cast<const char*>(*FullPath), FullPath.Len() * sizeof(TCHAR));
+	OutKey.Hash = CityHash64WithSeed(reinterpret_cast<const char*>(FileInfo), sizeof(FileInfo), PathHash);
+	return true;
+}
+
+FImageCacheKey FImageCacheKey::FromContent(const uint8* Data, int64 Size, uint64 SettingsHash)
+{
+	// CityHash takes 32 bit lengths, larger files are hashed in chunks chained through the seed
+	constexpr int64 ChunkSize = 1 << 30;
+
+	uint64 Hash = SettingsHash;
+	for (int64 Offset = 0; Offset < Size; Offset += ChunkSize)
+	{
+		Hash = CityHash64WithSeed(reinterpret_cast<const char*>(Data + Offset), uint32(FMath::Min(ChunkSize, Size - Offset)), Hash);
+	}
+
+	FImageCacheKey Key;
+	Key.Hash = Hash;
+	return Key;
+}
+
+FImageTextureCache& FImageTextureCache::Get()
+{
+	check(IsInGameThread() || GImageTextureCache.IsValid());
+	if (!GImageTextureCache.IsValid())
+	{
+		GImageTextureCache = MakeUnique<FImageTextureCache>();
+	}
+	return *GImageTextureCache;
+}
+
+void FImageTextureCache::Shutdown()
+{
+	GImageTextureCache.Reset();
+}
+
+bool FImageTextureCache::Pin(const FImageCacheKey& Key)
+{
+	FScopeLock Lock(&Critical);
+
+	FEntry* Entry = Entries.Find(Key);
+	if (!Entry || !Entry->Texture)
+	{
+		return false;
+	}
+
+	Entry->LastUse = ++UseCounter;
+	++Entry->PinCount;
+	++NumHits;
+	return true;
+}
+
+UTexture2D* FImageTextureCache::Unpin(const FImageCacheKey& Key)
+{
+	check(IsInGameThread());
+	FScopeLock Lock(&Critical);
+
+	FEntry& Entry = Entries.FindChecked(Key);
+	check(Entry.PinCount > 0);
+	--Entry.PinCount;
+	return Entry.Texture;
+}
+
+UTexture2D* FImageTextureCache::Find(const FImageCacheKey& Key)
+{
+	check(IsInGameThread());
+	FScopeLock Lock(&Critical);
+
+	FEntry* Entry = Entries.Find(Key);
+	if (!Entry || !Entry->Texture)
+	{
+		++NumMisses;
+		return nullptr;
+	}
+
+	Entry->LastUse = ++UseCounter;
+	++NumHits;
+	return Entry->Texture;
+}
+
+void FImageTextureCache::Add(const FImageCacheKey& Key, UTexture2D* Texture, int64 SizeBytes)
+{
+	check(IsInGameThread());
+	FScopeLock Lock(&Critical);
+
+	FEntry& Entry = Entries.FindOrAdd(Key);
+	ResidentBytes += SizeBytes - Entry.SizeBytes;
+	Entry.Texture = Texture;
+	Entry.SizeBytes = SizeBytes;
+	Entry.LastUse = ++UseCounter;
+
+	EvictToBudget(FMath::Max<int64>(CVarCacheBudgetMB.GetValueOnGameThread(), 0) * 1024 * 1024);
+}
+
+bool FImageTextureCache::RemoveTexture(UTexture2D* Texture)
+{
+	check(IsInGameThread());
+	FScopeLock Lock(&Critical);
+
+	for (auto It = Entries.CreateIterator(); It; ++It)
+	{
+		if (It.Value().Texture == Texture)
+		{
+			if (It.Value().PinCount > 0)
+			{
+				return false;
+			}
+
+			ResidentBytes -= It.Value().SizeBytes;
+			It.RemoveCurrent();
+		}
+	}
+	return true;
+}
+
+void FImageTextureCache::RecordMiss()
+{
+	FScopeLock Lock(&Critical);
+	++NumMisses;
+}
+
+void FImageTextureCache::Empty()
+{
+	check(IsInGameThread());
+	FScopeLock Lock(&Critical);
+
+	// Pinned entries are about to be handed out and stay until the next eviction
+	for (auto It = Entries.CreateIterator(); It; ++It)
+	{
+		if (It.Value().PinCount == 0)
+		{
+			ResidentBytes -= It.Value().SizeBytes;
+			++NumEvictions;
+			It.RemoveCurrent();
+		}
+	}
+}
+
+FImageTextureCacheStats FImageTextureCache::GetStats() const
+{
+	FScopeLock Lock(&Critical);
+
+	FImageTextureCacheStats Stats;
+	Stats.NumEntries = Entries.Num();
+	Stats.ResidentBytes = ResidentBytes;
+	Stats.NumHits = NumHits;
+	Stats.NumMisses = NumMisses;
+	Stats.NumEvictions = NumEvictions;
+	Stats.HitRate = NumHits + NumMisses > 0 ? float(double(NumHits) / double(NumHits + NumMisses)) : 0.f;
+	return Stats;
+}
+
+void FImageTextureCache::EvictToBudget(int64 BudgetBytes)
+{
+	// The most recently used entry is kept even when it alone is over the budget, it was just requested
+	while (ResidentBytes > BudgetBytes)
+	{
+		TOptional<FImageCacheKey> OldestKey;
+		uint64 OldestUse = UseCounter;
+		for (const TPair<FImageCacheKey, FEntry>& Pair : Entries)
+		{
+			if (Pair.Value.PinCount == 0 && Pair.Value.LastUse < OldestUse)
+			{
+				OldestKey = Pair.Key;
+				OldestUse = Pair.Value.LastUse;
+			}
+		}
+
+		if (!OldestKey.IsSet())
+		{
+			break;
+		}
+
+		ResidentBytes -= Entries.FindChecked(OldestKey.GetValue()).SizeBytes;
+		Entries.Remove(OldestKey.GetValue());
+		++NumEvictions;
+	}
+}
+
+void FImageTextureCache::AddReferencedObjects(FReferenceCollector& Collector)
+{
+	FScopeLock Lock(&Critical);
+
+	for (TPair<FImageCacheKey, FEntry>& Pair : Entries)
+	{
+		Collector.AddReferencedObject(Pair.Value.Texture);
+	}
+}
+
+FString FImageTextureCache::GetReferencerName() const
+{
+	return TEXT("FImageTextureCache");
+}
+
+FImageCacheLookup::FImageCacheLookup(bool bInEnabled, EImageCacheKeyMode InKeyMode, uint64 InSettingsHash)
+	: bEnabled(bInEnabled)
+	, KeyMode(InKeyMode)
+	, SettingsHash(InSettingsHash)
+{
+}
+
+bool FImageCacheLookup::PinByPath(const FString& Filename)
+{
+	if (!bEnabled || KeyMode != EImageCacheKeyMode::PathAndTimestamp)
+	{
+		return false;
+	}
+
+	FImageCacheKey PathKey;
+	if (FImageCacheKey::FromPath(Filename, SettingsHash, PathKey))
+	{
+		Key = PathKey;
+		bPinned = FImageTextureCache::Get().Pin(PathKey);
+	}
+
+	if (!bPinned)
+	{
+		FImageTextureCache::Get().RecordMiss();
+	}
+	return bPinned;
+}
+
+bool FImageCacheLookup::PinByContent(const uint8* Data, int64 Size)
+{
+	if (!bEnabled || KeyMode != EImageCacheKeyMode::Content)
+	{
+		return false;
+	}
+
+	Key = FImageCacheKey::FromContent(Data, Size, SettingsHash);
+	bPinned = FImageTextureCache::Get().Pin(Key.GetValue());
+
+	if (!bPinned)
+	{
+		FImageTextureCache::Get().RecordMiss();
+	}
+	return bPinned;
+}
+
+UTexture2D* FImageCacheLookup::TakeTexture()
+{
+	if (!bPinned)
+	{
+		return nullptr;
+	}
+
+	bPinned = false;
+	return FImageTextureCache::Get().Unpin(Key.GetValue());
+}
+
+void FImageCacheLookup::AddTexture(UTexture2D* Texture)
+{
+	if (Texture && Key.IsSet())
+	{
+		FImageTextureCache::Get().Add(Key.GetValue(), Texture, Texture->CalcTextureMemorySizeEnum(TMC_ResidentMips));
+	}
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/GCObject.h"
+#include "ImageImporter.h"
+
+/** Identifies the texture an import produces: the file (by content or by path and timestamp) plus the import settings */
+struct FImageCacheKey
+{
+	uint64 Hash = 0;
+
+	bool operator==(const FImageCacheKey& Other) const { return Hash == Other.Hash; }
+	friend uint32 GetTypeHash(const FImageCacheKey& Key) { return GetTypeHash(Key.Hash); }
+
+	/** Full path, file size and modification time, only stats the file. False when the file doesn't exist. */
+	static bool FromPath(const FString& Filename, uint64 SettingsHash, FImageCacheKey& OutKey);
+
+	/** Hash of the file data, the same image imported from different paths shares one entry */
+	static FImageCacheKey FromContent(const uint8* Data, int64 Size, uint64 SettingsHash);
+};
+
+/**
+ * Textures of previous imports, shared by all importers. Entries are evicted least recently used first
+ * once the textures exceed RTImageImport.Cache.BudgetMB, an evicted texture stays alive as long as
+ * something else references it. Workers pin entries so they can skip decoding, the texture itself is
+ * only handed out on the game thread.
+ */
+class FImageTextureCache : public FGCObject
+{
+public:
+	static FImageTextureCache& Get();
+
+	/** Releases the textures, called on module shutdown */
+	static void Shutdown();
+
+	/** Marks the entry as used and protects it from eviction until Unpin. Any thread. */
+	bool Pin(const FImageCacheKey& Key);
+
+	/** Texture of a pinned entry. Game thread only. */
+	UTexture2D* Unpin(const FImageCacheKey& Key);
+
+	/** Texture of the entry or nullptr, counts as a hit or miss. Game thread only. */
+	UTexture2D* Find(const FImageCacheKey& Key);
+
+	/** Adds an imported texture that takes SizeBytes of texture memory and evicts down to the budget. Game thread only. */
+	void Add(const FImageCacheKey& Key, UTexture2D* Texture, int64 SizeBytes);
+
+	/** Drops the entry holding Texture, false when it is pinned and about to be handed out. Game thread only. */
+	bool RemoveTexture(UTexture2D* Texture);
+
+	/** Counts a lookup done through Pin that didn't find an entry */
+	void RecordMiss();
+
+	void Empty();
+
+	FImageTextureCacheStats GetStats() const;
+
+	//~ FGCObject
+	virtual void AddReferencedObjects(FReferenceCollector& Collector) override;
+	virtual FString GetReferencerName() const override;
+
+private:
+	struct FEntry
+	{
+		UTexture2D* Texture = nullptr;
+		int64 SizeBytes = 0;
+		uint64 LastUse = 0;
+		int32 PinCount = 0;
+	};
+
+	void EvictToBudget(int64 BudgetBytes);
+
+	mutable FCriticalSection Critical;
+	TMap<FImageCacheKey, FEntry> Entries;
+	uint64 UseCounter = 0;
+	int64 ResidentBytes = 0;
+	int64 NumHits = 0;
+	int64 NumMisses = 0;
+	int64 NumEvictions = 0;
+};
+
+/**
+ * Cache lookup of a single import. The key is built on the thread that reads the file, before reading it
+ * for path keys and from the file data for content keys, so hits skip the read or the decode.
+ */
+class FImageCacheLookup
+{
+public:
+	FImageCacheLookup(bool bInEnabled, EImageCacheKeyMode InKeyMode, uint64 InSettingsHash);
+
+	/** True when the path key hits, the entry stays pinned until TakeTexture. Any thread. */
+	bool PinByPath(const FString& Filename);
+
+	/** True when the content key hits, the entry stays pinned until TakeTexture. Any thread. */
+	bool PinByContent(const uint8* Data, int64 Size);
+
+	/** Texture of the pinned entry, nullptr on a miss. Game thread only. */
+	UTexture2D* TakeTexture();
+
+	/** Adds the texture imported after a miss. Game thread only. */
+	void AddTexture(UTexture2D* Texture);
+
+private:
+	bool bEnabled;
+	EImageCacheKeyMode KeyMode;
+	uint64 SettingsHash;
+	TOptional<FImageCacheKey> Key;
+	bool bPinned = false;
+};
@@ -0,0 +1,184 @@
+#include "ImageTexturePool.h"
+
+#include "ImageTextureCache.h"
+#include "Engine/Texture2D.h"
+#include "HAL/IConsoleManager.h"
+
+
+static TAutoConsoleVariable<int32> CVarTexturePoolBudgetMB(
+	TEXT("RTImageImport.TexturePool.BudgetMB"),
+	128,
+	TEXT("Texture memory of released textures kept for reuse, 0 disables the pool."));
+
+static TUniquePtr<FImageTexturePool> GImageTexturePool;
+
+FImageTexturePool& FImageTexturePool::Get()
+{
+	check(IsInGameThread());
+	if (!GImageTexturePool.IsValid())
+	{
+		GImageTexturePool = MakeUnique<FImageTexturePool>();
+	}
+	return *GImageTexturePool;
+}
+
+void FImageTexturePool::Shutdown()
+{
+	GImageTexturePool.Reset();
+}
+
+UTexture2D* FImageTexturePool::Acquire(const FImageTexturePoolKey& Key)
+{
+	check(IsInGameThread());
+
+	TArray<FFreeTexture>* Textures = FreeTextures.Find(Key);
+	if (!Textures)
+	{
+		return nullptr;
+	}
+
+	// Most recently released first, its memory is the most likely to still be warm
+	const FFreeTexture FreeTexture = Textures->Pop(false);
+	if (Textures->Num() == 0)
+	{
+		FreeTextures.Remove(Key);
+	}
+
+	FreeBytes -= FreeTexture.SizeBytes;
+	return FreeTexture.Texture;
+}
+
+bool FImageTexturePool::HasFreeTexture(const FImageTexturePoolKey& Key) const
+{
+	check(IsInGameThread());
+	return FreeTextures.Contains(Key);
+}
+
+void FImageTexturePool::Release(UTexture2D* Texture)
+{
+	check(IsInGameThread());
+
+	const int64 BudgetBytes = FMath::Max<int64>(CVarTexturePoolBudgetMB.GetValueOnGameThread(), 0) * 1024 * 1024;
+	if (!Texture || BudgetBytes == 0 || !Texture->HasAnyFlags(RF_Transient) || !Texture->GetPlatformData() || !Texture->GetResource())
+	{
+		return;
+	}
+
+	// A cached texture would be handed out by the cache and refilled by the pool at the same time
+	if (!FImageTextureCache::Get().RemoveTexture(Texture))
+	{
+		return;
+	}
+
+	FImageTexturePoolKey Key;
+	Key.SizeX = Texture->GetSizeX();
+	Key.SizeY = Texture->GetSizeY();
+	Key.NumMips = Texture->GetNumMips();
+	Key.PixelFormat = Texture->GetPixelFormat();
+	Key.bSRGB = Texture->SRGB;
+
+	TArray<FFreeTexture>& Textures = FreeTextures.FindOrAdd(Key);
+	if (Textures.ContainsByPredicate([Texture](const FFreeTexture& FreeTexture) { return FreeTexture.Texture == Texture; }))
+	{
+		return;
+	}
+
+	FFreeTexture& FreeTexture = Textures.AddDefaulted_GetRef();
+	FreeTexture.Texture = Texture;
+	FreeTexture.SizeBytes = Texture->CalcTextureMemorySizeEnum(TMC_AllMips);
+	FreeTexture.ReleaseOrder = ++ReleaseCounter;
+	FreeBytes += FreeTexture.SizeBytes;
+
+	TrimToBudget(BudgetBytes);
+}
+
+void FImageTexturePool::Empty()
+{
+	check(IsInGameThread());
+	FreeTextures.Empty();
+	FreeBytes = 0;
+}
+
+void FImageTexturePool::TrimToBudget(int64 BudgetBytes)
+{
+	while (FreeBytes > BudgetBytes)
+	{
+		// Each list is in release order, so the oldest texture is at the front of one of them
+		TOptional<FImageTexturePoolKey> OldestKey;
+		uint64 OldestOrder = MAX_uint64;
+		for (const TPair<FImageTexturePoolKey, TArray<FFreeTexture>>& Pair : FreeTextures)
+		{
+			if (Pair.Value[0].ReleaseOrder < OldestOrder)
+			{
+				OldestKey = Pair.Key;
+				OldestOrder = Pair.Value[0].ReleaseOrder;
+			}
+		}
+
+		if (!OldestKey.IsSet())
+		{
+			break;
+		}
+
+		// Dropped textures are left to the GC
+		TArray<FFreeTexture>& Textures = FreeTextures.FindChecked(OldestKey.GetValue());
+		FreeBytes -= Textures[0].SizeBytes;
+		Textures.RemoveAt(0, 1, false);
+		if (Textures.Num() == 0)
+		{
+			FreeTextures.Remove(OldestKey.GetValue());
+		}
+	}
+}
+
+void FImageTexturePool::AddReferencedObjects(FReferenceCollector& Collector)
+{
+	for (TPair<FImageTexturePoolKey, TArray<FFreeTexture>>& Pair : FreeTextures)
+	{
+		for (FFreeTexture& FreeTexture : Pair.Value)
+		{
+			Collector.AddReferencedObject(FreeTexture.Texture);
+		}
+	}
+}
+
+FString FImageTexturePool::GetReferencerName() const
+{
+	return TEXT("FImageTexturePool");
+}
+
+void RefillPooledTexture(UTexture2D* Texture, const uint8* MipData)
+{
+	check(IsInGameThread());
+
+	const FPixelFormatInfo& FormatInfo = GPixelFormats[Texture->GetPixelFormat()];
+	for (int32 MipIndex = 0; MipIndex < Texture->GetNumMips(); ++MipIndex)
+	{
+		FTexture2DMipMap& Mip = Texture->GetPlatformData()->Mips[MipIndex];
+		const int64 NumBlocksX = FMath::DivideAndRoundUp<int64>(Mip.SizeX, FormatInfo.BlockSizeX);
+		const int64 NumBlocksY = FMath::DivideAndRoundUp<int64>(Mip.SizeY, FormatInfo.BlockSizeY);
+		const int64 Pitch = NumBlocksX * FormatInfo.BlockBytes;
+		const int64 MipSize = Pitch * NumBlocksY;
+
+		// The bulk data is what the saver and a later UpdateResource read, keep it in sync
+		if (Mip.BulkData.GetBulkDataSize() == MipSize)
+		{
+			FMemory::Memcpy(Mip.BulkData.Lock(EBulkDataLockFlags::LOCK_READ_WRITE), MipData, MipSize);
+			Mip.BulkData.Unlock();
+		}
+
+		// The render thread reads the data later, it gets its own copy that it frees once uploaded
+		uint8* UploadData = static_cast<uint8*>(FMemory::Malloc(MipSize));
+		FMemory::Memcpy(UploadData, MipData, MipSize);
+
+		FUpdateTextureRegion2D* Region = new FUpdateTextureRegion2D(0, 0, 0, 0, Mip.SizeX, Mip.SizeY);
+		Texture->UpdateTextureRegions(MipIndex, 1, Region, uint32(Pitch), FormatInfo.BlockBytes, UploadData,
+			[](uint8* Data, const FUpdateTextureRegion2D* Regions)
+			{
+				FMemory::Free(Data);
+				delete Regions;
+			});
+
+		MipData += MipSize;
+	}
+}
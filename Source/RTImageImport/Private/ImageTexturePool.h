@@ -0,0 +1,82 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/GCObject.h"
+
+class UTexture2D;
+
+/** Textures can only be reused for images with the same layout, sRGB included as it decides the RHI format */
+struct FImageTexturePoolKey
+{
+	int32 SizeX = 0;
+	int32 SizeY = 0;
+	int32 NumMips = 0;
+	EPixelFormat PixelFormat = PF_Unknown;
+	bool bSRGB = false;
+
+	bool operator==(const FImageTexturePoolKey& Other) const
+	{
+		return SizeX == Other.SizeX && SizeY == Other.SizeY && NumMips == Other.NumMips && PixelFormat == Other.PixelFormat && bSRGB == Other.bSRGB;
+	}
+
+	friend uint32 GetTypeHash(const FImageTexturePoolKey& Key)
+	{
+		uint32 Hash = HashCombine(GetTypeHash(Key.SizeX), GetTypeHash(Key.SizeY));
+		Hash = HashCombine(Hash, GetTypeHash(Key.NumMips));
+		return HashCombine(Hash, GetTypeHash(uint32(Key.PixelFormat) | (uint32(Key.bSRGB) << 16)));
+	}
+};
+
+/**
+ * Transient textures handed back by their users, kept with their RHI texture so imports of the same
+ * size and format refill them instead of creating a new texture. Textures that have been free the
+ * longest are dropped once the pool exceeds RTImageImport.TexturePool.BudgetMB. Game thread only.
+ */
+class FImageTexturePool : public FGCObject
+{
+public:
+	static FImageTexturePool& Get();
+
+	/** Releases the textures, called on module shutdown */
+	static void Shutdown();
+
+	/** A free texture with this layout, it leaves the pool. Nullptr when there is none. */
+	UTexture2D* Acquire(const FImageTexturePoolKey& Key);
+
+	bool HasFreeTexture(const FImageTexturePoolKey& Key) const;
+
+	/**
+	 * Takes a texture created by the importer back for reuse, the caller must not use it afterwards.
+	 * Textures that are still in the texture cache are removed from it first, textures pinned by an
+	 * import in flight are left alone.
+	 */
+	void Release(UTexture2D* Texture);
+
+	void Empty();
+
+	int64 GetFreeBytes() const { return FreeBytes; }
+
+	//~ FGCObject
+	virtual void AddReferencedObjects(FReferenceCollector& Collector) override;
+	virtual FString GetReferencerName() const override;
+
+private:
+	struct FFreeTexture
+	{
+		UTexture2D* Texture = nullptr;
+		int64 SizeBytes = 0;
+		uint64 ReleaseOrder = 0;
+	};
+
+	void TrimToBudget(int64 BudgetBytes);
+
+	TMap<FImageTexturePoolKey, TArray<FFreeTexture>> FreeTextures;
+	int64 FreeBytes = 0;
+	uint64 ReleaseCounter = 0;
+};
+
+/**
+ * Replaces all mips of a pooled texture, the bulk data right away and the RHI texture through render
+ * commands, without recreating the resource. MipData holds the mips back to back in the texture's layout.
+ */
+void RefillPooledTexture(UTexture2D* Texture, const uint8* MipData);
@@ -0,0 +1,335 @@
+#include "JpegRowDecoder.h"
+
+#if RTIMAGEIMPORT_WITH_LIBJPEGTURBO
+
+#include "ImageImporter.h"
+#include "ImageRowDownsampler.h"
+
+#include <setjmp.h>
+#include <stdio.h>
+
+THIRD_PARTY_INCLUDES_START
+#include "jpeglib.h"
+THIRD_PARTY_INCLUDES_END
+
+
+struct FJpegState
+{
+	jpeg_decompress_struct DecompressInfo;
+	jpeg_error_mgr ErrorManager;
+
+	/** libjpeg reports errors by jumping back into the setjmp of the wrapper that called it */
+	jmp_buf SetjmpBuffer;
+
+	static void ErrorExit(j_common_ptr Info)
+	{
+		char Message[JMSG_LENGTH_MAX];
+		(*Info->err->format_message)(Info, Message);
+		UE_LOG(ImageImporter, Error, TEXT("JPEG Error: %s"), ANSI_TO_TCHAR(Message));
+
+		FJpegState* State = static_cast<FJpegState*>(Info->client_data);
+		longjmp(State->SetjmpBuffer, 1);
+	}
+
+	static void OutputMessage(j_common_ptr Info)
+	{
+		char Message[JMSG_LENGTH_MAX];
+		(*Info->err->format_message)(Info, Message);
+		UE_LOG(ImageImporter, Verbose, TEXT("JPEG Warning: %s"), ANSI_TO_TCHAR(Message));
+	}
+
+	/**
+	 * Calls into libjpeg that can fail, each wrapped in its own setjmp. Their frames hold nothing but pointers
+	 * and the results are written through them, so a jump never skips a destructor or a modified local.
+	 */
+	static FORCENOINLINE bool ReadHeader(FJpegState* State, const uint8* Buffer, unsigned long Length, int* OutResult)
+	{
+		if (setjmp(State->SetjmpBuffer) != 0)
+		{
+			return false;
+		}
+
+		jpeg_mem_src(&State->DecompressInfo, const_cast<uint8*>(Buffer), Length);
+		*OutResult = jpeg_read_header(&State->DecompressInfo, TRUE);
+		return true;
+	}
+
+	static FORCENOINLINE bool CalcOutputDimensions(FJpegState* State)
+	{
+		if (setjmp(State->SetjmpBuffer) != 0)
+		{
+			return false;
+		}
+
+		jpeg_calc_output_dimensions(&State->DecompressInfo);
+		return true;
+	}
+
+	static FORCENOINLINE bool StartDecompress(FJpegState* State)
+	{
+		if (setjmp(State->SetjmpBuffer) != 0)
+		{
+			return false;
+		}
+
+		jpeg_start_decompress(&State->DecompressInfo);
+		return true;
+	}
+
+	static FORCENOINLINE bool CropScanline(FJpegState* State, JDIMENSION* InOutX, JDIMENSION* InOutWidth)
+	{
+		if (setjmp(State->SetjmpBuffer) != 0)
+		{
+			return false;
+		}
+
+		jpeg_crop_scanline(&State->DecompressInfo, InOutX, InOutWidth);
+		return true;
+	}
+
+	static FORCENOINLINE bool SkipScanlines(FJpegState* State, JDIMENSION NumLines, JDIMENSION* OutNumSkipped)
+	{
+		if (setjmp(State->SetjmpBuffer) != 0)
+		{
+			return false;
+		}
+
+		*OutNumSkipped = jpeg_skip_scanlines(&State->DecompressInfo, NumLines);
+		return true;
+	}
+
+	static FORCENOINLINE bool ReadScanlines(FJpegState* State, JSAMPARRAY Rows, JDIMENSION NumRows, JDIMENSION* OutNumRead)
+	{
+		if (setjmp(State->SetjmpBuffer) != 0)
+		{
+			return false;
+		}
+
+		*OutNumRead = jpeg_read_scanlines(&State->DecompressInfo, Rows, NumRows);
+		return true;
+	}
+
+	static FORCENOINLINE bool FinishDecompress(FJpegState* State)
+	{
+		if (setjmp(State->SetjmpBuffer) != 0)
+		{
+			return false;
+		}
+
+		jpeg_finish_decompress(&State->DecompressInfo);
+		return true;
+	}
+};
+
+FJpegRowDecoder::FJpegRowDecoder(const uint8* InBuffer, int64 InLength)
+	: Buffer(InBuffer)
+	, Length(InLength)
+{
+}
+
+FJpegRowDecoder::~FJpegRowDecoder()
+{
+	if (State)
+	{
+		jpeg_destroy_decompress(&State->DecompressInfo);
+		delete State;
+	}
+}
+
+bool FJpegRowDecoder::ReadHeader()
+{
+	if (State || Length < 3 || Length > MAX_uint32 || Buffer[0] != 0xFF || Buffer[1] != 0xD8 || Buffer[2] != 0xFF)
+	{
+		return TextureFormat != TSF_Invalid;
+	}
+
+	State = new FJpegState();
+	jpeg_decompress_struct& Info = State->DecompressInfo;
+	Info.err = jpeg_std_error(&State->ErrorManager);
+	State->ErrorManager.error_exit = &FJpegState::ErrorExit;
+	State->ErrorManager.output_message = &FJpegState::OutputMessage;
+	jpeg_create_decompress(&Info);
+	Info.client_data = State;
+
+	int HeaderResult = 0;
+	if (!FJpegState::ReadHeader(State, Buffer, (unsigned long)Length, &HeaderResult) || HeaderResult != JPEG_HEADER_OK)
+	{
+		return false;
+	}
+
+	switch (Info.jpeg_color_space)
+	{
+	case JCS_GRAYSCALE:
+		Info.out_color_space = JCS_GRAYSCALE;
+		TextureFormat = TSF_G8;
+		break;
+
+	case JCS_YCbCr:
+	case JCS_RGB:
+		// libjpeg-turbo writes the texture layout directly, alpha set to opaque
+		Info.out_color_space = JCS_EXT_BGRA;
+		TextureFormat = TSF_BGRA8;
+		break;
+
+	default:
+		return false;
+	}
+
+	Width = Info.image_width;
+	Height = Info.image_height;
+	ScaledWidth = Width;
+	ScaledHeight = Height;
+	return Width > 0 && Height > 0;
+}
+
+void FJpegRowDecoder::SetScaleForMaxDimension(int32 MaxDimension)
+{
+	check(TextureFormat != TSF_Invalid);
+
+	const int32 LongerSide = FMath::Max(Width, Height);
+	int32 ScaleDenom = 8;
+	while (ScaleDenom > 1 && (MaxDimension <= 0 || FMath::DivideAndRoundUp(LongerSide, ScaleDenom) < MaxDimension))
+	{
+		ScaleDenom /= 2;
+	}
+
+	jpeg_decompress_struct& Info = State->DecompressInfo;
+	Info.scale_num = 1;
+	Info.scale_denom = ScaleDenom;
+
+	if (!FJpegState::CalcOutputDimensions(State))
+	{
+		return;
+	}
+
+	ScaledWidth = Info.output_width;
+	ScaledHeight = Info.output_height;
+}
+
+bool FJpegRowDecoder::Decode(uint8* Dest, int64 DestSize, int32 Factor)
+{
+	const int32 BytesPerPixel = FTextureSource::GetBytesPerPixel(TextureFormat);
+	const int64 DestSizeNeeded = (int64)FImageRowDownsampler::GetScaledSize(ScaledWidth, Factor) * FImageRowDownsampler::GetScaledSize(ScaledHeight, Factor) * BytesPerPixel;
+	if (TextureFormat == TSF_Invalid || !Dest || DestSize < DestSizeNeeded)
+	{
+		return false;
+	}
+
+	// Rows go straight into Dest unless they are filtered further
+	TArray64<uint8> Row;
+	if (Factor > 1)
+	{
+		Row.SetNumUninitialized((int64)ScaledWidth * BytesPerPixel);
+	}
+	FImageRowDownsampler Downsampler(ScaledWidth, ScaledHeight, Factor, TextureFormat, true, Dest);
+
+	jpeg_decompress_struct& Info = State->DecompressInfo;
+	if (!FJpegState::StartDecompress(State))
+	{
+		return false;
+	}
+
+	if ((int32)Info.output_width != ScaledWidth || (int32)Info.output_height != ScaledHeight || Info.output_components != BytesPerPixel)
+	{
+		jpeg_abort_decompress(&Info);
+		return false;
+	}
+
+	// Color conversion and upsampling run in libjpeg-turbo's SIMD kernels (SSE2, AVX2, NEON) for the BGRA
+	// output, handing it several rows at once lets it emit a whole iMCU row of upsampled output per call
+	constexpr int32 MaxRowsPerRead = 16;
+	while (Info.output_scanline < Info.output_height)
+	{
+		JSAMPROW RowPointers[MaxRowsPerRead];
+		int32 NumRows = 1;
+		if (Factor > 1)
+		{
+			RowPointers[0] = Row.GetData();
+		}
+		else
+		{
+			NumRows = FMath::Min<int32>(MaxRowsPerRead, Info.output_height - Info.output_scanline);
+			for (int32 RowIndex = 0; RowIndex < NumRows; ++RowIndex)
+			{
+				RowPointers[RowIndex] = Dest + int64(Info.output_scanline + RowIndex) * ScaledWidth * BytesPerPixel;
+			}
+		}
+
+		JDIMENSION NumRowsRead = 0;
+		if (!FJpegState::ReadScanlines(State, RowPointers, JDIMENSION(NumRows), &NumRowsRead) || NumRowsRead == 0)
+		{
+			jpeg_abort_decompress(&Info);
+			return false;
+		}
+
+		if (Factor > 1)
+		{
+			Downsampler.AddRow(Row.GetData());
+		}
+	}
+
+	return FJpegState::FinishDecompress(State);
+}
+
+bool FJpegRowDecoder::DecodeRegion(const FIntRect& Region, uint8* Dest)
+{
+	if (TextureFormat == TSF_Invalid || !Dest || Region.Min.X < 0 || Region.Min.Y < 0 || Region.Max.X > Width || Region.Max.Y > Height || Region.Width() <= 0 || Region.Height() <= 0)
+	{
+		return false;
+	}
+
+	const int32 BytesPerPixel = FTextureSource::GetBytesPerPixel(TextureFormat);
+	const int64 RegionRowSize = (int64)Region.Width() * BytesPerPixel;
+	TArray64<uint8> Row;
+
+	jpeg_decompress_struct& Info = State->DecompressInfo;
+	Info.scale_num = 1;
+	Info.scale_denom = 1;
+
+	if (!FJpegState::StartDecompress(State))
+	{
+		return false;
+	}
+
+	if (Info.output_components != BytesPerPixel)
+	{
+		jpeg_abort_decompress(&Info);
+		return false;
+	}
+
+	// The crop is widened to whole iMCU columns, the row buffer starts up to one iMCU left of the region
+	JDIMENSION CropX = JDIMENSION(Region.Min.X);
+	JDIMENSION CropWidth = JDIMENSION(Region.Width());
+	if (!FJpegState::CropScanline(State, &CropX, &CropWidth))
+	{
+		jpeg_abort_decompress(&Info);
+		return false;
+	}
+	Row.SetNumUninitialized((int64)Info.output_width * BytesPerPixel);
+	const int64 RowOffset = (int64)(Region.Min.X - int32(CropX)) * BytesPerPixel;
+
+	JDIMENSION NumRowsSkipped = 0;
+	if (Region.Min.Y > 0 && (!FJpegState::SkipScanlines(State, JDIMENSION(Region.Min.Y), &NumRowsSkipped) || NumRowsSkipped != JDIMENSION(Region.Min.Y)))
+	{
+		jpeg_abort_decompress(&Info);
+		return false;
+	}
+
+	for (int32 Y = 0; Y < Region.Height(); ++Y)
+	{
+		JSAMPROW RowPointer = Row.GetData();
+		JDIMENSION NumRowsRead = 0;
+		if (!FJpegState::ReadScanlines(State, &RowPointer, 1, &NumRowsRead) || NumRowsRead != 1)
+		{
+			jpeg_abort_decompress(&Info);
+			return false;
+		}
+		FMemory::Memcpy(Dest + Y * RegionRowSize, Row.GetData() + RowOffset, RegionRowSize);
+	}
+
+	// The rows below the region are never decoded
+	jpeg_abort_decompress(&Info);
+	return true;
+}
+
+#endif
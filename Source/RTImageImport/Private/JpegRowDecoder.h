@@ -0,0 +1,61 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/Texture.h"
+
+#if RTIMAGEIMPORT_WITH_LIBJPEGTURBO
+
+/**
+ * Decodes a JPEG straight from the compressed buffer with libjpeg-turbo, one scanline at a time. The
+ * image can be scaled by 1/2, 1/4 or 1/8 in the DCT domain, which skips most of the inverse DCT and
+ * upsampling work, and then box filtered further while the rows come out.
+ */
+class FJpegRowDecoder
+{
+public:
+	FJpegRowDecoder(const uint8* InBuffer, int64 InLength);
+	~FJpegRowDecoder();
+
+	/** Parses the header, fails for color spaces that don't decode to BGRA or gray (CMYK, YCCK) */
+	bool ReadHeader();
+
+	int32 GetWidth() const { return Width; }
+	int32 GetHeight() const { return Height; }
+
+	/** TSF_G8 or TSF_BGRA8, TSF_Invalid before ReadHeader succeeded */
+	ETextureSourceFormat GetTextureFormat() const { return TextureFormat; }
+
+	/** Picks the smallest DCT scale that keeps the longer side at or above MaxDimension */
+	void SetScaleForMaxDimension(int32 MaxDimension);
+
+	/** Size after DCT scaling */
+	int32 GetScaledWidth() const { return ScaledWidth; }
+	int32 GetScaledHeight() const { return ScaledHeight; }
+
+	/**
+	 * Decodes at the DCT scale and box filters the rows down by Factor on top, Dest holds the image at
+	 * GetScaledWidth() / Factor x GetScaledHeight() / Factor rounded up.
+	 */
+	bool Decode(uint8* Dest, int64 DestSize, int32 Factor);
+
+	/**
+	 * Decodes Region at full scale into Dest as tightly packed rows of Region's width. Only the iMCU columns
+	 * Region touches are decoded, the rows above it are entropy decoded and skipped. Ignores the DCT scale.
+	 */
+	bool DecodeRegion(const FIntRect& Region, uint8* Dest);
+
+private:
+	const uint8* Buffer;
+	int64 Length;
+
+	/** libjpeg state and the error manager that jumps back into the decoder, defined with the libjpeg types */
+	struct FJpegState* State = nullptr;
+
+	int32 Width = 0;
+	int32 Height = 0;
+	int32 ScaledWidth = 0;
+	int32 ScaledHeight = 0;
+	ETextureSourceFormat TextureFormat = TSF_Invalid;
+};
+
+#endif
@@ -0,0 +1,194 @@
+#include "PcxDecoder.h"
+
+#include "ImageImporter.h"
+#include "ImagePixelExpansion.h"
+
+
+#pragma pack(push,1)
+class FPCXFileHeader
+{
+public:
+	uint8	Manufacturer;		// Always 10.
+	uint8	Version;			// PCX file version.
+	uint8	Encoding;			// 1=run-length, 0=none.
+	uint8	BitsPerPixel;		// 1,2,4, or 8.
+	uint16	XMin;				// Dimensions of the image.
+	uint16	YMin;				// Dimensions of the image.
+	uint16	XMax;				// Dimensions of the image.
+	uint16	YMax;				// Dimensions of the image.
+	uint16	XDotsPerInch;		// Horizontal printer resolution.
+	uint16	YDotsPerInch;		// Vertical printer resolution.
+	uint8	OldColorMap[48];	// Old colormap info data.
+	uint8	Reserved1;			// Must be 0.
+	uint8	NumPlanes;			// Number of color planes (1, 3, 4, etc).
+	uint16	BytesPerLine;		// Number of bytes per scanline.
+	uint16	PaletteType;		// How to interpret palette: 1=color, 2=gray.
+	uint16	HScreenSize;		// Horizontal monitor size.
+	uint16	VScreenSize;		// Vertical monitor size.
+	uint8	Reserved2[54];		// Must be 0.
+	friend FArchive& operator<<(FArchive& Ar, FPCXFileHeader& H)
+	{
+		Ar << H.Manufacturer << H.Version << H.Encoding << H.BitsPerPixel;
+		Ar << H.XMin << H.YMin << H.XMax << H.YMax << H.XDotsPerInch << H.YDotsPerInch;
+		for (int32 i = 0; i < UE_ARRAY_COUNT(H.OldColorMap); i++)
+			Ar << H.OldColorMap[i];
+		Ar << H.Reserved1 << H.NumPlanes;
+		Ar << H.BytesPerLine << H.PaletteType << H.HScreenSize << H.VScreenSize;
+		for (int32 i = 0; i < UE_ARRAY_COUNT(H.Reserved2); i++)
+			Ar << H.Reserved2[i];
+		return Ar;
+	}
+};
+#pragma pack(pop)
+
+static_assert(sizeof(FPCXFileHeader) == 128, "PCX pixel data starts right after the 128 byte header");
+
+namespace
+{
+	constexpr int64 PcxPaletteSize = 256 * 3;
+
+	/** Marker byte in front of the palette at the end of 8 bit files */
+	constexpr uint8 PcxPaletteMarker = 0x0c;
+}
+
+FPcxDecoder::FPcxDecoder(const uint8* InBuffer, int64 InLength)
+	: Buffer(InBuffer)
+	, Length(InLength)
+{
+}
+
+bool FPcxDecoder::ReadHeader()
+{
+	if (bHeaderRead || Length < (int64)sizeof(FPCXFileHeader))
+	{
+		return bHeaderRead;
+	}
+
+	FPCXFileHeader Header;
+	FMemory::Memcpy(&Header, Buffer, sizeof(Header));
+
+	if (Header.Manufacturer != 10 || Header.Encoding > 1 || Header.XMax < Header.XMin || Header.YMax < Header.YMin)
+	{
+		return false;
+	}
+
+	if (Header.BitsPerPixel != 8 || (Header.NumPlanes != 1 && Header.NumPlanes != 3 && Header.NumPlanes != 4))
+	{
+		UE_LOG(ImageImporter, Error, TEXT("PCX uses an unsupported format (%i/%i)"), Header.NumPlanes, Header.BitsPerPixel);
+		return false;
+	}
+
+	Width = Header.XMax + 1 - Header.XMin;
+	Height = Header.YMax + 1 - Header.YMin;
+	NumPlanes = Header.NumPlanes;
+	BytesPerLine = Header.BytesPerLine;
+	bRLE = Header.Encoding == 1;
+
+	if (BytesPerLine < Width)
+	{
+		return false;
+	}
+
+	DataEnd = Length;
+	if (NumPlanes == 1)
+	{
+		if (Length < (int64)sizeof(FPCXFileHeader) + PcxPaletteSize)
+		{
+			return false;
+		}
+
+		DataEnd = Length - PcxPaletteSize;
+		if (DataEnd > (int64)sizeof(FPCXFileHeader) && Buffer[DataEnd - 1] == PcxPaletteMarker)
+		{
+			--DataEnd;
+		}
+
+		// Index 0 is transparent, the way the editor's PCX importer always treated it
+		const uint8* PaletteData = Buffer + Length - PcxPaletteSize;
+		for (int32 Index = 0; Index < 256; ++Index)
+		{
+			const uint8* Color = PaletteData + Index * 3;
+			Palette[Index] = FColor(Color[0], Color[1], Color[2], Index == 0 ? 0 : 255).DWColor();
+		}
+	}
+
+	bHeaderRead = true;
+	return true;
+}
+
+bool FPcxDecoder::Decode(uint8* Dest, int64 DestSize)
+{
+	if (!bHeaderRead || DestSize < (int64)Width * Height * 4)
+	{
+		return false;
+	}
+
+	const int32 ScanlineBytes = BytesPerLine * NumPlanes;
+	TArray<uint8> Scanline;
+	Scanline.SetNumUninitialized(ScanlineBytes);
+
+	int64 Offset = sizeof(FPCXFileHeader);
+	int32 RunRemaining = 0;
+	uint8 RunValue = 0;
+
+	for (int32 Y = 0; Y < Height; ++Y)
+	{
+		const uint8* Line = Buffer + Offset;
+		if (bRLE)
+		{
+			for (int32 Index = 0; Index < ScanlineBytes;)
+			{
+				if (RunRemaining == 0)
+				{
+					if (Offset >= DataEnd)
+					{
+						UE_LOG(ImageImporter, Error, TEXT("PCX data ends at row %d of %d"), Y, Height);
+						return false;
+					}
+
+					const uint8 Value = Buffer[Offset++];
+					if ((Value & 0xc0) != 0xc0)
+					{
+						Scanline[Index++] = Value;
+						continue;
+					}
+
+					if (Offset >= DataEnd)
+					{
+						UE_LOG(ImageImporter, Error, TEXT("PCX data ends at row %d of %d"), Y, Height);
+						return false;
+					}
+					RunRemaining = Value & 0x3f;
+					RunValue = Buffer[Offset++];
+				}
+
+				const int32 Span = FMath::Min(RunRemaining, ScanlineBytes - Index);
+				FMemory::Memset(Scanline.GetData() + Index, RunValue, Span);
+				Index += Span;
+				RunRemaining -= Span;
+			}
+			Line = Scanline.GetData();
+		}
+		else
+		{
+			if (Offset + ScanlineBytes > DataEnd)
+			{
+				UE_LOG(ImageImporter, Error, TEXT("PCX data ends at row %d of %d"), Y, Height);
+				return false;
+			}
+			Offset += ScanlineBytes;
+		}
+
+		uint32* DestRow = reinterpret_cast<uint32*>(Dest) + (int64)Y * Width;
+		if (NumPlanes == 1)
+		{
+			ExpandPaletteIndices(Line, Palette, DestRow, Width);
+		}
+		else
+		{
+			// Planes are stored R, G, B and optionally A, each BytesPerLine long
+			InterleavePlanesToBGRA8(Line + 2 * BytesPerLine, Line + BytesPerLine, Line, NumPlanes == 4 ? Line + 3 * BytesPerLine : nullptr, DestRow, Width);
+		}
+	}
+	return true;
+}
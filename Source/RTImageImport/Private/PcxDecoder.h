@@ -0,0 +1,43 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/Texture.h"
+
+/**
+ * Decodes 8 bit palettized and 24/32 bit planar PCX files to BGRA8, one scanline at a time straight into
+ * a destination owned by the caller. The RLE expansion is bounds checked against the file data and the
+ * scanline, runs that continue into the next scanline are carried over as some writers produce them.
+ */
+class FPcxDecoder
+{
+public:
+	FPcxDecoder(const uint8* InBuffer, int64 InLength);
+
+	/** Parses the header, fails for bit depths and plane counts other than 8 bit with 1, 3 or 4 planes */
+	bool ReadHeader();
+
+	int32 GetWidth() const { return Width; }
+	int32 GetHeight() const { return Height; }
+
+	/** Always TSF_BGRA8, palettes and planes are expanded */
+	ETextureSourceFormat GetTextureFormat() const { return TSF_BGRA8; }
+
+	/** Decodes into Dest as tightly packed BGRA8 rows, Dest has to hold Width x Height pixels */
+	bool Decode(uint8* Dest, int64 DestSize);
+
+private:
+	const uint8* Buffer;
+	int64 Length;
+
+	/** End of the pixel data, the 256 color palette of 8 bit images follows it */
+	int64 DataEnd = 0;
+
+	int32 Width = 0;
+	int32 Height = 0;
+	int32 NumPlanes = 0;
+	int32 BytesPerLine = 0;
+	bool bRLE = false;
+	bool bHeaderRead = false;
+
+	uint32 Palette[256];
+};
@@ -0,0 +1,276 @@
+#include "PngRowDecoder.h"
+
+#include "ImageFillZeroAlpha.h"
+#include "ImageImporter.h"
+#include "ImageRowDownsampler.h"
+
+THIRD_PARTY_INCLUDES_START
+#include "png.h"
+THIRD_PARTY_INCLUDES_END
+
+
+FPngRowDecoder::FPngRowDecoder(const uint8* InBuffer, int64 InLength)
+	: Buffer(InBuffer)
+	, Length(InLength)
+{
+}
+
+FPngRowDecoder::~FPngRowDecoder()
+{
+	if (PngPtr)
+	{
+		png_destroy_read_struct(&PngPtr, InfoPtr ? &InfoPtr : nullptr, nullptr);
+	}
+}
+
+void FPngRowDecoder::ReadCallback(png_structp InPngPtr, png_bytep OutData, size_t InLength)
+{
+	FPngRowDecoder* Decoder = static_cast<FPngRowDecoder*>(png_get_io_ptr(InPngPtr));
+	if (Decoder->ReadOffset + (int64)InLength > Decoder->Length)
+	{
+		png_error(InPngPtr, "Read past the end of the PNG data");
+	}
+
+	FMemory::Memcpy(OutData, Decoder->Buffer + Decoder->ReadOffset, InLength);
+	Decoder->ReadOffset += InLength;
+}
+
+void FPngRowDecoder::ErrorCallback(png_structp InPngPtr, png_const_charp Message)
+{
+	FPngRowDecoder* Decoder = static_cast<FPngRowDecoder*>(png_get_error_ptr(InPngPtr));
+	UE_LOG(ImageImporter, Error, TEXT("PNG Error: %s"), ANSI_TO_TCHAR(Message));
+	longjmp(Decoder->SetjmpBuffer, 1);
+}
+
+void FPngRowDecoder::WarningCallback(png_structp InPngPtr, png_const_charp Message)
+{
+	UE_LOG(ImageImporter, Verbose, TEXT("PNG Warning: %s"), ANSI_TO_TCHAR(Message));
+}
+
+bool FPngRowDecoder::ReadHeader()
+{
+	static const int32 SignatureSize = 8;
+	if (bHeaderRead || Length < SignatureSize || png_sig_cmp(Buffer, 0, SignatureSize) != 0)
+	{
+		return bHeaderRead;
+	}
+
+	PngPtr = png_create_read_struct(PNG_LIBPNG_VER_STRING, this, ErrorCallback, WarningCallback);
+	if (!PngPtr)
+	{
+		return false;
+	}
+
+	InfoPtr = png_create_info_struct(PngPtr);
+	if (!InfoPtr)
+	{
+		return false;
+	}
+
+	if (!TryReadInfo())
+	{
+		return false;
+	}
+
+	Width = png_get_image_width(PngPtr, InfoPtr);
+	Height = png_get_image_height(PngPtr, InfoPtr);
+	BitDepth = png_get_bit_depth(PngPtr, InfoPtr);
+	ColorType = png_get_color_type(PngPtr, InfoPtr);
+	bInterlaced = png_get_interlace_type(PngPtr, InfoPtr) != PNG_INTERLACE_NONE;
+
+	if (Width <= 0 || Height <= 0)
+	{
+		return false;
+	}
+
+	// Gray with an alpha channel goes to a color format so the alpha isn't lost
+	if (ColorType == PNG_COLOR_TYPE_GRAY)
+	{
+		TextureFormat = BitDepth <= 8 ? TSF_G8 : TSF_G16;
+	}
+	else
+	{
+		TextureFormat = BitDepth <= 8 ? TSF_BGRA8 : TSF_RGBA16;
+	}
+
+	if (!TryUpdateInfo())
+	{
+		return false;
+	}
+
+	if ((int64)png_get_rowbytes(PngPtr, InfoPtr) != (int64)Width * FTextureSource::GetBytesPerPixel(TextureFormat))
+	{
+		UE_LOG(ImageImporter, Error, TEXT("PNG row size doesn't match the selected texture format"));
+		return false;
+	}
+
+	bHeaderRead = true;
+	return true;
+}
+
+bool FPngRowDecoder::TryReadInfo()
+{
+	if (setjmp(SetjmpBuffer) != 0)
+	{
+		return false;
+	}
+
+	png_set_read_fn(PngPtr, this, ReadCallback);
+	png_read_info(PngPtr, InfoPtr);
+	return true;
+}
+
+bool FPngRowDecoder::TryUpdateInfo()
+{
+	if (setjmp(SetjmpBuffer) != 0)
+	{
+		return false;
+	}
+
+	SetupTransforms();
+	png_read_update_info(PngPtr, InfoPtr);
+	return true;
+}
+
+bool FPngRowDecoder::TryReadRow(uint8* Row)
+{
+	if (setjmp(SetjmpBuffer) != 0)
+	{
+		return false;
+	}
+
+	png_read_row(PngPtr, Row, nullptr);
+	return true;
+}
+
+void FPngRowDecoder::SetupTransforms()
+{
+	const bool bIs16Bit = BitDepth == 16;
+
+	if (ColorType == PNG_COLOR_TYPE_PALETTE)
+	{
+		png_set_palette_to_rgb(PngPtr);
+	}
+
+	if ((ColorType & PNG_COLOR_MASK_COLOR) == 0 && BitDepth < 8)
+	{
+		png_set_expand_gray_1_2_4_to_8(PngPtr);
+	}
+
+	if (TextureFormat == TSF_BGRA8 || TextureFormat == TSF_RGBA16)
+	{
+		if ((ColorType & PNG_COLOR_MASK_COLOR) == 0)
+		{
+			png_set_gray_to_rgb(PngPtr);
+		}
+
+		if (png_get_valid(PngPtr, InfoPtr, PNG_INFO_tRNS))
+		{
+			png_set_tRNS_to_alpha(PngPtr);
+		}
+		else if ((ColorType & PNG_COLOR_MASK_ALPHA) == 0)
+		{
+			png_set_add_alpha(PngPtr, bIs16Bit ? 0xffff : 0xff, PNG_FILLER_AFTER);
+		}
+
+		if (TextureFormat == TSF_BGRA8)
+		{
+			png_set_bgr(PngPtr);
+		}
+	}
+
+#if PLATFORM_LITTLE_ENDIAN
+	if (bIs16Bit)
+	{
+		// PNG stores 16 bit samples big endian
+		png_set_swap(PngPtr);
+	}
+#endif
+
+	NumPasses = bInterlaced ? png_set_interlace_handling(PngPtr) : 1;
+}
+
+bool FPngRowDecoder::Decode(uint8* Dest, int64 DestSize, bool bFillZeroAlpha)
+{
+	if (!bHeaderRead || !Dest || DestSize < GetDecodedSize())
+	{
+		return false;
+	}
+
+	const int64 RowBytes = (int64)Width * FTextureSource::GetBytesPerPixel(TextureFormat);
+	const bool bFillRows = bFillZeroAlpha && FZeroAlphaRowFiller::SupportsFormat(TextureFormat);
+	FZeroAlphaRowFiller Filler(Width, Height, TextureFormat, Dest);
+
+	for (int32 Pass = 0; Pass < NumPasses; ++Pass)
+	{
+		const bool bLastPass = Pass == NumPasses - 1;
+		for (int32 Y = 0; Y < Height; ++Y)
+		{
+			// Interlaced passes combine into the rows that are already in Dest
+			if (!TryReadRow(Dest + Y * RowBytes))
+			{
+				return false;
+			}
+
+			if (bFillRows && bLastPass)
+			{
+				Filler.ProcessRow(Y);
+			}
+		}
+	}
+
+	return true;
+}
+
+bool FPngRowDecoder::DecodeDownsampled(int32 Factor, uint8* Dest, int64 DestSize)
+{
+	const int32 BytesPerPixel = FTextureSource::GetBytesPerPixel(TextureFormat);
+	const int64 ScaledSize = (int64)FImageRowDownsampler::GetScaledSize(Width, Factor) * FImageRowDownsampler::GetScaledSize(Height, Factor) * BytesPerPixel;
+	if (!bHeaderRead || bInterlaced || !Dest || DestSize < ScaledSize)
+	{
+		return false;
+	}
+
+	TArray64<uint8> Row;
+	Row.SetNumUninitialized((int64)Width * BytesPerPixel);
+	// 8 bit PNGs are imported sRGB, the downsampler keeps 16 bit ones linear either way
+	FImageRowDownsampler Downsampler(Width, Height, Factor, TextureFormat, true, Dest);
+
+	for (int32 Y = 0; Y < Height; ++Y)
+	{
+		if (!TryReadRow(Row.GetData()))
+		{
+			return false;
+		}
+		Downsampler.AddRow(Row.GetData());
+	}
+
+	return true;
+}
+
+bool FPngRowDecoder::DecodeRegion(const FIntRect& Region, uint8* Dest)
+{
+	if (!bHeaderRead || bInterlaced || !Dest || Region.Min.X < 0 || Region.Min.Y < 0 || Region.Max.X > Width || Region.Max.Y > Height || Region.Width() <= 0 || Region.Height() <= 0)
+	{
+		return false;
+	}
+
+	const int32 BytesPerPixel = FTextureSource::GetBytesPerPixel(TextureFormat);
+	const int64 RegionRowSize = (int64)Region.Width() * BytesPerPixel;
+	TArray64<uint8> Row;
+	Row.SetNumUninitialized((int64)Width * BytesPerPixel);
+
+	for (int32 Y = 0; Y < Region.Max.Y; ++Y)
+	{
+		if (!TryReadRow(Row.GetData()))
+		{
+			return false;
+		}
+		if (Y >= Region.Min.Y)
+		{
+			FMemory::Memcpy(Dest + (Y - Region.Min.Y) * RegionRowSize, Row.GetData() + (int64)Region.Min.X * BytesPerPixel, RegionRowSize);
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/Texture.h"
+
+#include <setjmp.h>
+
+/**
+ * Decodes a PNG straight from the compressed buffer with libpng, one scanline at a time, into a
+ * destination owned by the caller. Unlike IImageWrapper::GetRaw there is no internal copy of the
+ * compressed data and no intermediate full size image, only libpng's own row buffers.
+ */
+class FPngRowDecoder
+{
+public:
+	FPngRowDecoder(const uint8* InBuffer, int64 InLength);
+	~FPngRowDecoder();
+
+	/** Parses the header and picks the texture source format the image is decoded to */
+	bool ReadHeader();
+
+	int32 GetWidth() const { return Width; }
+	int32 GetHeight() const { return Height; }
+	bool IsInterlaced() const { return bInterlaced; }
+
+	/** TSF_G8, TSF_G16, TSF_BGRA8 or TSF_RGBA16, TSF_Invalid before ReadHeader succeeded */
+	ETextureSourceFormat GetTextureFormat() const { return TextureFormat; }
+
+	/** Size of the tightly packed decoded image */
+	int64 GetDecodedSize() const { return (int64)Width * Height * FTextureSource::GetBytesPerPixel(TextureFormat); }
+
+	/**
+	 * Decodes all rows into Dest as tightly packed scanlines, Dest has to hold GetDecodedSize() bytes. When
+	 * bFillZeroAlpha is set the zero alpha fill runs on every row right after it was decoded, while it is
+	 * still in cache. Interlaced images are filled as rows come out of the last pass.
+	 */
+	bool Decode(uint8* Dest, int64 DestSize, bool bFillZeroAlpha);
+
+	/**
+	 * Decodes into a single row buffer and box filters the rows down by Factor as they come out, Dest
+	 * holds the scaled image. Interlaced images can't be decoded a row at a time and fail here.
+	 */
+	bool DecodeDownsampled(int32 Factor, uint8* Dest, int64 DestSize);
+
+	/**
+	 * Decodes the rows down to the bottom of Region into a single row buffer and copies Region out of them,
+	 * Dest holds tightly packed rows of Region's width. Interlaced images fail here.
+	 */
+	bool DecodeRegion(const FIntRect& Region, uint8* Dest);
+
+private:
+	static void ReadCallback(struct png_struct_def* PngPtr, uint8* OutData, size_t Length);
+	static void ErrorCallback(struct png_struct_def* PngPtr, const char* Message);
+	static void WarningCallback(struct png_struct_def* PngPtr, const char* Message);
+
+	/**
+	 * Calls into libpng that can fail, each wrapped in its own setjmp. They touch nothing but members, so an error
+	 * never jumps over a destructor or a modified local of the decode loops.
+	 */
+	FORCENOINLINE bool TryReadInfo();
+	FORCENOINLINE bool TryUpdateInfo();
+	FORCENOINLINE bool TryReadRow(uint8* Row);
+
+	void SetupTransforms();
+
+	const uint8* Buffer;
+	int64 Length;
+	int64 ReadOffset = 0;
+
+	struct png_struct_def* PngPtr = nullptr;
+	struct png_info_def* InfoPtr = nullptr;
+
+	int32 Width = 0;
+	int32 Height = 0;
+	int32 BitDepth = 0;
+	int32 ColorType = 0;
+	int32 NumPasses = 1;
+	bool bInterlaced = false;
+	bool bHeaderRead = false;
+	ETextureSourceFormat TextureFormat = TSF_Invalid;
+
+	/** libpng reports errors by jumping back into the setjmp of the Try wrapper that called it */
+	jmp_buf SetjmpBuffer;
+};
@@ -22,6 +22,41 @@ ARTImageImportActor_Test::ARTImageImportActor_Test()
 }
 
 void ARTImageImportActor_Test::ImportTest(const FString Path)
+{
+	TArray<FString> SelectedFiles;
+	if(OpenImportFileDialog(SelectedFiles))
+	{
+		const FString FilePath = SelectedFiles[0];
+		UImageImporter* Importer = NewObject<UImageImporter>(this, UImageImporter::StaticClass(), NAME_None, RF_Transient);
+		if (Importer)
+			Importer->ImportFile(FilePath);
+	}
+}
+
+void ARTImageImportActor_Test::ImportTestAsync(const FString Path, FOnImageImported OnImported)
+{
+	TArray<FString> SelectedFiles;
+	if(OpenImportFileDialog(SelectedFiles))
+	{
+		const FString FilePath = SelectedFiles[0];
+		UImageImporter* Importer = NewObject<UImageImporter>(this, UImageImporter::StaticClass(), NAME_None, RF_Transient);
+		if (Importer)
+			Importer->ImportFileAsync(FilePath, OnImported);
+	}
+}
+
+void ARTImageImportActor_Test::ImportTestBatch(FOnImageBatchImported OnImported)
+{
+	TArray<FString> SelectedFiles;
+	if(OpenImportFileDialog(SelectedFiles))
+	{
+		UImageImporter* Importer = NewObject<UImageImporter>(this, UImageImporter::StaticClass(), NAME_None, RF_Transient);
+		if (Importer)
+			Importer->ImportFilesAsync(SelectedFiles, OnImported);
+	}
+}
+
+bool ARTImageImportActor_Test::OpenImportFileDialog(TArray<FString>& OutSelectedFiles) const
 {
 	FDesktopPlatformModule& DesktopModule = FModuleManager::LoadModuleChecked<FDesktopPlatformModule>("DesktopPlatform");
 	IDesktopPlatform* DesktopPlatform = FDesktopPlatformModule::Get();
@@ -31,7 +66,6 @@ void ARTImageImportActor_Test::ImportTest(const FString Path)
 	AllExtensions = "*.png";
 	FileTypes = FString::Printf(TEXT("All Files (%s)|%s|%s"), *AllExtensions, *AllExtensions, *FileTypes);
 
-	TArray<FString> SelectedFiles;
 	int32 FilterIndex = -1;
 	DesktopPlatform->OpenFileDialog(
 		ParentWindowWindowHandle,
@@ -40,36 +74,16 @@ void ARTImageImportActor_Test::ImportTest(const FString Path)
 		TEXT(""),
 		FileTypes,
 		EFileDialogFlags::Multiple,
-		SelectedFiles,
+		OutSelectedFiles,
 		FilterIndex
 	);
 
-	if(SelectedFiles.Num() > 0)
-	{
-		const FString FilePath = SelectedFiles[0];
-		UImageImporter* Importer = NewObject<UImageImporter>(this, UImageImporter::StaticClass(), NAME_None, RF_Transient);
-		if (Importer)
-			Importer->ImportFile(FilePath);
-	}
+	return OutSelectedFiles.Num() > 0;
 }
 
-UTexture2D* ARTImageImportActor_Test::TestLoadImage()
+void ARTImageImportActor_Test::TestLoadImage(FOnImageLoaded OnLoaded)
 {
-	USaveGame* GameSaver = UGameplayStatics::LoadGameFromSlot("TestSaveImage", 0);
-	UImageSaver* ImageSaver = Cast<UImageSaver>(GameSaver);
-	if(ImageSaver)
-	{
-		UTexture2D* Image = ImageSaver->SavedTexture2D;
-		if(Image)
-		{
-			const FName Name = Image->GetFName();
-			GEngine->AddOnScreenDebugMessage(-1, 10.f, FColor::Red, Name.ToString());
-			
-			return Image;
-		}
-	}
-
-	return nullptr;
+	UImageSaver::AsyncLoadTextureFromSlot("TestSaveImage", 0, OnLoaded);
 }
 
 void ARTImageImportActor_Test::CreateSaveGameObject()
@@ -1,17 +1,43 @@
 #include "RTImageImportModule.h"
 
+#include "ImageDecoderRegistry.h"
+#include "ImageImportStats.h"
+#include "ImageScratchBufferPool.h"
+#include "ImageTextureCache.h"
+#include "ImageTexturePool.h"
+#include "UObject/UObjectGlobals.h"
+
 
 #define LOCTEXT_NAMESPACE "FRTImageImportModule"
 
 void FRTImageImportModule::StartupModule()
 {
-
+	// Loads the image wrapper module, imports may start on any thread afterwards
+	FImageDecoderRegistry::Get();
+
+	// Live imported texture memory is only known once the GC destroyed the textures
+	PostGarbageCollectHandle = FCoreUObjectDelegates::GetPostGarbageCollect().AddLambda([]()
+	{
+		FImageImportStats::Get().PruneDestroyedTextures();
+	});
+
+	// Idle scratch buffers are freed even when no import comes along to notice
+	TrimTickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([](float DeltaTime)
+	{
+		FImageScratchBufferPool::Get().Trim();
+		return true;
+	}), 1.f);
 };
 
 
 void FRTImageImportModule::ShutdownModule()
 {
-
+	FCoreUObjectDelegates::GetPostGarbageCollect().Remove(PostGarbageCollectHandle);
+	FTSTicker::GetCoreTicker().RemoveTicker(TrimTickerHandle);
+	FImageScratchBufferPool::Get().Empty();
+	FImageTexturePool::Shutdown();
+	FImageTextureCache::Shutdown();
+	FImageDecoderRegistry::Shutdown();
 };
 
 
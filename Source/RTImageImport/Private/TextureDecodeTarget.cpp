@@ -0,0 +1,157 @@
+#include "TextureDecodeTarget.h"
+
+#include "ImageImportStats.h"
+#include "ImageTexturePool.h"
+#include "Async/Async.h"
+#include "Async/Future.h"
+#include "Engine/Texture2D.h"
+#include "HAL/IConsoleManager.h"
+
+
+static TAutoConsoleVariable<int32> CVarDecodeTargetMaxWaitMs(
+	TEXT("RTImageImport.DecodeTarget.MaxWaitMs"),
+	100,
+	TEXT("How long a worker waits for the game thread to create the texture it decodes into before it decodes into a buffer and copies."));
+
+FTextureDecodeTarget::FTextureDecodeTarget(UImageImporter* InImporter)
+	: Importer(InImporter)
+{
+}
+
+bool FTextureDecodeTarget::AllocateMips(const FImportedImageStruct& Image, TArray<uint8*>& OutMipData)
+{
+	const int32 SizeX = Image.SizeX;
+	const int32 SizeY = Image.SizeY;
+	const int32 NumMips = Image.NumMips;
+
+	// Images already in a GPU format (DDS) are copied as they are, the rest is decoded to the source format's match
+	const EPixelFormat PixelFormat = Image.PixelFormat != PF_Unknown ? Image.PixelFormat : UImageImporter::GetPixelFormatForSourceFormat(Image.Format);
+	const bool bSRGB = Image.SRGB;
+
+	if (IsInGameThread())
+	{
+		return CreateLockedTexture(SizeX, SizeY, NumMips, PixelFormat, bSRGB, OutMipData);
+	}
+
+	TPromise<TArray<uint8*>> Promise;
+	TFuture<TArray<uint8*>> Future = Promise.GetFuture();
+	AsyncTask(ENamedThreads::GameThread, [This = AsShared(), SizeX, SizeY, NumMips, PixelFormat, bSRGB, Promise = MoveTemp(Promise)]() mutable
+	{
+		// A worker that gave up decodes into RawData, a texture locked now would never be unlocked
+		FScopeLock Lock(&This->AllocateCritical);
+		TArray<uint8*> MipData;
+		if (!This->bAllocateAbandoned)
+		{
+			This->CreateLockedTexture(SizeX, SizeY, NumMips, PixelFormat, bSRGB, MipData);
+		}
+		Promise.SetValue(MoveTemp(MipData));
+	});
+
+	// The pool thread is only held for a bounded time, and the game thread won't get to the task anymore
+	// while the engine shuts down
+	const double Deadline = FPlatformTime::Seconds() + FMath::Max(CVarDecodeTargetMaxWaitMs.GetValueOnAnyThread(), 0) / 1000.0;
+	while (!Future.IsReady() && !IsEngineExitRequested())
+	{
+		const double Remaining = Deadline - FPlatformTime::Seconds();
+		if (Remaining <= 0.0)
+		{
+			break;
+		}
+		Future.WaitFor(FTimespan::FromSeconds(FMath::Min(Remaining, 0.1)));
+	}
+
+	// The task may be creating the texture right now, the lock decides whether it counts
+	FScopeLock Lock(&AllocateCritical);
+	if (!Future.IsReady())
+	{
+		bAllocateAbandoned = true;
+		return false;
+	}
+
+	OutMipData = Future.Get();
+	return OutMipData.Num() > 0;
+}
+
+bool FTextureDecodeTarget::CreateLockedTexture(int32 SizeX, int32 SizeY, int32 NumMips, EPixelFormat PixelFormat, bool bSRGB, TArray<uint8*>& OutMipData)
+{
+	check(IsInGameThread());
+	check(!Texture);
+
+	// Formats the RHI can't hold natively need a conversion from RawData
+	if (PixelFormat == PF_Unknown || !GPixelFormats[PixelFormat].Supported)
+	{
+		return false;
+	}
+
+	// A pooled texture can't be decoded into without recreating its resource, decode into RawData and refill it
+	FImageTexturePoolKey PoolKey;
+	PoolKey.SizeX = SizeX;
+	PoolKey.SizeY = SizeY;
+	PoolKey.NumMips = NumMips;
+	PoolKey.PixelFormat = PixelFormat;
+	PoolKey.bSRGB = bSRGB;
+	if (FImageTexturePool::Get().HasFreeTexture(PoolKey))
+	{
+		return false;
+	}
+
+	UTexture2D* NewTexture = UImageImporter::CreateTransientTexture(SizeX, SizeY, NumMips, PixelFormat);
+	if (!NewTexture)
+	{
+		return false;
+	}
+
+	// Keep the texture referenced while it is being decoded into
+	Texture = NewTexture;
+	Importer->PendingTextures.Add(Texture);
+
+	for (FTexture2DMipMap& Mip : Texture->GetPlatformData()->Mips)
+	{
+		OutMipData.Add(static_cast<uint8*>(Mip.BulkData.Lock(EBulkDataLockFlags::LOCK_READ_WRITE)));
+	}
+	return true;
+}
+
+void FTextureDecodeTarget::UnlockMips()
+{
+	for (FTexture2DMipMap& Mip : Texture->GetPlatformData()->Mips)
+	{
+		Mip.BulkData.Unlock();
+	}
+}
+
+UTexture2D* FTextureDecodeTarget::FinishTexture(const FImportedImageStruct& Image, bool bDecoded)
+{
+	check(IsInGameThread());
+
+	if (!Texture)
+	{
+		return bDecoded ? Importer->CreateTextureFromImage(Image) : nullptr;
+	}
+
+	UnlockMips();
+
+	UTexture2D* DecodedTexture = Texture;
+	Texture = nullptr;
+	Importer->PendingTextures.RemoveSingleSwap(DecodedTexture);
+
+	if (!bDecoded)
+	{
+		return nullptr;
+	}
+
+	if (!Image.IsRawDataInTarget())
+	{
+		// The decoder couldn't write into the mips, the texture is left to the GC
+		return Importer->CreateTextureFromImage(Image);
+	}
+
+	DecodedTexture->CompressionSettings = Image.CompressionSettings;
+
+	// Has to be set before the resource is created, the RHI texture is created sRGB or not
+	DecodedTexture->SRGB = Image.SRGB;
+
+	DecodedTexture->UpdateResource();
+	FImageImportStats::Get().AddUploadedTexture(DecodedTexture);
+	return DecodedTexture;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ImageImporter.h"
+
+/**
+ * Decode target that creates the transient texture as soon as the header is known and hands out its
+ * locked mips, so decoders write straight into the texture's bulk data. When called from a worker
+ * thread the texture is created on the game thread while the worker waits, for at most
+ * RTImageImport.DecodeTarget.MaxWaitMs. Past that, or once the engine is exiting, the request is
+ * abandoned and the image is decoded into RawData instead.
+ */
+class FTextureDecodeTarget : public FImageDecodeTarget, public TSharedFromThis<FTextureDecodeTarget, ESPMode::ThreadSafe>
+{
+public:
+	explicit FTextureDecodeTarget(UImageImporter* InImporter);
+
+	virtual bool AllocateMips(const FImportedImageStruct& Image, TArray<uint8*>& OutMipData) override;
+
+	/**
+	 * Unlocks and uploads the texture the image was decoded into, or creates one from RawData when the
+	 * decoder didn't use the target. Game thread only.
+	 */
+	UTexture2D* FinishTexture(const FImportedImageStruct& Image, bool bDecoded);
+
+private:
+	bool CreateLockedTexture(int32 SizeX, int32 SizeY, int32 NumMips, EPixelFormat PixelFormat, bool bSRGB, TArray<uint8*>& OutMipData);
+
+	void UnlockMips();
+
+	UImageImporter* Importer;
+	UTexture2D* Texture = nullptr;
+
+	/** Orders the game thread's texture creation against the worker giving up on it */
+	FCriticalSection AllocateCritical;
+	bool bAllocateAbandoned = false;
+};
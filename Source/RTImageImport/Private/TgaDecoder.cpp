@@ -0,0 +1,263 @@
+#include "TgaDecoder.h"
+
+#include "ImageImporter.h"
+#include "ImagePixelExpansion.h"
+#include "TgaImageSupport.h"
+#include "Algo/Reverse.h"
+
+
+namespace
+{
+	enum ETgaImageType : uint8
+	{
+		TgaColorMapped = 1,
+		TgaTrueColor = 2,
+		TgaGrayscale = 3,
+		TgaRLEColorMapped = 9,
+		TgaRLETrueColor = 10,
+		TgaRLEGrayscale = 11,
+	};
+
+	bool IsSupportedColorBits(int32 Bits)
+	{
+		return Bits == 15 || Bits == 16 || Bits == 24 || Bits == 32;
+	}
+}
+
+FTgaDecoder::FTgaDecoder(const uint8* InBuffer, int64 InLength)
+	: Buffer(InBuffer)
+	, Length(InLength)
+{
+}
+
+bool FTgaDecoder::ReadHeader()
+{
+	if (bHeaderRead || Length < (int64)sizeof(FTGAFileHeader))
+	{
+		return bHeaderRead;
+	}
+
+	FTGAFileHeader Header;
+	FMemory::Memcpy(&Header, Buffer, sizeof(Header));
+
+	const uint8 ImageType = Header.ImageTypeCode;
+	bColorMapped = ImageType == TgaColorMapped || ImageType == TgaRLEColorMapped;
+	const bool bGrayscale = ImageType == TgaGrayscale || ImageType == TgaRLEGrayscale;
+	const bool bTrueColor = ImageType == TgaTrueColor || ImageType == TgaRLETrueColor;
+	bRLE = ImageType >= TgaRLEColorMapped;
+
+	// Interleaved row orders (descriptor bits 6 and 7) were never written by anything still in use
+	if ((!bColorMapped && !bGrayscale && !bTrueColor) || Header.ColorMapType > 1 || (Header.ImageDescriptor & 0xc0) != 0
+		|| Header.Width == 0 || Header.Height == 0)
+	{
+		return false;
+	}
+
+	if ((bColorMapped && (Header.ColorMapType != 1 || Header.BitsPerPixel != 8 || !IsSupportedColorBits(Header.ColorMapEntrySize)))
+		|| (bGrayscale && Header.BitsPerPixel != 8)
+		|| (bTrueColor && !IsSupportedColorBits(Header.BitsPerPixel)))
+	{
+		return false;
+	}
+
+	// True color images may still carry a color map, it is skipped
+	const int32 ColorMapEntryBytes = (Header.ColorMapEntrySize + 7) / 8;
+	const int64 ColorMapOffset = (int64)sizeof(FTGAFileHeader) + Header.IdFieldLength;
+	const int64 ColorMapSize = Header.ColorMapType == 1 ? (int64)Header.ColorMapLength * ColorMapEntryBytes : 0;
+
+	Width = Header.Width;
+	Height = Header.Height;
+	SrcBitsPerPixel = Header.BitsPerPixel;
+	SrcBytesPerPixel = (Header.BitsPerPixel + 7) / 8;
+	DataOffset = ColorMapOffset + ColorMapSize;
+	bTopDown = (Header.ImageDescriptor & 0x20) != 0;
+	bRightToLeft = (Header.ImageDescriptor & 0x10) != 0;
+
+	if (DataOffset > Length || (!bRLE && DataOffset + (int64)Width * Height * SrcBytesPerPixel > Length))
+	{
+		return false;
+	}
+
+	if (bColorMapped)
+	{
+		// Indices outside the map are opaque black
+		for (uint32& Entry : Palette)
+		{
+			Entry = 0xff000000u;
+		}
+
+		const uint8* ColorMap = Buffer + ColorMapOffset;
+		const int32 NumEntries = FMath::Clamp(256 - int32(Header.ColorMapOrigin), 0, int32(Header.ColorMapLength));
+		uint32* FirstEntry = Palette + FMath::Min<int32>(Header.ColorMapOrigin, 256);
+		switch (Header.ColorMapEntrySize)
+		{
+		case 15:
+		case 16:	ExpandBGR555ToBGRA8(ColorMap, FirstEntry, NumEntries); break;
+		case 24:	ExpandBGR8ToBGRA8(ColorMap, FirstEntry, NumEntries); break;
+		default:	FMemory::Memcpy(FirstEntry, ColorMap, NumEntries * sizeof(uint32)); break;
+		}
+	}
+
+	TextureFormat = bGrayscale ? TSF_G8 : TSF_BGRA8;
+	DestBytesPerPixel = FTextureSource::GetBytesPerPixel(TextureFormat);
+	bHeaderRead = true;
+	return true;
+}
+
+bool FTgaDecoder::Decode(uint8* Dest, int64 DestSize)
+{
+	if (!bHeaderRead || DestSize < (int64)Width * Height * DestBytesPerPixel)
+	{
+		return false;
+	}
+
+	if (bRLE)
+	{
+		if (!DecodeRLE(Dest))
+		{
+			UE_LOG(ImageImporter, Error, TEXT("TGA RLE data is truncated or corrupt"));
+			return false;
+		}
+	}
+	else
+	{
+		DecodeUncompressed(Dest);
+	}
+
+	if (bRightToLeft)
+	{
+		FlipRowsHorizontally(Dest);
+	}
+	return true;
+}
+
+void FTgaDecoder::ConvertPixels(const uint8* Src, uint8* Dest, int32 Count) const
+{
+	if (TextureFormat == TSF_G8)
+	{
+		FMemory::Memcpy(Dest, Src, Count);
+	}
+	else if (bColorMapped)
+	{
+		ExpandPaletteIndices(Src, Palette, reinterpret_cast<uint32*>(Dest), Count);
+	}
+	else if (SrcBitsPerPixel == 24)
+	{
+		ExpandBGR8ToBGRA8(Src, reinterpret_cast<uint32*>(Dest), Count);
+	}
+	else if (SrcBitsPerPixel == 32)
+	{
+		FMemory::Memcpy(Dest, Src, (int64)Count * 4);
+	}
+	else
+	{
+		// The attribute bit of 16 bit pixels is left unset by most writers, they are treated as opaque
+		ExpandBGR555ToBGRA8(Src, reinterpret_cast<uint32*>(Dest), Count);
+	}
+}
+
+uint8* FTgaDecoder::GetDestRow(uint8* Dest, int32 Y) const
+{
+	return Dest + (int64)(bTopDown ? Y : Height - 1 - Y) * Width * DestBytesPerPixel;
+}
+
+bool FTgaDecoder::DecodeRLE(uint8* Dest) const
+{
+	int64 Offset = DataOffset;
+	int32 X = 0;
+	int32 Y = 0;
+	uint8* Row = GetDestRow(Dest, 0);
+
+	// Packets are allowed to run across rows
+	while (Y < Height)
+	{
+		if (Offset >= Length)
+		{
+			return false;
+		}
+
+		const uint8 Packet = Buffer[Offset++];
+		const bool bRun = (Packet & 0x80) != 0;
+		int32 Count = (Packet & 0x7f) + 1;
+
+		uint8 RunPixel[4] = {};
+		if (bRun)
+		{
+			if (Offset + SrcBytesPerPixel > Length)
+			{
+				return false;
+			}
+			ConvertPixels(Buffer + Offset, RunPixel, 1);
+			Offset += SrcBytesPerPixel;
+		}
+		else if (Offset + (int64)Count * SrcBytesPerPixel > Length)
+		{
+			return false;
+		}
+
+		while (Count > 0 && Y < Height)
+		{
+			const int32 Span = FMath::Min(Count, Width - X);
+			uint8* DestPixels = Row + (int64)X * DestBytesPerPixel;
+
+			if (!bRun)
+			{
+				ConvertPixels(Buffer + Offset, DestPixels, Span);
+				Offset += (int64)Span * SrcBytesPerPixel;
+			}
+			else if (TextureFormat == TSF_G8)
+			{
+				FMemory::Memset(DestPixels, RunPixel[0], Span);
+			}
+			else
+			{
+				uint32 RunValue;
+				FMemory::Memcpy(&RunValue, RunPixel, sizeof(RunValue));
+				FillPixelsBGRA8(reinterpret_cast<uint32*>(DestPixels), RunValue, Span);
+			}
+
+			Count -= Span;
+			X += Span;
+			if (X == Width)
+			{
+				X = 0;
+				if (++Y < Height)
+				{
+					Row = GetDestRow(Dest, Y);
+				}
+			}
+		}
+	}
+	return true;
+}
+
+void FTgaDecoder::DecodeUncompressed(uint8* Dest) const
+{
+	const int64 SrcRowBytes = (int64)Width * SrcBytesPerPixel;
+	ParallelForRowBands(Width, Height, [this, Dest, SrcRowBytes](int32 StartY, int32 EndY)
+	{
+		for (int32 Y = StartY; Y < EndY; ++Y)
+		{
+			ConvertPixels(Buffer + DataOffset + Y * SrcRowBytes, GetDestRow(Dest, Y), Width);
+		}
+	});
+}
+
+void FTgaDecoder::FlipRowsHorizontally(uint8* Dest) const
+{
+	ParallelForRowBands(Width, Height, [this, Dest](int32 StartY, int32 EndY)
+	{
+		for (int32 Y = StartY; Y < EndY; ++Y)
+		{
+			uint8* Row = Dest + (int64)Y * Width * DestBytesPerPixel;
+			if (TextureFormat == TSF_G8)
+			{
+				Algo::Reverse(Row, Width);
+			}
+			else
+			{
+				Algo::Reverse(reinterpret_cast<uint32*>(Row), Width);
+			}
+		}
+	});
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/Texture.h"
+
+/**
+ * Decodes uncompressed and RLE TGAs (color mapped, true color and grayscale) straight into a destination
+ * owned by the caller. Every read of the file data is bounds checked, truncated or malformed files fail
+ * instead of reading past the buffer. Uncompressed images are converted in parallel row bands.
+ */
+class FTgaDecoder
+{
+public:
+	FTgaDecoder(const uint8* InBuffer, int64 InLength);
+
+	/**
+	 * Parses and validates the header. TGAs have no magic bytes, a header that is consistent and whose data
+	 * fits the buffer is what identifies one.
+	 */
+	bool ReadHeader();
+
+	int32 GetWidth() const { return Width; }
+	int32 GetHeight() const { return Height; }
+
+	/** TSF_G8 for grayscale images, TSF_BGRA8 for the rest, TSF_Invalid before ReadHeader succeeded */
+	ETextureSourceFormat GetTextureFormat() const { return TextureFormat; }
+
+	/** Grayscale TGAs are mostly masks, they are imported linear and without color compression */
+	bool IsSRGB() const { return TextureFormat != TSF_G8; }
+	TextureCompressionSettings GetCompressionSettings() const { return TextureFormat == TSF_G8 ? TC_Grayscale : TC_Default; }
+
+	/** Decodes into Dest as tightly packed top down rows, Dest has to hold Width x Height pixels */
+	bool Decode(uint8* Dest, int64 DestSize);
+
+private:
+	/** Converts Count pixels from the file's layout to the texture format */
+	void ConvertPixels(const uint8* Src, uint8* Dest, int32 Count) const;
+
+	/** Destination row of the Y-th row stored in the file */
+	uint8* GetDestRow(uint8* Dest, int32 Y) const;
+
+	bool DecodeRLE(uint8* Dest) const;
+	void DecodeUncompressed(uint8* Dest) const;
+	void FlipRowsHorizontally(uint8* Dest) const;
+
+	const uint8* Buffer;
+	int64 Length;
+	int64 DataOffset = 0;
+
+	int32 Width = 0;
+	int32 Height = 0;
+	int32 SrcBitsPerPixel = 0;
+	int32 SrcBytesPerPixel = 0;
+	int32 DestBytesPerPixel = 0;
+	bool bColorMapped = false;
+	bool bRLE = false;
+	bool bTopDown = false;
+	bool bRightToLeft = false;
+	bool bHeaderRead = false;
+	ETextureSourceFormat TextureFormat = TSF_Invalid;
+
+	uint32 Palette[256];
+};
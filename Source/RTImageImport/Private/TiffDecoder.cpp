@@ -0,0 +1,456 @@
+#include "TiffDecoder.h"
+
+#if RTIMAGEIMPORT_WITH_LIBTIFF
+
+#include "ImageImporter.h"
+#include "Async/ParallelFor.h"
+
+#include <atomic>
+
+THIRD_PARTY_INCLUDES_START
+#include "tiffio.h"
+THIRD_PARTY_INCLUDES_END
+
+
+/** Read position of one libtiff handle in the shared file data */
+struct FTiffMemoryReader
+{
+	const uint8* Buffer = nullptr;
+	int64 Length = 0;
+	int64 Position = 0;
+
+	static tmsize_t Read(thandle_t Handle, void* Data, tmsize_t Size)
+	{
+		FTiffMemoryReader* Reader = static_cast<FTiffMemoryReader*>(Handle);
+		if (Reader->Position < 0)
+		{
+			return 0;
+		}
+
+		const int64 BytesToRead = FMath::Clamp<int64>(Reader->Length - Reader->Position, 0, Size);
+		FMemory::Memcpy(Data, Reader->Buffer + Reader->Position, BytesToRead);
+		Reader->Position += BytesToRead;
+		return tmsize_t(BytesToRead);
+	}
+
+	static tmsize_t Write(thandle_t Handle, void* Data, tmsize_t Size)
+	{
+		return 0;
+	}
+
+	static toff_t Seek(thandle_t Handle, toff_t Offset, int Whence)
+	{
+		FTiffMemoryReader* Reader = static_cast<FTiffMemoryReader*>(Handle);
+		switch (Whence)
+		{
+		case SEEK_SET:	Reader->Position = int64(Offset); break;
+		case SEEK_CUR:	Reader->Position += int64(Offset); break;
+		case SEEK_END:	Reader->Position = Reader->Length + int64(Offset); break;
+		default:		break;
+		}
+		return toff_t(Reader->Position);
+	}
+
+	static int Close(thandle_t Handle)
+	{
+		return 0;
+	}
+
+	static toff_t Size(thandle_t Handle)
+	{
+		return toff_t(static_cast<FTiffMemoryReader*>(Handle)->Length);
+	}
+
+	/** The file is already in memory, uncompressed chunks are read from it without a copy */
+	static int Map(thandle_t Handle, void** Base, toff_t* Size)
+	{
+		FTiffMemoryReader* Reader = static_cast<FTiffMemoryReader*>(Handle);
+		*Base = const_cast<uint8*>(Reader->Buffer);
+		*Size = toff_t(Reader->Length);
+		return 1;
+	}
+
+	static void Unmap(thandle_t Handle, void* Base, toff_t Size)
+	{
+	}
+};
+
+namespace
+{
+	/** Below this many pixels one handle decodes everything, opening more would cost more than it saves */
+	constexpr int64 MinPixelsForParallelDecode = 512 * 512;
+
+	/**
+	 * Expands gray, gray alpha, RGB or RGBA samples to four channels, RedIndex and BlueIndex pick RGBA or BGRA
+	 * order. Missing alpha is Opaque.
+	 */
+	template<typename SampleType>
+	void ExpandSamples(const SampleType* Src, SampleType* Dest, int32 NumSamples, int32 RedIndex, int32 BlueIndex, SampleType Opaque, int32 Count)
+	{
+		for (int32 X = 0; X < Count; ++X)
+		{
+			const SampleType* In = Src + X * NumSamples;
+			SampleType* Out = Dest + X * 4;
+			if (NumSamples < 3)
+			{
+				Out[0] = Out[1] = Out[2] = In[0];
+				Out[3] = NumSamples == 2 ? In[1] : Opaque;
+			}
+			else
+			{
+				Out[RedIndex] = In[0];
+				Out[1] = In[1];
+				Out[BlueIndex] = In[2];
+				Out[3] = NumSamples == 4 ? In[3] : Opaque;
+			}
+		}
+	}
+}
+
+FTiffDecoder::FTiffDecoder(const uint8* InBuffer, int64 InLength)
+	: Buffer(InBuffer)
+	, Length(InLength)
+{
+}
+
+FTiffDecoder::~FTiffDecoder()
+{
+	if (Tiff)
+	{
+		TIFFClose(Tiff);
+	}
+	delete HeaderReader;
+}
+
+TIFF* FTiffDecoder::OpenTiff(FTiffMemoryReader& Reader) const
+{
+	Reader.Buffer = Buffer;
+	Reader.Length = Length;
+	Reader.Position = 0;
+
+	return TIFFClientOpen("RTImageImport", "r", static_cast<thandle_t>(&Reader),
+		&FTiffMemoryReader::Read, &FTiffMemoryReader::Write, &FTiffMemoryReader::Seek, &FTiffMemoryReader::Close,
+		&FTiffMemoryReader::Size, &FTiffMemoryReader::Map, &FTiffMemoryReader::Unmap);
+}
+
+bool FTiffDecoder::ReadHeader()
+{
+	// Little and big endian classic TIFF and BigTIFF
+	const bool bHasMagic = Length >= 8
+		&& ((Buffer[0] == 'I' && Buffer[1] == 'I' && (Buffer[2] == 42 || Buffer[2] == 43) && Buffer[3] == 0)
+			|| (Buffer[0] == 'M' && Buffer[1] == 'M' && Buffer[2] == 0 && (Buffer[3] == 42 || Buffer[3] == 43)));
+	if (HeaderReader || !bHasMagic)
+	{
+		return TextureFormat != TSF_Invalid;
+	}
+
+	HeaderReader = new FTiffMemoryReader();
+	Tiff = OpenTiff(*HeaderReader);
+	if (!Tiff)
+	{
+		return false;
+	}
+
+	uint32 TiffWidth = 0;
+	uint32 TiffHeight = 0;
+	uint16 Photometric = 0;
+	uint16 SamplesPerPixel = 1;
+	uint16 TiffBitsPerSample = 1;
+	uint16 SampleFormat = SAMPLEFORMAT_UINT;
+	uint16 PlanarConfig = PLANARCONFIG_CONTIG;
+	if (!TIFFGetField(Tiff, TIFFTAG_IMAGEWIDTH, &TiffWidth)
+		|| !TIFFGetField(Tiff, TIFFTAG_IMAGELENGTH, &TiffHeight)
+		|| !TIFFGetField(Tiff, TIFFTAG_PHOTOMETRIC, &Photometric))
+	{
+		return false;
+	}
+	TIFFGetFieldDefaulted(Tiff, TIFFTAG_SAMPLESPERPIXEL, &SamplesPerPixel);
+	TIFFGetFieldDefaulted(Tiff, TIFFTAG_BITSPERSAMPLE, &TiffBitsPerSample);
+	TIFFGetFieldDefaulted(Tiff, TIFFTAG_SAMPLEFORMAT, &SampleFormat);
+	TIFFGetFieldDefaulted(Tiff, TIFFTAG_PLANARCONFIG, &PlanarConfig);
+
+	if (TiffWidth == 0 || TiffHeight == 0 || TiffWidth > (uint32)MAX_int32 || TiffHeight > (uint32)MAX_int32)
+	{
+		return false;
+	}
+
+	Width = int32(TiffWidth);
+	Height = int32(TiffHeight);
+	NumSamples = SamplesPerPixel;
+	BitsPerSample = TiffBitsPerSample;
+	bFloat = SampleFormat == SAMPLEFORMAT_IEEEFP;
+
+	// Palettized, CMYK, YCbCr, inverted gray and planar files are left to the image wrapper
+	const bool bGray = Photometric == PHOTOMETRIC_MINISBLACK && (NumSamples == 1 || NumSamples == 2);
+	const bool bRGB = Photometric == PHOTOMETRIC_RGB && (NumSamples == 3 || NumSamples == 4);
+	if ((!bGray && !bRGB) || (NumSamples > 1 && PlanarConfig != PLANARCONFIG_CONTIG))
+	{
+		return false;
+	}
+
+	ETextureSourceFormat Format = TSF_Invalid;
+	if (bFloat && (BitsPerSample == 16 || BitsPerSample == 32))
+	{
+		Format = TSF_RGBA16F;
+	}
+	else if (SampleFormat == SAMPLEFORMAT_UINT && BitsPerSample == 8)
+	{
+		Format = NumSamples == 1 ? TSF_G8 : TSF_BGRA8;
+	}
+	else if (SampleFormat == SAMPLEFORMAT_UINT && BitsPerSample == 16)
+	{
+		Format = NumSamples == 1 ? TSF_G16 : TSF_RGBA16;
+	}
+	else
+	{
+		return false;
+	}
+
+	bTiled = TIFFIsTiled(Tiff) != 0;
+	if (bTiled)
+	{
+		uint32 TileWidth = 0;
+		uint32 TileHeight = 0;
+		if (!TIFFGetField(Tiff, TIFFTAG_TILEWIDTH, &TileWidth) || !TIFFGetField(Tiff, TIFFTAG_TILELENGTH, &TileHeight)
+			|| TileWidth == 0 || TileHeight == 0 || TileWidth > (uint32)MAX_int32 || TileHeight > (uint32)MAX_int32)
+		{
+			return false;
+		}
+
+		ChunkWidth = int32(TileWidth);
+		ChunkHeight = int32(TileHeight);
+		NumChunks = int32(TIFFNumberOfTiles(Tiff));
+		ChunkSize = int64(TIFFTileSize64(Tiff));
+		ChunkRowSize = int64(TIFFTileRowSize64(Tiff));
+	}
+	else
+	{
+		uint32 RowsPerStrip = 0;
+		TIFFGetFieldDefaulted(Tiff, TIFFTAG_ROWSPERSTRIP, &RowsPerStrip);
+
+		ChunkWidth = Width;
+		ChunkHeight = int32(FMath::Clamp<uint32>(RowsPerStrip, 1, TiffHeight));
+		NumChunks = int32(TIFFNumberOfStrips(Tiff));
+		ChunkSize = int64(TIFFStripSize64(Tiff));
+		ChunkRowSize = int64(TIFFScanlineSize64(Tiff));
+	}
+
+	const int64 PixelSize = (int64)NumSamples * BitsPerSample / 8;
+	if (NumChunks <= 0 || ChunkSize <= 0 || ChunkRowSize < ChunkWidth * PixelSize || ChunkSize < ChunkRowSize * ChunkHeight)
+	{
+		return false;
+	}
+
+	TextureFormat = Format;
+	return true;
+}
+
+TextureCompressionSettings FTiffDecoder::GetCompressionSettings() const
+{
+	switch (TextureFormat)
+	{
+	case TSF_RGBA16F:	return TC_HDR;
+	case TSF_G8:
+	case TSF_G16:		return TC_Grayscale;
+	default:			return TC_Default;
+	}
+}
+
+bool FTiffDecoder::Decode(uint8* Dest, int64 DestSize)
+{
+	if (TextureFormat == TSF_Invalid || DestSize < (int64)Width * Height * FTextureSource::GetBytesPerPixel(TextureFormat))
+	{
+		return false;
+	}
+
+	const int32 NumWorkers = FTaskGraphInterface::Get().GetNumWorkerThreads() + 1;
+	const int32 NumTasks = (int64)Width * Height < MinPixelsForParallelDecode ? 1 : FMath::Min(NumChunks, NumWorkers);
+	if (NumTasks == 1)
+	{
+		TArray64<uint8> ChunkBuffer;
+		return DecodeChunks(Tiff, 0, NumChunks, Dest, ChunkBuffer);
+	}
+
+	// Each task takes a contiguous range of chunks so that its reads through the file stay sequential
+	const int32 ChunksPerTask = FMath::DivideAndRoundUp(NumChunks, NumTasks);
+	std::atomic<bool> bFailed{false};
+	ParallelFor(NumTasks, [this, ChunksPerTask, Dest, &bFailed](int32 TaskIndex)
+	{
+		const int32 StartChunk = TaskIndex * ChunksPerTask;
+		const int32 EndChunk = FMath::Min(StartChunk + ChunksPerTask, NumChunks);
+		if (StartChunk >= EndChunk)
+		{
+			return;
+		}
+
+		// libtiff handles keep per chunk codec state and can't be shared between threads
+		FTiffMemoryReader Reader;
+		TIFF* TaskTiff = OpenTiff(Reader);
+		if (!TaskTiff)
+		{
+			bFailed = true;
+			return;
+		}
+
+		TArray64<uint8> ChunkBuffer;
+		if (!DecodeChunks(TaskTiff, StartChunk, EndChunk, Dest, ChunkBuffer))
+		{
+			bFailed = true;
+		}
+		TIFFClose(TaskTiff);
+	});
+
+	return !bFailed;
+}
+
+bool FTiffDecoder::DecodeChunks(TIFF* Handle, int32 StartChunk, int32 EndChunk, uint8* Dest, TArray64<uint8>& ChunkBuffer) const
+{
+	ChunkBuffer.SetNumUninitialized(ChunkSize);
+
+	const int64 DestPixelSize = FTextureSource::GetBytesPerPixel(TextureFormat);
+	const int32 ChunksAcross = FMath::DivideAndRoundUp(Width, ChunkWidth);
+
+	for (int32 Chunk = StartChunk; Chunk < EndChunk; ++Chunk)
+	{
+		const int64 BytesRead = ReadChunk(Handle, Chunk, ChunkBuffer);
+		if (BytesRead < 0)
+		{
+			return false;
+		}
+
+		// Tiles along the right and bottom edge and the last strip reach past the image
+		const int32 StartX = (Chunk % ChunksAcross) * ChunkWidth;
+		const int32 StartY = (Chunk / ChunksAcross) * ChunkHeight;
+		if (StartY >= Height)
+		{
+			continue;
+		}
+
+		const int32 NumPixels = FMath::Min(ChunkWidth, Width - StartX);
+		const int32 NumRows = FMath::Min<int32>(FMath::Min(ChunkHeight, Height - StartY), int32(BytesRead / ChunkRowSize));
+		for (int32 Row = 0; Row < NumRows; ++Row)
+		{
+			uint8* DestRow = Dest + ((int64)(StartY + Row) * Width + StartX) * DestPixelSize;
+			ConvertPixels(ChunkBuffer.GetData() + Row * ChunkRowSize, DestRow, NumPixels);
+		}
+	}
+	return true;
+}
+
+bool FTiffDecoder::DecodeRegion(const FIntRect& Region, uint8* Dest) const
+{
+	if (TextureFormat == TSF_Invalid || !Dest || Region.Min.X < 0 || Region.Min.Y < 0 || Region.Max.X > Width || Region.Max.Y > Height || Region.Width() <= 0 || Region.Height() <= 0)
+	{
+		return false;
+	}
+
+	FTiffMemoryReader Reader;
+	TIFF* Handle = OpenTiff(Reader);
+	if (!Handle)
+	{
+		return false;
+	}
+
+	TArray64<uint8> ChunkBuffer;
+	ChunkBuffer.SetNumUninitialized(ChunkSize);
+
+	const int64 SrcPixelSize = (int64)NumSamples * BitsPerSample / 8;
+	const int64 DestPixelSize = FTextureSource::GetBytesPerPixel(TextureFormat);
+	const int32 ChunksAcross = FMath::DivideAndRoundUp(Width, ChunkWidth);
+
+	// Strips span the whole width, so for them only the row of chunks varies
+	bool bDecoded = true;
+	for (int32 ChunkY = Region.Min.Y / ChunkHeight; bDecoded && ChunkY * ChunkHeight < Region.Max.Y; ++ChunkY)
+	{
+		for (int32 ChunkX = Region.Min.X / ChunkWidth; ChunkX * ChunkWidth < Region.Max.X; ++ChunkX)
+		{
+			const int64 BytesRead = ReadChunk(Handle, ChunkY * ChunksAcross + ChunkX, ChunkBuffer);
+			if (BytesRead < 0)
+			{
+				bDecoded = false;
+				break;
+			}
+
+			const int32 ChunkStartX = ChunkX * ChunkWidth;
+			const int32 ChunkStartY = ChunkY * ChunkHeight;
+			const int32 StartX = FMath::Max(Region.Min.X, ChunkStartX);
+			const int32 EndX = FMath::Min(Region.Max.X, ChunkStartX + ChunkWidth);
+			const int32 StartY = FMath::Max(Region.Min.Y, ChunkStartY);
+			const int32 EndY = FMath::Min3(Region.Max.Y, ChunkStartY + ChunkHeight, ChunkStartY + int32(BytesRead / ChunkRowSize));
+
+			for (int32 Y = StartY; Y < EndY; ++Y)
+			{
+				const uint8* SrcRow = ChunkBuffer.GetData() + (Y - ChunkStartY) * ChunkRowSize + (StartX - ChunkStartX) * SrcPixelSize;
+				uint8* DestRow = Dest + ((int64)(Y - Region.Min.Y) * Region.Width() + (StartX - Region.Min.X)) * DestPixelSize;
+				ConvertPixels(SrcRow, DestRow, EndX - StartX);
+			}
+		}
+	}
+
+	TIFFClose(Handle);
+	return bDecoded;
+}
+
+int64 FTiffDecoder::ReadChunk(TIFF* Handle, int32 Chunk, TArray64<uint8>& ChunkBuffer) const
+{
+	const tmsize_t BytesRead = bTiled
+		? TIFFReadEncodedTile(Handle, uint32(Chunk), ChunkBuffer.GetData(), tmsize_t(ChunkSize))
+		: TIFFReadEncodedStrip(Handle, uint32(Chunk), ChunkBuffer.GetData(), tmsize_t(ChunkSize));
+	if (BytesRead < 0)
+	{
+		UE_LOG(ImageImporter, Error, TEXT("Failed to decode TIFF %s %d of %d"), bTiled ? TEXT("tile") : TEXT("strip"), Chunk, NumChunks);
+	}
+	return int64(BytesRead);
+}
+
+void FTiffDecoder::ConvertPixels(const uint8* Src, uint8* Dest, int32 Count) const
+{
+	switch (TextureFormat)
+	{
+	case TSF_G8:
+	case TSF_G16:
+		FMemory::Memcpy(Dest, Src, (int64)Count * FTextureSource::GetBytesPerPixel(TextureFormat));
+		break;
+
+	case TSF_BGRA8:
+		ExpandSamples<uint8>(Src, Dest, NumSamples, 2, 0, MAX_uint8, Count);
+		break;
+
+	case TSF_RGBA16:
+		if (NumSamples == 4)
+		{
+			FMemory::Memcpy(Dest, Src, (int64)Count * 8);
+		}
+		else
+		{
+			ExpandSamples<uint16>(reinterpret_cast<const uint16*>(Src), reinterpret_cast<uint16*>(Dest), NumSamples, 0, 2, MAX_uint16, Count);
+		}
+		break;
+
+	case TSF_RGBA16F:
+		if (BitsPerSample == 16)
+		{
+			ExpandSamples<uint16>(reinterpret_cast<const uint16*>(Src), reinterpret_cast<uint16*>(Dest), NumSamples, 0, 2, FFloat16(1.0f).Encoded, Count);
+		}
+		else
+		{
+			const float* In = reinterpret_cast<const float*>(Src);
+			FFloat16* Out = reinterpret_cast<FFloat16*>(Dest);
+			for (int32 X = 0; X < Count; ++X, In += NumSamples, Out += 4)
+			{
+				const float Gray = In[0];
+				Out[0] = Gray;
+				Out[1] = NumSamples < 3 ? Gray : In[1];
+				Out[2] = NumSamples < 3 ? Gray : In[2];
+				Out[3] = NumSamples == 2 ? In[1] : NumSamples == 4 ? In[3] : 1.0f;
+			}
+		}
+		break;
+
+	default:
+		checkNoEntry();
+		break;
+	}
+}
+
+#endif
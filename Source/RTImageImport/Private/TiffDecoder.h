@@ -0,0 +1,85 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/Texture.h"
+
+#if RTIMAGEIMPORT_WITH_LIBTIFF
+
+/** libtiff's TIFF */
+struct tiff;
+struct FTiffMemoryReader;
+
+/**
+ * Decodes striped and tiled TIFFs with libtiff straight into a destination owned by the caller. Strips and
+ * tiles are compressed independently, so they are spread over worker threads that each open their own
+ * libtiff handle on the shared file data. Handles 8 and 16 bit gray, gray alpha, RGB and RGBA samples and
+ * 16 and 32 bit float samples stored interleaved, other layouts are left to the image wrapper.
+ */
+class FTiffDecoder
+{
+public:
+	FTiffDecoder(const uint8* InBuffer, int64 InLength);
+	~FTiffDecoder();
+
+	FTiffDecoder(const FTiffDecoder&) = delete;
+	FTiffDecoder& operator=(const FTiffDecoder&) = delete;
+
+	/** Parses the first directory, fails for sample layouts, photometrics and planar files this decoder doesn't handle */
+	bool ReadHeader();
+
+	int32 GetWidth() const { return Width; }
+	int32 GetHeight() const { return Height; }
+
+	/** TSF_G8, TSF_G16, TSF_BGRA8, TSF_RGBA16 or TSF_RGBA16F, TSF_Invalid before ReadHeader succeeded */
+	ETextureSourceFormat GetTextureFormat() const { return TextureFormat; }
+
+	/** Only 8 bit color is sRGB, like the editor's TIFF import */
+	bool IsSRGB() const { return TextureFormat == TSF_BGRA8; }
+	TextureCompressionSettings GetCompressionSettings() const;
+
+	/** Decodes into Dest as tightly packed top down rows, Dest has to hold Width x Height pixels */
+	bool Decode(uint8* Dest, int64 DestSize);
+
+	/**
+	 * Decodes only the strips or tiles Region touches into Dest as tightly packed rows of Region's width. Opens
+	 * its own libtiff handle, so regions can be decoded on several threads at once after ReadHeader.
+	 */
+	bool DecodeRegion(const FIntRect& Region, uint8* Dest) const;
+
+private:
+	/** Opens a libtiff handle reading from Reader, which has to outlive it */
+	tiff* OpenTiff(FTiffMemoryReader& Reader) const;
+
+	/** Decodes the strips or tiles [StartChunk, EndChunk) with the handle into Dest, ChunkBuffer is grown to one chunk */
+	bool DecodeChunks(tiff* Handle, int32 StartChunk, int32 EndChunk, uint8* Dest, TArray64<uint8>& ChunkBuffer) const;
+
+	/** Reads and decompresses one strip or tile, the number of bytes read or -1 */
+	int64 ReadChunk(tiff* Handle, int32 Chunk, TArray64<uint8>& ChunkBuffer) const;
+
+	/** Converts Count pixels of interleaved samples to the texture format */
+	void ConvertPixels(const uint8* Src, uint8* Dest, int32 Count) const;
+
+	const uint8* Buffer;
+	int64 Length;
+
+	/** Handle the header was read with and its read position, used for decoding when it doesn't go wide */
+	tiff* Tiff = nullptr;
+	FTiffMemoryReader* HeaderReader = nullptr;
+
+	int32 Width = 0;
+	int32 Height = 0;
+	int32 NumSamples = 0;
+	int32 BitsPerSample = 0;
+	bool bFloat = false;
+
+	bool bTiled = false;
+	int32 ChunkWidth = 0;
+	int32 ChunkHeight = 0;
+	int32 NumChunks = 0;
+	int64 ChunkSize = 0;
+	int64 ChunkRowSize = 0;
+
+	ETextureSourceFormat TextureFormat = TSF_Invalid;
+};
+
+#endif
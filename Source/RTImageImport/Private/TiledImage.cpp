@@ -0,0 +1,282 @@
+#include "TiledImage.h"
+
+#include "ImageImporter.h"
+#include "ImageImportStats.h"
+#include "ImageMipGenerator.h"
+#include "ImageScratchBufferPool.h"
+#include "ImageTexturePool.h"
+#include "TiledImageSource.h"
+#include "Async/Async.h"
+#include "Engine/Texture2D.h"
+#include "HAL/IConsoleManager.h"
+
+
+static TAutoConsoleVariable<int32> CVarTiledMaxConcurrentLoads(
+	TEXT("RTImageImport.Tiled.MaxConcurrentLoads"),
+	4,
+	TEXT("Maximum number of tiles a tiled image decodes at once, each holds one decoded tile."));
+
+/** Tiles every RHI can create a texture for */
+static constexpr int32 MinTileSize = 64;
+static constexpr int32 MaxTileSize = 8192;
+
+void UTiledImage::Init(UImageImporter* InImporter, TSharedPtr<FTiledImageSource, ESPMode::ThreadSafe> InSource, int32 InTileSize, int32 MaxResidentMegabytes)
+{
+	Importer = InImporter;
+	Source = MoveTemp(InSource);
+	Width = Source->GetWidth();
+	Height = Source->GetHeight();
+	// Whole 4x4 blocks, so every tile but those cut off at the right and bottom edges can be block compressed
+	TileSize = FMath::Clamp(InTileSize, MinTileSize, MaxTileSize) & ~3;
+	BudgetBytes = FMath::Max<int64>(MaxResidentMegabytes, 0) * 1024 * 1024;
+}
+
+int32 UTiledImage::GetNumTilesX() const
+{
+	return TileSize > 0 ? FMath::DivideAndRoundUp(Width, TileSize) : 0;
+}
+
+int32 UTiledImage::GetNumTilesY() const
+{
+	return TileSize > 0 ? FMath::DivideAndRoundUp(Height, TileSize) : 0;
+}
+
+bool UTiledImage::IsValidTile(int32 TileX, int32 TileY) const
+{
+	return TileX >= 0 && TileY >= 0 && TileX < GetNumTilesX() && TileY < GetNumTilesY();
+}
+
+void UTiledImage::GetTileBounds(int32 TileX, int32 TileY, int32& OutX, int32& OutY, int32& OutWidth, int32& OutHeight) const
+{
+	if (!IsValidTile(TileX, TileY))
+	{
+		OutX = OutY = OutWidth = OutHeight = 0;
+		return;
+	}
+
+	OutX = TileX * TileSize;
+	OutY = TileY * TileSize;
+	OutWidth = FMath::Min(TileSize, Width - OutX);
+	OutHeight = FMath::Min(TileSize, Height - OutY);
+}
+
+UTexture2D* UTiledImage::GetTile(int32 TileX, int32 TileY)
+{
+	check(IsInGameThread());
+
+	FTiledImageResidentTile* Resident = ResidentTiles.Find(FIntPoint(TileX, TileY));
+	if (!Resident)
+	{
+		return nullptr;
+	}
+
+	Resident->LastUse = ++UseCounter;
+	return Resident->Texture;
+}
+
+void UTiledImage::RequestTile(int32 TileX, int32 TileY, FOnImageTileLoaded OnLoaded)
+{
+	RequestTile(TileX, TileY, FOnImageTileLoadedNative::CreateLambda([OnLoaded](int32 X, int32 Y, UTexture2D* Texture)
+	{
+		OnLoaded.ExecuteIfBound(X, Y, Texture);
+	}));
+}
+
+void UTiledImage::RequestTile(int32 TileX, int32 TileY, FOnImageTileLoadedNative OnLoaded)
+{
+	check(IsInGameThread());
+
+	if (!IsValidTile(TileX, TileY))
+	{
+		UE_LOG(ImageImporter, Warning, TEXT("Tile %d, %d is outside the %d x %d tiles of the image"), TileX, TileY, GetNumTilesX(), GetNumTilesY());
+		OnLoaded.ExecuteIfBound(TileX, TileY, nullptr);
+		return;
+	}
+
+	if (UTexture2D* Texture = GetTile(TileX, TileY))
+	{
+		OnLoaded.ExecuteIfBound(TileX, TileY, Texture);
+		return;
+	}
+
+	const FIntPoint Tile(TileX, TileY);
+	if (TArray<FOnImageTileLoadedNative>* Requests = PendingRequests.Find(Tile))
+	{
+		Requests->Add(MoveTemp(OnLoaded));
+
+		// Asked for again, so it is wanted now, move it to the front of the queue unless it is already decoding
+		if (QueuedTiles.RemoveSingle(Tile) > 0)
+		{
+			QueuedTiles.Add(Tile);
+		}
+		return;
+	}
+
+	PendingRequests.Add(Tile).Add(MoveTemp(OnLoaded));
+	QueuedTiles.Add(Tile);
+	StartQueuedLoads();
+}
+
+void UTiledImage::CancelRequests()
+{
+	check(IsInGameThread());
+
+	// Delegates may request tiles again, the queue has to be in a consistent state before they fire
+	TArray<FIntPoint> CancelledTiles = MoveTemp(QueuedTiles);
+	QueuedTiles.Reset();
+
+	for (const FIntPoint& Tile : CancelledTiles)
+	{
+		TArray<FOnImageTileLoadedNative> Requests;
+		PendingRequests.RemoveAndCopyValue(Tile, Requests);
+		for (const FOnImageTileLoadedNative& OnLoaded : Requests)
+		{
+			OnLoaded.ExecuteIfBound(Tile.X, Tile.Y, nullptr);
+		}
+	}
+}
+
+void UTiledImage::EvictAllTiles()
+{
+	check(IsInGameThread());
+
+	TArray<FIntPoint> Tiles;
+	ResidentTiles.GetKeys(Tiles);
+	for (const FIntPoint& Tile : Tiles)
+	{
+		EvictTile(Tile);
+	}
+}
+
+void UTiledImage::StartQueuedLoads()
+{
+	const int32 MaxConcurrentLoads = FMath::Max(CVarTiledMaxConcurrentLoads.GetValueOnGameThread(), 1);
+	while (NumLoadsInFlight < MaxConcurrentLoads && QueuedTiles.Num() > 0)
+	{
+		StartLoad(QueuedTiles.Pop(false));
+	}
+}
+
+void UTiledImage::StartLoad(const FIntPoint& Tile)
+{
+	check(IsInGameThread());
+
+	int32 X, Y, TileWidth, TileHeight;
+	GetTileBounds(Tile.X, Tile.Y, X, Y, TileWidth, TileHeight);
+	const FIntRect Region(X, Y, X + TileWidth, Y + TileHeight);
+
+	++NumLoadsInFlight;
+
+	// The importer supplies the settings on the worker, the tiled image itself may be collected meanwhile
+	Importer->BeginAsyncImport();
+
+	Async(EAsyncExecution::ThreadPool, [WeakThis = TWeakObjectPtr<UTiledImage>(this), Importer = Importer, Source = Source, Tile, Region]()
+	{
+		TSharedRef<FImportedImageStruct> Image = MakeShared<FImportedImageStruct>();
+		Image->Init2DWithOneMip(Region.Width(), Region.Height(), Source->GetTextureFormat());
+		Image->SRGB = Source->IsSRGB();
+		Image->CompressionSettings = Importer->bOverrideCompressionSettings ? Importer->CompressionSettings.GetValue() : Source->GetCompressionSettings();
+
+		bool bDecoded = false;
+		{
+			RTIMAGEIMPORT_STAGE_SCOPE(Decode);
+			bDecoded = Source->DecodeRegion(Region, Image->RawData.GetData());
+		}
+
+		if (bDecoded)
+		{
+			if (Importer->bGenerateMips && CanGenerateMips(Image->Format))
+			{
+				Importer->GenerateMips(*Image);
+			}
+
+			if (Importer->bCompressTextures)
+			{
+				Importer->CompressImage(*Image);
+			}
+		}
+		else
+		{
+			UE_LOG(ImageImporter, Warning, TEXT("Failed to decode tile %d, %d"), Tile.X, Tile.Y);
+		}
+
+		AsyncTask(ENamedThreads::GameThread, [WeakThis, Importer, Image, Tile, bDecoded]()
+		{
+			UTexture2D* Texture = bDecoded ? UImageImporter::CreateTextureFromImage(*Image) : nullptr;
+			FImageScratchBufferPool::Get().Release(Image->RawData);
+
+			if (UTiledImage* TiledImage = WeakThis.Get())
+			{
+				TiledImage->FinishLoad(Tile, Texture);
+			}
+			else if (Texture)
+			{
+				FImageTexturePool::Get().Release(Texture);
+			}
+
+			Importer->EndAsyncImport();
+		});
+	});
+}
+
+void UTiledImage::FinishLoad(const FIntPoint& Tile, UTexture2D* Texture)
+{
+	check(IsInGameThread());
+	check(NumLoadsInFlight > 0);
+	--NumLoadsInFlight;
+
+	if (Texture)
+	{
+		FTiledImageResidentTile& Resident = ResidentTiles.Add(Tile);
+		Resident.Texture = Texture;
+		Resident.SizeBytes = Texture->CalcTextureMemorySizeEnum(TMC_ResidentMips);
+		Resident.LastUse = ++UseCounter;
+		ResidentBytes += Resident.SizeBytes;
+
+		EvictToBudget(Tile);
+	}
+
+	TArray<FOnImageTileLoadedNative> Requests;
+	PendingRequests.RemoveAndCopyValue(Tile, Requests);
+	for (const FOnImageTileLoadedNative& OnLoaded : Requests)
+	{
+		OnLoaded.ExecuteIfBound(Tile.X, Tile.Y, Texture);
+	}
+
+	StartQueuedLoads();
+}
+
+void UTiledImage::EvictToBudget(const FIntPoint& Keep)
+{
+	while (ResidentBytes > BudgetBytes)
+	{
+		TOptional<FIntPoint> Oldest;
+		uint64 OldestUse = MAX_uint64;
+		for (const TPair<FIntPoint, FTiledImageResidentTile>& Pair : ResidentTiles)
+		{
+			if (Pair.Key != Keep && Pair.Value.LastUse < OldestUse)
+			{
+				Oldest = Pair.Key;
+				OldestUse = Pair.Value.LastUse;
+			}
+		}
+
+		if (!Oldest.IsSet())
+		{
+			break;
+		}
+		EvictTile(Oldest.GetValue());
+	}
+}
+
+void UTiledImage::EvictTile(const FIntPoint& Tile)
+{
+	FTiledImageResidentTile Resident = ResidentTiles.FindAndRemoveChecked(Tile);
+	ResidentBytes -= Resident.SizeBytes;
+
+	OnTileEvicted.Broadcast(Tile.X, Tile.Y, Resident.Texture);
+	if (Resident.Texture)
+	{
+		FImageTexturePool::Get().Release(Resident.Texture);
+	}
+}
@@ -0,0 +1,126 @@
+#include "TiledImageSource.h"
+
+#include "ImageImporter.h"
+#include "JpegRowDecoder.h"
+#include "PngRowDecoder.h"
+#include "TiffDecoder.h"
+
+
+namespace
+{
+#if RTIMAGEIMPORT_WITH_LIBTIFF
+	/** One decoder holds the parsed header, every region opens its own libtiff handle */
+	class FTiffTiledImageSource : public FTiledImageSource
+	{
+	public:
+		using FTiledImageSource::FTiledImageSource;
+
+		bool ReadHeader()
+		{
+			Decoder = MakeUnique<FTiffDecoder>(File->GetData(), File->Num());
+			if (!Decoder->ReadHeader())
+			{
+				return false;
+			}
+
+			Width = Decoder->GetWidth();
+			Height = Decoder->GetHeight();
+			TextureFormat = Decoder->GetTextureFormat();
+			bSRGB = Decoder->IsSRGB();
+			CompressionSettings = Decoder->GetCompressionSettings();
+			return true;
+		}
+
+		virtual bool DecodeRegion(const FIntRect& Region, uint8* Dest) const override
+		{
+			return Decoder->DecodeRegion(Region, Dest);
+		}
+
+	private:
+		TUniquePtr<FTiffDecoder> Decoder;
+	};
+#endif
+
+	/** libjpeg and libpng state can't be shared, every region parses the header again with its own decoder */
+	template<typename DecoderType>
+	class FRowTiledImageSource : public FTiledImageSource
+	{
+	public:
+		using FTiledImageSource::FTiledImageSource;
+
+		bool ReadHeader()
+		{
+			DecoderType Decoder(File->GetData(), File->Num());
+			if (!Decoder.ReadHeader() || !CanDecodeRegions(Decoder))
+			{
+				return false;
+			}
+
+			Width = Decoder.GetWidth();
+			Height = Decoder.GetHeight();
+			TextureFormat = Decoder.GetTextureFormat();
+			bSRGB = TextureFormat == TSF_BGRA8 || TextureFormat == TSF_G8;
+			return true;
+		}
+
+		virtual bool DecodeRegion(const FIntRect& Region, uint8* Dest) const override
+		{
+			DecoderType Decoder(File->GetData(), File->Num());
+			return Decoder.ReadHeader() && Decoder.DecodeRegion(Region, Dest);
+		}
+
+	private:
+		static bool CanDecodeRegions(const FPngRowDecoder& Decoder) { return !Decoder.IsInterlaced(); }
+
+#if RTIMAGEIMPORT_WITH_LIBJPEGTURBO
+		static bool CanDecodeRegions(const FJpegRowDecoder& Decoder) { return true; }
+#endif
+	};
+
+	template<typename SourceType>
+	TSharedPtr<FTiledImageSource, ESPMode::ThreadSafe> OpenSource(TUniquePtr<FImageFileView> File)
+	{
+		TSharedPtr<SourceType, ESPMode::ThreadSafe> Source = MakeShared<SourceType, ESPMode::ThreadSafe>(MoveTemp(File));
+		if (!Source->ReadHeader())
+		{
+			return nullptr;
+		}
+		return Source;
+	}
+}
+
+TSharedPtr<FTiledImageSource, ESPMode::ThreadSafe> FTiledImageSource::Open(const FString& Filename)
+{
+	TUniquePtr<FImageFileView> File = MakeUnique<FImageFileView>();
+	if (!File->Open(*Filename) || File->Num() < 8)
+	{
+		UE_LOG(ImageImporter, Error, TEXT("Failed to load file '%s'"), *Filename);
+		return nullptr;
+	}
+
+	const uint8* Magic = File->GetData();
+
+	TSharedPtr<FTiledImageSource, ESPMode::ThreadSafe> Source;
+	if ((Magic[0] == 'I' && Magic[1] == 'I') || (Magic[0] == 'M' && Magic[1] == 'M'))
+	{
+#if RTIMAGEIMPORT_WITH_LIBTIFF
+		Source = OpenSource<FTiffTiledImageSource>(MoveTemp(File));
+#endif
+	}
+	else if (Magic[0] == 0xFF && Magic[1] == 0xD8 && Magic[2] == 0xFF)
+	{
+#if RTIMAGEIMPORT_WITH_LIBJPEGTURBO
+		Source = OpenSource<FRowTiledImageSource<FJpegRowDecoder>>(MoveTemp(File));
+#endif
+	}
+	else if (Magic[0] == 0x89 && Magic[1] == 'P' && Magic[2] == 'N' && Magic[3] == 'G')
+	{
+		Source = OpenSource<FRowTiledImageSource<FPngRowDecoder>>(MoveTemp(File));
+	}
+
+	if (!Source.IsValid())
+	{
+		UE_LOG(ImageImporter, Error, TEXT("'%s' can't be imported tiled, only striped or tiled TIFFs, JPEGs and non-interlaced PNGs can"), *Filename);
+	}
+	return Source;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/Texture.h"
+#include "ImageFileView.h"
+
+/**
+ * File and header of an image opened for tiled import, decodes rectangles of it without ever holding the
+ * whole image. Tiled and striped TIFFs only decode the chunks a region touches. JPEGs and non-interlaced
+ * PNGs are decoded from the top down to the region's last row a row at a time, their cost grows with the
+ * region's distance from the top while the memory stays at one row.
+ */
+class FTiledImageSource
+{
+public:
+	virtual ~FTiledImageSource() = default;
+
+	/** Maps the file and reads its header, null for formats and layouts that can't be decoded by region */
+	static TSharedPtr<FTiledImageSource, ESPMode::ThreadSafe> Open(const FString& Filename);
+
+	int32 GetWidth() const { return Width; }
+	int32 GetHeight() const { return Height; }
+	ETextureSourceFormat GetTextureFormat() const { return TextureFormat; }
+	bool IsSRGB() const { return bSRGB; }
+	TextureCompressionSettings GetCompressionSettings() const { return CompressionSettings; }
+
+	/** Decodes Region into Dest as tightly packed rows of Region's width. Any thread, also several at once. */
+	virtual bool DecodeRegion(const FIntRect& Region, uint8* Dest) const = 0;
+
+protected:
+	explicit FTiledImageSource(TUniquePtr<FImageFileView> InFile)
+		: File(MoveTemp(InFile))
+	{
+	}
+
+	TUniquePtr<FImageFileView> File;
+
+	int32 Width = 0;
+	int32 Height = 0;
+	ETextureSourceFormat TextureFormat = TSF_Invalid;
+	bool bSRGB = true;
+	TextureCompressionSettings CompressionSettings = TC_Default;
+};
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/Texture.h"
+#include "HAL/CriticalSection.h"
+#include "Templates/UniquePtr.h"
+
+class FImageDecodeTarget;
+class UImageImporter;
+struct FImportedImageStruct;
+
+/** What a decoder reads from the header of a file without decoding it */
+struct FImageHeaderInfo
+{
+	int32 Width = 0;
+	int32 Height = 0;
+	ETextureSourceFormat Format = TSF_Invalid;
+
+	/** Whether the decoder scales previews and oversized images while decoding, so the full size image is never held */
+	bool bScalesWhileDecoding = false;
+};
+
+/**
+ * Decodes one file format for ImportImage. Instances are pooled by the registry and reused for later files,
+ * one instance only ever decodes one file at a time, so it can keep scratch state between files.
+ */
+class RTIMAGEIMPORT_API IImageDecoder
+{
+public:
+	virtual ~IImageDecoder() = default;
+
+	/** Format name the import stats group decode times under */
+	virtual const TCHAR* GetName() const = 0;
+
+	/**
+	 * Cheap check of the magic bytes whether the file is this decoder's. Called concurrently on one shared
+	 * instance, it must not touch decoder state. Length is at least 1.
+	 */
+	virtual bool CanDecode(const uint8* Buffer, int64 Length) const = 0;
+
+	/**
+	 * Decodes the file with the importer's settings into OutImage, or into the target's mips through
+	 * UImageImporter::AllocateDecodedMips. The result is final, no other decoder is tried afterwards.
+	 */
+	virtual bool Decode(UImageImporter& Importer, const uint8* Buffer, int64 Length, FImportedImageStruct& OutImage, FImageDecodeTarget* Target) = 0;
+
+	/**
+	 * Reads the size and format from the header only, so batch imports can budget the decoded image before
+	 * decoding it. Optional, files of decoders that return false are budgeted once they are decoded.
+	 */
+	virtual bool ReadHeaderInfo(const uint8* Buffer, int64 Length, FImageHeaderInfo& OutInfo) { return false; }
+};
+
+/**
+ * The decoders ImportImage picks from. Files are dispatched on their first byte to the decoders registered
+ * for it, so only decoders whose magic can match are asked, decoders without magic bytes are asked last.
+ * Decoder instances are pooled per decoder and handed to one thread at a time, small imports don't pay for
+ * creating decoders or image wrappers. Registration is game thread only, decoding any thread.
+ */
+class RTIMAGEIMPORT_API FImageDecoderRegistry
+{
+public:
+	using FDecoderFactory = TFunction<TUniquePtr<IImageDecoder>()>;
+
+	/** Created with the built in decoders on module startup */
+	static FImageDecoderRegistry& Get();
+
+	/** Frees the pooled decoders, called on module shutdown */
+	static void Shutdown();
+
+	FImageDecoderRegistry();
+	~FImageDecoderRegistry();
+
+	/**
+	 * Registers a decoder for files starting with one of LeadingBytes, an empty list registers it for files
+	 * no decoder with magic bytes claimed. Decoders registered later are asked first, so they can take
+	 * formats over from the built in ones. Returns the handle for UnregisterDecoder.
+	 */
+	int32 RegisterDecoder(TConstArrayView<uint8> LeadingBytes, FDecoderFactory Factory);
+
+	/** Decodes already running finish with their instance, it is freed afterwards */
+	void UnregisterDecoder(int32 Handle);
+
+	/**
+	 * Decodes with the first registered decoder that claims the file. OutFormatName is the decoder's name
+	 * and stays null when no decoder claimed it.
+	 */
+	bool Decode(UImageImporter& Importer, const uint8* Buffer, int64 Length, FImportedImageStruct& OutImage, FImageDecodeTarget* Target, const TCHAR*& OutFormatName);
+
+	/** Header info from the decoder Decode would pick, false when none claims the file or it can't tell */
+	bool ReadHeaderInfo(const uint8* Buffer, int64 Length, FImageHeaderInfo& OutInfo);
+
+private:
+	struct FRegisteredDecoder;
+
+	/** The first registered decoder that claims the file, null when none does */
+	TSharedPtr<FRegisteredDecoder, ESPMode::ThreadSafe> PickDecoder(const uint8* Buffer, int64 Length) const;
+
+	/** Pops a pooled instance of the decoder or creates one */
+	static TUniquePtr<IImageDecoder> AcquireInstance(FRegisteredDecoder& Decoder);
+	static void ReleaseInstance(FRegisteredDecoder& Decoder, TUniquePtr<IImageDecoder> Instance);
+
+	mutable FRWLock Lock;
+
+	/** Newest first for every leading byte, entries are shared with decodes still using them */
+	TArray<TSharedPtr<FRegisteredDecoder, ESPMode::ThreadSafe>> DecodersByLeadingByte[256];
+	TArray<TSharedPtr<FRegisteredDecoder, ESPMode::ThreadSafe>> DecodersWithoutMagic;
+
+	int32 NextHandle = 1;
+};
@@ -8,17 +8,135 @@
 
 DECLARE_LOG_CATEGORY_EXTERN(ImageImporter, Log, All)
 
+DECLARE_DYNAMIC_DELEGATE_TwoParams(FOnImageImported, UTexture2D*, Texture, bool, bSuccess);
+DECLARE_DELEGATE_TwoParams(FOnImageImportedNative, UTexture2D* /*Texture*/, bool /*bSuccess*/);
+
+UENUM(BlueprintType)
+enum class EImageCompressionQuality : uint8
+{
+	/** Bounding box endpoints, meant for imports at runtime */
+	Fast,
+	/** Principal axis endpoints refined by least squares, several times slower */
+	Quality,
+};
+
+UENUM(BlueprintType)
+enum class EImageOversizePolicy : uint8
+{
+	/** Scale the image down until it fits, while decoding where the format allows it */
+	Downscale,
+	/** Fail the import */
+	Reject,
+};
+
+USTRUCT(BlueprintType)
+struct FImageImportResult
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly)
+	FString Filename;
+
+	UPROPERTY(BlueprintReadOnly)
+	UTexture2D* Texture = nullptr;
+
+	UPROPERTY(BlueprintReadOnly)
+	bool bSuccess = false;
+
+	UPROPERTY(BlueprintReadOnly)
+	int64 BytesRead = 0;
+
+	/** Time spent reading and decoding the file on the worker thread */
+	UPROPERTY(BlueprintReadOnly)
+	float DecodeSeconds = 0.f;
+};
+
+USTRUCT(BlueprintType)
+struct FImageBatchImportStats
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 NumSucceeded = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 NumFailed = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 NumWorkers = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	int64 TotalBytesRead = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	int64 TotalPixels = 0;
+
+	/** Highest amount of file and decoded data held at once */
+	UPROPERTY(BlueprintReadOnly)
+	int64 PeakInFlightBytes = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	float WallSeconds = 0.f;
+
+	UPROPERTY(BlueprintReadOnly)
+	float MegabytesPerSecond = 0.f;
+
+	UPROPERTY(BlueprintReadOnly)
+	float MegapixelsPerSecond = 0.f;
+};
+
+UENUM(BlueprintType)
+enum class EImageCacheKeyMode : uint8
+{
+	/** Full path, file size and modification time, hits without reading the file */
+	PathAndTimestamp,
+	/** Hash of the file data, also dedupes copies of a file. Hits still read the file but skip decoding. */
+	Content,
+};
+
+USTRUCT(BlueprintType)
+struct FImageTextureCacheStats
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 NumEntries = 0;
+
+	/** Texture memory of the cached textures */
+	UPROPERTY(BlueprintReadOnly)
+	int64 ResidentBytes = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	int64 NumHits = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	int64 NumMisses = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	int64 NumEvictions = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	float HitRate = 0.f;
+};
+
+DECLARE_DYNAMIC_DELEGATE_TwoParams(FOnImageBatchImported, const TArray<FImageImportResult>&, Results, const FImageBatchImportStats&, Stats);
+DECLARE_DELEGATE_TwoParams(FOnImageBatchImportedNative, const TArray<FImageImportResult>& /*Results*/, const FImageBatchImportStats& /*Stats*/);
+
 struct FImportedImageStruct
 {
 	TArray64<uint8> RawData;
 	ETextureSourceFormat Format = TSF_Invalid;
 	TextureCompressionSettings CompressionSettings = TC_Default;
-	int32 NumMips;
+	int32 NumMips = 1;
 	int32 SizeX = 0;
 	int32 SizeY = 0;
 	bool SRGB = true;
 	/** Which compression format (if any) that is applied to RawData */
 	ETextureSourceCompressionFormat RawDataCompressionFormat = TSCF_None;
+	/** GPU format RawData is stored in when it was block compressed or imported from a DDS, PF_Unknown while it holds Format pixels */
+	EPixelFormat PixelFormat = PF_Unknown;
+	/** Mips of the FImageDecodeTarget passed to ImportImage the pixels were decoded into, RawData stays empty then */
+	TArray<uint8*> TargetMipData;
 
 	void Init2DWithParams(int32 InSizeX, int32 InSizeY, ETextureSourceFormat InFormat, bool InSRGB);
 	void Init2DWithOneMip(int32 InSizeX, int32 InSizeY, ETextureSourceFormat InFormat, const void* InData = nullptr);
@@ -26,21 +144,242 @@ struct FImportedImageStruct
 
 	int64 GetMipSize(int32 InMipIndex) const;
 	void* GetMipData(int32 InMipIndex);
+
+	bool IsRawDataInTarget() const { return TargetMipData.Num() > 0; }
+};
+
+/**
+ * Memory ImportImage can decode into instead of FImportedImageStruct::RawData, e.g. a locked texture mip,
+ * so the decoded image never exists twice. Decoders that can't write into external memory ignore it.
+ */
+class FImageDecodeTarget
+{
+public:
+	virtual ~FImageDecodeTarget() = default;
+
+	/**
+	 * Called on the decoding thread once the header and the number of mips are known. Fills OutMipData with
+	 * Image.NumMips pointers to Image.GetMipSize bytes each, or returns false to let the decoder use RawData.
+	 */
+	virtual bool AllocateMips(const FImportedImageStruct& Image, TArray<uint8*>& OutMipData) = 0;
 };
 
-UCLASS()
+class FImageCacheLookup;
+struct FImageHeaderInfo;
+class UTiledImage;
+
+UCLASS(BlueprintType)
 class UImageImporter : public UObject
 {
 public:
 	GENERATED_BODY()
 
 	void ImportFile(const FString Filename);
+
+	/**
+	 * Reads and decodes the file on a worker thread, then creates the texture on the game thread
+	 * and fires OnImported there. The importer keeps itself alive until the delegate has fired.
+	 */
+	UFUNCTION(BlueprintCallable)
+	void ImportFileAsync(const FString Filename, FOnImageImported OnImported);
+	void ImportFileAsync(const FString Filename, FOnImageImportedNative OnImported);
+
+	/**
+	 * Imports all files concurrently on a worker pool bounded by the core count and by
+	 * RTImageImport.Batch.MaxInFlightMB of file and decoded data waiting for upload.
+	 * Results are reported in the order of Filenames once every file has been processed.
+	 */
+	UFUNCTION(BlueprintCallable)
+	void ImportFilesAsync(const TArray<FString>& Filenames, FOnImageBatchImported OnImported);
+	void ImportFilesAsync(const TArray<FString>& Filenames, FOnImageBatchImportedNative OnImported);
+
+	/**
+	 * Opens an image for tiled import, for images beyond the largest texture. Only the header is read, tiles
+	 * of TileSize, rounded down to a multiple of 4, are decoded on demand with this importer's mip and
+	 * compression settings, edge tiles that aren't whole blocks stay uncompressed. MaxDimension and
+	 * the import limits don't apply. Tiled and striped TIFFs decode only the strips or tiles a tile touches,
+	 * JPEGs and non-interlaced PNGs decode from the top down to the tile's last row, which makes tiles further
+	 * down slower. Nullptr for other formats. Game thread only.
+	 */
+	UFUNCTION(BlueprintCallable)
+	UTiledImage* OpenTiledImage(const FString Filename, int32 TileSize = 1024, int32 MaxResidentMegabytes = 256);
+
 	UObject* CreateBinary(UClass* InClass, UObject* InParent, FName InName, EObjectFlags Flags, UObject* Context, const TCHAR* Type, const uint8*& Buffer, const uint8* BufferEnd);
-	bool ImportImage(const uint8* Buffer, uint32 Length, FImportedImageStruct& OutImage);
+	bool ImportImage(const uint8* Buffer, uint32 Length, FImportedImageStruct& OutImage, FImageDecodeTarget* Target = nullptr);
 	UTexture2D* CreateTexture2D(UObject* InParent, FName Name, EObjectFlags Flags);
-	bool IsImportResolutionValid(int32 Width, int32 Height, bool bAllowNonPowerOfTwo);
+	/** Creates a transient texture from a decoded image and uploads it. Game thread only. */
+	static UTexture2D* CreateTextureFromImage(const FImportedImageStruct& Image);
+
+	/**
+	 * Whether an image of this size can be decoded at all, its sides are positive and it has no more pixels
+	 * than the largest texture. Images decoded in full are checked before they are scaled down.
+	 */
+	RTIMAGEIMPORT_API bool IsImportResolutionValid(int32 Width, int32 Height, bool bAllowNonPowerOfTwo) const;
+
+	/**
+	 * Applies OversizePolicy to an image about to be decoded, for IImageDecoder implementations. OutMaxDimension
+	 * is the largest side the imported image may have under MaxDimension and the import limits, 0 when it keeps
+	 * its size. Decoders that can scale while decoding scale to it, ImportImage scales the rest afterwards.
+	 * Fails when the image is over the limits and the policy rejects it.
+	 */
+	RTIMAGEIMPORT_API bool CheckImportLimits(int32 Width, int32 Height, ETextureSourceFormat Format, int32& OutMaxDimension) const;
+
+	/**
+	 * CheckImportLimits for decoders that decode at full size and leave the scaling to ImportImage. An image over
+	 * the limits also fails when it can't be scaled after decoding, or when its full size decode alone would
+	 * exceed MaxImportMegabytes, so the limits bound the memory of every format before anything is decoded.
+	 */
+	RTIMAGEIMPORT_API bool CheckFullSizeImportLimits(int32 Width, int32 Height, ETextureSourceFormat Format, bool bCanDownsample) const;
+
+	/** Number of mips an image decoded with the current settings ends up with, for IImageDecoder implementations */
+	RTIMAGEIMPORT_API int32 GetNumMipsToImport(const FImportedImageStruct& Image) const;
+
+	/**
+	 * Sets the number of mips to import and points the image at the target's mips, or at RawData when there is
+	 * no target or the image is block compressed after decoding. IImageDecoder implementations call it once the
+	 * image is initialized and decode into mip 0.
+	 */
+	RTIMAGEIMPORT_API void AllocateDecodedMips(FImportedImageStruct& Image, FImageDecodeTarget* Target) const;
+
+	UFUNCTION(BlueprintCallable, Category = "Import")
+	static FImageTextureCacheStats GetTextureCacheStats();
+
+	/** Drops all cached textures, textures still referenced elsewhere stay alive */
+	UFUNCTION(BlueprintCallable, Category = "Import")
+	static void FlushTextureCache();
+
+	/**
+	 * Hands a texture created by an import back for reuse by later imports of the same size and format,
+	 * which refill it in place instead of creating a new texture. The texture must not be used afterwards.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Import")
+	static void ReleaseTexture(UTexture2D* Texture);
+
+	/** Drops all released textures kept for reuse */
+	UFUNCTION(BlueprintCallable, Category = "Import")
+	static void FlushTexturePool();
+
+	/** GPU format that holds a texture source format without conversion */
+	static EPixelFormat GetPixelFormatForSourceFormat(ETextureSourceFormat Format);
+
+	/** UTexture2D::CreateTransient with a mip chain of NumMips levels */
+	static UTexture2D* CreateTransientTexture(int32 SizeX, int32 SizeY, int32 NumMips, EPixelFormat PixelFormat);
+
+	/**
+	 * Preview imports: scale images down so neither side is larger than this, 0 keeps the full size. JPEGs
+	 * are scaled in the DCT domain and non-interlaced PNGs box filtered row by row while decoding, so the
+	 * full size image is never held. Other images are decoded in full and scaled afterwards.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Import", meta = (ClampMin = "0"))
+	int32 MaxDimension = 0;
+
+	/**
+	 * Keep JPEGs compressed (TSCF_JPEG) until the texture is created and decode them straight into its mip
+	 * then, so no decoded copy of the pixels is held in between. Lowers the memory of imports waiting for
+	 * upload at the cost of decoding on the game thread. Only used when no mips are generated and nothing
+	 * is compressed, and where libjpeg-turbo is available.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Import")
+	bool bRetainJpegData = false;
+
+	/**
+	 * What happens to images larger than the largest texture, MaxImportPixels or MaxImportMegabytes. Imports
+	 * never ask, so oversized images behave the same in batches and on worker threads. Downscaled images are
+	 * scaled like MaxDimension previews. Formats the box filter can't scale are rejected, as are images only
+	 * scaled after decoding whose full size decode alone exceeds MaxImportMegabytes.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Import")
+	EImageOversizePolicy OversizePolicy = EImageOversizePolicy::Downscale;
+
+	/** Largest number of pixels an imported image may have, 0 for no limit */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Import", meta = (ClampMin = "0"))
+	int64 MaxImportPixels = 0;
+
+	/** Memory budget of one import: megabytes the decoded pixels may take including generated mips, 0 for no limit */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Import", meta = (ClampMin = "0"))
+	int32 MaxImportMegabytes = 0;
+
+	/** Fill the mip chain of imported images with a box filtered downsample and upload all mips */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Import")
+	bool bGenerateMips = false;
+
+	/**
+	 * Encode 8 bit images to BC1/BC3/BC4/BC5/BC7 on the CPU before upload, picked from the compression
+	 * settings. Images the settings don't map to a block format stay uncompressed, as do images whose sides
+	 * aren't a multiple of 4, which block compressed textures can't be created with.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Import")
+	bool bCompressTextures = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Import", meta = (EditCondition = "bCompressTextures"))
+	EImageCompressionQuality CompressionQuality = EImageCompressionQuality::Fast;
+
+	/** Use CompressionSettings instead of what the decoder suggests for the image */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Import")
+	bool bOverrideCompressionSettings = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Import", meta = (EditCondition = "bOverrideCompressionSettings"))
+	TEnumAsByte<TextureCompressionSettings> CompressionSettings = TC_Default;
+
+	/**
+	 * Return the texture of an earlier import of the same file with the same settings instead of importing
+	 * it again. The cache is shared by all importers, so cached textures must not be modified.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Import")
+	bool bUseTextureCache = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Import", meta = (EditCondition = "bUseTextureCache"))
+	EImageCacheKeyMode TextureCacheKey = EImageCacheKeyMode::PathAndTimestamp;
+
+	/**
+	 * Keep the final images in a cache under Saved/ keyed by the hash of the file data, imports of a file
+	 * seen in an earlier session copy the stored mips instead of decoding.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Import")
+	bool bUseDiskCache = false;
 
 protected:
 	UPROPERTY()
 	UTexture2D* Texture2D;
+
+	/** Textures being decoded into or waiting for their import to report results */
+	UPROPERTY()
+	TArray<UTexture2D*> PendingTextures;
+
+private:
+	/** Decodes retained JPEG data straight into the mip of a new texture */
+	static UTexture2D* CreateTextureFromRetainedJpeg(const FImportedImageStruct& Image);
+
+	/** Whether an image of this size and format is within MaxImportPixels, MaxImportMegabytes and the largest texture */
+	bool IsWithinImportLimits(int64 Width, int64 Height, ETextureSourceFormat Format) const;
+
+	/** Largest side an image may be imported with, see CheckImportLimits */
+	int32 GetImportMaxDimension(int32 Width, int32 Height, ETextureSourceFormat Format) const;
+
+	/** Decoded bytes an import of an image with this header holds at its peak, for budgeting batch imports */
+	int64 EstimateImportBytes(const FImageHeaderInfo& Info) const;
+
+	/** Box filters images the decoder didn't already scale down to fit MaxDimension and the import limits */
+	void DownsampleToMaxDimension(FImportedImageStruct& Image) const;
+
+	void GenerateMips(FImportedImageStruct& Image) const;
+
+	/** Replaces RawData with block compressed mips when the settings map to a format the RHI supports */
+	void CompressImage(FImportedImageStruct& Image) const;
+
+	/** Hash of the settings that change the imported texture, part of the cache key */
+	uint64 GetImportSettingsHash() const;
+
+	/** Texture cache lookup for one import with the current settings. Game thread only. */
+	FImageCacheLookup CreateCacheLookup() const;
+
+	friend class FImageBatchImport;
+	friend class FTextureDecodeTarget;
+	friend class UTiledImage;
+
+	/** Keeps the importer rooted while async imports are in flight. Game thread only. */
+	void BeginAsyncImport();
+	void EndAsyncImport();
+
+	int32 NumPendingAsyncImports = 0;
 };
\ No newline at end of file
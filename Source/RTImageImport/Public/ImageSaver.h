@@ -7,6 +7,50 @@
 #include "ImageSaver.generated.h"
 
 
+DECLARE_DYNAMIC_DELEGATE_OneParam(FOnImageSaved, bool, bSuccess);
+DECLARE_DYNAMIC_DELEGATE_OneParam(FOnImageLoaded, UTexture2D*, Texture);
+
+/** Layout of the pixels stored in a UImageSaver, the fields of FImportedImageStruct */
+USTRUCT()
+struct FSavedImageInfo
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	int32 SizeX = 0;
+
+	UPROPERTY()
+	int32 SizeY = 0;
+
+	UPROPERTY()
+	int32 NumMips = 0;
+
+	UPROPERTY()
+	TEnumAsByte<ETextureSourceFormat> Format = TSF_Invalid;
+
+	/** Pixel format of the mips when they are block compressed or RGBA8, PF_Unknown when they hold Format pixels */
+	UPROPERTY()
+	TEnumAsByte<EPixelFormat> PixelFormat = PF_Unknown;
+
+	UPROPERTY()
+	TEnumAsByte<TextureCompressionSettings> CompressionSettings = TC_Default;
+
+	UPROPERTY()
+	bool bSRGB = true;
+
+	/** Mips back to back are split into chunks of ChunkSize bytes that are compressed independently */
+	UPROPERTY()
+	FName CompressionFormat;
+
+	UPROPERTY()
+	int64 UncompressedSize = 0;
+
+	UPROPERTY()
+	int32 ChunkSize = 0;
+
+	UPROPERTY()
+	TArray<int32> ChunkCompressedSizes;
+};
 
 UCLASS()
 class UImageSaver : public USaveGame
@@ -14,6 +58,30 @@ class UImageSaver : public USaveGame
 public:
 	GENERATED_BODY()
 
-	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	/** The texture that was saved, or the one rebuilt from the stored pixels after a load. Not saved itself. */
+	UPROPERTY(Transient, BlueprintReadWrite, EditAnywhere)
 	TObjectPtr<UTexture2D> SavedTexture2D;
-};
\ No newline at end of file
+
+	UPROPERTY()
+	FSavedImageInfo ImageInfo;
+
+	/**
+	 * Copies the texture's mips on the game thread, compresses them on a worker and writes the slot
+	 * through the async save game path. OnSaved fires on the game thread.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Import")
+	static void AsyncSaveTextureToSlot(UTexture2D* Texture, const FString& SlotName, int32 UserIndex, FOnImageSaved OnSaved);
+
+	/**
+	 * Reads the slot through the async save game path, decompresses the pixels on a worker and creates the
+	 * texture on the game thread. OnLoaded fires on the game thread with nullptr when the slot has no image.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Import")
+	static void AsyncLoadTextureFromSlot(const FString& SlotName, int32 UserIndex, FOnImageLoaded OnLoaded);
+
+	virtual void Serialize(FArchive& Ar) override;
+
+private:
+	/** Compressed chunks, serialized in bulk instead of as a reflected byte array */
+	TArray<uint8> CompressedPixels;
+};
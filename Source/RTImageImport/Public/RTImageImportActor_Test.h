@@ -4,6 +4,8 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "ImageImporter.h"
+#include "ImageSaver.h"
 #include "RTImageImportActor_Test.generated.h"
 
 UCLASS()
@@ -19,7 +21,13 @@ public:
 	void ImportTest(const FString Path);
 
 	UFUNCTION(BlueprintCallable)
-	UTexture2D* TestLoadImage();
+	void ImportTestAsync(const FString Path, FOnImageImported OnImported);
+
+	UFUNCTION(BlueprintCallable)
+	void ImportTestBatch(FOnImageBatchImported OnImported);
+
+	UFUNCTION(BlueprintCallable)
+	void TestLoadImage(FOnImageLoaded OnLoaded);
 
 	UFUNCTION(BlueprintCallable)
 	void CreateSaveGameObject();
@@ -28,6 +36,8 @@ protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
+	bool OpenImportFileDialog(TArray<FString>& OutSelectedFiles) const;
+
 public:	
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
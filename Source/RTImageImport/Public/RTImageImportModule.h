@@ -1,5 +1,6 @@
 #pragma once
 
+#include "Containers/Ticker.h"
 #include "Modules/ModuleInterface.h"
 
 
@@ -8,4 +9,8 @@ class FRTImageImportModule : public IModuleInterface
 public:
     virtual void StartupModule() override;
     virtual void ShutdownModule() override;
+
+private:
+    FDelegateHandle PostGarbageCollectHandle;
+    FTSTicker::FDelegateHandle TrimTickerHandle;
 };
\ No newline at end of file
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+
+#include "TiledImage.generated.h"
+
+class FTiledImageSource;
+class UImageImporter;
+
+DECLARE_DYNAMIC_DELEGATE_ThreeParams(FOnImageTileLoaded, int32, TileX, int32, TileY, UTexture2D*, Texture);
+DECLARE_DELEGATE_ThreeParams(FOnImageTileLoadedNative, int32 /*TileX*/, int32 /*TileY*/, UTexture2D* /*Texture*/);
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FOnImageTileEvicted, int32, TileX, int32, TileY, UTexture2D*, Texture);
+
+USTRUCT()
+struct FTiledImageResidentTile
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	UTexture2D* Texture = nullptr;
+
+	int64 SizeBytes = 0;
+	uint64 LastUse = 0;
+};
+
+/**
+ * An image too large for one texture, opened by UImageImporter::OpenTiledImage. It is cut into a grid of
+ * TileSize textures that are decoded on demand from the file, which stays mapped but is never decoded as
+ * a whole. Resident tiles are evicted least recently used first once they exceed the memory budget, so
+ * viewing a gigapixel image only costs the tiles on screen. Game thread only.
+ */
+UCLASS(BlueprintType)
+class UTiledImage : public UObject
+{
+public:
+	GENERATED_BODY()
+
+	UFUNCTION(BlueprintPure, Category = "Import")
+	int32 GetWidth() const { return Width; }
+
+	UFUNCTION(BlueprintPure, Category = "Import")
+	int32 GetHeight() const { return Height; }
+
+	UFUNCTION(BlueprintPure, Category = "Import")
+	int32 GetTileSize() const { return TileSize; }
+
+	UFUNCTION(BlueprintPure, Category = "Import")
+	int32 GetNumTilesX() const;
+
+	UFUNCTION(BlueprintPure, Category = "Import")
+	int32 GetNumTilesY() const;
+
+	/** Pixel rectangle of a tile in the image, tiles in the last row and column are cut to the image */
+	UFUNCTION(BlueprintPure, Category = "Import")
+	void GetTileBounds(int32 TileX, int32 TileY, int32& OutX, int32& OutY, int32& OutWidth, int32& OutHeight) const;
+
+	/** Texture of a resident tile, which counts as a use for eviction. Nullptr while it isn't loaded. */
+	UFUNCTION(BlueprintCallable, Category = "Import")
+	UTexture2D* GetTile(int32 TileX, int32 TileY);
+
+	/**
+	 * Loads a tile on a worker thread unless it is resident, then fires OnLoaded on the game thread with its
+	 * texture, or nullptr when it failed. At most RTImageImport.Tiled.MaxConcurrentLoads tiles are decoded at
+	 * once, the most recently requested tiles go first so panning doesn't wait for tiles already scrolled past.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Import")
+	void RequestTile(int32 TileX, int32 TileY, FOnImageTileLoaded OnLoaded);
+	void RequestTile(int32 TileX, int32 TileY, FOnImageTileLoadedNative OnLoaded);
+
+	/** Drops the requests that haven't started decoding, their delegates fire with nullptr */
+	UFUNCTION(BlueprintCallable, Category = "Import")
+	void CancelRequests();
+
+	/** Evicts all resident tiles, OnTileEvicted fires for each */
+	UFUNCTION(BlueprintCallable, Category = "Import")
+	void EvictAllTiles();
+
+	/** Texture memory of the resident tiles */
+	UFUNCTION(BlueprintPure, Category = "Import")
+	int64 GetResidentBytes() const { return ResidentBytes; }
+
+	/**
+	 * Fires before a tile is evicted. Its texture goes back to the importer's texture pool and is refilled
+	 * with another tile later, so it must not be displayed any more.
+	 */
+	UPROPERTY(BlueprintAssignable, Category = "Import")
+	FOnImageTileEvicted OnTileEvicted;
+
+private:
+	friend class UImageImporter;
+
+	void Init(UImageImporter* InImporter, TSharedPtr<FTiledImageSource, ESPMode::ThreadSafe> InSource, int32 InTileSize, int32 MaxResidentMegabytes);
+
+	bool IsValidTile(int32 TileX, int32 TileY) const;
+
+	/** Starts queued loads until RTImageImport.Tiled.MaxConcurrentLoads are in flight */
+	void StartQueuedLoads();
+
+	void StartLoad(const FIntPoint& Tile);
+
+	/** Game thread part of a load, Texture is nullptr when the tile failed */
+	void FinishLoad(const FIntPoint& Tile, UTexture2D* Texture);
+
+	/** Evicts least recently used tiles until the resident ones fit the budget, Keep stays even when it alone exceeds it */
+	void EvictToBudget(const FIntPoint& Keep);
+
+	void EvictTile(const FIntPoint& Tile);
+
+	/** Supplies the import settings, mips and compression apply to every tile */
+	UPROPERTY()
+	UImageImporter* Importer = nullptr;
+
+	UPROPERTY()
+	TMap<FIntPoint, FTiledImageResidentTile> ResidentTiles;
+
+	TSharedPtr<FTiledImageSource, ESPMode::ThreadSafe> Source;
+
+	/** Delegates of tiles that are queued or decoding, a tile is in here exactly while it is requested */
+	TMap<FIntPoint, TArray<FOnImageTileLoadedNative>> PendingRequests;
+
+	/** Requested tiles that haven't started decoding, the last one is started first */
+	TArray<FIntPoint> QueuedTiles;
+
+	int32 Width = 0;
+	int32 Height = 0;
+	int32 TileSize = 0;
+	int32 NumLoadsInFlight = 0;
+	int64 BudgetBytes = 0;
+	int64 ResidentBytes = 0;
+	uint64 UseCounter = 0;
+};
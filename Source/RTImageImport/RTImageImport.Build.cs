@@ -49,6 +49,38 @@ public class RTImageImport : ModuleRules
 			);
 		
 		
+		// Reports of the import benchmark commandlet, which is compiled out of game builds
+		if (Target.bBuildEditor)
+		{
+			PrivateDependencyModuleNames.Add("Json");
+		}
+
+		// libpng is used directly for row by row decoding
+		AddEngineThirdPartyPrivateStaticDependencies(Target, "UElibPNG", "zlib");
+
+		// libjpeg-turbo is used directly for scaled decoding, on the platforms the engine ships it for
+		if (Target.Platform == UnrealTargetPlatform.Win64 || Target.Platform == UnrealTargetPlatform.Mac || Target.Platform == UnrealTargetPlatform.Linux)
+		{
+			AddEngineThirdPartyPrivateStaticDependencies(Target, "LibJpegTurbo");
+			PrivateDefinitions.Add("RTIMAGEIMPORT_WITH_LIBJPEGTURBO=1");
+		}
+		else
+		{
+			PrivateDefinitions.Add("RTIMAGEIMPORT_WITH_LIBJPEGTURBO=0");
+		}
+
+		// libtiff is used directly for strip and tile parallel decoding, on the platforms the engine ships it for
+		if (Target.Platform == UnrealTargetPlatform.Win64 || Target.Platform == UnrealTargetPlatform.Mac || Target.Platform == UnrealTargetPlatform.Linux)
+		{
+			AddEngineThirdPartyPrivateStaticDependencies(Target, "LibTiff");
+			PrivateDefinitions.Add("RTIMAGEIMPORT_WITH_LIBTIFF=1");
+		}
+		else
+		{
+			PrivateDefinitions.Add("RTIMAGEIMPORT_WITH_LIBTIFF=0");
+		}
+
+
 		DynamicallyLoadedModuleNames.AddRange(
 			new string[]
 			{